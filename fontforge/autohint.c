@@ -1894,7 +1894,8 @@ return( into );
 
 static void __SplineCharAutoHint( SplineChar *sc, int layer, BlueData *bd, int gen_undoes );
 
-static void AutoHintRefs(SplineChar *sc,int layer, BlueData *bd, int picky, int gen_undoes) {
+static void AutoHintRefs(SplineChar *sc,int layer, BlueData *bd, int picky,
+	int gen_undoes, int notify) {
     RefChar *ref;
 
     /* Add hints for base characters before accent hints => if there are any */
@@ -1905,7 +1906,7 @@ static void AutoHintRefs(SplineChar *sc,int layer, BlueData *bd, int picky, int
 		if ( !ref->sc->manualhints && ref->sc->changedsincelasthinted &&
 			(ref->sc->layers[layer].refs!=NULL &&
 			 ref->sc->layers[layer].splines==NULL))
-		    AutoHintRefs(ref->sc,layer,bd,true,gen_undoes);
+		    AutoHintRefs(ref->sc,layer,bd,true,gen_undoes,notify);
 	    } else if ( !ref->sc->manualhints && ref->sc->changedsincelasthinted )
 		__SplineCharAutoHint(ref->sc,layer,bd,gen_undoes);
 	    if ( ref->sc->unicodeenc!=-1 && ref->sc->unicodeenc<0x10000 &&
@@ -1930,8 +1931,10 @@ static void AutoHintRefs(SplineChar *sc,int layer, BlueData *bd, int picky, int
     sc->vconflicts = StemListAnyConflicts(sc->vstem);
     sc->hconflicts = StemListAnyConflicts(sc->hstem);
 
-    SCOutOfDateBackground(sc);
-    SCHintsChanged(sc);
+    if ( notify ) {
+	SCOutOfDateBackground(sc);
+	SCHintsChanged(sc);
+    }
 }
 
 void SCClearHints(SplineChar *sc) {
@@ -2907,8 +2910,10 @@ static DStemInfo *GDFindDStems(struct glyphdata *gd) {
 return( head );
 }
 
-void _SplineCharAutoHint( SplineChar *sc, int layer, BlueData *bd, struct glyphdata *gd2,
-	int gen_undoes ) {
+/* If notify is false we don't tell the ui about the new hints. The caller */
+/*  must do that itself (this is what lets us hint glyphs in worker threads) */
+static void _SCAutoHint( SplineChar *sc, int layer, BlueData *bd, struct glyphdata *gd2,
+	int gen_undoes, int notify ) {
     struct glyphdata *gd;
 
     if ( gen_undoes )
@@ -2935,7 +2940,12 @@ void _SplineCharAutoHint( SplineChar *sc, int layer, BlueData *bd, struct glyphd
 	if ( gd2==NULL ) GlyphDataFree(gd);
     }
 
-    AutoHintRefs(sc,layer,bd,false,gen_undoes);
+    AutoHintRefs(sc,layer,bd,false,gen_undoes,notify);
+}
+
+void _SplineCharAutoHint( SplineChar *sc, int layer, BlueData *bd, struct glyphdata *gd2,
+	int gen_undoes ) {
+    _SCAutoHint(sc,layer,bd,gd2,gen_undoes,true);
 }
 
 static void __SplineCharAutoHint( SplineChar *sc, int layer, BlueData *bd, int gen_undoes ) {
@@ -2972,6 +2982,126 @@ return;
     SplineCharAutoHint(sc,layer,bd);
 }
 
+/* Multi-threaded autohinting. A glyph's hints depend on its own outlines */
+/*  and on the hints of the glyphs it refers to (AutoHintRefs merges those */
+/*  in) and on nothing else. So we sort the glyphs into generations where */
+/*  a glyph always comes after anything it refers to, and hint all the glyphs */
+/*  of one generation at the same time. The ui gets told about the changes */
+/*  afterwards in the same order, so the result is just what we'd get if */
+/*  we had called SFSCAutoHint on each glyph */
+struct ahthreads {
+    SplineChar **glyphs;
+    char *done;
+    int layer;
+    BlueData *bd;
+};
+
+static void AHThreadedGlyph(void *data,int i) {
+    struct ahthreads *aht = data;
+    SplineChar *sc = aht->glyphs[i];
+
+    _SCAutoHint(sc,aht->layer,aht->bd,NULL,true,false);
+    SCFigureHintMasks(sc,aht->layer);
+    aht->done[i] = true;
+}
+
+/* When AutoHintRefs finds an unhinted reference it hints that too. Make */
+/*  sure all such references are in our list (unticked) up front, so that */
+/*  the worker threads never have to do it themselves */
+static void AHAddRefs(SplineChar *sc,int layer) {
+    RefChar *ref;
+
+    for ( ref=sc->layers[layer].refs; ref!=NULL; ref=ref->next ) {
+	if ( ref->transform[1]==0 && ref->transform[2]==0 &&
+		ref->sc->ticked && !ref->sc->manualhints &&
+		ref->sc->changedsincelasthinted ) {
+	    ref->sc->ticked = false;
+	    AHAddRefs(ref->sc,layer);
+	}
+    }
+}
+
+static int AHGeneration(SplineChar *sc,int layer,int *gens) {
+    RefChar *ref;
+    int g, gen = 0;
+
+    if ( gens[sc->orig_pos]!=-1 )
+return( gens[sc->orig_pos] );		/* -2 => we're in a reference loop */
+    gens[sc->orig_pos] = -2;
+    for ( ref=sc->layers[layer].refs; ref!=NULL; ref=ref->next ) if ( !ref->sc->ticked ) {
+	if ( (g = AHGeneration(ref->sc,layer,gens))<0 )
+return( -2 );
+	if ( g+1>gen )
+	    gen = g+1;
+    }
+    gens[sc->orig_pos] = gen;
+return( gen );
+}
+
+/* AutoHints every glyph in sf which is not ticked, using up to threads */
+/*  worker threads. Returns false if the user cancelled */
+int SFAutoHintUntickedThreaded( SplineFont *sf, int layer, BlueData *bd, int threads ) {
+    int gid, g, i, cnt, total, maxgen, ok = true;
+    int *gens;
+    char *done;
+    SplineChar *sc, **glyphs;
+    struct ahthreads aht;
+
+    for ( gid=0; gid<sf->glyphcnt; ++gid ) if ( (sc = sf->glyphs[gid])!=NULL && !sc->ticked )
+	AHAddRefs(sc,layer);
+
+    gens = galloc(sf->glyphcnt*sizeof(int));
+    for ( gid=0; gid<sf->glyphcnt; ++gid )
+	gens[gid] = -1;
+    total = maxgen = 0;
+    for ( gid=0; gid<sf->glyphcnt; ++gid ) if ( (sc = sf->glyphs[gid])!=NULL && !sc->ticked ) {
+	if ( (g = AHGeneration(sc,layer,gens))<0 )
+    break;
+	if ( g>maxgen )
+	    maxgen = g;
+	++total;
+    }
+    if ( gid<sf->glyphcnt || sf->mm!=NULL || threads<=1 ) {
+	/* Reference loop (shouldn't happen) or something too odd, do it the */
+	/*  old way */
+	free(gens);
+	for ( gid=0; gid<sf->glyphcnt; ++gid ) if ( (sc = sf->glyphs[gid])!=NULL && !sc->ticked ) {
+	    SFSCAutoHint(sc,layer,bd);
+	    if ( !ff_progress_next())
+return( false );
+	}
+return( true );
+    }
+
+    glyphs = galloc(total*sizeof(SplineChar *));
+    done = gcalloc(total,sizeof(char));
+    memset(&aht,0,sizeof(aht));
+    aht.layer = layer;
+    aht.bd = bd;
+    total = 0;
+    for ( g=0; g<=maxgen && ok; ++g ) {
+	cnt = 0;
+	for ( gid=0; gid<sf->glyphcnt; ++gid ) if ( gens[gid]==g )
+	    glyphs[total+cnt++] = sf->glyphs[gid];
+	aht.glyphs = glyphs+total;
+	aht.done = done+total;
+	ok = ThreadedForEach(cnt,threads,true,AHThreadedGlyph,&aht);
+	total += cnt;
+    }
+
+    for ( i=0; i<total; ++i ) if ( done[i] ) {
+	sc = glyphs[i];
+	sc->ticked = true;
+	SCOutOfDateBackground(sc);
+	SCHintsChanged(sc);
+	SCUpdateAll(sc);
+    }
+    free(done);
+    free(glyphs);
+    free(gens);
+return( ok );
+}
+
 int SFNeedsAutoHint( SplineFont *_sf,int layer) {
     int i,k;
     SplineFont *sf;
@@ -2989,7 +3119,7 @@ return( true );
 return( false );
 }
     
-void SplineFontAutoHint( SplineFont *_sf,int layer) {
+void _SplineFontAutoHint( SplineFont *_sf,int layer,int threads) {
     int i,k;
     SplineFont *sf;
     BlueData *bd = NULL, _bd;
@@ -3009,6 +3139,17 @@ void SplineFontAutoHint( SplineFont *_sf,int layer) {
 	++k;
     } while ( k<_sf->subfontcnt );
 
+    if ( threads>1 && _sf->mm==NULL ) {
+	k=0;
+	do {
+	    sf = _sf->subfontcnt==0 ? _sf : _sf->subfonts[k];
+	    if ( !SFAutoHintUntickedThreaded(sf,layer,bd,threads))
+	break;
+	    ++k;
+	} while ( k<_sf->subfontcnt );
+return;
+    }
+
     k=0;
     do {
 	sf = _sf->subfontcnt==0 ? _sf : _sf->subfonts[k];
@@ -3025,6 +3166,10 @@ void SplineFontAutoHint( SplineFont *_sf,int layer) {
     } while ( k<_sf->subfontcnt );
 }
 
+void SplineFontAutoHint( SplineFont *_sf,int layer) {
+    _SplineFontAutoHint(_sf,layer,1);
+}
+
 void SplineFontAutoHintRefs( SplineFont *_sf,int layer) {
     int i,k;
     SplineFont *sf;
@@ -3046,7 +3191,7 @@ void SplineFontAutoHintRefs( SplineFont *_sf,int layer) {
 		SCPreserveHints(sc,layer);
 		StemInfosFree(sc->vstem); sc->vstem=NULL;
 		StemInfosFree(sc->hstem); sc->hstem=NULL;
-		AutoHintRefs(sc,layer,bd,true,true);
+		AutoHintRefs(sc,layer,bd,true,true,true);
 	    }
 	}
 	++k;
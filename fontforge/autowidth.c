@@ -1487,6 +1487,7 @@ return;
 	if ( any1 && any2 ) {
 	    vkc = chunkalloc(sizeof(KernClass));
 	    *vkc = *kc;
+	    vkc->firstidx = vkc->secondidx = NULL;
 	    vkc->subtable = VSubtableFromH(&lookupmap,kc->subtable);
 	    vkc->subtable->kc = vkc;
 	    vkc->next = sf->vkerns;
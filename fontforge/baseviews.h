@@ -305,6 +305,10 @@ extern void FVOverlap(FontViewBase *fv,enum overlap_type ot);
 extern void FVAddExtrema(FontViewBase *fv);
 extern void FVCorrectDir(FontViewBase *fv);
 extern void FVRound2Int(FontViewBase *fv,real factor);
+extern void _FVRound2Int(FontViewBase *fv,int layer,int all,int undoes,real factor);
+extern void FVGlyphBatch(FontViewBase *fv,int layer,int all,const char *title,
+	void (*prepare)(SplineChar *sc,int layer,void *data),
+	void (*func)(SplineChar *sc,int layer,void *data),void *data);
 extern void FVCanonicalStart(FontViewBase *fv);
 extern void FVCanonicalContours(FontViewBase *fv);
 extern void FVCluster(FontViewBase *fv);
@@ -312,10 +316,12 @@ extern void CIDSetEncMap(FontViewBase *fv, SplineFont *new );
 extern void FVInsertInCID(FontViewBase *fv,SplineFont *sf);
 
 extern void FVAutoHint(FontViewBase *fv);
+extern void _FVAutoHint(FontViewBase *fv,int threads);
 extern void FVAutoHintSubs(FontViewBase *fv);
 extern void FVAutoCounter(FontViewBase *fv);
 extern void FVDontAutoHint(FontViewBase *fv);
 extern void FVAutoInstr(FontViewBase *fv);
+extern void _FVAutoInstr(FontViewBase *fv,int threads);
 extern void FVClearInstrs(FontViewBase *fv);
 extern void FVClearHints(FontViewBase *fv);
 extern void SCAutoTrace(SplineChar *sc,int layer, int ask);
@@ -582,6 +588,7 @@ extern uint8 *_IVParse(SplineFont *sf, char *text, int *len,
 extern char *_IVUnParseInstrs(uint8 *instrs,int instr_cnt);
 
 extern int BitmapControl(FontViewBase *fv,int32 *sizes,int isavail,int rasterize);
+extern int _BitmapControl(FontViewBase *fv,int32 *sizes,int isavail,int rasterize,int threads);
 extern void FVSetWidthScript(FontViewBase *fv,enum widthtype wtype,int val,int incr);
 extern void FVMetricsCenter(FontViewBase *fv,int docenter);
 extern void FVRevert(FontViewBase *fv);
@@ -95,34 +95,38 @@ static void SFRemoveUnwantedBitmaps(SplineFont *sf,int32 *sizes) {
     }
 }
 
-static void SFFigureBitmaps(SplineFont *sf,int32 *sizes,int usefreetype,int rasterize,int layer) {
-    BDFFont *bdf;
-    int i, first;
-    void *freetypecontext = NULL;
+static void SFFigureBitmaps(SplineFont *sf,int32 *sizes,int usefreetype,int rasterize,int layer,int threads) {
+    BDFFont **bdfs;
+    int32 *wanted;
+    int i, cnt;
 
     SFRemoveUnwantedBitmaps(sf,sizes);
 
-    first = true;
-    for ( i=0; sizes[i]!=0 ; ++i ) if ( sizes[i]>0 ) {
-	if ( first && autohint_before_generate )
+    for ( i=cnt=0; sizes[i]!=0 ; ++i ) if ( sizes[i]>0 )
+	++cnt;
+    if ( cnt!=0 ) {
+	wanted = galloc(cnt*sizeof(int32));
+	bdfs = galloc(cnt*sizeof(BDFFont *));
+	for ( i=cnt=0; sizes[i]!=0 ; ++i ) if ( sizes[i]>0 )
+	    wanted[cnt++] = sizes[i];
+	if ( autohint_before_generate )
 	    SplineFontAutoHint(sf,layer);
-	if ( first && usefreetype )
-	    freetypecontext = FreeTypeFontContext(sf,NULL,NULL,layer);
-	if ( !rasterize )
-	    bdf = BDFNew(sf,sizes[i]&0xffff,sizes[i]>>16);
-	else if ( freetypecontext )
-	    bdf = SplineFontFreeTypeRasterize(freetypecontext,sizes[i]&0xffff,sizes[i]>>16);
-	else if ( usefreetype )
-	    bdf = SplineFontFreeTypeRasterizeNoHints(sf,layer,sizes[i]&0xffff,sizes[i]>>16);
-	else
-	    bdf = SplineFontAntiAlias(sf,layer,sizes[i]&0xffff,1<<((sizes[i]>>16)/2));
-	bdf->next = sf->bitmaps;
-	sf->bitmaps = bdf;
+	if ( !rasterize ) {
+	    for ( i=0; i<cnt; ++i )
+		bdfs[i] = BDFNew(sf,wanted[i]&0xffff,wanted[i]>>16);
+	} else
+	    /* All the strikes at once, so their glyphs can be shared out */
+	    /*  between threads */
+	    SplineFontRasterizeStrikes(sf,layer,wanted,cnt,usefreetype,
+		    ThreadCount(threads),bdfs);
+	for ( i=0; i<cnt; ++i ) {
+	    bdfs[i]->next = sf->bitmaps;
+	    sf->bitmaps = bdfs[i];
+	}
 	sf->changed = true;
-	first = false;
+	free(bdfs);
+	free(wanted);
     }
-    if ( freetypecontext )
-	FreeTypeFreeContext(freetypecontext);
 
     /* Order the list */
     SFOrderBitmapList(sf);
@@ -319,7 +323,7 @@ void BitmapsDoIt(CreateBitmapData *bd,int32 *sizes,int usefreetype) {
     else if ( bd->isavail && bd->sf->onlybitmaps && bd->sf->bitmaps!=NULL )
 	FVScaleBitmaps(bd->fv,sizes,bd->rasterize);
     else if ( bd->isavail ) {
-	SFFigureBitmaps(bd->sf,sizes,usefreetype,bd->rasterize,bd->layer);
+	SFFigureBitmaps(bd->sf,sizes,usefreetype,bd->rasterize,bd->layer,bd->threads);
 	/* If we had an empty font, to which we've just added bitmaps, then */
 	/*  presumably we should treat this as a bitmap font and switch the */
 	/*  fontview so that it shows one of the bitmaps */
@@ -342,7 +346,7 @@ return;
 }
 
 
-int BitmapControl(FontViewBase *fv,int32 *sizes,int isavail,int rasterize) {
+int _BitmapControl(FontViewBase *fv,int32 *sizes,int isavail,int rasterize,int threads) {
     CreateBitmapData bd;
 
     memset(&bd,0,sizeof(bd));
@@ -352,6 +356,11 @@ int BitmapControl(FontViewBase *fv,int32 *sizes,int isavail,int rasterize) {
     bd.which = bd_selected;
     bd.rasterize = rasterize;
     bd.layer = fv->active_layer;
+    bd.threads = threads;
     BitmapsDoIt(&bd,sizes,hasFreeType());
 return( bd.done );
 }
+
+int BitmapControl(FontViewBase *fv,int32 *sizes,int isavail,int rasterize) {
+return( _BitmapControl(fv,sizes,isavail,rasterize,0));
+}
@@ -33,6 +33,7 @@ typedef struct createbitmapdata {
     int isavail;
     int which;
     int rasterize;
+    int threads;		/* Strikes rasterized at once, 0 => ThreadCount preference */
     unsigned int done: 1;
 } CreateBitmapData;
 
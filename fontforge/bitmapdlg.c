@@ -275,6 +275,7 @@ void BitmapDlg(FontView *fv,SplineChar *sc, int isavail) {
     bd.bd.layer = fv!=NULL ? fv->b.active_layer : ly_fore;
     bd.bd.sf = fv->b.cidmaster ? fv->b.cidmaster : fv->b.sf;
     bd.bd.isavail = isavail;
+    bd.bd.threads = 0;
     bd.bd.done = false;
 
     for ( bdf=bd.bd.sf->bitmaps, i=0; bdf!=NULL; bdf=bdf->next, ++i );
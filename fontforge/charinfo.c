@@ -1588,6 +1588,7 @@ static void CI_ApplyAll(CharInfo *ci) {
     SplineChar *cached, *sc;
     SplineFont *sf = ci->sc->parent;
     FontView *fvs;
+    struct altuni *alt;
 
     for ( scl = ci->changes; scl!=NULL; scl=scl->next ) {
 	cached = scl->sc;
@@ -1606,7 +1607,6 @@ static void CI_ApplyAll(CharInfo *ci) {
 	    struct splinecharlist *scl;
 	    int layer;
 	    RefChar *ref;
-	    struct altuni *alt;
 
 	    /* All references need the new unicode value */
 	    for ( scl=sc->dependents; scl!=NULL; scl=scl->next ) {
@@ -1622,6 +1622,7 @@ static void CI_ApplyAll(CharInfo *ci) {
 	    if ( alt!=NULL )	/* alt->unienc==new value */
 		alt->unienc = sc->unicodeenc;
 	    sc->unicodeenc = cached->unicodeenc;
+	    SFHashUnicode(sf,sc,sc->unicodeenc);
 	}
 	free(sc->comment); sc->comment = copy(cached->comment);
 	sc->unlink_rm_ovrlp_save_undo = cached->unlink_rm_ovrlp_save_undo;
@@ -1653,6 +1654,8 @@ static void CI_ApplyAll(CharInfo *ci) {
 	AltUniFree(sc->altuni);
 	sc->altuni = cached->altuni;
 	cached->altuni = NULL;
+	for ( alt=sc->altuni; alt!=NULL; alt=alt->next )
+	    SFHashUnicode(sf,sc,alt->unienc);
 	sc->lig_caret_cnt_fixed = cached->lig_caret_cnt_fixed;
 	PSTFree(sc->possub);
 	sc->possub = cached->possub;
@@ -227,6 +227,7 @@
 /* If there is no ungif library (or if it is out of date) define _NO_LIBUNGIF */
 /* If there is no png (or z) library define _NO_LIBPNG			      */
 /* If there libpng is version 1.2 define _LIBPNG12			      */
+/* If there is no bzip2 library define _NO_LIBBZ2			      */
 /* If there is no jpeg library define _NO_LIBJPEG			      */
 /* If there is no tiff library define _NO_LIBTIFF			      */
 /* If there is no xml2 library define _NO_LIBXML			      */
@@ -236,6 +237,8 @@
 /*  with a dynamic loader) then define _STATIC_LIBUNGIF, etc.		      */
 
 /* If there is no snprintf define _NO_SNPRINTF				      */
+/* If there is no open_memstream define _NO_OPEN_MEMSTREAM		      */
+/* If there is no fopencookie define _NO_FOPENCOOKIE			      */
 
 /* If the XInput extension is not available define _NO_XINPUT		      */
 /* If the Xkb extension is not available define _NO_XKB			      */
@@ -982,6 +982,7 @@ static void _CCD_Ok(struct contextchaindlg *ccd) {
 
     buts[0] = _("_Yes"); buts[1] = _("_No"); buts[2] = NULL;
 
+    FPSTClearIndex(fpst);
     switch ( ccd->aw ) {
       case aw_grules: {
 	old = GMatrixEditGet(GWidgetGetControl(ccd->gw,CID_GList),&len);
@@ -1089,6 +1090,7 @@ return;
 	}
 	dummyfpst = chunkalloc(sizeof(FPST));
 	*dummyfpst = *fpst;
+	dummyfpst->nclassidx = dummyfpst->bclassidx = dummyfpst->fclassidx = NULL;
 	dummyfpst->format = pst_glyphs;
 	if ( ccd->aw==aw_classes_simple ) {
 	    dummyfpst->format = pst_class;
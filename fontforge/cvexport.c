@@ -77,11 +77,10 @@ int _ExportEPS(FILE *eps,SplineChar *sc, int layer, int preview) {
     time_t now;
     struct tm *tm;
     int ret;
-    char oldloc[24];
+    CLocaleSave oldloc;
     const char *author = GetAuthor();
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
 
     fprintf( eps, "%%!PS-Adobe-3.0 EPSF-3.0\n" );
     SplineCharLayerFindBounds(sc,layer,&b);
@@ -131,7 +130,7 @@ int _ExportEPS(FILE *eps,SplineChar *sc, int layer, int preview) {
 	fprintf( eps, "fill grestore\n" );
     fprintf( eps, "%%%%EOF\n" );
     ret = !ferror(eps);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 return( ret );
 }
 
@@ -153,15 +152,14 @@ int _ExportPDF(FILE *pdf,SplineChar *sc,int layer) {
     time_t now;
     struct tm *tm;
     int ret;
-    char oldloc[24];
+    CLocaleSave oldloc;
     int _objlocs[8], xrefloc, streamstart, streamlength, resid, nextobj;
     int *objlocs = _objlocs;
     const char *author = GetAuthor();
     int i;
 
     SFUntickAll(sc->parent);
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
 
     fprintf( pdf, "%%PDF-1.4\n%%\201\342\202\203\n" );	/* Header comment + binary comment */
     /* Every document contains a catalog which points to a page tree, which */
@@ -272,7 +270,7 @@ int _ExportPDF(FILE *pdf,SplineChar *sc,int layer) {
 	free(objlocs);
 
     ret = !ferror(pdf);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 return( ret );
 }
 
@@ -291,14 +289,13 @@ return( ret );
 
 
 int _ExportPlate(FILE *plate,SplineChar *sc,int layer) {
-    char oldloc[24];
+    CLocaleSave oldloc;
     int do_open;
     SplineSet *ss;
     spiro_cp *spiros;
     int i, ret;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     /* Output closed contours first, then open. Plate files can only handle */
     /*  one open contour (I think) and it must be at the end */
     fprintf( plate, "(plate\n" );
@@ -330,7 +327,7 @@ int _ExportPlate(FILE *plate,SplineChar *sc,int layer) {
     }
     fprintf(plate, ")\n");
     ret = !ferror(plate);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 return( ret );
 }
 
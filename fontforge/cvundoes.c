@@ -960,6 +960,7 @@ static void SCUndoAct(SplineChar *sc,int layer, Undoes *undo) {
 	    undo->u.state.charname = temp;
 	    sc->unicodeenc = undo->u.state.unicodeenc;
 	    undo->u.state.unicodeenc = uni;
+	    SFHashUnicode(sc->parent,sc,sc->unicodeenc);
 	    sc->possub = undo->u.state.possub;
 	    undo->u.state.possub = possub;
 	    sc->comment = undo->u.state.comment;
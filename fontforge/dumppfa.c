@@ -38,6 +38,9 @@
 #endif
 #include <stdarg.h>
 #include <time.h>
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
 #include "psfont.h"
 #include "splinefont.h"
 #ifdef FONTFORGE_CONFIG_TYPE3
@@ -1807,10 +1810,21 @@ const char *GetAuthor(void) {
     struct passwd *pwd;
     static char author[200] = { '\0' };
     const char *ret = NULL, *pt;
+#ifdef HAVE_PTHREAD_H
+    /* getpwuid's result is shared, and fonts may be saved on several threads */
+    static pthread_mutex_t pwd_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&pwd_lock);
+    if ( author[0]!='\0' ) {
+	pthread_mutex_unlock(&pwd_lock);
+return( author );
+    }
+#else
     if ( author[0]!='\0' )
 return( author );
-
+#endif
 /* Can all be commented out if no pwd routines */
     pwd = getpwuid(getuid());
 #ifndef __VMS
@@ -1832,6 +1846,9 @@ return( author );
     }
     endpwent();
 /* End comment */
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&pwd_lock);
+#endif
 return( ret );
 #endif
 }
@@ -1839,6 +1856,7 @@ return( ret );
 static void dumpfontcomments(void (*dumpchar)(int ch,void *data), void *data,
 	SplineFont *sf, int format ) {
     time_t now;
+    char timebuf[32];
     const char *author = GetAuthor();
 
     time(&now);
@@ -1856,7 +1874,13 @@ static void dumpfontcomments(void (*dumpchar)(int ch,void *data), void *data,
 	dumpf(dumpchar,data,"%%%%Title: %s\n", sf->fontname);
 	dumpf(dumpchar,data,"%%Version: %s\n", sf->version);
     }
-    dumpf(dumpchar,data,"%%%%CreationDate: %s", ctime(&now));
+#if defined(__MINGW32__)
+    strncpy(timebuf,ctime(&now),sizeof(timebuf));
+    timebuf[sizeof(timebuf)-1] = '\0';
+#else
+    ctime_r(&now,timebuf);
+#endif
+    dumpf(dumpchar,data,"%%%%CreationDate: %s", timebuf);
     if ( author!=NULL )
 	dumpf(dumpchar,data,"%%%%Creator: %s\n", author);
 
@@ -2711,7 +2735,7 @@ return( !cidbytes.errors );
 
 int _WritePSFont(FILE *out,SplineFont *sf,enum fontformat format,int flags,
 	EncMap *map, SplineFont *fullsf,int layer) {
-    char oldloc[24];
+    CLocaleSave oldloc;
     int err = false;
     extern const char **othersubrs[];
 
@@ -2721,8 +2745,7 @@ int _WritePSFont(FILE *out,SplineFont *sf,enum fontformat format,int flags,
 	flags &= ~ps_flag_noflex;
 
     /* make sure that all reals get output with '.' for decimal points */
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     if ( (format==ff_mma || format==ff_mmb) && sf->mm!=NULL )
 	sf = sf->mm->normal;
     if ( format==ff_cid )
@@ -2732,7 +2755,7 @@ int _WritePSFont(FILE *out,SplineFont *sf,enum fontformat format,int flags,
 	if ( format==ff_ptype0 )
 	    dumptype0stuff(out,sf,map);
     }
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     if ( ferror(out) || err)
 return( 0 );
 
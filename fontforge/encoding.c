@@ -35,6 +35,14 @@
 #include <gfile.h>
 #include "plugins.h"
 #include "encoding.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+#if !defined(__MINGW32__) && !defined(__VMS)
+# include <sys/mman.h>
+#endif
 
 Encoding *default_encoding = NULL;
 
@@ -122,6 +130,39 @@ static Encoding symbol = { "Symbol", 256, unicode_from_MacSymbol, NULL, &adobest
 
 Encoding *enclist = &symbol;
 
+/* Encodings and cid maps are shared by all fonts and are filled in as they */
+/*  are needed. When fonts are worked on from several threads only one at a */
+/*  time may do that */
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t enc_lock;
+static pthread_once_t enc_lock_once = PTHREAD_ONCE_INIT;
+
+static void EncLockInit(void) {
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&enc_lock,&attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static int EncLock(void) {
+    if ( !ff_threads_active )
+return( false );
+    pthread_once(&enc_lock_once,EncLockInit);
+    pthread_mutex_lock(&enc_lock);
+return( true );
+}
+
+static void EncUnlock(int locked) {
+    if ( locked )
+	pthread_mutex_unlock(&enc_lock);
+}
+#else
+# define EncLock()		0
+# define EncUnlock(locked)
+#endif
+
 const char *FindUnicharName(void) {
     /* Iconv and libiconv use different names for UCS2. Just great. Perhaps */
     /*  different versions of each use still different names? */
@@ -233,7 +274,7 @@ static int TryEscape( Encoding *enc,char *escape_sequence ) {
 return( enc->has_2byte );
 }
 
-Encoding *_FindOrMakeEncoding(const char *name,int make_it) {
+static Encoding *FindOrMakeEncodingNoLock(const char *name,int make_it) {
     Encoding *enc;
     char buffer[20];
     const char *iconv_name;
@@ -436,12 +477,20 @@ return( NULL );
 return( enc );
 }
 
+Encoding *_FindOrMakeEncoding(const char *name,int make_it) {
+    int locked = EncLock();
+    Encoding *enc = FindOrMakeEncodingNoLock(name,make_it);
+
+    EncUnlock(locked);
+return( enc );
+}
+
 Encoding *FindOrMakeEncoding(const char *name) {
 return( _FindOrMakeEncoding(name,true));
 }
 
 /* Plugin API */
-int AddEncoding(char *name,EncFunc enc_to_uni,EncFunc uni_to_enc,int max) {
+static int AddEncodingNoLock(char *name,EncFunc enc_to_uni,EncFunc uni_to_enc,int max) {
     Encoding *enc;
     int i;
 
@@ -484,6 +533,14 @@ return( 0 );			/* Failure */
 return( 1 );
 }
 
+int AddEncoding(char *name,EncFunc enc_to_uni,EncFunc uni_to_enc,int max) {
+    int locked = EncLock();
+    int ret = AddEncodingNoLock(name,enc_to_uni,uni_to_enc,max);
+
+    EncUnlock(locked);
+return( ret );
+}
+
 static char *getPfaEditEncodings(void) {
     static char *encfile=NULL;
     char buffer[1025];
@@ -500,6 +557,7 @@ return( encfile );
 static void EncodingFree(Encoding *item) {
     int i;
 
+    EncodingRevMapsFree(item);
     free(item->enc_name);
     if ( item->psnames!=NULL ) for ( i=0; i<item->char_cnt; ++i )
 	free(item->psnames[i]);
@@ -719,6 +777,103 @@ return;
 /* ************************************************************************** */
 /* ****************************** CID Encodings ***************************** */
 /* ************************************************************************** */
+static int32 RevMapNameKey(const char *name) {
+    uint32 val = 0;
+
+    while ( *name )
+	val = val*31 + (unsigned char) *name++;
+return( val&0x7fffffff );
+}
+
+static struct enc_revmap *RevMapNew(int cnt) {
+    struct enc_revmap *rm = gcalloc(1,sizeof(struct enc_revmap));
+    int i;
+
+    for ( rm->size=64; rm->size<2*cnt; rm->size<<=1 );
+    rm->keys = galloc(rm->size*sizeof(int32));
+    rm->vals = galloc(rm->size*sizeof(int32));
+    for ( i=0; i<rm->size; ++i )
+	rm->vals[i] = -1;
+return( rm );
+}
+
+static void RevMapFree(struct enc_revmap *rm) {
+    if ( rm==NULL )
+return;
+    free(rm->keys);
+    free(rm->vals);
+    free(rm);
+}
+
+static void RevMapAdd(struct enc_revmap *rm,int32 key,int32 val) {
+    int i, j, start, old_size;
+    int32 *old_keys, *old_vals;
+
+    if ( 2*(rm->cnt+1)>rm->size ) {
+	/* Entries which share a key must stay in the order they were added. */
+	/*  Within a run of full slots they are, so re-add the runs starting */
+	/*  just after an empty slot (there always is one) */
+	old_size = rm->size; old_keys = rm->keys; old_vals = rm->vals;
+	rm->size <<= 1; rm->cnt = 0;
+	rm->keys = galloc(rm->size*sizeof(int32));
+	rm->vals = galloc(rm->size*sizeof(int32));
+	for ( i=0; i<rm->size; ++i )
+	    rm->vals[i] = -1;
+	for ( start=0; old_vals[start]!=-1; ++start );
+	for ( i=1; i<=old_size; ++i ) {
+	    j = (start+i)&(old_size-1);
+	    if ( old_vals[j]!=-1 )
+		RevMapAdd(rm,old_keys[j],old_vals[j]);
+	}
+	free(old_keys); free(old_vals);
+    }
+    for ( i=key&(rm->size-1); rm->vals[i]!=-1; i=(i+1)&(rm->size-1) );
+    rm->keys[i] = key;
+    rm->vals[i] = val;
+    ++rm->cnt;
+}
+
+/* Returns the next value stored under key, starting with the first one */
+/*  added when *slot is -1. Returns -1 when there are no more */
+static int32 RevMapNext(struct enc_revmap *rm,int32 key,int *slot) {
+    int i;
+
+    i = *slot==-1 ? key&(rm->size-1) : ((*slot+1)&(rm->size-1));
+    for ( ; rm->vals[i]!=-1; i=(i+1)&(rm->size-1) ) {
+	if ( rm->keys[i]==key ) {
+	    *slot = i;
+return( rm->vals[i] );
+	}
+    }
+return( -1 );
+}
+
+static void CIDMapHash(struct cidmap *map) {
+    struct cidaltuni *alts;
+    int i, cnt;
+
+    if ( map->namemax==0 )
+return;
+    for ( i=cnt=0; i<map->namemax; ++i )
+	if ( map->unicode[i]!=0 ) ++cnt;
+    for ( alts=map->alts; alts!=NULL; alts=alts->next )
+	++cnt;
+    map->unirev = RevMapNew(cnt);
+    /* NameUni2CID prefers the main unicode value to the alternates */
+    for ( i=0; i<map->namemax; ++i )
+	if ( map->unicode[i]!=0 )
+	    RevMapAdd(map->unirev,map->unicode[i],i);
+    for ( alts=map->alts; alts!=NULL; alts=alts->next )
+	RevMapAdd(map->unirev,alts->uni,alts->cid);
+
+    for ( i=cnt=0; i<map->namemax; ++i )
+	if ( map->name[i]!=NULL ) ++cnt;
+    map->namerev = RevMapNew(cnt);
+    for ( i=0; i<map->namemax; ++i )
+	if ( map->name[i]!=NULL )
+	    RevMapAdd(map->namerev,RevMapNameKey(map->name[i]),i);
+}
+
 struct cidmap *cidmaps = NULL;
 
 int CIDFromName(char *name,SplineFont *cidmaster) {
@@ -807,18 +962,27 @@ return( enc );
 }
 
 int NameUni2CID(struct cidmap *map,int uni, const char *name) {
-    int i;
+    int i, slot;
     struct cidaltuni *alts;
 
     if ( map==NULL )
 return( -1 );
     if ( uni!=-1 ) {
+	if ( uni!=0 && map->unirev!=NULL ) {
+	    slot = -1;
+return( RevMapNext(map->unirev,uni,&slot));
+	}
 	for ( i=0; i<map->namemax; ++i )
 	    if ( map->unicode[i]==uni )
 return( i );
 	for ( alts=map->alts; alts!=NULL; alts=alts->next )
 	    if ( alts->uni==uni )
 return( alts->cid );
+    } else if ( map->namerev!=NULL ) {
+	slot = -1;
+	while ( (i=RevMapNext(map->namerev,RevMapNameKey(name),&slot))!=-1 )
+	    if ( strcmp(map->name[i],name)==0 )
+return( i );
     } else {
 	for ( i=0; i<map->namemax; ++i )
 	    if ( map->name[i]!=NULL && strcmp(map->name[i],name)==0 )
@@ -935,11 +1099,262 @@ static struct cidmap *MakeDummyMap(char *registry,char *ordering,int supplement)
     ret->cidmax = ret->namemax = 0;
     ret->unicode = NULL; ret->name = NULL;
     ret->alts = NULL;
+    ret->unirev = ret->namerev = NULL;
     ret->next = cidmaps;
     cidmaps = ret;
 return( ret );
 }
 
+/* Parsing the text cidmap files is slow (Adobe-Japan1 has 23000 cids), so */
+/*  the first time we read one we save a binary copy, with its hash tables, */
+/*  in ~/.FontForge/cidcache. Later that is mapped into memory and used as */
+/*  it stands. The copy remembers the full name, size and date of the text */
+/*  file, and is ignored if the text file changes (or if it was written on */
+/*  a machine with a different byte order). Anything in it which doesn't */
+/*  make sense makes us ignore it too, it's only a cache */
+#define CIDCACHE_MAGIC		0x46464d43	/* FFMC */
+#define CIDCACHE_VERSION	2
+
+struct cidcache_header {
+    int32 magic, version;
+    int32 byteorder;		/* 0x01020304 as written */
+    int32 srcsize, srcmtime;
+    int32 cidmax, namemax;
+    int32 altcnt;
+    int32 unirevsize, unirevcnt;
+    int32 namerevsize, namerevcnt;
+    int32 poolsize;
+    int32 pathlen;
+};
+/* Followed by: */
+/*  uint32 unicode[namemax+1] */
+/*  int32 nameoffsets[namemax+1]	(into the pool, -1 for no name) */
+/*  int32 alts[2*altcnt]		(uni, cid, in the order of the alts list) */
+/*  int32 unirevkeys[unirevsize], unirevvals[unirevsize] */
+/*  int32 namerevkeys[namerevsize], namerevvals[namerevsize] */
+/*  char pool[poolsize]			(NUL terminated names) */
+/*  char path[pathlen]			(NUL terminated full name of the text file) */
+
+/* Files with the same name in different directories get different caches */
+/*  so the cache name has a hash of the full name of the text file (which */
+/*  is returned in path) */
+static char *CIDCacheName(char *file,char *path,int plen) {
+    char buffer[1025], *dir, *pt;
+
+    if ( (dir = getPfaEditDir(buffer))==NULL )
+return( NULL );
+    GFileGetAbsoluteName(file,path,plen);
+    if ( (pt = strrchr(path,'/'))==NULL )
+	pt = path;
+    else
+	++pt;
+    snprintf(buffer,sizeof(buffer),"%s/cidcache", dir);
+    if ( access(buffer,F_OK)==-1 )
+	if ( GFileMkDir(buffer)==-1 )
+return( NULL );
+    snprintf(buffer,sizeof(buffer),"%s/cidcache/%s-%08x.bin", dir, pt,
+	    (unsigned int) RevMapNameKey(path) );
+return( copy(buffer));
+}
+
+/* A revmap from the cache must have an empty slot (or RevMapNext won't */
+/*  stop) and every value must be a cid we have */
+static int CIDCacheRevMapOk(int32 *vals,int size,int cnt,int namemax) {
+    int i, used = 0;
+
+    if ( size<=0 || (size&(size-1))!=0 )
+return( false );
+    for ( i=0; i<size; ++i ) {
+	if ( vals[i]==-1 )
+    continue;
+	if ( vals[i]<0 || vals[i]>namemax )
+return( false );
+	++used;
+    }
+return( used==cnt && used<size );
+}
+
+static void CIDMapSaveCache(struct cidmap *map,char *file) {
+    struct cidcache_header head;
+    struct stat sb;
+    struct cidaltuni *alts;
+    char *cachename, *tempname, path[1025];
+    FILE *f;
+    int i, ok;
+    int32 off, none = -1;
+
+    if ( map->namemax==0 || stat(file,&sb)==-1 ||
+	    (cachename = CIDCacheName(file,path,sizeof(path)))==NULL )
+return;
+    memset(&head,0,sizeof(head));
+    head.magic = CIDCACHE_MAGIC;
+    head.version = CIDCACHE_VERSION;
+    head.byteorder = 0x01020304;
+    head.srcsize = sb.st_size;
+    head.srcmtime = sb.st_mtime;
+    head.cidmax = map->cidmax;
+    head.namemax = map->namemax;
+    for ( alts=map->alts; alts!=NULL; alts=alts->next )
+	++head.altcnt;
+    head.unirevsize = map->unirev->size; head.unirevcnt = map->unirev->cnt;
+    head.namerevsize = map->namerev->size; head.namerevcnt = map->namerev->cnt;
+    for ( i=0; i<=map->namemax; ++i )
+	if ( map->name[i]!=NULL )
+	    head.poolsize += strlen(map->name[i])+1;
+    head.pathlen = strlen(path)+1;
+
+    /* Write somewhere private and rename, so that another process never */
+    /*  sees half a file */
+    tempname = galloc(strlen(cachename)+20);
+    sprintf(tempname,"%s.%d", cachename, (int) getpid());
+    f = fopen(tempname,"wb");
+    if ( f==NULL ) {
+	free(tempname); free(cachename);
+return;
+    }
+    fwrite(&head,sizeof(head),1,f);
+    fwrite(map->unicode,sizeof(uint32),map->namemax+1,f);
+    for ( i=0, off=0; i<=map->namemax; ++i ) {
+	if ( map->name[i]==NULL )
+	    fwrite(&none,sizeof(int32),1,f);
+	else {
+	    fwrite(&off,sizeof(int32),1,f);
+	    off += strlen(map->name[i])+1;
+	}
+    }
+    for ( alts=map->alts; alts!=NULL; alts=alts->next ) {
+	fwrite(&alts->uni,sizeof(int32),1,f);
+	fwrite(&alts->cid,sizeof(int32),1,f);
+    }
+    fwrite(map->unirev->keys,sizeof(int32),map->unirev->size,f);
+    fwrite(map->unirev->vals,sizeof(int32),map->unirev->size,f);
+    fwrite(map->namerev->keys,sizeof(int32),map->namerev->size,f);
+    fwrite(map->namerev->vals,sizeof(int32),map->namerev->size,f);
+    for ( i=0; i<=map->namemax; ++i )
+	if ( map->name[i]!=NULL )
+	    fwrite(map->name[i],1,strlen(map->name[i])+1,f);
+    fwrite(path,1,head.pathlen,f);
+    ok = !ferror(f);
+    if ( fclose(f)!=0 ) ok = false;
+    if ( !ok || rename(tempname,cachename)==-1 )
+	unlink(tempname);
+    free(tempname); free(cachename);
+}
+
+static int CIDMapLoadCache(struct cidmap *map,char *file) {
+    struct cidcache_header *head;
+    struct stat sb, cb;
+    struct cidaltuni *alt, *last;
+    char *cachename, *data, *pool, *path, fullname[1025];
+    int32 *pt, *names, *alts, *unirevvals, *namerevvals;
+    int fd, i, ok;
+    size_t len, expected, maxcnt;
+
+    if ( stat(file,&sb)==-1 ||
+	    (cachename = CIDCacheName(file,fullname,sizeof(fullname)))==NULL )
+return( false );
+    fd = open(cachename,O_RDONLY);
+    free(cachename);
+    if ( fd==-1 )
+return( false );
+    if ( fstat(fd,&cb)==-1 || cb.st_size<sizeof(struct cidcache_header) ) {
+	close(fd);
+return( false );
+    }
+    len = cb.st_size;
+#if !defined(__MINGW32__) && !defined(__VMS)
+    data = mmap(NULL,len,PROT_READ,MAP_PRIVATE,fd,0);
+    if ( data==MAP_FAILED ) {
+	close(fd);
+return( false );
+    }
+#else
+    data = galloc(len);
+    if ( read(fd,data,len)!=len ) {
+	free(data);
+	close(fd);
+return( false );
+    }
+#endif
+    close(fd);
+
+    /* No count may be big enough for the sizes below to overflow */
+    head = (struct cidcache_header *) data;
+    maxcnt = len/(2*sizeof(int32));
+    ok = head->magic==CIDCACHE_MAGIC && head->version==CIDCACHE_VERSION &&
+	    head->byteorder==0x01020304 &&
+	    head->srcsize==(int32) sb.st_size && head->srcmtime==(int32) sb.st_mtime &&
+	    head->namemax>0 && (size_t) head->namemax<maxcnt && head->cidmax>=0 &&
+	    head->altcnt>=0 && (size_t) head->altcnt<maxcnt &&
+	    head->unirevsize>0 && (size_t) head->unirevsize<maxcnt &&
+	    head->namerevsize>0 && (size_t) head->namerevsize<maxcnt &&
+	    head->poolsize>=0 && (size_t) head->poolsize<len &&
+	    head->pathlen>0 && (size_t) head->pathlen<len;
+    if ( ok ) {
+	expected = sizeof(struct cidcache_header) + 2*(head->namemax+1)*sizeof(int32) +
+		2*(head->altcnt+head->unirevsize+head->namerevsize)*sizeof(int32) +
+		head->poolsize + head->pathlen;
+	ok = expected==len;
+    }
+    if ( ok ) {
+	pt = (int32 *) (head+1);
+	names = pt + head->namemax+1;
+	alts = names + head->namemax+1;
+	unirevvals = alts + 2*head->altcnt + head->unirevsize;
+	namerevvals = unirevvals + head->unirevsize + head->namerevsize;
+	pool = (char *) (namerevvals + head->namerevsize);
+	path = pool + head->poolsize;
+	ok = (head->poolsize==0 || pool[head->poolsize-1]=='\0') &&
+		path[head->pathlen-1]=='\0' &&
+		strcmp(path,fullname)==0 &&
+		CIDCacheRevMapOk(unirevvals,head->unirevsize,head->unirevcnt,head->namemax) &&
+		CIDCacheRevMapOk(namerevvals,head->namerevsize,head->namerevcnt,head->namemax);
+	for ( i=0; ok && i<=head->namemax; ++i )
+	    if ( names[i]<-1 || names[i]>=head->poolsize )
+		ok = false;
+	for ( i=0; ok && i<head->altcnt; ++i )
+	    if ( alts[2*i+1]<0 || alts[2*i+1]>head->namemax )
+		ok = false;
+    }
+    if ( !ok ) {
+#if !defined(__MINGW32__) && !defined(__VMS)
+	munmap(data,len);
+#else
+	free(data);
+#endif
+return( false );
+    }
+
+    /* The arrays are used where they lie in the file */
+    map->cidmax = head->cidmax;
+    map->namemax = head->namemax;
+    map->unicode = (uint32 *) pt;
+    map->name = galloc((map->namemax+1)*sizeof(char *));
+    for ( i=0; i<=map->namemax; ++i )
+	map->name[i] = names[i]==-1 ? NULL : pool+names[i];
+    pt = alts;
+    last = NULL;
+    for ( i=0; i<head->altcnt; ++i ) {
+	alt = chunkalloc(sizeof(struct cidaltuni));
+	alt->uni = *pt++;
+	alt->cid = *pt++;
+	if ( last==NULL )
+	    map->alts = alt;
+	else
+	    last->next = alt;
+	last = alt;
+    }
+    map->unirev = gcalloc(1,sizeof(struct enc_revmap));
+    map->unirev->size = head->unirevsize; map->unirev->cnt = head->unirevcnt;
+    map->unirev->keys = pt; pt += head->unirevsize;
+    map->unirev->vals = pt; pt += head->unirevsize;
+    map->namerev = gcalloc(1,sizeof(struct enc_revmap));
+    map->namerev->size = head->namerevsize; map->namerev->cnt = head->namerevcnt;
+    map->namerev->keys = pt; pt += head->namerevsize;
+    map->namerev->vals = pt;
+return( true );
+}
+
 struct cidmap *LoadMapFromFile(char *file,char *registry,char *ordering,
 	int supplement) {
     struct cidmap *ret = galloc(sizeof(struct cidmap));
@@ -958,9 +1373,13 @@ struct cidmap *LoadMapFromFile(char *file,char *registry,char *ordering,
     ret->alts = NULL;
     ret->cidmax = ret->namemax = 0;
     ret->unicode = NULL; ret->name = NULL;
+    ret->unirev = ret->namerev = NULL;
     ret->next = cidmaps;
     cidmaps = ret;
 
+    if ( CIDMapLoadCache(ret,file))
+return( ret );
+
     f = fopen( file,"r" );
     if ( f==NULL ) {
 	ff_post_error(_("Missing cidmap file"),_("Couldn't open cidmap file: %s"), file );
@@ -1000,11 +1419,13 @@ struct cidmap *LoadMapFromFile(char *file,char *registry,char *ordering,
 	    }
 	}
 	fclose(f);
+	CIDMapHash(ret);
+	CIDMapSaveCache(ret,file);
     }
 return( ret );
 }
 
-struct cidmap *FindCidMap(char *registry,char *ordering,int supplement,SplineFont *sf) {
+static struct cidmap *FindCidMapNoLock(char *registry,char *ordering,int supplement,SplineFont *sf) {
     struct cidmap *map, *maybe=NULL;
     char *file, *maybefile=NULL;
     int maybe_sup = -1;
@@ -1117,6 +1538,14 @@ return( map );
 return( MakeDummyMap(registry,ordering,supplement));
 }
 
+struct cidmap *FindCidMap(char *registry,char *ordering,int supplement,SplineFont *sf) {
+    int locked = EncLock();
+    struct cidmap *map = FindCidMapNoLock(registry,ordering,supplement,sf);
+
+    EncUnlock(locked);
+return( map );
+}
+
 static void SFApplyOrdering(SplineFont *sf, int glyphcnt) {
     SplineChar **glyphs, *sc;
     int i;
@@ -1357,13 +1786,31 @@ return;
 SplineFont *CIDFlatten(SplineFont *cidmaster,SplineChar **glyphs,int charcnt) {
     FontViewBase *fvs;
     SplineFont *new;
+    struct chunkarena *arena;
     char buffer[20];
     BDFFont *bdf;
-    int j;
+    int j, k, acnt=0;
 
     if ( cidmaster==NULL )
 return(NULL);
     new = SplineFontEmpty();
+    /* The glyphs move to the new font, so it must keep their arenas. If */
+    /*  the subfonts came from different files there may be several */
+    for ( j=-1; j<cidmaster->subfontcnt; ++j ) {
+	arena = j==-1 ? cidmaster->arena : cidmaster->subfonts[j]->arena;
+	if ( arena==NULL || arena==new->arena )
+    continue;
+	if ( new->arena==NULL ) {
+	    new->arena = ChunkArenaRef(arena);
+    continue;
+	}
+	for ( k=0; k<acnt && new->more_arenas[k]!=arena; ++k );
+	if ( k<acnt )
+    continue;
+	new->more_arenas = grealloc(new->more_arenas,(acnt+2)*sizeof(struct chunkarena *));
+	new->more_arenas[acnt++] = ChunkArenaRef(arena);
+	new->more_arenas[acnt] = NULL;
+    }
     new->fontname = copy(cidmaster->fontname);
     new->fullname = copy(cidmaster->fullname);
     new->familyname = copy(cidmaster->familyname);
@@ -1872,6 +2319,7 @@ return( true );
 	free(sf->glyphs[j]->name);
 	sf->glyphs[j]->name = copy(dummy.name);
     }
+    GlyphHashFree(sf);
     /* We just changed the unicode values for most glyphs */
     /* but any references to them will have the old values, and that's bad, so fix 'em up */
     for ( i=0; i<sf->glyphcnt; ++i ) if ( sf->glyphs[i]!=NULL ) {
@@ -2410,7 +2858,7 @@ return;
 	SFMatchGlyphs(mm->normal,base,true);
 }
 
-int32 UniFromEnc(int enc, Encoding *encname) {
+static int32 UniFromEncNoLock(int enc, Encoding *encname) {
     char from[20];
     unichar_t to[20];
     ICONV_CONST char *fpt;
@@ -2465,7 +2913,61 @@ return( (encname->tounicode_func)(enc) );
 return( -1 );
 }
 
-int32 EncFromUni(int32 uni, Encoding *enc) {
+int32 UniFromEnc(int enc, Encoding *encname) {
+    int locked, ret;
+
+    if ( encname->tounicode==NULL )
+return( UniFromEncNoLock(enc,encname));
+    /* iconv converters carry state */
+    locked = EncLock();
+    ret = UniFromEncNoLock(enc,encname);
+    EncUnlock(locked);
+return( ret );
+}
+
+void EncodingRevMapsFree(Encoding *enc) {
+    RevMapFree(enc->unirev);
+    RevMapFree(enc->namerev);
+    enc->unirev = enc->namerev = NULL;
+    enc->rev_unicode = NULL;
+    enc->rev_cnt = 0;
+}
+
+/* The unicode and psnames arrays of temporary encodings may grow after the */
+/*  encoding is made, so check the reverse maps still describe them */
+static void EncodingRevMaps(Encoding *enc) {
+    int i, cnt;
+
+    if ( enc->unirev!=NULL && enc->rev_unicode==enc->unicode &&
+	    enc->rev_cnt==enc->char_cnt )
+return;
+    EncodingRevMapsFree(enc);
+    cnt = 0;
+    if ( enc->unicode!=NULL ) {
+	for ( i=0; i<enc->char_cnt; ++i )
+	    if ( enc->unicode[i]>0 ) ++cnt;
+    }
+    /* For iconv encodings this remembers the answers we've had from iconv */
+    enc->unirev = RevMapNew(cnt);
+    if ( enc->unicode!=NULL ) {
+	for ( i=0; i<enc->char_cnt; ++i )
+	    if ( enc->unicode[i]>0 )
+		RevMapAdd(enc->unirev,enc->unicode[i],i);
+    }
+    if ( enc->psnames!=NULL ) {
+	for ( i=cnt=0; i<enc->char_cnt; ++i )
+	    if ( enc->psnames[i]!=NULL ) ++cnt;
+	enc->namerev = RevMapNew(cnt);
+	for ( i=0; i<enc->char_cnt; ++i )
+	    if ( enc->psnames[i]!=NULL )
+		RevMapAdd(enc->namerev,RevMapNameKey(enc->psnames[i]),i);
+    }
+    enc->rev_unicode = enc->unicode;
+    enc->rev_cnt = enc->char_cnt;
+}
+
+static int32 _EncFromUni(int32 uni, Encoding *enc) {
+
     unichar_t from[20];
     unsigned char to[20];
     ICONV_CONST char *fpt;
@@ -2521,13 +3023,66 @@ return( (enc->fromunicode_func)(uni) );
 return( -1 );
 }
 
+static int32 EncFromUniNoLock(int32 uni, Encoding *enc) {
+    int slot = -1, ret;
+
+    if ( enc->is_custom || enc->is_original || enc->is_compact || uni==-1 )
+return( -1 );
+    if ( enc->is_unicodebmp || enc->is_unicodefull )
+return( uni<enc->char_cnt ? uni : -1 );
+    if ( uni<=0 || (enc->unicode==NULL && enc->fromunicode==NULL) )
+return( _EncFromUni(uni,enc));
+
+    EncodingRevMaps(enc);
+    ret = RevMapNext(enc->unirev,uni,&slot);
+    if ( enc->unicode!=NULL || ret!=-1 )
+return( ret==-2 ? -1 : ret );
+    /* Ask iconv, and remember what it said, even if it found nothing */
+    ret = _EncFromUni(uni,enc);
+    RevMapAdd(enc->unirev,uni,ret==-1 ? -2 : ret);
+return( ret );
+}
+
+int32 EncFromUni(int32 uni, Encoding *enc) {
+    int locked, ret;
+
+    if ( enc->is_custom || enc->is_original || enc->is_compact || uni==-1 )
+return( -1 );
+    if ( enc->is_unicodebmp || enc->is_unicodefull )
+return( uni<enc->char_cnt ? uni : -1 );
+    /* The reverse maps are built, and the iconv answers added, as we go */
+    locked = EncLock();
+    ret = EncFromUniNoLock(uni,enc);
+    EncUnlock(locked);
+return( ret );
+}
+
+/* Finds the encoding point with this postscript name. If there are several */
+/*  return the first, or if last is set, the last */
+int32 EncFromPSName(const char *name,Encoding *encname,int last) {
+    int slot = -1, i, found = -1, locked;
+    int32 key;
+
+    if ( encname->psnames==NULL )
+return( -1 );
+    locked = EncLock();
+    EncodingRevMaps(encname);
+    key = RevMapNameKey(name);
+    while ( (i=RevMapNext(encname->namerev,key,&slot))!=-1 ) {
+	if ( strcmp(encname->psnames[i],name)==0 ) {
+	    found = i;
+	    if ( !last )
+    break;
+	}
+    }
+    EncUnlock(locked);
+return( found );
+}
+
 int32 EncFromName(const char *name,enum uni_interp interp,Encoding *encname) {
     int i;
-    if ( encname->psnames!=NULL ) {
-	for ( i=0; i<encname->char_cnt; ++i )
-	    if ( encname->psnames[i]!=NULL && strcmp(name,encname->psnames[i])==0 )
+    if ( encname->psnames!=NULL && (i=EncFromPSName(name,encname,false))!=-1 )
 return( i );
-    }
     i = UniFromName(name,interp,encname);
     if ( i==-1 && strlen(name)==4 ) {
 	/* MS says use this kind of name, Adobe says use the one above */
@@ -7,15 +7,27 @@ struct cidaltuni {
     int cid;
 };
 
+/* Maps a key (a unicode code point or the hash of a name) back to the index */
+/*  it came from. Several indices may share a key, they are found in the */
+/*  order they were added. Open addressing, empty slots have a val of -1 */
+struct enc_revmap {
+    int size;			/* a power of 2 */
+    int cnt;
+    int32 *keys;
+    int32 *vals;
+};
+
 struct cidmap {
     char *registry, *ordering;
     int supplement, maxsupple;
     int cidmax;			/* Max cid found in the charset */
     int namemax;		/* Max cid with useful info */
-    uint32 *unicode;
+    uint32 *unicode;		/* May point into a mapped cache file */
     char **name;
     struct cidaltuni *alts;
     struct cidmap *next;
+    struct enc_revmap *unirev;	/* unicode (and alts) -> cid */
+    struct enc_revmap *namerev;	/* name -> cid */
 };
 
 extern struct cidmap *cidmaps;
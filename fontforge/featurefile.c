@@ -327,7 +327,7 @@ static void dump_fpst_everythingelse(FILE *out, SplineFont *sf,char **classes,
 
 static char *lookupname(OTLookup *otl) {
     char *pt1, *pt2;
-    static char space[32];
+    static ff_thread_local char space[32];
 
     if ( otl->tempname != NULL )
 return( otl->tempname );
@@ -2061,15 +2061,14 @@ static void cleanupnames(SplineFont *sf) {
 }
 
 void FeatDumpFontLookups(FILE *out,SplineFont *sf) {
-    char oldloc[24];
+    CLocaleSave oldloc;
 
     if ( sf->cidmaster!=NULL ) sf=sf->cidmaster;
 
     SFFindUnusedLookups(sf);
 
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     untick_lookups(sf);
     preparenames(sf);
     gdef_markclasscheck(out,sf,NULL);
@@ -2077,7 +2076,7 @@ void FeatDumpFontLookups(FILE *out,SplineFont *sf) {
     dump_gdef(out,sf);
     dump_base(out,sf);
     cleanupnames(sf);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 }
 
 
@@ -2982,6 +2981,7 @@ return( sc );
 	free(sc->name);
 	sc->name = copy(name);
 	sc->unicodeenc = UniFromName(name,ui_none,&custom);
+	SFHashUnicode(sf,sc,sc->unicodeenc);
     }
 #else
 /* Don't encode it (not in current encoding), just add it, so we needn't */
@@ -7549,7 +7549,7 @@ void SFApplyFeatureFile(SplineFont *sf,FILE *file,char *filename) {
     struct namedanchor *nap, *napnext;
     struct namedvalue *nvr, *nvrnext;
     int i,j;
-    char oldloc[24];
+    CLocaleSave oldloc;
 
     memset(&tok,0,sizeof(tok));
     tok.line[0] = 1;
@@ -7559,10 +7559,9 @@ void SFApplyFeatureFile(SplineFont *sf,FILE *file,char *filename) {
     if ( sf->cidmaster ) sf = sf->cidmaster;
     tok.sf = sf;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     fea_ParseFeatureFile(&tok);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     if ( tok.err_count==0 ) {
 	tok.sofar = fea_reverseList(tok.sofar);
 	fea_ApplyFile(&tok, tok.sofar);
@@ -105,6 +105,13 @@ typedef struct freetypecontext {
 			        /*  times */
     int isttf;
     int em;			/* Em size in the spline font, not ppem */
+    SplineChar **glyphs;	/* For a context kept by a piecemeal font, the glyphs */
+				/*  as they were when it was built. Cleared as */
+				/*  they change */
+    uint32 *serials;		/* And their serials, as a glyph made after one */
+				/*  was removed may be at the same address */
+    int glyphcnt;
+    FT_Library library;		/* Our own, for a context used on another thread */
 } FTC;
 
 extern void *__FreeTypeFontContext(FT_Library context,
@@ -5545,10 +5545,7 @@ void FVRegenChar(FontView *fv,SplineChar *sc) {
 return;
 
     /* sc->changedsincelasthinted = true;*/	/* Why was this here? */
-    if ( sc->orig_pos<fv->filled->glyphcnt ) {
-	BDFCharFree(fv->filled->glyphs[sc->orig_pos]);
-	fv->filled->glyphs[sc->orig_pos] = NULL;
-    }
+    BDFPieceMealRegen(fv->filled,sc->orig_pos);
 		/* FVRefreshChar does NOT do this for us */
     for ( mv=fv->b.sf->metrics; mv!=NULL; mv=mv->next )
 	MVRegenChar(mv,sc);
@@ -36,8 +36,20 @@
 #include <gresource.h>
 #include <math.h>
 #include <unistd.h>
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
 
 static FontViewBase *fv_list=NULL;
+/* Fonts may be opened on one thread while another looks through the list */
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t fv_list_lock = PTHREAD_MUTEX_INITIALIZER;
+# define FVListLock()	pthread_mutex_lock(&fv_list_lock)
+# define FVListUnlock()	pthread_mutex_unlock(&fv_list_lock)
+#else
+# define FVListLock()
+# define FVListUnlock()
+#endif
 
 extern int onlycopydisplayed;
 float joinsnap=0;
@@ -828,76 +840,144 @@ void FVReencode(FontViewBase *fv,Encoding *enc) {
     FontViewReformatOne(fv);
 }
 
-void FVOverlap(FontViewBase *fv,enum overlap_type ot) {
-    int i, cnt=0, layer, first, last, gid;
-    SplineChar *sc;
+/* Most glyph transformations (remove overlap, simplify, ...) change nothing */
+/*  but the glyph itself, so we can do several glyphs at once. Anything */
+/*  which isn't thread safe happens on the main thread: first prepare is */
+/*  called for each glyph in encoding order (to preserve undoes and so on) */
+/*  then func does the real work for all the glyphs on worker threads and */
+/*  finally the ui is told about the glyphs which were finished before any */
+/*  cancel (which also refreshes references to them in other glyphs). The */
+/*  undoes prepare made for glyphs which were never started are taken off */
+/*  again so a cancel doesn't leave them with an undo which does nothing */
+struct glyphbatch {
+    SplineChar **glyphs;
+    char *done;
+    int layer;
+    void (*func)(SplineChar *sc,int layer,void *data);
+    void *data;
+};
 
-    /* We know it's more likely that we'll find a problem in the overlap code */
-    /*  than anywhere else, so let's save the current state against a crash */
-    DoAutoSaves();
+static void GlyphBatchJob(void *_gb,int i) {
+    struct glyphbatch *gb = _gb;
 
-    for ( i=0; i<fv->map->enccount; ++i )
-	if ( fv->selected[i] && (gid = fv->map->map[i])!=-1 &&
-		SCWorthOutputting(fv->sf->glyphs[gid]) )
-	    ++cnt;
+    (gb->func)(gb->glyphs[i],gb->layer,gb->data);
+    gb->done[i] = true;
+}
 
-    ff_progress_start_indicator(10,_("Removing overlaps..."),_("Removing overlaps..."),0,cnt,1);
+void FVGlyphBatch(FontViewBase *fv,int layer,int all,const char *title,
+	void (*prepare)(SplineChar *sc,int layer,void *data),
+	void (*func)(SplineChar *sc,int layer,void *data),void *data) {
+    int i, cnt, gid, l, lcnt = fv->sf->layer_cnt, ok;
+    SplineChar *sc;
+    struct glyphbatch gb;
+    Undoes **undoes, *undo;
 
+    memset(&gb,0,sizeof(gb));
+    gb.glyphs = galloc((fv->map->enccount+1)*sizeof(SplineChar *));
     SFUntickAll(fv->sf);
+    cnt = 0;
     for ( i=0; i<fv->map->enccount; ++i ) if ( fv->selected[i] &&
-	    (gid = fv->map->map[i])!=-1 &&
-	    SCWorthOutputting((sc=fv->sf->glyphs[gid])) &&
-	    !sc->ticked ) {
+	    (gid = fv->map->map[i])!=-1 && (sc = fv->sf->glyphs[gid])!=NULL &&
+	    (all || SCWorthOutputting(sc)) && !sc->ticked ) {
 	sc->ticked = true;
-	if ( !SCRoundToCluster(sc,ly_all,false,.03,.12))
-	    SCPreserveLayer(sc,fv->active_layer,false);
-	MinimumDistancesFree(sc->md);
-	if ( sc->parent->multilayer ) {
-	    first = ly_fore;
-	    last = sc->layer_cnt-1;
-	} else
-	    first = last = fv->active_layer;
-	for ( layer = first; layer<=last; ++layer )
-	    sc->layers[layer].splines = SplineSetRemoveOverlap(sc,sc->layers[layer].splines,ot);
-	SCCharChangedUpdate(sc,fv->active_layer);
-	if ( !ff_progress_next())
-    break;
-    }
+	gb.glyphs[cnt++] = sc;
+    }
+    gb.done = gcalloc(cnt+1,sizeof(char));
+    gb.layer = layer;
+    gb.func = func;
+    gb.data = data;
+
+    undoes = galloc((cnt*lcnt+1)*sizeof(Undoes *));
+    for ( i=0; i<cnt; ++i )
+	for ( l=0; l<lcnt; ++l )
+	    undoes[i*lcnt+l] = gb.glyphs[i]->layers[l].undoes;
+    if ( prepare!=NULL )
+	for ( i=0; i<cnt; ++i )
+	    (prepare)(gb.glyphs[i],layer,data);
+    hasspiro();			/* Load libspiro (if we can) now, not in a thread */
+    ff_progress_start_indicator(10,title,title,0,cnt,1);
+    ok = ThreadedForEach(cnt,ThreadCount(0),true,GlyphBatchJob,&gb);
     ff_progress_end_indicator();
+
+    /* prepare adds at most one undo to a layer, so if the head has changed */
+    /*  the new head is the one it made */
+    if ( !ok )
+	for ( i=0; i<cnt; ++i ) if ( !gb.done[i] ) {
+	    sc = gb.glyphs[i];
+	    for ( l=0; l<lcnt; ++l )
+		if ( (undo = sc->layers[l].undoes)!=undoes[i*lcnt+l] && undo!=NULL ) {
+		    sc->layers[l].undoes = undo->next;
+		    undo->next = NULL;
+		    UndoesFree(undo);
+		}
+	}
+    free(undoes);
+
+    for ( i=0; i<cnt; ++i ) if ( gb.done[i] )
+	SCCharChangedUpdate(gb.glyphs[i],
+		gb.glyphs[i]->parent->multilayer ? ly_fore : layer);
+    free(gb.done);
+    free(gb.glyphs);
 }
 
-void FVAddExtrema(FontViewBase *fv) {
-    int i, cnt=0, layer, first, last, gid;
-    SplineChar *sc;
-    SplineFont *sf = fv->sf;
-    int emsize = sf->ascent+sf->descent;
+static void GlyphLayerRange(SplineChar *sc,int layer,int *first,int *last) {
+    if ( sc->parent->multilayer ) {
+	*first = ly_fore;
+	*last = sc->layer_cnt-1;
+    } else
+	*first = *last = layer;
+}
 
-    for ( i=0; i<fv->map->enccount; ++i )
-	if ( fv->selected[i] && (gid = fv->map->map[i])!=-1 &&
-		SCWorthOutputting(fv->sf->glyphs[gid]) )
-	    ++cnt;
-    ff_progress_start_indicator(10,_("Adding points at Extrema..."),_("Adding points at Extrema..."),0,cnt,1);
+static void SCPreserveActive(SplineChar *sc,int layer,void *data) {
+    SCPreserveLayer(sc,layer,false);
+}
 
-    SFUntickAll(fv->sf);
-    for ( i=0; i<fv->map->enccount; ++i ) if ( fv->selected[i] &&
-	    (gid = fv->map->map[i])!=-1 &&
-	    SCWorthOutputting((sc = fv->sf->glyphs[gid])) &&
-	    !sc->ticked) {
-	sc->ticked = true;
-	if ( sc->parent->multilayer ) {
-	    first = ly_fore;
-	    last = sc->layer_cnt-1;
-	} else
-	    first = last = fv->active_layer;
-	for ( layer = first; layer<=last; ++layer ) {
-	    SCPreserveLayer(sc,layer,false);
-	    SplineCharAddExtrema(sc,sc->layers[layer].splines,ae_only_good,emsize);
-	}
-	SCCharChangedUpdate(sc,fv->active_layer);
-	if ( !ff_progress_next())
-    break;
-    }
-    ff_progress_end_indicator();
+static void SCPreserveLayers(SplineChar *sc,int active,void *data) {
+    int layer, first, last;
+
+    GlyphLayerRange(sc,active,&first,&last);
+    for ( layer = first; layer<=last; ++layer )
+	SCPreserveLayer(sc,layer,false);
+}
+
+static void SCOverlapPrepare(SplineChar *sc,int layer,void *data) {
+    if ( !SCRoundToCluster(sc,ly_all,false,.03,.12))
+	SCPreserveLayer(sc,layer,false);
+    MinimumDistancesFree(sc->md);
+    sc->md = NULL;
+}
+
+static void SCOverlapJob(SplineChar *sc,int active,void *data) {
+    enum overlap_type ot = *(enum overlap_type *) data;
+    int layer, first, last;
+
+    GlyphLayerRange(sc,active,&first,&last);
+    for ( layer = first; layer<=last; ++layer )
+	sc->layers[layer].splines = SplineSetRemoveOverlap(sc,sc->layers[layer].splines,ot);
+}
+
+void FVOverlap(FontViewBase *fv,enum overlap_type ot) {
+
+    /* We know it's more likely that we'll find a problem in the overlap code */
+    /*  than anywhere else, so let's save the current state against a crash */
+    DoAutoSaves();
+
+    FVGlyphBatch(fv,fv->active_layer,false,_("Removing overlaps..."),
+	    SCOverlapPrepare,SCOverlapJob,&ot);
+}
+
+static void SCAddExtremaJob(SplineChar *sc,int active,void *data) {
+    int layer, first, last;
+    int emsize = sc->parent->ascent+sc->parent->descent;
+
+    GlyphLayerRange(sc,active,&first,&last);
+    for ( layer = first; layer<=last; ++layer )
+	SplineCharAddExtrema(sc,sc->layers[layer].splines,ae_only_good,emsize);
+}
+
+void FVAddExtrema(FontViewBase *fv) {
+    FVGlyphBatch(fv,fv->active_layer,false,_("Adding points at Extrema..."),
+	    SCPreserveLayers,SCAddExtremaJob,NULL);
 }
 
 void FVCanonicalStart(FontViewBase *fv) {
@@ -916,25 +996,20 @@ void FVCanonicalContours(FontViewBase *fv) {
 	    CanonicalContours(fv->sf->glyphs[gid],fv->active_layer);
 }
 
-void FVRound2Int(FontViewBase *fv,real factor) {
-    int i, cnt=0, gid;
-
-    for ( i=0; i<fv->map->enccount; ++i )
-	if ( fv->selected[i] && (gid = fv->map->map[i])!=-1 &&
-		SCWorthOutputting(fv->sf->glyphs[gid]) )
-	    ++cnt;
-    ff_progress_start_indicator(10,_("Rounding to integer..."),_("Rounding to integer..."),0,cnt,1);
+static void SCRound2IntJob(SplineChar *sc,int layer,void *data) {
+    _SCRound2Int(sc,layer,*(real *) data);
+}
 
-    for ( i=0; i<fv->map->enccount; ++i ) if ( fv->selected[i] &&
-	    (gid = fv->map->map[i])!=-1 && SCWorthOutputting(fv->sf->glyphs[gid]) ) {
-	SplineChar *sc = fv->sf->glyphs[gid];
+/* The scripting RoundToInt (and python's font.round) never preserved undoes */
+/*  so they pass undoes as false. A glyph encoded in several slots is only */
+/*  rounded once (it used to be rounded once per slot, with the same result) */
+void _FVRound2Int(FontViewBase *fv,int layer,int all,int undoes,real factor) {
+    FVGlyphBatch(fv,layer,all,_("Rounding to integer..."),
+	    undoes ? SCPreserveActive : NULL,SCRound2IntJob,&factor);
+}
 
-	SCPreserveLayer(sc,fv->active_layer,false);
-	SCRound2Int( sc,fv->active_layer,factor);
-	if ( !ff_progress_next())
-    break;
-    }
-    ff_progress_end_indicator();
+void FVRound2Int(FontViewBase *fv,real factor) {
+    _FVRound2Int(fv,fv->active_layer,false,true,factor);
 }
 
 void FVCluster(FontViewBase *fv) {
@@ -1022,37 +1097,20 @@ return;
     ff_progress_end_indicator();
 }
 
-void _FVSimplify(FontViewBase *fv,struct simplifyinfo *smpl) {
-    int i, cnt=0, layer, first, last, gid;
-    SplineChar *sc;
+static void SCSimplifyJob(SplineChar *sc,int active,void *data) {
+    int layer, first, last;
 
-    for ( i=0; i<fv->map->enccount; ++i )
-	if ( fv->selected[i] && (gid = fv->map->map[i])!=-1 &&
-		SCWorthOutputting(fv->sf->glyphs[gid]) )
-	    ++cnt;
-    ff_progress_start_indicator(10,_("Simplifying..."),_("Simplifying..."),0,cnt,1);
+    GlyphLayerRange(sc,active,&first,&last);
+    for ( layer = first; layer<=last; ++layer )
+	sc->layers[layer].splines = SplineCharSimplify(sc,sc->layers[layer].splines,data);
+}
 
-    SFUntickAll(fv->sf);
-    for ( i=0; i<fv->map->enccount; ++i )
-	if ( (gid=fv->map->map[i])!=-1 && SCWorthOutputting((sc=fv->sf->glyphs[gid])) &&
-		fv->selected[i] && !sc->ticked ) {
-	    sc->ticked = true;
-	    SCPreserveLayer(sc,fv->active_layer,false);
-	    if ( sc->parent->multilayer ) {
-		first = ly_fore;
-		last = sc->layer_cnt-1;
-	    } else
-		first = last = fv->active_layer;
-	    for ( layer = first; layer<=last; ++layer )
-		sc->layers[layer].splines = SplineCharSimplify(sc,sc->layers[layer].splines,smpl);
-	    SCCharChangedUpdate(sc,fv->active_layer);
-	    if ( !ff_progress_next())
-    break;
-	}
-    ff_progress_end_indicator();
+void _FVSimplify(FontViewBase *fv,struct simplifyinfo *smpl) {
+    FVGlyphBatch(fv,fv->active_layer,false,_("Simplifying..."),
+	    SCPreserveActive,SCSimplifyJob,smpl);
 }
 
-void FVAutoHint(FontViewBase *fv) {
+void _FVAutoHint(FontViewBase *fv,int threads) {
     int i, cnt=0, gid;
     BlueData *bd = NULL, _bd;
     SplineChar *sc;
@@ -1074,6 +1132,16 @@ void FVAutoHint(FontViewBase *fv) {
 	}
     ff_progress_start_indicator(10,_("Auto Hinting Font..."),_("Auto Hinting Font..."),0,cnt,1);
 
+    if ( threads>1 && fv->sf->mm==NULL ) {
+	for ( i=0; i<fv->map->enccount; ++i ) if ( fv->selected[i] &&
+		(gid = fv->map->map[i])!=-1 && SCWorthOutputting(fv->sf->glyphs[gid]) )
+	    fv->sf->glyphs[gid]->manualhints = false;
+	SFAutoHintUntickedThreaded(fv->sf,fv->active_layer,bd,threads);
+	ff_progress_end_indicator();
+	FVRefreshAll(fv->sf);
+return;
+    }
+
     for ( i=0; i<fv->map->enccount; ++i ) if ( fv->selected[i] &&
 	    (gid = fv->map->map[i])!=-1 && SCWorthOutputting(fv->sf->glyphs[gid]) ) {
 	sc = fv->sf->glyphs[gid];
@@ -1087,6 +1155,10 @@ void FVAutoHint(FontViewBase *fv) {
     FVRefreshAll(fv->sf);
 }
 
+void FVAutoHint(FontViewBase *fv) {
+    _FVAutoHint(fv,1);
+}
+
 void FVAutoHintSubs(FontViewBase *fv) {
     int i, cnt=0, gid;
 
@@ -1240,10 +1312,11 @@ static void ClearFpgmPrepCvt(SplineFont *sf) {
     }
 }
 
-void FVAutoInstr(FontViewBase *fv) {
+void _FVAutoInstr(FontViewBase *fv,int threads) {
     BlueData bd;
     int i, cnt=0, gid;
     GlobalInstrCt gic;
+    SplineChar *sc, **glyphs;
 
     /* If all glyphs are selected, then no legacy hint will remain after */
     /*  instructing, so we might as well clear all the legacy tables too */
@@ -1259,25 +1332,31 @@ void FVAutoInstr(FontViewBase *fv) {
 
     InitGlobalInstrCt(&gic,fv->sf,fv->active_layer,&bd);
 
+    /* A glyph may be selected in several encoding slots, but we must only */
+    /*  give it to the threads once */
+    for ( gid=0; gid<fv->sf->glyphcnt; ++gid ) if ( (sc = fv->sf->glyphs[gid])!=NULL )
+	sc->ticked = false;
+    glyphs = galloc((fv->sf->glyphcnt+1)*sizeof(SplineChar *));
     for ( i=0; i<fv->map->enccount; ++i )
 	if ( fv->selected[i] && (gid = fv->map->map[i])!=-1 &&
-		SCWorthOutputting(fv->sf->glyphs[gid]) )
-	    ++cnt;
+		SCWorthOutputting(sc = fv->sf->glyphs[gid]) && !sc->ticked ) {
+	    sc->ticked = true;
+	    glyphs[cnt++] = sc;
+	}
     ff_progress_start_indicator(10,_("Auto Instructing Font..."),_("Auto Instructing Font..."),0,cnt,1);
 
-    for ( i=0; i<fv->map->enccount; ++i ) if ( fv->selected[i] &&
-	    (gid = fv->map->map[i])!=-1 && SCWorthOutputting(fv->sf->glyphs[gid]) ) {
-	SplineChar *sc = fv->sf->glyphs[gid];
-	NowakowskiSCAutoInstr(&gic,sc);
-	if ( !ff_progress_next())
-    break;
-    }
-    
+    NowakowskiAutoInstrThreaded(&gic,glyphs,cnt,threads);
+    free(glyphs);
+
     FreeGlobalInstrCt(&gic);
 
     ff_progress_end_indicator();
 }
 
+void FVAutoInstr(FontViewBase *fv) {
+    _FVAutoInstr(fv,1);
+}
+
 void FVClearInstrs(FontViewBase *fv) {
     SplineChar *sc;
     int i, gid;
@@ -1910,11 +1989,13 @@ static FontViewBase *FontViewBase_Append(FontViewBase *fv) {
     /*  created. but we don't create any windows here, so... */
     FontViewBase *test;
 
+    FVListLock();
     if ( fv_list==NULL ) fv_list = fv;
     else {
 	for ( test = fv_list; test->next!=NULL; test=test->next );
 	test->next = fv;
     }
+    FVListUnlock();
 return( fv );
 }
 
@@ -1967,11 +2048,12 @@ static FontViewBase *FVAny(void) { return fv_list; }
 static int  FontIsActive(SplineFont *sf) {
     FontViewBase *fv;
 
+    FVListLock();
     for ( fv=fv_list; fv!=NULL; fv=fv->next )
 	if ( fv->sf == sf )
-return( true );
-
-return( false );
+    break;
+    FVListUnlock();
+return( fv!=NULL );
 }
 
 static SplineFont *FontOfFilename(const char *filename) {
@@ -1979,19 +2061,22 @@ static SplineFont *FontOfFilename(const char *filename) {
     FontViewBase *fv;
 
     GFileGetAbsoluteName((char *) filename,buffer,sizeof(buffer)); 
+    FVListLock();
     for ( fv=fv_list; fv!=NULL ; fv=fv->next ) {
 	if ( fv->sf->filename!=NULL && strcmp(fv->sf->filename,buffer)==0 )
-return( fv->sf );
+    break;
 	else if ( fv->sf->origname!=NULL && strcmp(fv->sf->origname,buffer)==0 )
-return( fv->sf );
+    break;
     }
-return( NULL );
+    FVListUnlock();
+return( fv!=NULL ? fv->sf : NULL );
 }
 
 static void FVExtraEncSlots(FontViewBase *fv, int encmax) {
 }
 
 static void FontViewBase_Close(FontViewBase *fv) {
+    FVListLock();
     if ( fv_list==fv )
 	fv_list = fv->next;
     else {
@@ -1999,6 +2084,7 @@ static void FontViewBase_Close(FontViewBase *fv) {
 	for ( n=fv_list; n->next!=fv; n=n->next );
 	n->next = fv->next;
     }
+    FVListUnlock();
     FontViewFree(fv);
 }
 
@@ -72,6 +72,26 @@ return( NULL );
 void FreeTypeFreeContext(void *freetypecontext) {
 }
 
+void *FreeTypeFontContextIncremental(SplineFont *sf,int layer) {
+return( NULL );
+}
+
+int FreeTypeContextHasGlyph(void *freetypecontext,SplineChar *sc) {
+return( false );
+}
+
+void FreeTypeContextGlyphChanged(void *freetypecontext,int gid) {
+}
+
+void *FreeTypeContextForThread(void *freetypecontext) {
+return( NULL );
+}
+
+BDFChar *_SplineCharFreeTypeRasterizeNoHints(void *thread_context,
+	SplineChar *sc,int layer,int ptsize,int dpi,int depth) {
+return( NULL );
+}
+
 struct freetype_raster *FreeType_GetRaster(void *single_glyph_context,
 	int enc, real ptsizey, real ptsizex, int dpi, int depth) {
 return( NULL );
@@ -334,6 +354,11 @@ return;
 
     if ( ftc->face!=NULL )
 	_FT_Done_Face(ftc->face);
+    if ( ftc->library!=NULL ) {
+	_FT_Done_FreeType(ftc->library);
+	free(ftc);
+return;
+    }
     if ( ftc->shared_ftc )
 return;
     if ( ftc->mappedfile )
@@ -341,6 +366,8 @@ return;
     if ( ftc->file!=NULL )
 	fclose(ftc->file);
     free(ftc->glyph_indeces);
+    free(ftc->glyphs);
+    free(ftc->serials);
     free(ftc);
 }
     
@@ -1140,8 +1167,9 @@ static void MergeBitmaps(FT_Bitmap *bitmap,FT_Bitmap *newstuff,struct brush *bru
 }
 #endif
 
-BDFChar *SplineCharFreeTypeRasterizeNoHints(SplineChar *sc,int layer,
-	int ptsize, int dpi,int depth) {
+BDFChar *_SplineCharFreeTypeRasterizeNoHints(void *thread_context,
+	SplineChar *sc,int layer, int ptsize, int dpi,int depth) {
+    FT_Library context = thread_context!=NULL ? ((FTC *) thread_context)->library : ff_ft_context;
     FT_Outline outline;
     FT_Bitmap bitmap, temp;
 #ifdef FONTFORGE_CONFIG_TYPE3
@@ -1221,7 +1249,7 @@ return( NULL );
 	memset(temp.buffer,0,temp.pitch*temp.rows);
 	FillOutline(stroked,&outline,&pmax,&cmax,
 		scale,&b,sc->layers[layer].order2,false);
-	err |= (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&bitmap);
+	err |= (_FT_Outline_Get_Bitmap)(context,&outline,&bitmap);
 	SplinePointListsFree(stroked);
     } else 
 #ifndef FONTFORGE_CONFIG_TYPE3
@@ -1229,7 +1257,7 @@ return( NULL );
 	all = LayerAllOutlines(&sc->layers[layer]);
 	FillOutline(all,&outline,&pmax,&cmax,
 		scale,&b,sc->layers[layer].order2,false);
-	err = (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&bitmap);
+	err = (_FT_Outline_Get_Bitmap)(context,&outline,&bitmap);
 	if ( sc->layers[layer].splines!=all )
 	    SplinePointListsFree(all);
     }
@@ -1238,7 +1266,7 @@ return( NULL );
 	all = LayerAllOutlines(&sc->layers[layer]);
 	FillOutline(all,&outline,&pmax,&cmax,
 		scale,&b,sc->layers[layer].order2,false);
-	err = (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&bitmap);
+	err = (_FT_Outline_Get_Bitmap)(context,&outline,&bitmap);
 	if ( sc->layers[layer].splines!=all )
 	    SplinePointListsFree(all);
     } else {
@@ -1251,7 +1279,7 @@ return( NULL );
 		memset(temp.buffer,0,temp.pitch*temp.rows);
 		FillOutline(sc->layers[i].splines,&outline,&pmax,&cmax,
 			scale,&b,sc->layers[i].order2,2);
-		err |= (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&temp);
+		err |= (_FT_Outline_Get_Bitmap)(context,&outline,&temp);
 		clipmask = galloc(bitmap.pitch*bitmap.rows);
 		memcpy(clipmask,temp.buffer,bitmap.pitch*bitmap.rows);
 	    }
@@ -1259,7 +1287,7 @@ return( NULL );
 		memset(temp.buffer,0,temp.pitch*temp.rows);
 		FillOutline(sc->layers[i].splines,&outline,&pmax,&cmax,
 			scale,&b,sc->layers[i].order2,true);
-		err |= (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&temp);
+		err |= (_FT_Outline_Get_Bitmap)(context,&outline,&temp);
 		MergeBitmaps(&bitmap,&temp,&sc->layers[i].fill_brush,clipmask,rscale,&b,sc);
 	    }
 	    if ( sc->layers[i].dostroke ) {
@@ -1267,7 +1295,7 @@ return( NULL );
 		memset(temp.buffer,0,temp.pitch*temp.rows);
 		FillOutline(stroked,&outline,&pmax,&cmax,
 			scale,&b,sc->layers[i].order2,true);
-		err |= (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&temp);
+		err |= (_FT_Outline_Get_Bitmap)(context,&outline,&temp);
 		MergeBitmaps(&bitmap,&temp,&sc->layers[i].stroke_pen.brush,clipmask,rscale,&b,sc);
 		SplinePointListsFree(stroked);
 	    }
@@ -1277,7 +1305,7 @@ return( NULL );
 			memset(temp.buffer,0,temp.pitch*temp.rows);
 			FillOutline(r->layers[j].splines,&outline,&pmax,&cmax,
 				scale,&b,sc->layers[i].order2,true);
-			err |= (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&temp);
+			err |= (_FT_Outline_Get_Bitmap)(context,&outline,&temp);
 			MergeBitmaps(&bitmap,&temp,&r->layers[j].fill_brush,clipmask,rscale,&b,sc);
 		    }
 		    if ( r->layers[j].dostroke ) {
@@ -1285,7 +1313,7 @@ return( NULL );
 			memset(temp.buffer,0,temp.pitch*temp.rows);
 			FillOutline(stroked,&outline,&pmax,&cmax,
 				scale,&b,sc->layers[i].order2,true);
-			err |= (_FT_Outline_Get_Bitmap)(ff_ft_context,&outline,&temp);
+			err |= (_FT_Outline_Get_Bitmap)(context,&outline,&temp);
 			MergeBitmaps(&bitmap,&temp,&r->layers[j].stroke_pen.brush,clipmask,rscale,&b,sc);
 			SplinePointListsFree(stroked);
 		    }
@@ -1309,6 +1337,11 @@ return( NULL );
 return( bdfc );
 }
 
+BDFChar *SplineCharFreeTypeRasterizeNoHints(SplineChar *sc,int layer,
+	int ptsize, int dpi,int depth) {
+return( _SplineCharFreeTypeRasterizeNoHints(NULL,sc,layer,ptsize,dpi,depth));
+}
+
 BDFFont *SplineFontFreeTypeRasterizeNoHints(SplineFont *sf,int layer,int pixelsize,int depth) {
     SplineFont *subsf;
     int i,k;
@@ -1348,6 +1381,93 @@ return( _FreeTypeFontContext(sf,sc,fv,layer,sf->subfontcnt!=0?ff_otfcid:
 	sf->layers[layer].order2?ff_ttf:ff_pfb,0,NULL) );
 }
 
+static int SCWouldBeHinted(SplineChar *sc,int layer) {
+    RefChar *ref;
+
+    if ( sc->changedsincelasthinted && !sc->manualhints )
+return( true );
+    for ( ref=sc->layers[layer].refs; ref!=NULL; ref=ref->next )
+	if ( SCWouldBeHinted(ref->sc,layer))
+return( true );
+return( false );
+}
+
+void *FreeTypeFontContextIncremental(SplineFont *sf,int layer) {
+    /* Piecemeal fonts used to build a tiny font for each glyph they */
+    /*  rasterized. Instead build the whole font once, and remember which */
+    /*  glyphs went into it. When a glyph changes it is dropped from here */
+    /*  and gets a tiny font of its own, as before */
+    FTC *ftc;
+    int i, ahbg = autohint_before_generate;
+
+    /* Don't autohint the font now, that would update (and so rasterize) */
+    /*  every glyph in it before we had anything to show. Glyphs which */
+    /*  want hints are left to the tiny fonts, which hint just them */
+    autohint_before_generate = false;
+    ftc = FreeTypeFontContext(sf,NULL,NULL,layer);
+    autohint_before_generate = ahbg;
+    if ( ftc==NULL )
+return( NULL );
+
+    ftc->glyphcnt = sf->glyphcnt;
+    ftc->glyphs = galloc(sf->glyphcnt*sizeof(SplineChar *));
+    memcpy(ftc->glyphs,sf->glyphs,sf->glyphcnt*sizeof(SplineChar *));
+    ftc->serials = galloc(sf->glyphcnt*sizeof(uint32));
+    for ( i=0; i<ftc->glyphcnt; ++i )
+	ftc->serials[i] = ftc->glyphs[i]!=NULL ? ftc->glyphs[i]->serial : 0;
+    if ( ahbg && !ftc->isttf ) {
+	for ( i=0; i<ftc->glyphcnt; ++i )
+	    if ( ftc->glyphs[i]!=NULL && SCWouldBeHinted(ftc->glyphs[i],layer))
+		ftc->glyphs[i] = NULL;
+    }
+return( ftc );
+}
+
+int FreeTypeContextHasGlyph(void *freetypecontext,SplineChar *sc) {
+    FTC *ftc = freetypecontext;
+    int gid = sc->orig_pos;
+
+return( gid>=0 && gid<ftc->glyphcnt && ftc->glyphs[gid]==sc &&
+	ftc->serials[gid]==sc->serial && ftc->glyph_indeces[gid]!=-1 );
+}
+
+void FreeTypeContextGlyphChanged(void *freetypecontext,int gid) {
+    FTC *ftc = freetypecontext;
+
+    if ( gid>=0 && gid<ftc->glyphcnt )
+	ftc->glyphs[gid] = NULL;
+}
+
+void *FreeTypeContextForThread(void *freetypecontext) {
+    /* Another face on the font of freetypecontext, for use on another */
+    /*  thread. It gets a library of its own too, as the rasterizer's pool */
+    /*  belongs to the library. With no freetypecontext we just make the */
+    /*  library, which is all _SplineCharFreeTypeRasterizeNoHints needs */
+    FTC *ftc = freetypecontext, *new;
+
+    if ( !hasFreeType())
+return( NULL );
+    new = gcalloc(1,sizeof(FTC));
+    if ( ftc!=NULL ) {
+	*new = *ftc;
+	new->face = NULL;
+	new->shared_ftc = ftc;
+	new->glyphs = NULL;
+	new->glyphcnt = 0;
+    }
+    new->library = NULL;
+    if ( _FT_Init_FreeType(&new->library) ) {
+	free(new);
+return( NULL );
+    }
+    if ( ftc!=NULL && _FT_New_Memory_Face(new->library,ftc->mappedfile,ftc->len,0,&new->face)) {
+	_FT_Done_FreeType(new->library);
+	free(new);
+return( NULL );
+    }
+return( new );
+}
+
 void FreeType_FreeRaster(struct freetype_raster *raster) {
     if ( raster==NULL || raster==(void *) -1 )
 return;
@@ -487,9 +487,11 @@ return( head );
 SplineChar *SplineCharCopy(SplineChar *sc,SplineFont *into,struct sfmergecontext *mc) {
     SplineChar *nsc = SFSplineCharCreate(into);
     Layer *layers = nsc->layers;
+    uint32 serial = nsc->serial;
     int layer, lycopy;
 
     *nsc = *sc;		/* We copy the layers just below */
+    nsc->serial = serial;
     nsc->layer_cnt = into==NULL?2:into->layer_cnt;
     nsc->layers = layers;
     lycopy = sc->layer_cnt>nsc->layer_cnt ? nsc->layer_cnt : sc->layer_cnt;
@@ -618,8 +620,28 @@ return;
     }
 }
 
+static void GlyphUniHashFree(SplineFont *sf) {
+    struct glyphunibucket *test, *next;
+    int i;
+
+    if ( sf->glyphunis==NULL )
+return;
+    for ( i=0; i<sf->glyphunis->size; ++i ) {
+	for ( test = sf->glyphunis->table[i]; test!=NULL; test = next ) {
+	    next = test->next;
+	    chunkfree(test,sizeof(struct glyphunibucket));
+	}
+    }
+    free(sf->glyphunis->table);
+    free(sf->glyphunis);
+    sf->glyphunis = NULL;
+}
+
 static void _GlyphHashFree(SplineFont *sf) {
 
+    /* Compiled glyph classes map names to glyphs too */
+    ++(sf->cidmaster!=NULL ? sf->cidmaster : sf)->class_generation;
+    GlyphUniHashFree(sf);
     if ( sf->glyphnames==NULL )
 return;
     __GlyphHashFree(sf->glyphnames);
@@ -661,11 +683,78 @@ return;
     } while ( k<sf->subfontcnt );
 }
 
+static int hashuni(struct glyphunihash *guh,int uni) {
+return( (((uint32) uni)*2654435761U)>>8 & (guh->size-1) );
+}
+
+static void UniHashAdd(struct glyphunihash *guh,SplineChar *sc,int gid,int uni) {
+    struct glyphunibucket *test, **old;
+    int i, hash, oldsize;
+
+    if ( uni==-1 )
+return;
+    hash = hashuni(guh,uni);
+    for ( test=guh->table[hash]; test!=NULL; test=test->next )
+	if ( test->sc==sc && test->gid==gid && test->uni==uni )
+return;
+    if ( guh->cnt>=guh->size ) {
+	old = guh->table; oldsize = guh->size;
+	guh->size *= 2;
+	guh->table = gcalloc(guh->size,sizeof(struct glyphunibucket *));
+	for ( i=0; i<oldsize; ++i ) {
+	    while ( (test=old[i])!=NULL ) {
+		old[i] = test->next;
+		hash = hashuni(guh,test->uni);
+		test->next = guh->table[hash];
+		guh->table[hash] = test;
+	    }
+	}
+	free(old);
+	hash = hashuni(guh,uni);
+    }
+    test = chunkalloc(sizeof(struct glyphunibucket));
+    test->sc = sc;
+    test->gid = gid;
+    test->uni = uni;
+    test->next = guh->table[hash];
+    guh->table[hash] = test;
+    ++guh->cnt;
+}
+
+static void UniHashAddGlyph(struct glyphunihash *guh,SplineChar *sc,int gid) {
+    struct altuni *alt;
+
+    UniHashAdd(guh,sc,gid,sc->unicodeenc);
+    for ( alt=sc->altuni; alt!=NULL; alt=alt->next )
+	UniHashAdd(guh,sc,gid,alt->unienc);
+}
+
+static void GlyphUniHashCreate(SplineFont *sf) {
+    struct glyphunihash *guh;
+    int i;
+
+    sf->glyphunis = guh = gcalloc(1,sizeof(*guh));
+    for ( guh->size=256; guh->size<sf->glyphcnt; guh->size*=2 );
+    guh->table = gcalloc(guh->size,sizeof(struct glyphunibucket *));
+    for ( i=0; i<sf->glyphcnt; ++i ) if ( sf->glyphs[i]!=NULL )
+	UniHashAddGlyph(guh,sf->glyphs[i],i);
+}
+
+void SFHashUnicode(SplineFont *sf,SplineChar *sc,int uni) {
+    /* sc just got a new (alternate) encoding. Put it in the lookup */
+    /* Removing an encoding needn't be tracked, matches get checked anyway */
+    if ( sf!=NULL && sf->glyphunis!=NULL )
+	UniHashAdd(sf->glyphunis,sc,sc->orig_pos,uni);
+}
+
 void SFHashGlyph(SplineFont *sf,SplineChar *sc) {
     /* sc just got added to the font. Put it in the lookup */
     int hash;
     struct glyphnamebucket *new;
 
+    if ( sf->glyphunis!=NULL )
+	UniHashAddGlyph(sf->glyphunis,sc,sc->orig_pos);
+    ++(sf->cidmaster!=NULL ? sf->cidmaster : sf)->class_generation;
     if ( sf->glyphnames==NULL )
 return;		/* No hash table, nothing to update */
 
@@ -701,6 +790,80 @@ return( true );
 return( false );
 }
 
+static int SCUniMatchNoVS(SplineChar *sc,int unienc) {
+    struct altuni *alt;
+
+    if ( sc->unicodeenc==unienc )
+return( true );
+    for ( alt=sc->altuni; alt!=NULL; alt=alt->next )
+	if ( alt->unienc==unienc && alt->vs==-1 && alt->fid==0 )
+return( true );
+
+return( false );
+}
+
+/* Look up the glyphs with a given code point. If want_vs is set then a */
+/*  variation selector sequence for the code point will match too. Returns */
+/*  the lowest gid matched (the highest if last is set), or -1 */
+static int SFHashUni(SplineFont *sf,int unienc,int want_vs,int last) {
+    struct glyphunibucket *test;
+    int gid = -1;
+
+    if ( unienc==-1 )
+return( -1 );
+    if ( sf->glyphunis==NULL )
+	GlyphUniHashCreate(sf);
+    for ( test=sf->glyphunis->table[hashuni(sf->glyphunis,unienc)]; test!=NULL; test=test->next ) {
+	if ( test->uni!=unienc )
+    continue;
+	if ( test->gid<0 || test->gid>=sf->glyphcnt || sf->glyphs[test->gid]!=test->sc ) {
+	    /* Glyphs have been moved or removed behind our back. Start again */
+	    GlyphUniHashFree(sf);
+return( SFHashUni(sf,unienc,want_vs,last));
+	}
+	if ( !(want_vs ? SCUniMatch(test->sc,unienc) : SCUniMatchNoVS(test->sc,unienc)) )
+    continue;
+	if ( gid==-1 || (last ? test->gid>gid : test->gid<gid) )
+	    gid = test->gid;
+    }
+return( gid );
+}
+
+/* Find the slot of a code point through the unicode hash, for encodings */
+/*  where the code point doesn't give it. If last is set we want the highest */
+/*  slot of any glyph with the code point, otherwise the lowest at or above */
+/*  min. A glyph's lowest slot is its backmap, and a glyph with only one code */
+/*  point is in only one slot. A glyph with alternates may be in several, so */
+/*  those must be searched for. Returns -1 if there is no slot, -2 to search */
+static int SFHashUniSlot(SplineFont *sf,EncMap *map,int unienc,int min,int last) {
+    struct glyphunibucket *test;
+    int slot, index = -1;
+
+    if ( sf->glyphunis==NULL )
+	GlyphUniHashCreate(sf);
+    for ( test=sf->glyphunis->table[hashuni(sf->glyphunis,unienc)]; test!=NULL; test=test->next ) {
+	if ( test->uni!=unienc )
+    continue;
+	if ( test->gid<0 || test->gid>=sf->glyphcnt || sf->glyphs[test->gid]!=test->sc ) {
+	    GlyphUniHashFree(sf);
+return( SFHashUniSlot(sf,map,unienc,min,last));
+	}
+	if ( !SCUniMatch(test->sc,unienc) )
+    continue;
+	if ( test->sc->altuni!=NULL || test->gid>=map->backmax )
+return( -2 );
+	if ( (slot = map->backmap[test->gid])==-1 )
+    continue;			/* Not in this encoding */
+	if ( slot<0 || slot>=map->enccount || map->map[slot]!=test->gid )
+return( -2 );
+	if ( slot<min )
+    continue;
+	if ( index==-1 || (last ? slot>index : slot<index) )
+	    index = slot;
+    }
+return( index );
+}
+
 /* Find the position in the glyph list where this code point/name is found. */
 /*  Returns -1 else on error */
 int SFFindGID(SplineFont *sf, int unienc, const char *name ) {
@@ -708,10 +871,9 @@ int SFFindGID(SplineFont *sf, int unienc, const char *name ) {
     SplineChar *sc;
 
     if ( unienc!=-1 ) {
-	for ( gid=0; gid<sf->glyphcnt; ++gid ) if ( sf->glyphs[gid]!=NULL ) {
-	    if ( SCUniMatch(sf->glyphs[gid],unienc) )
+	gid = SFHashUni(sf,unienc,true,false);
+	if ( gid!=-1 )
 return( gid );
-	}
     }
     if ( name!=NULL ) {
 	sc = SFHashName(sf,name);
@@ -743,10 +905,14 @@ int SFFindSlot(SplineFont *sf, EncMap *map, int unienc, const char *name ) {
 		sf->glyphs[map->map[unienc]]!=NULL &&
 		sf->glyphs[map->map[unienc]]->unicodeenc==unienc )
 	    index = unienc;
-	else for ( index = map->enccount-1; index>=0; --index ) {
-	    if ( (pos = map->map[index])!=-1 && sf->glyphs[pos]!=NULL &&
+	else if ( (index = SFHashUniSlot(sf,map,unienc,0,true))==-2 ) {
+	    /* A glyph with the code point may be in several slots and we */
+	    /*  want the last */
+	    for ( index = map->enccount-1; index>=0; --index ) {
+		if ( (pos = map->map[index])!=-1 && sf->glyphs[pos]!=NULL &&
 			SCUniMatch(sf->glyphs[pos],unienc) )
-	break;
+	    break;
+	    }
 	}
     } else if ( unienc!=-1 &&
 	    ((unienc<0x10000 && map->enc->is_unicodebmp) ||
@@ -755,12 +921,16 @@ int SFFindSlot(SplineFont *sf, EncMap *map, int unienc, const char *name ) {
     } else if ( unienc!=-1 ) {
 	index = EncFromUni(unienc,map->enc);
 	if ( index<0 || index>=map->enccount ) {
-	    for ( index=map->enc->char_cnt; index<map->enccount; ++index )
-		if ( (pos = map->map[index])!=-1 && sf->glyphs[pos]!=NULL &&
-			SCUniMatch(sf->glyphs[pos],unienc) )
-	    break;
-	    if ( index>=map->enccount )
-		index = -1;
+	    /* Might be an unencoded glyph beyond the end of the encoding */
+	    index = SFHashUniSlot(sf,map,unienc,map->enc->char_cnt,false);
+	    if ( index==-2 ) {
+		for ( index=map->enc->char_cnt; index<map->enccount; ++index )
+		    if ( (pos = map->map[index])!=-1 && sf->glyphs[pos]!=NULL &&
+			    SCUniMatch(sf->glyphs[pos],unienc) )
+		break;
+		if ( index>=map->enccount )
+		    index = -1;
+	    }
 	}
     }
     if ( index==-1 && name!=NULL ) {
@@ -770,12 +940,9 @@ int SFFindSlot(SplineFont *sf, EncMap *map, int unienc, const char *name ) {
 	    unienc = UniFromName(name,sf->uni_interp,map->enc);
 	    if ( unienc!=-1 )
 return( SFFindSlot(sf,map,unienc,NULL));
-	    if ( map->enc->psnames!=NULL ) {
-		for ( index = map->enc->char_cnt-1; index>=0; --index )
-		    if ( map->enc->psnames[index]!=NULL &&
-			    strcmp(map->enc->psnames[index],name)==0 )
+	    if ( map->enc->psnames!=NULL &&
+		    (index = EncFromPSName(name,map->enc,true))!=-1 )
 return( index );
-	    }
 	}
     }
 
@@ -858,8 +1025,11 @@ SplineChar *SFGetChar(SplineFont *sf, int unienc, const char *name ) {
     if ( ind==-1 )
 return( NULL );
 
-    if ( sf->subfonts==NULL && sf->cidmaster==NULL )
+    if ( sf->subfonts==NULL && sf->cidmaster==NULL ) {
+	if ( sf->lazy!=NULL )
+	    SFDLoadLazyGlyph(sf->glyphs[ind]);
 return( sf->glyphs[ind]);
+    }
 
     if ( sf->cidmaster!=NULL )
 	sf=sf->cidmaster;
@@ -904,19 +1074,9 @@ return( sc );
 
 static int _SFFindExistingSlot(SplineFont *sf, int unienc, const char *name ) {
     int gid = -1;
-    struct altuni *altuni;
 
-    if ( unienc!=-1 ) {
-	for ( gid=sf->glyphcnt-1; gid>=0; --gid ) if ( sf->glyphs[gid]!=NULL ) {
-	    if ( sf->glyphs[gid]->unicodeenc==unienc )
-	break;
-	    for ( altuni=sf->glyphs[gid]->altuni ; altuni!=NULL &&
-		    (altuni->unienc!=unienc || altuni->vs!=-1 || altuni->fid!=0);
-		    altuni=altuni->next );
-	    if ( altuni!=NULL )
-	break;
-	}
-    }
+    if ( unienc!=-1 )
+	gid = SFHashUni(sf,unienc,false,true);
     if ( gid==-1 && name!=NULL ) {
 	SplineChar *sc = SFHashName(sf,name);
 	if ( sc==NULL )
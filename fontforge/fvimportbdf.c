@@ -2360,6 +2360,7 @@ static void SFAddToBackground(SplineFont *sf,BDFFont *bdf) {
 		sc->name = copy(bdf->glyphs[i]->sc->name);
 		sc->orig_pos = i;
 		sc->unicodeenc = bdf->glyphs[i]->sc->unicodeenc;
+		SFHashGlyph(sf,sc);
 	    }
 	    bdfc = bdf->glyphs[i];
 
@@ -1194,6 +1194,7 @@ static void FDAddMissingGlyph(struct font_diff *fd,SplineChar *sc2) {
     free(sc->name);
     sc->name = copy(sc2->name);
     sc->unicodeenc = sc2->unicodeenc;
+    SFHashUnicode(fd->sf1,sc,sc->unicodeenc);
     SCAddBackgrounds(sc,sc2,fd);
 }
 
@@ -1192,6 +1192,7 @@ return( true );
 	kc->subtable->onlyCloser = onlyCloser;
 	kc->subtable->dontautokern = !autokern;
 
+	KernClassClearIndex(kc);
 	kc->first_cnt = kcd->first_cnt;
 	kc->second_cnt = kcd->second_cnt;
 	kc->firsts = galloc(kc->first_cnt*sizeof(char *));
@@ -3340,8 +3341,8 @@ KernClass *SFFindKernClass(SplineFont *sf,SplineChar *first,SplineChar *last,
     for ( i=0; i<=pcnt; ++i ) {
 	for ( kc=sf->kerns; kc!=NULL; kc=kc->next ) {
 	    uint8 kspecd = kc->firsts[0] != NULL;
-	    f = KCFindName(first->name,kc->firsts ,kc->first_cnt ,i % 2);
-	    l = KCFindName(last->name ,kc->seconds,kc->second_cnt,i % 2);
+	    f = KCFindClass(kc,first,false,i % 2);
+	    l = KCFindClass(kc,last ,true ,i % 2);
 	    if ( f!=-1 && l!=-1 && ( kspecd || f!=0 || l!=0 )  ) {
 		if ( i > 1 || kc->offsets[f*kc->second_cnt+l]!=0 ) {
 		    *index = f*kc->second_cnt+l;
@@ -3362,8 +3363,8 @@ KernClass *SFFindVKernClass(SplineFont *sf,SplineChar *first,SplineChar *last,
     for ( i=0; i<=pcnt; ++i ) {
 	for ( kc=sf->vkerns; kc!=NULL; kc=kc->next ) {
 	    uint8 kspecd = kc->firsts[0] != NULL;
-	    f = KCFindName(first->name,kc->firsts ,kc->first_cnt ,i % 2);
-	    l = KCFindName(last->name ,kc->seconds,kc->second_cnt,i % 2);
+	    f = KCFindClass(kc,first,false,i % 2);
+	    l = KCFindClass(kc,last ,true ,i % 2);
 	    if ( f!=-1 && l!=-1 && ( kspecd || f!=0 || l!=0 ) ) {
 		if ( i > 1 || kc->offsets[f*kc->second_cnt+l]!=0 ) {
 		    *index = f*kc->second_cnt+l;
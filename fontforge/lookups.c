@@ -34,6 +34,9 @@
 #include <stdarg.h>
 #include "ttf.h"
 #include "lookups.h"
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
 
 struct opentype_feature_friendlynames friendlies[] = {
 #if 0		/* They get stuffed into the 'MATH' table now */
@@ -1425,13 +1428,9 @@ static struct {
     { NULL }
 };
 
-void LookupInit(void) {
-    static int done = false;
+static void _LookupInit(void) {
     int i, j;
 
-    if ( done )
-return;
-    done = true;
     for ( j=0; j<2; ++j ) {
 	for ( i=0; i<10; ++i )
 	    if ( lookup_type_names[j][i]!=NULL )
@@ -1443,6 +1442,24 @@ return;
 	friendlies[i].friendlyname = S_(friendlies[i].friendlyname);
 }
 
+/* The first fonts may be loaded on several threads at once */
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t lookup_once = PTHREAD_ONCE_INIT;
+
+void LookupInit(void) {
+    pthread_once(&lookup_once,_LookupInit);
+}
+#else
+void LookupInit(void) {
+    static int done = false;
+
+    if ( done )
+return;
+    done = true;
+    _LookupInit();
+}
+#endif
+
 char *TagFullName(SplineFont *sf,uint32 tag, int ismac, int onlyifknown) {
     char ubuf[200], *end = ubuf+sizeof(ubuf), *setname;
     int k;
@@ -1996,6 +2013,7 @@ static KernClass *SF_AddKernClass(struct sfmergecontext *mc,KernClass *kc,
     newkc = chunkalloc(sizeof(KernClass));
     *newkc = *kc;
     newkc->subtable = sub;
+    newkc->firstidx = newkc->secondidx = NULL;
     if ( sub->vertical_kerning ) {
 	newkc->next = mc->sf_to->vkerns;
 	mc->sf_to->vkerns = newkc;
@@ -2019,6 +2037,7 @@ static FPST *SF_AddFPST(struct sfmergecontext *mc,FPST *fpst,
     newfpst = chunkalloc(sizeof(FPST));
     *newfpst = *fpst;
     newfpst->subtable = sub;
+    newfpst->nclassidx = newfpst->bclassidx = newfpst->fclassidx = NULL;
     newfpst->next = mc->sf_to->possub;
     mc->sf_to->possub = newfpst;
 
@@ -2610,6 +2629,23 @@ return( true );
 return( false );
 }
 
+/* Which class of a contextual lookup is the glyph in? which is 0 for the */
+/*  match classes, 1 for backtrack, 2 for lookahead. -1 if in none */
+static int FPSTClassOf(FPST *fpst,int which,SplineChar *sc) {
+    char **classes = (&fpst->nclass)[which];
+    int cnt = (&fpst->nccnt)[which];
+    int class;
+
+    class = GlyphClassIndexFind(&(&fpst->nclassidx)[which],classes,cnt,sc);
+    if ( class==-2 ) {
+	for ( class=0; class<cnt; ++class )
+	    if ( GlyphNameInClass(sc->name,classes[class]) )
+return( class );
+return( -1 );
+    }
+return( class );
+}
+
 /* ************************************************************************** */
 /* ************************ Apply Apple State Machines ********************** */
 /* ************************************************************************** */
@@ -3058,7 +3094,7 @@ return( 0 );
     continue;		/* didn't match */
 	    } else if ( fpst->format==pst_class ) {
 		for ( i=bskipglyphs(lookup_flags,data,pos-1), cpos=0; i>=0 && cpos<rule->u.class.bcnt; i = bskipglyphs(lookup_flags,data,i-1)) {
-		    if ( !GlyphNameInClass(data->str[i].sc->name,fpst->bclass[rule->u.class.bclasses[cpos]]) )
+		    if ( FPSTClassOf(fpst,1,data->str[i].sc)!=rule->u.class.bclasses[cpos] )
 		break;
 		    ++cpos;
 		}
@@ -3091,16 +3127,13 @@ return( 0 );
 	} else if ( fpst->format==pst_class ) {
 	    for ( i=pos, cpos=0; i<data->cnt && cpos<rule->u.class.ncnt; i = skipglyphs(lookup_flags,data,i+1)) {
 		int class = rule->u.class.nclasses[cpos];
+		int c = FPSTClassOf(fpst,0,data->str[i].sc);
 		if ( class!=0 ) {
-		    if ( !GlyphNameInClass(data->str[i].sc->name,fpst->nclass[class]) )
+		    if ( c!=class )
 	    break;
 		} else {
-		    int c;
 		    /* Ok, to match class 0 we must fail to match all other classes */
-		    for ( c=1; c<fpst->nccnt; ++c )
-			if ( !GlyphNameInClass(data->str[i].sc->name,fpst->nclass[c]) )
-		    break;
-		    if ( c!=fpst->nccnt )
+		    if ( c>0 )
 	    break;		/* It matched another class => not in class 0 */
 		}
 		data->str[i].context_pos = cpos++;
@@ -3135,7 +3168,7 @@ return( 0 );		/* Not ready to deal with reverse chainging */
     continue;		/* didn't match */
 	    } else if ( fpst->format==pst_class ) {
 		for ( i=retpos, cpos=0; i<data->cnt && cpos<rule->u.class.fcnt; i = skipglyphs(lookup_flags,data,i+1)) {
-		    if ( !GlyphNameInClass(data->str[i].sc->name,fpst->fclass[rule->u.class.fclasses[cpos]]) )
+		    if ( FPSTClassOf(fpst,2,data->str[i].sc)!=rule->u.class.fclasses[cpos] )
 		break;
 		    cpos++;
 		}
@@ -3369,8 +3402,8 @@ static int ApplyPairPosAtPos(struct lookup_subtable *sub,struct lookup_data *dat
 return( 0 );
     if ( sub->kc!=NULL ) {
 	kcspecd = sub->kc->firsts[0] != NULL;
-	f = KCFindName(data->str[pos].sc->name ,sub->kc->firsts ,sub->kc->first_cnt ,allow_class0);
-	l = KCFindName(data->str[npos].sc->name,sub->kc->seconds,sub->kc->second_cnt,allow_class0);
+	f = KCFindClass(sub->kc,data->str[pos].sc ,false,allow_class0);
+	l = KCFindClass(sub->kc,data->str[npos].sc,true ,allow_class0);
 	if ( f==-1 || l==-1 || ( !kcspecd && f==0 && l==0 ) )
 return( 0 );
 	data->str[pos].kc_index = within = f*sub->kc->second_cnt+l;
@@ -3674,33 +3707,110 @@ return( fl->featuretag );
 return( 0 );
 }
 
-/* This routine takes a string of glyphs and applies the opentype transformations */
-/*  indicated by the features (and script and language) we are passed, it returns */
-/*  a transformed string with substitutions applied and containing positioning */
-/*  info */
-struct opentype_str *ApplyTickedFeatures(SplineFont *sf,uint32 *flist, uint32 script, uint32 lang,
-	int pixelsize, SplineChar **glyphs) {
-    int isgpos, cnt;
+/* A shaping plan is the list of lookups which the features (and script and */
+/*  language) select, worked out once so that many strings can be shaped */
+/*  with it. If asked the plan also records, for the simpler lookup types, */
+/*  which glyphs could possibly start a match, so that we don't have to look */
+/*  through the subtables at every position of every string. The plan */
+/*  points into the font, it must be freed before the font's lookups change */
+struct shaping_lookup {
     OTLookup *otl;
-    struct lookup_data data;
-    uint32 *langs, templang;
-    int i;
+    uint32 tag;
+    uint8 *coverage;		/* One bit per glyph (by orig_pos), NULL if all glyphs might match */
+};
 
-    memset(&data,0,sizeof(data));
-    for ( cnt=0; glyphs[cnt]!=NULL; ++cnt );
-    data.str = gcalloc(cnt+1,sizeof(struct opentype_str));
-    data.cnt = data.max = cnt;
-    for ( cnt=0; glyphs[cnt]!=NULL; ++cnt ) {
-	data.str[cnt].sc = glyphs[cnt];
-	data.str[cnt].orig_index = cnt;
-	data.str[cnt].lig_pos = data.str[cnt].context_pos = -1;
+struct shaping_plan {
+    SplineFont *sf;		/* cidmaster if there is one */
+    int gcnt;			/* number of glyphs the coverage bitmaps cover */
+    int cnt[2];			/* gsub, gpos */
+    struct shaping_lookup *lookups[2];
+};
+
+static void CoverageSet(uint8 *coverage,SplineChar *sc,int gcnt) {
+    if ( sc->orig_pos>=0 && sc->orig_pos<gcnt )
+	coverage[sc->orig_pos>>3] |= 1<<(sc->orig_pos&7);
+}
+
+static int ShapingGlyphCovered(struct shaping_plan *plan,struct shaping_lookup *sl,
+	SplineChar *sc) {
+    SplineFont *parent = sc->parent;
+
+    if ( sl->coverage==NULL || sc->orig_pos<0 || sc->orig_pos>=plan->gcnt )
+return( true );
+    /* A glyph we can't find in the font might be anything, assume it matches */
+    if ( parent==NULL || (parent!=plan->sf && parent->cidmaster!=plan->sf) ||
+	    sc->orig_pos>=parent->glyphcnt || parent->glyphs[sc->orig_pos]!=sc )
+return( true );
+return( (sl->coverage[sc->orig_pos>>3] & (1<<(sc->orig_pos&7)))!=0 );
+}
+
+static uint8 *ShapingCoverage(struct shaping_plan *plan,OTLookup *otl) {
+    int lt = otl->lookup_type, isv, k, gid;
+    struct lookup_subtable *sub;
+    SplineFont *ssf;
+    SplineChar *sc;
+    uint8 *coverage;
+    PST *pst;
+    KernPair *kp;
+
+    if ( lt!=gsub_single && lt!=gsub_multiple && lt!=gsub_alternate &&
+	    lt!=gpos_single && lt!=gpos_pair )
+return( NULL );
+    if ( lt==gpos_pair ) {
+	/* A kerning class without a specified first class 0 covers everything */
+	for ( sub=otl->subtables; sub!=NULL; sub=sub->next )
+	    if ( sub->kc!=NULL && sub->kc->firsts[0]==NULL )
+return( NULL );
     }
+
+    coverage = gcalloc((plan->gcnt+7)/8,1);
+    k=0;
+    do {
+	ssf = plan->sf->subfontcnt==0 ? plan->sf : plan->sf->subfonts[k];
+	for ( gid=0; gid<ssf->glyphcnt; ++gid ) if ( (sc=ssf->glyphs[gid])!=NULL ) {
+	    for ( pst=sc->possub; pst!=NULL; pst=pst->next )
+		if ( pst->subtable!=NULL && pst->subtable->lookup==otl ) {
+		    CoverageSet(coverage,sc,plan->gcnt);
+	    break;
+		}
+	    if ( lt!=gpos_pair )
+	continue;
+	    for ( isv=0; isv<2; ++isv ) {
+		for ( kp = isv ? sc->vkerns : sc->kerns; kp!=NULL; kp=kp->next )
+		    if ( kp->subtable!=NULL && kp->subtable->lookup==otl ) {
+			CoverageSet(coverage,sc,plan->gcnt);
+		break;
+		    }
+	    }
+	    for ( sub=otl->subtables; sub!=NULL; sub=sub->next )
+		if ( sub->kc!=NULL && KCFindClass(sub->kc,sc,false,true)!=-1 ) {
+		    CoverageSet(coverage,sc,plan->gcnt);
+	    break;
+		}
+	}
+	++k;
+    } while ( k<plan->sf->subfontcnt );
+return( coverage );
+}
+
+struct shaping_plan *ShapingPlanCreate(SplineFont *sf,uint32 *flist, uint32 script,
+	uint32 lang, int precompile) {
+    struct shaping_plan *plan;
+    int isgpos, cnt, i, k;
+    OTLookup *otl;
+    uint32 *langs, templang, tag;
+
     if ( sf->cidmaster!=NULL ) sf=sf->cidmaster;
-    data.sf = sf;
-    data.pixelsize = pixelsize;
-    data.scale = pixelsize/(double) (sf->ascent+sf->descent);
+    plan = gcalloc(1,sizeof(struct shaping_plan));
+    plan->sf = sf;
+    if ( sf->subfontcnt==0 )
+	plan->gcnt = sf->glyphcnt;
+    else {
+	for ( k=0; k<sf->subfontcnt; ++k )
+	    if ( sf->subfonts[k]->glyphcnt>plan->gcnt )
+		plan->gcnt = sf->subfonts[k]->glyphcnt;
+    }
 
-    /* Indic glyph reordering???? */
     for ( isgpos=0; isgpos<2; ++isgpos ) {
 	/* Check that this table has an entry for this language */
 	/*  if it doesn't use the default language */
@@ -3712,11 +3822,83 @@ struct opentype_str *ApplyTickedFeatures(SplineFont *sf,uint32 *flist, uint32 sc
 	    templang = DEFAULT_LANG;
 	free(langs);
 
+	cnt = 0;
+	for ( otl = isgpos ? sf->gpos_lookups : sf->gsub_lookups; otl!=NULL ; otl = otl->next )
+	    ++cnt;
+	plan->lookups[isgpos] = galloc((cnt+1)*sizeof(struct shaping_lookup));
+	cnt = 0;
 	for ( otl = isgpos ? sf->gpos_lookups : sf->gsub_lookups; otl!=NULL ; otl = otl->next ) {
-	    uint32 tag;
-	    if ( (tag=FSLLMatches(otl->features,flist,script,templang))!=0 )
-		ApplyLookup(tag,otl,&data);
+	    if ( (tag=FSLLMatches(otl->features,flist,script,templang))!=0 ) {
+		plan->lookups[isgpos][cnt].otl = otl;
+		plan->lookups[isgpos][cnt].tag = tag;
+		plan->lookups[isgpos][cnt].coverage = precompile ? ShapingCoverage(plan,otl) : NULL;
+		++cnt;
+	    }
 	}
+	plan->cnt[isgpos] = cnt;
+    }
+return( plan );
+}
+
+void ShapingPlanFree(struct shaping_plan *plan) {
+    int isgpos, i;
+
+    if ( plan==NULL )
+return;
+    for ( isgpos=0; isgpos<2; ++isgpos ) {
+	for ( i=0; i<plan->cnt[isgpos]; ++i )
+	    free(plan->lookups[isgpos][i].coverage);
+	free(plan->lookups[isgpos]);
+    }
+    free(plan);
+}
+
+static void ShapingApplyLookup(struct shaping_plan *plan,struct shaping_lookup *sl,
+	struct lookup_data *data) {
+    int pos, npos;
+
+    if ( sl->coverage==NULL ) {
+	ApplyLookup(sl->tag,sl->otl,data);
+return;
+    }
+    for ( pos = 0; pos<data->cnt; ) {
+	if ( !ShapingGlyphCovered(plan,sl,data->str[pos].sc) )
+	    npos = pos+1;
+	else {
+	    npos = ApplyLookupAtPos(sl->tag,sl->otl,data,pos);
+	    if ( npos<=pos)
+		npos = pos+1;
+	}
+	pos = npos;
+    }
+}
+
+/* This routine takes a string of glyphs and applies the lookups of a shaping */
+/*  plan to it, it returns a transformed string with substitutions applied */
+/*  and containing positioning info */
+struct opentype_str *ShapingPlanApply(struct shaping_plan *plan,
+	int pixelsize, SplineChar **glyphs) {
+    int isgpos, cnt, i;
+    struct lookup_data data;
+    SplineFont *sf = plan->sf;
+
+    memset(&data,0,sizeof(data));
+    for ( cnt=0; glyphs[cnt]!=NULL; ++cnt );
+    data.str = gcalloc(cnt+1,sizeof(struct opentype_str));
+    data.cnt = data.max = cnt;
+    for ( cnt=0; glyphs[cnt]!=NULL; ++cnt ) {
+	data.str[cnt].sc = glyphs[cnt];
+	data.str[cnt].orig_index = cnt;
+	data.str[cnt].lig_pos = data.str[cnt].context_pos = -1;
+    }
+    data.sf = sf;
+    data.pixelsize = pixelsize;
+    data.scale = pixelsize/(double) (sf->ascent+sf->descent);
+
+    /* Indic glyph reordering???? */
+    for ( isgpos=0; isgpos<2; ++isgpos ) {
+	for ( i=0; i<plan->cnt[isgpos]; ++i )
+	    ShapingApplyLookup(plan,&plan->lookups[isgpos][i],&data);
     }
     LigatureFree(&data);
     free(data.ligs);
@@ -3726,6 +3908,22 @@ struct opentype_str *ApplyTickedFeatures(SplineFont *sf,uint32 *flist, uint32 sc
 return( data.str );
 }
 
+/* This routine takes a string of glyphs and applies the opentype transformations */
+/*  indicated by the features (and script and language) we are passed, it returns */
+/*  a transformed string with substitutions applied and containing positioning */
+/*  info */
+struct opentype_str *ApplyTickedFeatures(SplineFont *sf,uint32 *flist, uint32 script, uint32 lang,
+	int pixelsize, SplineChar **glyphs) {
+    struct shaping_plan *plan;
+    struct opentype_str *str;
+
+    /* For a single string it costs more to work out the coverage than to use it */
+    plan = ShapingPlanCreate(sf,flist,script,lang,false);
+    str = ShapingPlanApply(plan,pixelsize,glyphs);
+    ShapingPlanFree(plan);
+return( str );
+}
+
 static void doreplace(char **haystack,char *start,char *search,char *rpl,int slen) {
     int rlen;
     char *pt = start+slen;
@@ -4495,6 +4693,91 @@ return( i );
 return( classnames[0]!=NULL || !allow_class0 ? -1 : 0 );
 }
 
+static struct glyphclassindex *GlyphClassIndexCompile(SplineFont *sf,char **classnames,int cnt) {
+    struct glyphclassindex *gc = chunkalloc(sizeof(struct glyphclassindex));
+    int i, k;
+    char *pt, *end, ch;
+    SplineChar *sc;
+
+    gc->sf = sf;
+    gc->generation = sf->class_generation;
+    k = 0;
+    do {
+	if ( sf->subfontcnt==0 )
+	    gc->cnt = sf->glyphcnt;
+	else if ( sf->subfonts[k]->glyphcnt>gc->cnt )
+	    gc->cnt = sf->subfonts[k]->glyphcnt;
+	++k;
+    } while ( k<sf->subfontcnt );
+    gc->classes = galloc((gc->cnt+1)*sizeof(int));
+    memset(gc->classes,-1,(gc->cnt+1)*sizeof(int));
+
+    /* A glyph belongs to the first class which names it, as in KCFindName */
+    for ( i=0; i<cnt; ++i ) {
+	if ( classnames[i]==NULL )
+    continue;
+	for ( pt = classnames[i]; *pt; pt = end+1 ) {
+	    while ( *pt==' ' ) ++pt;
+	    if ( *pt=='\0' )
+	break;
+	    end = strchr(pt,' ');
+	    if ( end==NULL )
+		end = pt+strlen(pt);
+	    ch = *end;
+	    *end = '\0';
+	    sc = SFHashName(sf,pt);
+	    *end = ch;
+	    if ( sc!=NULL && sc->orig_pos>=0 && sc->orig_pos<gc->cnt ) {
+		if ( gc->classes[sc->orig_pos]==-1 )
+		    gc->classes[sc->orig_pos] = i;
+		else if ( gc->classes[sc->orig_pos]!=i )
+		    gc->overlaps = true;
+	    }
+	    if ( ch=='\0' )
+	break;
+	}
+    }
+return( gc );
+}
+
+/* Returns the class sc is in (or -1), compiling classnames into *_gc if */
+/*  need be. Returns -2 if sc isn't a glyph in a font we can index */
+int GlyphClassIndexFind(struct glyphclassindex **_gc,char **classnames,int cnt,SplineChar *sc) {
+    SplineFont *sf = sc->parent;
+
+    if ( sf==NULL || sc->orig_pos<0 || sc->orig_pos>=sf->glyphcnt ||
+	    sf->glyphs[sc->orig_pos]!=sc )
+return( -2 );
+    if ( sf->cidmaster!=NULL )
+	sf = sf->cidmaster;
+    if ( *_gc!=NULL && (*_gc)->sf==sf && (*_gc)->generation!=sf->class_generation ) {
+	/* Glyphs have been added or renamed since we built it */
+	GlyphClassIndexFree(*_gc);
+	*_gc = NULL;
+    }
+    if ( *_gc==NULL )
+	*_gc = GlyphClassIndexCompile(sf,classnames,cnt);
+    else if ( (*_gc)->sf!=sf )
+return( -2 );
+    if ( sc->orig_pos>=(*_gc)->cnt )
+return( -1 );
+return( (*_gc)->classes[sc->orig_pos] );
+}
+
+/* Same as KCFindName, but uses a compiled index for the kernclass */
+int KCFindClass(KernClass *kc, SplineChar *sc, int second, int allow_class0 ) {
+    char **classnames = second ? kc->seconds : kc->firsts;
+    int cnt = second ? kc->second_cnt : kc->first_cnt;
+    int class;
+
+    class = GlyphClassIndexFind(second ? &kc->secondidx : &kc->firstidx,classnames,cnt,sc);
+    if ( class==-2 )
+return( KCFindName(sc->name,classnames,cnt,allow_class0));
+    if ( class!=-1 )
+return( class );
+return( classnames[0]!=NULL || !allow_class0 ? -1 : 0 );
+}
+
 /* Routines to generate human readable forms of FPST rules */
 static void GrowBufferAddLookup(GrowBuf *gb,struct fpst_rule *rule, int seq) {
     int i;
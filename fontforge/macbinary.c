@@ -2971,7 +2971,7 @@ return( MightBeTrueType(f,pos,dlen,flags,openflags));
 return( IsResourceFork(f,offset,filename,flags,openflags,into,map));
 }
 
-static int lastch=0, repeat = 0;
+static ff_thread_local int lastch=0, repeat = 0;
 static void outchr(FILE *binary, int ch) {
     int i;
 
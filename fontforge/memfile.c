@@ -0,0 +1,162 @@
+/* Copyright (C) 2012 by George Williams */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+
+ * The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _NO_FOPENCOOKIE
+# define _GNU_SOURCE		/* For fopencookie */
+#endif
+#include "fontforgevw.h"
+#include <stdio.h>
+#include <string.h>
+
+/* When we build an sfnt every table (and many bits of tables) gets written */
+/*  into a temporary file, and then the lot is copied into the final font. */
+/*  Going through the file system for all that is slow, so where the libc */
+/*  lets us we hand out a stdio stream which is really just a growing block */
+/*  of memory. It can be read, written and seeked like any other tmpfile, */
+/*  with one exception: glibc loses track of where it is if a cookie stream */
+/*  with buffered output is seeked with SEEK_CUR. So don't, seek to */
+/*  ftell()+offset instead */
+/* Should a stream grow absurdly large we move its contents out into a real */
+/*  temporary file and pass everything on to that from then on */
+
+#ifndef _NO_FOPENCOOKIE
+#define MEMFILE_MAX	(256*1024*1024)
+
+struct memfile {
+    char *data;
+    size_t len, max, pos;
+    FILE *spill;
+};
+
+static ssize_t MemFileRead(void *_mf,char *buf,size_t size) {
+    struct memfile *mf = _mf;
+
+    if ( mf->spill!=NULL ) {
+	if ( fseek(mf->spill,mf->pos,SEEK_SET)!=0 )
+return( -1 );
+	size = fread(buf,1,size,mf->spill);
+	if ( ferror(mf->spill) )
+return( -1 );
+    } else {
+	if ( mf->pos>=mf->len )
+return( 0 );
+	if ( size>mf->len-mf->pos )
+	    size = mf->len-mf->pos;
+	memcpy(buf,mf->data+mf->pos,size);
+    }
+    mf->pos += size;
+return( size );
+}
+
+static int MemFileSpill(struct memfile *mf) {
+    mf->spill = tmpfile();
+    if ( mf->spill==NULL )
+return( false );
+    if ( fwrite(mf->data,1,mf->len,mf->spill)!=mf->len ) {
+	fclose(mf->spill);
+	mf->spill = NULL;
+return( false );
+    }
+    free(mf->data);
+    mf->data = NULL;
+    mf->max = 0;
+return( true );
+}
+
+static ssize_t MemFileWrite(void *_mf,const char *buf,size_t size) {
+    struct memfile *mf = _mf;
+
+    if ( mf->spill==NULL && mf->pos+size>MEMFILE_MAX && !MemFileSpill(mf))
+return( -1 );
+    if ( mf->spill!=NULL ) {
+	if ( fseek(mf->spill,mf->pos,SEEK_SET)!=0 )
+return( -1 );
+	size = fwrite(buf,1,size,mf->spill);
+	if ( ferror(mf->spill) )
+return( -1 );
+    } else {
+	if ( mf->pos+size>mf->max ) {
+	    size_t max = mf->max==0 ? 4096 : 2*mf->max;
+	    while ( max<mf->pos+size )
+		max *= 2;
+	    mf->data = grealloc(mf->data,max);
+	    mf->max = max;
+	}
+	if ( mf->pos>mf->len )		/* Seeked beyond the end, fill the hole */
+	    memset(mf->data+mf->len,0,mf->pos-mf->len);
+	memcpy(mf->data+mf->pos,buf,size);
+    }
+    mf->pos += size;
+    if ( mf->pos>mf->len )
+	mf->len = mf->pos;
+return( size );
+}
+
+static int MemFileSeek(void *_mf,off64_t *offset,int whence) {
+    struct memfile *mf = _mf;
+    off64_t pos;
+
+    if ( whence==SEEK_SET )
+	pos = *offset;
+    else if ( whence==SEEK_CUR )
+	pos = mf->pos + *offset;
+    else
+	pos = mf->len + *offset;
+    if ( pos<0 )
+return( -1 );
+    mf->pos = pos;
+    *offset = pos;
+return( 0 );
+}
+
+static int MemFileClose(void *_mf) {
+    struct memfile *mf = _mf;
+    int ret = 0;
+
+    if ( mf->spill!=NULL )
+	ret = fclose(mf->spill);
+    free(mf->data);
+    free(mf);
+return( ret );
+}
+
+FILE *MemTmpFile(void) {
+    static cookie_io_functions_t funcs = { MemFileRead, MemFileWrite, MemFileSeek, MemFileClose };
+    struct memfile *mf = gcalloc(1,sizeof(struct memfile));
+    FILE *ret;
+
+    ret = fopencookie(mf,"w+",funcs);
+    if ( ret==NULL ) {
+	free(mf);
+return( tmpfile());
+    }
+return( ret );
+}
+#else
+FILE *MemTmpFile(void) {
+return( tmpfile());
+}
+#endif
@@ -847,10 +847,8 @@ void MVReKern(MetricsView *mv) {
 void MVRegenChar(MetricsView *mv, SplineChar *sc) {
     int i;
 
-    if ( mv->bdf==NULL && sc->orig_pos<mv->show->glyphcnt ) {
-	BDFCharFree(mv->show->glyphs[sc->orig_pos]);
-	mv->show->glyphs[sc->orig_pos] = NULL;
-    }
+    if ( mv->bdf==NULL )
+	BDFPieceMealRegen(mv->show,sc->orig_pos);
     for ( i=0; i<mv->glyphcnt; ++i ) {
 	if ( mv->glyphs[i].sc == sc )
     break;
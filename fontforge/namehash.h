@@ -39,6 +39,20 @@ struct glyphnamehash {
     struct glyphnamebucket *table[GN_HSIZE];
 };
 
+/* Maps unicode code points (main encoding and altunis) to glyphs. The table */
+/*  grows with the font. A glyph may sit in several buckets, and a bucket may*/
+/*  outlive a change to the glyph's encoding, so matches must be checked */
+struct glyphunibucket {
+    SplineChar *sc;
+    int uni, gid;
+    struct glyphunibucket *next;
+};
+
+struct glyphunihash {
+    int size, cnt;		/* size is a power of 2 */
+    struct glyphunibucket **table;
+};
+
 #ifndef __GNUC__
 # define __inline__
 #endif
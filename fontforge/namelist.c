@@ -29,6 +29,9 @@
 #include "ustring.h"
 #include <utype.h>
 #include "namehash.h"
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
 
 int recognizePUA = false;
 NameList *force_names_when_opening=NULL;
@@ -93,6 +96,20 @@ static void psinitnames(void) {
     psnamesinited = true;
 }
 
+/* The first lookups by name may come from several threads at once */
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t psnames_once = PTHREAD_ONCE_INIT;
+
+static void psinitnamesonce(void) {
+    pthread_once(&psnames_once,psinitnames);
+}
+#else
+static void psinitnamesonce(void) {
+    if ( !psnamesinited )
+	psinitnames();
+}
+#endif
+
 static void psreinitnames(void) {
     /* If we reread a (loaded) namelist file, then we must remove the old defn*/
     /*  which means we must remove all the old hash entries before we can put */
@@ -153,8 +170,7 @@ int UniFromName(const char *name,enum uni_interp interp,Encoding *encname) {
     } else if ( name[0]!='\0' && name[1]=='\0' )
 	i = ((unsigned char *) name)[0];
     if ( i==-1 ) {
-	if ( !psnamesinited )
-	    psinitnames();
+	psinitnamesonce();
 	for ( buck = psbuckets[hashname(name)]; buck!=NULL; buck=buck->prev )
 	    if ( strcmp(buck->name,name)==0 )
 	break;
@@ -535,8 +551,7 @@ NameList *LoadNamelist(char *filename) {
     if ( file==NULL )
 return( NULL );
 
-    if ( !psnamesinited )
-	psinitnames();
+    psinitnamesonce();
 
     nl = chunkalloc(sizeof(NameList));
     pt = strrchr(filename,'/');
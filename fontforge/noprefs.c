@@ -138,6 +138,7 @@ static char *script_filenames[SCRIPT_MENU_MAX];
 static char *RecentFiles[RECENT_MAX];
 static int ItalicConstrained = true;
 extern int clear_tt_instructions_when_needed;	/* cvundoes.c */
+extern int thread_count_pref;			/* threadpool.c */
 static int default_cv_width;			/* in charview.c */
 static int default_cv_height;			/* in charview.c */
 static int mv_width;				/* in metricsview.c */
@@ -173,6 +174,7 @@ static struct prefs_list {
     char *popup;
 } core_list[] = {
     { N_("OtherSubrsFile"), pr_file, &othersubrsfile, NULL, NULL, 'O', NULL, 0, N_("If you wish to replace Adobe's OtherSubrs array (for Type1 fonts)\nwith an array of your own, set this to point to a file containing\na list of up to 14 PostScript subroutines. Each subroutine must\nbe preceded by a line starting with '%%%%' (any text before the\nfirst '%%%%' line will be treated as an initial copyright notice).\nThe first three subroutines are for flex hints, the next for hint\nsubstitution (this MUST be present), the 14th (or 13 as the\nnumbering actually starts with 0) is for counter hints.\nThe subroutines should not be enclosed in a [ ] pair.") },
+    { N_("ThreadCount"), pr_int, &thread_count_pref, NULL, NULL, '\0', NULL, 0, N_("The number of threads FontForge will use for slow jobs which it can\nsplit up (autohinting, validating, generating fonts...).\nIf set to 0 it will use one for each processor.") },
     { N_("NewCharset"), pr_encoding, &default_encoding, NULL, NULL, 'N', NULL, 0, N_("Default encoding for\nnew fonts") },
     { N_("NewEmSize"), pr_int, &new_em_size, NULL, NULL, 'S', NULL, 0, N_("The default size of the Em-Square in a newly created font.") },
     { N_("NewFontsQuadratic"), pr_bool, &new_fonts_are_order2, NULL, NULL, 'Q', NULL, 0, N_("Whether new fonts should contain splines of quadratic (truetype)\nor cubic (postscript & opentype).") },
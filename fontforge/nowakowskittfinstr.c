@@ -314,6 +314,29 @@ int TTF_getcvtval(SplineFont *sf,int val) {
 return( TTF__getcvtval(sf,val));
 }
 
+/* Like TTF_getcvtval, but if the cvt is read-only (because other threads
+ * are looking at it too) then a value which isn't there yet isn't added.
+ * We just note that, and the glyph gets instructed again on its own later.
+ */
+static int GICGetCvtVal(GlobalInstrCt *gic,int val) {
+    struct ttf_table *cvt_tab;
+    int i;
+
+    if ( !gic->cvt_readonly )
+return( TTF_getcvtval(gic->sf,val));
+
+    if ( val<0 ) val = -val;
+    if ( (cvt_tab = SFFindTable(gic->sf,CHR('c','v','t',' ')))!=NULL ) {
+        for ( i=0; (int)sizeof(uint16)*i<cvt_tab->len; ++i ) {
+            int tval = (int16) memushort(cvt_tab->data,cvt_tab->len, sizeof(uint16)*i);
+            if ( val>=tval-1 && val<=tval+1 )
+return( i );
+        }
+    }
+    gic->cvt_missed = true;
+return( 0 );
+}
+
 /* We are given a stem weight and try to find matching one in CVT.
  * If none found, we return -1.
  */
@@ -1991,6 +2014,9 @@ void InitGlobalInstrCt(GlobalInstrCt *gic, SplineFont *sf, int layer,
     gic->stemsnapv = NULL;
     gic->stemsnapvcnt = 0;
 
+    gic->cvt_readonly = false;
+    gic->cvt_missed = false;
+
     GICImportBlues(gic);
     GICImportStems(0, gic); /* horizontal stems */
     GICImportStems(1, gic); /* vertical stems */
@@ -4553,7 +4579,7 @@ return( ct->pt );
          * stems, but for diagonales it is just unlikely that we can find an
          * acceptable predefined value in StemSnapH or StemSnapV
          */
-        cvt = TTF_getcvtval( ct->gic->sf,ds->width );
+        cvt = GICGetCvtVal( ct->gic,ds->width );
 
         pushpts[0] = EF2Dot14(ds->l_to_r.x);
         pushpts[1] = EF2Dot14(ds->l_to_r.y);
@@ -5165,26 +5191,19 @@ static uint8 *dogeninstructions(InstrCt *ct) {
 return ct->sc->ttf_instrs = grealloc(ct->instrs,(ct->pt)-(ct->instrs));
 }
 
-void NowakowskiSCAutoInstr(GlobalInstrCt *gic, SplineChar *sc) {
-    int cnt, contourcnt;
-    BasePoint *bp;
-    int *contourends;
-    uint8 *clockwise;
-    uint8 *touched;
-    uint8 *affected;
-    SplineSet *ss;
+/* Checks that sc can be instructed, numbers its points and autohints it if */
+/*  need be. Returns false if there's nothing more to do with it */
+static int SCAutoInstrPrepare(GlobalInstrCt *gic, SplineChar *sc) {
     RefChar *ref;
-    InstrCt ct;
-    int i;
 
     if ( !sc->layers[gic->layer].order2 )
-return;
+return( false );
 
     if ( sc->layers[gic->layer].refs!=NULL && sc->layers[gic->layer].splines!=NULL ) {
 	ff_post_error(_("Can't instruct this glyph"),
 		_("TrueType does not support mixed references and contours.\nIf you want instructions for %.30s you should either:\n * Unlink the reference(s)\n * Copy the inline contours into their own (unencoded\n    glyph) and make a reference to that."),
 		sc->name );
-return;
+return( false );
     }
     for ( ref = sc->layers[gic->layer].refs; ref!=NULL; ref=ref->next ) {
 	if ( ref->transform[0]>=2 || ref->transform[0]<-2 ||
@@ -5197,7 +5216,7 @@ return;
 	ff_post_error(_("Can't instruct this glyph"),
 		_("TrueType does not support references which\nare scaled by more than 200%%.  But %1$.30s\nhas been in %2$.30s. Any instructions\nadded would be meaningless."),
 		ref->sc->name, sc->name );
-return;
+return( false );
     }
 
     if ( sc->ttf_instrs ) {
@@ -5211,7 +5230,7 @@ return;
 	SplineCharAutoHint(sc,gic->layer,NULL);
 
     if ( sc->vstem==NULL && sc->hstem==NULL && sc->dstem==NULL && sc->md==NULL)
-return;
+return( false );
 
     /* TODO!
      *
@@ -5223,8 +5242,21 @@ return;
      * Perhaps we should advise turning 'use my metrics' off.
      */
 
-    if ( sc->layers[gic->layer].splines==NULL )
-return;
+return( sc->layers[gic->layer].splines!=NULL );
+}
+
+/* Generates the instructions themselves. This looks at nothing but sc and */
+/*  gic, and only changes sc and the blues' highest and lowest points in gic */
+static void SCAutoInstrGenerate(GlobalInstrCt *gic, SplineChar *sc) {
+    int cnt, contourcnt;
+    BasePoint *bp;
+    int *contourends;
+    uint8 *clockwise;
+    uint8 *touched;
+    uint8 *affected;
+    SplineSet *ss;
+    InstrCt ct;
+    int i;
 
     /* Start dealing with the glyph */
     contourcnt = 0;
@@ -5274,7 +5306,96 @@ return;
     free(bp);
     free(contourends);
     free(clockwise);
+}
 
+void NowakowskiSCAutoInstr(GlobalInstrCt *gic, SplineChar *sc) {
+
+    if ( !SCAutoInstrPrepare(gic,sc))
+return;
+    SCAutoInstrGenerate(gic,sc);
     SCMarkInstrDlgAsChanged(sc);
     SCHintsChanged(sc);
 }
+
+/* Multi-threaded autoinstructing. Once the global context is set up each */
+/*  glyph's instructions depend almost only on that glyph. But the blue */
+/*  zones in the context also record the highest and lowest points of the */
+/*  glyph being instructed, so each worker gets its own copy of the context. */
+/*  And diagonal stems add their widths to the cvt as they find them, so a */
+/*  glyph's cvt indices may depend on the glyphs done before it. So the */
+/*  workers may only read the cvt, and a glyph which wants a value that isn't */
+/*  there yet gets done again afterwards, in order, on the main thread. As */
+/*  are the checks (which might post errors) and autohinting (which might */
+/*  hint a reference too), and telling the ui about the changes. So we get */
+/*  the same instructions we would have got from NowakowskiSCAutoInstr */
+struct aithreads {
+    SplineChar **glyphs;
+    GlobalInstrCt *gics;
+    char *redo;
+};
+
+static void AIThreadedGlyph(void *data,int i) {
+    struct aithreads *ait = data;
+    GlobalInstrCt *gic = &ait->gics[ThreadedWorkerIndex()];
+
+    gic->cvt_missed = false;
+    SCAutoInstrGenerate(gic,ait->glyphs[i]);
+    ait->redo[i] = gic->cvt_missed;
+}
+
+/* Instructs the cnt glyphs in glyphs, using up to threads worker threads. */
+/*  Returns false if the user cancelled */
+int NowakowskiAutoInstrThreaded(GlobalInstrCt *gic, SplineChar **glyphs,
+	int cnt, int threads) {
+    SplineChar **todo;
+    struct aithreads ait;
+    int i, tcnt, ok = true;
+
+    if ( threads<=1 ) {
+	for ( i=0; i<cnt; ++i ) {
+	    NowakowskiSCAutoInstr(gic,glyphs[i]);
+	    if ( !ff_progress_next())
+return( false );
+	}
+return( true );
+    }
+
+    todo = galloc(cnt*sizeof(SplineChar *));
+    tcnt = 0;
+    for ( i=0; i<cnt; ++i ) {
+	if ( SCAutoInstrPrepare(gic,glyphs[i]) )
+	    todo[tcnt++] = glyphs[i];
+	else if ( !ff_progress_next()) {
+	    ok = false;
+    break;
+	}
+    }
+
+    if ( ok && tcnt>0 ) {
+	ait.glyphs = todo;
+	ait.redo = gcalloc(tcnt,sizeof(char));
+	ait.gics = galloc(threads*sizeof(GlobalInstrCt));
+	for ( i=0; i<threads; ++i ) {
+	    ait.gics[i] = *gic;
+	    ait.gics[i].cvt_readonly = true;
+	}
+	ok = ThreadedForEach(tcnt,threads,true,AIThreadedGlyph,&ait);
+	free(ait.gics);
+	for ( i=0; i<tcnt; ++i ) if ( ait.redo[i] ) {
+	    free(todo[i]->ttf_instrs);
+	    todo[i]->ttf_instrs = NULL;
+	    SCAutoInstrGenerate(gic,todo[i]);
+	}
+	free(ait.redo);
+    }
+
+    /* If the user cancelled then glyphs which were prepared but never got */
+    /*  instructed are left with none (their old ones were freed), so they */
+    /*  have changed too */
+    for ( i=0; i<tcnt; ++i ) {
+	SCMarkInstrDlgAsChanged(todo[i]);
+	SCHintsChanged(todo[i]);
+    }
+    free(todo);
+return( ok );
+}
@@ -1263,12 +1263,11 @@ static void _InterpretPdf(FILE *in, struct pdfcontext *pc, EntityChar *ec) {
     DashType dashes[DASH_MAX];
     int dash_offset = 0;
     Entity *ent;
-    char oldloc[24];
+    CLocaleSave oldloc;
     char tokbuf[100];
     const int tokbufsize = 100;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
 
     transform[0] = transform[3] = 1.0;
     transform[1] = transform[2] = transform[4] = transform[5] = 0;
@@ -1576,7 +1575,7 @@ static void _InterpretPdf(FILE *in, struct pdfcontext *pc, EntityChar *ec) {
 	ec->splines = ent;
     }
     ECCatagorizePoints(ec);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 }
 
 static SplineChar *pdf_InterpretSC(struct pdfcontext *pc,char *glyphname,
@@ -1993,12 +1992,11 @@ static void pcFree(struct pdfcontext *pc) {
 
 char **NamesReadPDF(char *filename) {
     struct pdfcontext pc;
-    char oldloc[24];
+    CLocaleSave oldloc;
     int i;
     char **list;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     memset(&pc,0,sizeof(pc));
     pc.pdf = fopen(filename,"r");
     if ( pc.pdf==NULL )
@@ -2007,20 +2005,20 @@ return( NULL );
 	LogError( _("Doesn't look like a valid pdf file, couldn't find xref section") );
 	fclose(pc.pdf);
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pc.encrypted ) {
 	LogError( _("This pdf file contains an /Encrypt dictionary, and FontForge does not currently\nsupport pdf encryption" ));
 	fclose(pc.pdf);
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pdf_findfonts(&pc)==0 ) {
 	fclose(pc.pdf);
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     list = galloc((pc.fcnt+1)*sizeof(char *));
@@ -2029,7 +2027,7 @@ return( NULL );
     list[i] = NULL;
     fclose(pc.pdf);
     pcFree(&pc);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 return( list );
 }
 
@@ -2037,30 +2035,29 @@ SplineFont *_SFReadPdfFont(FILE *pdf,char *filename,char *select_this_font,
 	enum openflags openflags) {
     struct pdfcontext pc;
     SplineFont *sf = NULL;
-    char oldloc[24];
+    CLocaleSave oldloc;
     int i;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     memset(&pc,0,sizeof(pc));
     pc.pdf = pdf;
     pc.openflags = openflags;
     if ( (pc.objs = FindObjects(&pc))==NULL ) {
 	LogError( _("Doesn't look like a valid pdf file, couldn't find xref section") );
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pc.encrypted ) {
 	LogError( _("This pdf file contains an /Encrypt dictionary, and FontForge does not currently\nsupport pdf encryption" ));
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pdf_findfonts(&pc)==0 ) {
 	LogError( _("This pdf file has no fonts"));
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pc.fcnt==1 ) {
@@ -2092,7 +2089,7 @@ return( NULL );
 	if ( choice!=-1 )
 	    sf = pdf_loadfont(&pc,choice);
     }
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     pcFree(&pc);
 return( sf );
 }
@@ -2122,32 +2119,31 @@ return( sf );
 
 Entity *EntityInterpretPDFPage(FILE *pdf,int select_page) {
     struct pdfcontext pc;
-    char oldloc[24];
+    CLocaleSave oldloc;
     Entity *ent;
     char *ret;
     int choice;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     memset(&pc,0,sizeof(pc));
     pc.pdf = pdf;
     pc.openflags = 0;
     if ( (pc.objs = FindObjects(&pc))==NULL ) {
 	LogError( _("Doesn't look like a valid pdf file, couldn't find xref section") );
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pc.encrypted ) {
 	LogError( _("This pdf file contains an /Encrypt dictionary, and FontForge does not currently\nsupport pdf encryption" ));
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pdf_findpages(&pc)==0 ) {
 	LogError( _("This pdf file has no pages"));
 	pcFree(&pc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( NULL );
     }
     if ( pc.pcnt==1 ) {
@@ -2163,19 +2159,19 @@ return( NULL );
 	    ret = ff_ask_string(_("Pick a page"),"1",buffer);
 	    if ( ret==NULL ) {
 		pcFree(&pc);
-		setlocale(LC_NUMERIC,oldloc);
+		SwitchFromCLocale(&oldloc);
 return( NULL );
 	    }
 	    choice = strtol(ret,NULL,10)-1;
 	    if ( choice<0 || choice>=pc.pcnt ) {
 		pcFree(&pc);
-		setlocale(LC_NUMERIC,oldloc);
+		SwitchFromCLocale(&oldloc);
 return( NULL );
 	    }
 	}
 	ent = pdf_InterpretEntity(&pc,choice);
     }
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     pcFree(&pc);
 return( ent );
 }
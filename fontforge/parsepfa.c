@@ -2037,7 +2037,7 @@ return;
 /*  NOTE: readhexstring!!! */
 /* And in files generated by GNU fontutils */
 static int glorpline(struct fontparse *fp, FILE *temp, char *rdtok) {
-    static char *buffer=NULL, *end;
+    static ff_thread_local char *buffer=NULL, *end;
     char *pt, *binstart;
     int binlen;
     int ch;
@@ -2196,7 +2196,7 @@ return( 0 );
 return( 1 );
 }
 
-static int nrandombytes[4];
+static ff_thread_local int nrandombytes[4];
 #define EODMARKLEN	16
 
 #define bgetc(extra,in)	(*(extra)=='\0' ? getc(in) : (unsigned char ) *(extra)++ )
@@ -2569,7 +2569,7 @@ return;
 FontDict *_ReadPSFont(FILE *in) {
     FILE *temp;
     struct fontparse fp;
-    char oldloc[24];
+    CLocaleSave oldloc;
     struct stat b;
 
     temp = tmpfile();
@@ -2579,14 +2579,13 @@ FontDict *_ReadPSFont(FILE *in) {
 return(NULL);
     }
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     memset(&fp,'\0',sizeof(fp));
     fp.fd = fp.mainfd = PSMakeEmptyFont();
     fp.fdindex = -1;
     realdecrypt(&fp,in,temp);
     free(fp.vbuf);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 
     fclose(temp);
 
@@ -3641,7 +3641,7 @@ static SplineFont *cffsffillup(struct topdicts *subdict, char **strings,
 	int scnt, struct ttfinfo *info) {
     SplineFont *sf = SplineFontEmpty();
     int emsize;
-    static int nameless;
+    static ff_thread_local int nameless;
 
     sf->fontname = utf8_verify_copy(getsid(subdict->sid_fontname,strings,scnt,info));
     if ( sf->fontname==NULL ) {
@@ -5474,7 +5474,7 @@ return( false );
 }
 
 static int readttf(FILE *ttf, struct ttfinfo *info, char *filename) {
-    char oldloc[24];
+    CLocaleSave oldloc;
     int i;
 
     ff_progress_change_stages(3);
@@ -5482,8 +5482,7 @@ static int readttf(FILE *ttf, struct ttfinfo *info, char *filename) {
 return( 0 );
     }
     /* TrueType doesn't need this but opentype dictionaries do */
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     readttfpreglyph(ttf,info);
     ff_progress_change_total(info->glyph_cnt);
 
@@ -5504,7 +5503,7 @@ return( 0 );
 	buts[3] = NULL;
 	choice = ff_ask(_("Pick a font, any font..."),(const char **) buts,0,2,_("This font contains both a TrueType 'glyf' table and an OpenType 'CFF ' table. FontForge can only deal with one at a time, please pick which one you want to use"));
 	if ( choice==2 ) {
-	    setlocale(LC_NUMERIC,oldloc);
+	    SwitchFromCLocale(&oldloc);
 return( 0 );
 	} else if ( choice==0 )
 	    info->cff_start=0;
@@ -5526,16 +5525,16 @@ return( 0 );
     } else if ( info->cff_start!=0 ) {
 	info->to_order2 = (loaded_fonts_same_as_new && new_fonts_are_order2);
 	if ( !readcffglyphs(ttf,info) ) {
-	    setlocale(LC_NUMERIC,oldloc);
+	    SwitchFromCLocale(&oldloc);
 return( 0 );
 	}
     } else if ( info->typ1_start!=0 ) {
 	if ( !readtyp1glyphs(ttf,info) ) {
-	    setlocale(LC_NUMERIC,oldloc);
+	    SwitchFromCLocale(&oldloc);
 return( 0 );
 	}
     } else {
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( 0 );
     }
     if ( info->bitmapdata_start!=0 && info->bitmaploc_start!=0 )
@@ -5544,7 +5543,7 @@ return( 0 );
 	ff_post_error( _("No Bitmap Strikes"), _("No (useable) bitmap strikes in this TTF font: %s"), filename==NULL ? "<unknown>" : filename );
     if ( info->onlystrikes && info->bitmaps==NULL ) {
 	free(info->chars);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 return( 0 );
     }
     if ( info->hmetrics_start!=0 )
@@ -5615,7 +5614,7 @@ return( 0 );
 	tex_read(ttf,info);
     if ( info->math_start!=0 )
 	otf_read_math(ttf,info);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     if ( !info->onlystrikes && info->glyphlocations_start!=0 && info->glyph_start!=0 )
 	ttfFixupReferences(info);
     /* Can't fix up any postscript references until we create a SplineFont */
@@ -626,9 +626,9 @@ return;
 /* *********************** Output --- Writing Bitmaps *********************** */
 /* ************************************************************************** */
 
-static BDFChar glyph0, glyph1, glyph2;
-static SplineChar sc0, sc1, sc2;
-static struct bdfcharlist bl[3];
+static ff_thread_local BDFChar glyph0, glyph1, glyph2;
+static ff_thread_local SplineChar sc0, sc1, sc2;
+static ff_thread_local struct bdfcharlist bl[3];
 
 static struct bdfcharlist *BDFAddDefaultGlyphs(BDFFont *bdf, int format) {
     /* when I dump out the glyf table I add 3 glyphs at the start. One is glyph*/
@@ -1023,7 +1023,7 @@ static struct bitmapSizeTable *ttfdumpstrikelocs(FILE *bloc,FILE *bdat,
     struct bitmapSizeTable *size = gcalloc(1,sizeof(struct bitmapSizeTable));
     struct indexarray *cur, *last=NULL, *head=NULL;
     int i,j, final,cnt;
-    FILE *subtables = tmpfile();
+    FILE *subtables = MemTmpFile();
     int32 pos = ftell(bloc), startofsubtables, base, stlen;
     BDFChar *bc, *bc2;
     int depth = BDFDepth(bdf), format, mwidth, mheight;
@@ -1191,14 +1191,14 @@ static void dumpbitmapSizeTable(FILE *bloc,struct bitmapSizeTable *size) {
 
 void ttfdumpbitmap(SplineFont *sf,struct alltabs *at,int32 *sizes) {
     int i, j;
-    static struct bitmapSizeTable space;
+    static ff_thread_local struct bitmapSizeTable space;
     struct bitmapSizeTable *head=NULL, *cur, *last;
     BDFFont *bdf;
     BDFChar *bc;
     struct bdfcharlist *bl;
 
-    at->bdat = tmpfile();
-    at->bloc = tmpfile();
+    at->bdat = MemTmpFile();
+    at->bloc = MemTmpFile();
     /* aside from the names the version number is about the only difference */
     /*  I'm aware of. Oh MS adds a couple new sub-tables, but I haven't seen */
     /*  them used, and Apple also has a subtable MS doesn't support, but so what? */
@@ -1323,7 +1323,7 @@ void ttfdumpbitmapscaling(SplineFont *sf,struct alltabs *at,int32 *sizes) {
 	    ++cnt;
     }
 
-    at->ebsc = tmpfile();
+    at->ebsc = MemTmpFile();
     putlong( at->ebsc, 0x20000 );
     putlong( at->ebsc, cnt );
     for ( i=0; expected_sizes[i]!=0; ++i ) {
@@ -1279,7 +1279,7 @@ static void _InterpretPS(IO *wrapper, EntityChar *ec, RetStack *rs) {
     DashType dashes[DASH_MAX];
     int dash_offset = 0;
     Entity *ent;
-    char oldloc[24];
+    CLocaleSave oldloc;
     int warned = 0;
     struct garbage tofrees;
     SplineSet *clippath = NULL;
@@ -1293,8 +1293,7 @@ static void _InterpretPS(IO *wrapper, EntityChar *ec, RetStack *rs) {
     tokbuf = galloc(tokbufsize);
 #endif
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
 
     memset(&gb,'\0',sizeof(GrowBuf));
     memset(&dict,'\0',sizeof(dict));
@@ -2844,7 +2843,7 @@ printf( "-%s-\n", toknames[tok]);
     ECCatagorizePoints(ec);
     if ( ec->width == UNDEFINED_WIDTH )
 	ec->width = wrapper->advance_width;
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 #ifdef FONTFORGE_CONFIG_TYPE3
     free(tokbuf);
 #endif
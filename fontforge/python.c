@@ -675,6 +675,14 @@ static PyObject *PyFF_ActiveLayer(PyObject *self, PyObject *args) {
 return( Py_BuildValue("i", layer_active_in_ui ));
 }
 
+/* Long operations on a single font let go of the interpreter lock so other */
+/*  python threads may work on other fonts meanwhile. Only when there is no */
+/*  UI, as progress and error dialogs belong to the main thread. Nothing in */
+/*  between may touch python objects */
+#define FF_BEGIN_ALLOW_THREADS	{ PyThreadState *_save = NULL; \
+	if ( no_windowing_ui ) { ThreadsEnterCore(); _save = PyEval_SaveThread(); }
+#define FF_END_ALLOW_THREADS	if ( _save!=NULL ) { PyEval_RestoreThread(_save); ThreadsLeaveCore(); } }
+
 static FontViewBase *SFAdd(SplineFont *sf,int hide) {
     if ( sf->fv!=NULL )
 	/* All done */;
@@ -693,7 +701,10 @@ static PyObject *PyFF_OpenFont(PyObject *self, PyObject *args) {
     if ( !PyArg_ParseTuple(args,"es|i", "UTF-8", &filename, &openflags ))
 return( NULL );
     locfilename = utf82def_copy(filename);
-    sf = LoadSplineFont(locfilename,openflags);
+    /* Python looks at sf->glyphs directly, so glyphs can't be read lazily */
+    FF_BEGIN_ALLOW_THREADS
+    sf = LoadSplineFont(locfilename,openflags&~of_lazy);
+    FF_END_ALLOW_THREADS
     free(filename); free(locfilename);
     if ( sf==NULL ) {
 	PyErr_Format(PyExc_EnvironmentError, "Open failed");
@@ -724,6 +735,19 @@ return( NULL );
 return( tuple );
 }
 
+static PyObject *PyFF_MemoryUsage(PyObject *self, PyObject *args) {
+    struct chunkusage usage[200];
+    PyObject *tuple;
+    int cnt, i;
+
+    cnt = ChunkUsage(usage,sizeof(usage)/sizeof(usage[0]));
+    tuple = PyTuple_New(cnt);
+    for ( i=0; i<cnt; ++i )
+	PyTuple_SetItem(tuple,i,Py_BuildValue("(ill)",usage[i].size,
+		usage[i].inuse,usage[i].reserved));
+return( tuple );
+}
+
 static void prterror(void *foo, char *msg, int pos) {
     fprintf( stderr, "%s\n", msg );
 }
@@ -4261,10 +4285,90 @@ return( NULL );
 return( ss );
 }
 
-static PyFF_Contour *ContourFromSS(SplineSet *ss,PyFF_Contour *ret) {
-    int k, cnt;
+/* The points of a contour go either to point objects or to packed arrays */
+struct pointsink {
+    PyFF_Point **points;
+    char *coords;		/* x,y pairs of doubles, perhaps not aligned */
+    uint8 *flags;		/* PACKED_ON_CURVE|PACKED_SELECTED */
+};
+#define PACKED_ON_CURVE	1
+#define PACKED_SELECTED	2
+
+static void SinkPoint(struct pointsink *sink,int cnt,double x,double y,int on_curve,int sel) {
+    if ( sink->points!=NULL )
+	sink->points[cnt] = PyFFPoint_CNew(x,y,on_curve,sel);
+    else {
+	memcpy(sink->coords+2*cnt*sizeof(double),&x,sizeof(double));
+	memcpy(sink->coords+(2*cnt+1)*sizeof(double),&y,sizeof(double));
+	sink->flags[cnt] = (on_curve?PACKED_ON_CURVE:0) | (sel?PACKED_SELECTED:0);
+    }
+}
+
+/* Returns the number of points in the contour, and if sink is not NULL */
+/*  stores them there */
+static int SSPoints(SplineSet *ss,struct pointsink *sink,short *is_quadratic) {
+    int cnt;
     SplinePoint *sp, *skip;
 
+    if ( ss->first->next == NULL ) {
+	if ( sink!=NULL )
+	    SinkPoint(sink,0,ss->first->me.x,ss->first->me.y,true,ss->first->selected);
+	cnt = 1;
+    } else if ( ss->first->next->order2 ) {
+	*is_quadratic = true;
+	cnt = 0;
+	skip = NULL;
+	if ( SPInterpolate(ss->first) ) {
+	    skip = ss->first->prev->from;
+	    if ( sink!=NULL )
+		SinkPoint(sink,cnt,skip->nextcp.x,skip->nextcp.y,false,skip->selected);
+	    ++cnt;
+	}
+	for ( sp=ss->first; ; ) {
+	    if ( !SPInterpolate(sp) ) {
+		if ( sink!=NULL )
+		    SinkPoint(sink,cnt,sp->me.x,sp->me.y,true,sp->selected);
+		++cnt;
+	    }
+	    if ( !sp->nonextcp && sp!=skip ) {
+		if ( sink!=NULL )
+		    SinkPoint(sink,cnt,sp->nextcp.x,sp->nextcp.y,false,
+			    sp->selected && SPInterpolate(sp));
+		++cnt;
+	    }
+	    if ( sp->next==NULL )
+	break;
+	    sp = sp->next->to;
+	    if ( sp==ss->first )
+	break;
+	}
+    } else {
+	*is_quadratic = false;
+	for ( sp=ss->first, cnt=0; ; ) {
+	    if ( sink!=NULL )
+		SinkPoint(sink,cnt,sp->me.x,sp->me.y,true, sp->selected);
+	    ++cnt;			/* Sp itself */
+	    if ( sp->next==NULL )
+	break;
+	    if ( !sp->nonextcp || !sp->next->to->noprevcp ) {
+		if ( sink!=NULL ) {
+		    SinkPoint(sink,cnt  ,sp->nextcp.x,sp->nextcp.y,false,false);
+		    SinkPoint(sink,cnt+1,sp->next->to->prevcp.x,sp->next->to->prevcp.y,false,false);
+		}
+		cnt += 2;		/* not a line => 2 control points */
+	    }
+	    sp = sp->next->to;
+	    if ( sp==ss->first )
+	break;
+	}
+    }
+return( cnt );
+}
+
+static PyFF_Contour *ContourFromSS(SplineSet *ss,PyFF_Contour *ret) {
+    int cnt;
+    struct pointsink sink;
+
     if ( ret==NULL )
 	ret = (PyFF_Contour *) PyFFContour_new(&PyFF_ContourType,NULL,NULL);
     else
@@ -4275,67 +4379,15 @@ static PyFF_Contour *ContourFromSS(SplineSet *ss,PyFF_Contour *ret) {
     }
     ret->name = copy(ss->contour_name);
     ret->closed = ss->first->prev!=NULL;
-    for ( k=0; k<2; ++k ) {
-	if ( ss->first->next == NULL ) {
-	    if ( k )
-		ret->points[0] = PyFFPoint_CNew(ss->first->me.x,ss->first->me.y,true,ss->first->selected);
-	    cnt = 1;
-	} else if ( ss->first->next->order2 ) {
-	    ret->is_quadratic = true;
-	    cnt = 0;
-	    skip = NULL;
-	    if ( SPInterpolate(ss->first) ) {
-		skip = ss->first->prev->from;
-		if ( k )
-		    ret->points[cnt] = PyFFPoint_CNew(skip->nextcp.x,skip->nextcp.y,false,skip->selected);
-		++cnt;
-	    }
-	    for ( sp=ss->first; ; ) {
-		if ( !SPInterpolate(sp) ) {
-		    if ( k )
-			ret->points[cnt] = PyFFPoint_CNew(sp->me.x,sp->me.y,true,sp->selected);
-		    ++cnt;
-		}
-		if ( !sp->nonextcp && sp!=skip ) {
-		    if ( k )
-			ret->points[cnt] = PyFFPoint_CNew(sp->nextcp.x,sp->nextcp.y,false,
-				sp->selected && SPInterpolate(sp));
-		    ++cnt;
-		}
-		if ( sp->next==NULL )
-	    break;
-		sp = sp->next->to;
-		if ( sp==ss->first )
-	    break;
-	    }
-	} else {
-	    ret->is_quadratic = false;
-	    for ( sp=ss->first, cnt=0; ; ) {
-		if ( k )
-		    ret->points[cnt] = PyFFPoint_CNew(sp->me.x,sp->me.y,true, sp->selected);
-		++cnt;			/* Sp itself */
-		if ( sp->next==NULL )
-	    break;
-		if ( !sp->nonextcp || !sp->next->to->noprevcp ) {
-		    if ( k ) {
-			ret->points[cnt  ] = PyFFPoint_CNew(sp->nextcp.x,sp->nextcp.y,false,false);
-			ret->points[cnt+1] = PyFFPoint_CNew(sp->next->to->prevcp.x,sp->next->to->prevcp.y,false,false);
-		    }
-		    cnt += 2;		/* not a line => 2 control points */
-		}
-		sp = sp->next->to;
-		if ( sp==ss->first )
-	    break;
-	    }
-	}
-	if ( !k ) {
-	    if ( cnt>=ret->pt_max ) {
-		ret->pt_max = cnt;
-		PyMem_Resize(ret->points,PyFF_Point *,cnt);  /* Messes with ret->points */
-	    }
-	    ret->pt_cnt = cnt;
-	}
-    }
+    cnt = SSPoints(ss,NULL,&ret->is_quadratic);
+    if ( cnt>=ret->pt_max ) {
+	ret->pt_max = cnt;
+	PyMem_Resize(ret->points,PyFF_Point *,cnt);  /* Messes with ret->points */
+    }
+    ret->pt_cnt = cnt;
+    memset(&sink,0,sizeof(sink));
+    sink.points = ret->points;
+    SSPoints(ss,&sink,&ret->is_quadratic);
 return( ret );
 }
 
@@ -4822,10 +4874,27 @@ return( NULL );
 return( (PyObject * ) ly );
 }
 
+static void GlyphReplaceSplines(PyFF_Glyph *self,Layer *layer,SplineSet *ss,int isquad) {
+    SplineSet *newss;
+
+    if ( layer->order2!=isquad ) {
+	if ( layer->order2 )
+	    newss = SplineSetsTTFApprox(ss);
+	else
+	    newss = SplineSetsPSApprox(ss);
+	SplinePointListsFree(ss);
+	ss = newss;
+    }
+    SplinePointListsFree(layer->splines);
+    layer->splines = ss;
+
+    SCCharChangedUpdate(self->sc,self->layer);
+}
+
 static int PyFF_Glyph_set_a_layer(PyFF_Glyph *self,PyObject *value,void *closure, int layeri) {
     SplineChar *sc = self->sc;
     Layer *layer;
-    SplineSet *ss, *newss;
+    SplineSet *ss;
     int isquad;
 
     if ( layeri<-1 || layeri>=sc->layer_cnt ) {
@@ -4845,18 +4914,7 @@ return( -1 );
 	PyErr_Format(PyExc_TypeError, "Argument must be a layer or a contour" );
 return( -1 );
     }
-    if ( layer->order2!=isquad ) {
-	if ( layer->order2 )
-	    newss = SplineSetsTTFApprox(ss);
-	else
-	    newss = SplineSetsPSApprox(ss);
-	SplinePointListsFree(ss);
-	ss = newss;
-    }
-    SplinePointListsFree(layer->splines);
-    layer->splines = ss;
-
-    SCCharChangedUpdate(sc,self->layer);
+    GlyphReplaceSplines(self,layer,ss,isquad);
 return( 0 );
 }
 
@@ -5632,6 +5690,7 @@ static int PyFF_Glyph_set_unicode(PyFF_Glyph *self,PyObject *value,void *closure
     if ( PyErr_Occurred()!=NULL )
 return( -1 );
     self->sc->unicodeenc = uenc;
+    SFHashUnicode(self->sc->parent,self->sc,uenc);
     SCRefreshTitles(self->sc);
     for ( fvs=self->sc->parent->fv; fvs!=NULL; fvs=fvs->nextsame ) {
 	/* Postscript encodings are by name, others are by codepoint */
@@ -5693,6 +5752,8 @@ return( -1 );
 
     AltUniFree(self->sc->altuni);
     self->sc->altuni = head;
+    for ( cur=head; cur!=NULL; cur=cur->next )
+	SFHashUnicode(self->sc->parent,self->sc,cur->unienc);
 return( 0 );
 }
 
@@ -7304,6 +7365,217 @@ return(NULL);
 Py_RETURN( self );
 }
 
+/* Packed layers: the points of a layer as flat arrays rather than as one */
+/*  python object per point. Coordinates are native doubles (x,y pairs), */
+/*  flags are one byte per point, contour starts are native int32s (with */
+/*  a final entry giving the total point count) and closed is one byte per */
+/*  contour. They are bytearrays so numpy.frombuffer (and memoryview) can */
+/*  look at them without copying */
+static int PackedLayerIndex(PyFF_Glyph *self,PyObject *obj) {
+    SplineChar *sc = self->sc;
+    int layer;
+
+    if ( obj==NULL || obj==Py_None )
+return( self->layer );
+    if ( STRING_CHECK(obj)) {
+#if PY_MAJOR_VERSION >= 3
+	PyObject *bytes = PyUnicode_AsUTF8String(obj);
+	if ( bytes == NULL )
+return( -2 );
+	layer = SFFindLayerIndexByName(sc->parent,PyBytes_AsString(bytes));
+	Py_DECREF(bytes);
+#else /* PY_MAJOR_VERSION >= 3 */
+	layer = SFFindLayerIndexByName(sc->parent,PyBytes_AsString(obj));
+#endif /* PY_MAJOR_VERSION >= 3 */
+	if ( layer<0 )
+return( -2 );
+    } else if ( PyInt_Check(obj)) {
+	layer = PyInt_AsLong(obj);
+    } else {
+	PyErr_Format(PyExc_TypeError, "Layer must be a layer name or index" );
+return( -2 );
+    }
+    if ( layer<-1 || layer>=sc->layer_cnt ) {
+	PyErr_Format(PyExc_ValueError, "Bad layer" );
+return( -2 );
+    }
+return( layer );
+}
+
+static int PackedBuffer(PyObject *obj,Py_buffer *view,char **data,Py_ssize_t *len) {
+    memset(view,0,sizeof(*view));
+    if ( PyObject_CheckBuffer(obj) ) {
+	if ( PyObject_GetBuffer(obj,view,PyBUF_SIMPLE)==-1 )
+return( false );
+	*data = view->buf;
+	*len = view->len;
+return( true );
+    }
+#if PY_MAJOR_VERSION < 3
+    {	/* array.array only has the old buffer interface in python 2 */
+	const void *buf;
+	if ( PyObject_AsReadBuffer(obj,&buf,len)==0 ) {
+	    *data = (char *) buf;
+return( true );
+	}
+    }
+#endif /* PY_MAJOR_VERSION < 3 */
+    PyErr_Format(PyExc_TypeError, "Packed layer arrays must support the buffer protocol" );
+return( false );
+}
+
+static PyObject *PyFFGlyph_getPackedLayer(PyFF_Glyph *self, PyObject *args) {
+    SplineChar *sc = self->sc;
+    PyObject *layerobj = NULL;
+    PyObject *coords, *flags, *starts, *closed;
+    struct pointsink sink;
+    SplineSet *ss;
+    Layer *layer;
+    int layeri, n, m, cnt;
+    short is_quadratic;
+    char *cstarts;
+    int32 start;
+
+    if ( !PyArg_ParseTuple(args,"|O",&layerobj) )
+return( NULL );
+    layeri = PackedLayerIndex(self,layerobj);
+    if ( layeri==-2 )
+return( NULL );
+    layer = layeri==-1 ? &sc->parent->grid : &sc->layers[layeri];
+
+    n = m = 0;
+    for ( ss=layer->splines; ss!=NULL; ss=ss->next, ++m )
+	n += SSPoints(ss,NULL,&is_quadratic);
+
+    coords = PyByteArray_FromStringAndSize(NULL,2*n*sizeof(double));
+    flags = PyByteArray_FromStringAndSize(NULL,n);
+    starts = PyByteArray_FromStringAndSize(NULL,(m+1)*sizeof(int32));
+    closed = PyByteArray_FromStringAndSize(NULL,m);
+    if ( coords==NULL || flags==NULL || starts==NULL || closed==NULL ) {
+	Py_XDECREF(coords); Py_XDECREF(flags);
+	Py_XDECREF(starts); Py_XDECREF(closed);
+return( NULL );
+    }
+    cstarts = PyByteArray_AS_STRING(starts);
+    memset(&sink,0,sizeof(sink));
+    sink.coords = PyByteArray_AS_STRING(coords);
+    sink.flags = (uint8 *) PyByteArray_AS_STRING(flags);
+    n = m = 0;
+    for ( ss=layer->splines; ss!=NULL; ss=ss->next, ++m ) {
+	start = n;
+	memcpy(cstarts+m*sizeof(int32),&start,sizeof(int32));
+	PyByteArray_AS_STRING(closed)[m] = ss->first->prev!=NULL;
+	cnt = SSPoints(ss,&sink,&is_quadratic);
+	sink.coords += 2*cnt*sizeof(double);
+	sink.flags += cnt;
+	n += cnt;
+    }
+    start = n;
+    memcpy(cstarts+m*sizeof(int32),&start,sizeof(int32));
+return( Py_BuildValue("(NNNNO)",coords,flags,starts,closed,
+	    layer->order2 ? Py_True : Py_False ));
+}
+
+static PyObject *PyFFGlyph_setPackedLayer(PyFF_Glyph *self, PyObject *args) {
+    SplineChar *sc = self->sc;
+    PyObject *coordobj, *flagobj, *startobj, *closedobj=Py_None, *layerobj=NULL;
+    Py_buffer views[4];
+    char *coords, *flags, *starts, *closed=NULL;
+    Py_ssize_t clen, flen, slen, closedlen=0;
+    int is_quadratic = false, layeri, n, m, i, j, tt_start=0, ok=false;
+    int32 *cstarts=NULL;
+    double xy[2];
+    PyFF_Point *pts=NULL, **ppts=NULL;
+    PyFF_Contour c;
+    SplineSet *head=NULL, *tail, *cur;
+    Layer *layer;
+
+    if ( !PyArg_ParseTuple(args,"OOO|OiO",&coordobj,&flagobj,&startobj,&closedobj,
+	    &is_quadratic,&layerobj) )
+return( NULL );
+    layeri = PackedLayerIndex(self,layerobj);
+    if ( layeri==-2 )
+return( NULL );
+    layer = layeri==-1 ? &sc->parent->grid : &sc->layers[layeri];
+
+    memset(views,0,sizeof(views));
+    if ( !PackedBuffer(coordobj,&views[0],&coords,&clen) ||
+	    !PackedBuffer(flagobj,&views[1],&flags,&flen) ||
+	    !PackedBuffer(startobj,&views[2],&starts,&slen) ||
+	    (closedobj!=Py_None && !PackedBuffer(closedobj,&views[3],&closed,&closedlen)) )
+ goto done;
+
+    n = flen;
+    m = slen/sizeof(int32)-1;
+    if ( clen!=2*n*sizeof(double) ) {
+	PyErr_Format(PyExc_ValueError, "There must be two coordinates for each flag" );
+ goto done;
+    }
+    if ( slen%sizeof(int32)!=0 || m<0 ) {
+	PyErr_Format(PyExc_ValueError, "Contour starts must begin with 0 and end with the number of points" );
+ goto done;
+    }
+    /* A buffer need not be aligned for its element type (a slice of a */
+    /*  bytearray, say), so copy the starts out rather than cast them */
+    cstarts = galloc((m+1)*sizeof(int32));
+    memcpy(cstarts,starts,(m+1)*sizeof(int32));
+    if ( cstarts[0]!=0 || cstarts[m]!=n ) {
+	PyErr_Format(PyExc_ValueError, "Contour starts must begin with 0 and end with the number of points" );
+ goto done;
+    }
+    if ( closed!=NULL && closedlen!=m ) {
+	PyErr_Format(PyExc_ValueError, "There must be one closed flag for each contour" );
+ goto done;
+    }
+    for ( j=0; j<m; ++j ) if ( cstarts[j]>cstarts[j+1] ) {
+	PyErr_Format(PyExc_ValueError, "Contour starts must not decrease" );
+ goto done;
+    }
+
+    /* SSFromContour only looks at the point fields, so the points don't */
+    /*  need to be real python objects */
+    pts = galloc((n+1)*sizeof(PyFF_Point));
+    ppts = galloc((n+1)*sizeof(PyFF_Point *));
+    for ( i=0; i<n; ++i ) {
+	memcpy(xy,coords+2*i*sizeof(double),sizeof(xy));
+	pts[i].x = xy[0];
+	pts[i].y = xy[1];
+	pts[i].on_curve = (flags[i]&PACKED_ON_CURVE)!=0;
+	pts[i].selected = (flags[i]&PACKED_SELECTED)!=0;
+	ppts[i] = &pts[i];
+    }
+    memset(&c,0,sizeof(c));
+    c.is_quadratic = is_quadratic!=0;
+    for ( j=0; j<m; ++j ) {
+	c.points = ppts+cstarts[j];
+	c.pt_cnt = cstarts[j+1]-cstarts[j];
+	c.closed = closed==NULL || closed[j];
+	cur = SSFromContour(&c,&tt_start);
+	if ( cur==NULL ) {
+	    if ( PyErr_Occurred()) {
+		SplinePointListsFree(head);
+ goto done;
+	    }
+	} else {
+	    if ( head==NULL )
+		head = cur;
+	    else
+		tail->next = cur;
+	    tail = cur;
+	}
+    }
+    GlyphReplaceSplines(self,layer,head,is_quadratic!=0);
+    ok = true;
+
+  done:
+    for ( i=0; i<4; ++i )
+	PyBuffer_Release(&views[i]);
+    free(pts); free(ppts); free(cstarts);
+    if ( !ok )
+return( NULL );
+Py_RETURN( self );
+}
+
 static PyObject *PyFFGlyph_export(PyObject *self, PyObject *args) {
     SplineChar *sc = ((PyFF_Glyph *) self)->sc;
     char *filename;
@@ -8170,6 +8442,7 @@ static PyMethodDef PyFF_Glyph_methods[] = {
     { "correctDirection", (PyCFunction) PyFFGlyph_Correct, METH_NOARGS, "Orient a layer so that external contours are clockwise and internal counter clockwise." },
     { "exclude", (PyCFunction) PyFFGlyph_Exclude, METH_VARARGS, "Exclude the area of the argument (a layer) from the current glyph"},
     { "export", PyFFGlyph_export, METH_VARARGS, "Export the glyph, the format is determined by the extension. (provide the filename of the image file)" },
+    { "getPackedLayer", (PyCFunction) PyFFGlyph_getPackedLayer, METH_VARARGS, "Returns the points of a layer as packed arrays (coords,flags,contour_starts,closed,is_quadratic)" },
     { "getPosSub", PyFFGlyph_getPosSub, METH_VARARGS, "Gets position/substitution data from the glyph"},
     { "importOutlines", PyFFGlyph_import, METH_VARARGS, "Import a background image or a foreground eps/svg/etc. (provide the filename of the image file)" },
     { "intersect", (PyCFunction) PyFFGlyph_Intersect, METH_NOARGS, "Leaves the areas where the contours of a glyph overlap."},
@@ -8179,6 +8452,7 @@ static PyMethodDef PyFF_Glyph_methods[] = {
     { "round", (PyCFunction)PyFFGlyph_Round, METH_VARARGS, "Rounds point coordinates (and reference translations) to integers"},
     { "selfIntersects", (PyCFunction)PyFFGlyph_selfIntersects, METH_NOARGS, "Returns whether this glyph intersects itself" },
     { "validate", (PyCFunction)PyFFGlyph_validate, METH_VARARGS, "Returns whether this glyph is valid for output (if not check validation_state" },
+    { "setPackedLayer", (PyCFunction)PyFFGlyph_setPackedLayer, METH_VARARGS, "Replaces the contents of a layer with packed arrays (coords,flags,contour_starts[,closed,is_quadratic,layer])" },
     { "simplify", (PyCFunction)PyFFGlyph_Simplify, METH_VARARGS, "Simplifies a glyph" },
     { "stroke", (PyCFunction)PyFFGlyph_Stroke, METH_VARARGS, "Strokes the countours in a glyph"},
     { "transform", (PyCFunction)PyFFGlyph_Transform, METH_VARARGS, "Transform a glyph by a 6 element matrix." },
@@ -13403,6 +13677,105 @@ return( Py_BuildValue("(OOO)",
 	offsets));
 }
 
+/* Returns a new reference to the utf8 bytes of a (unicode or byte) string */
+/*  or NULL if obj isn't a string */
+static PyObject *ShapeStringBytes(PyObject *obj) {
+    if ( obj==NULL )
+return( NULL );
+    if ( PyUnicode_Check(obj))
+return( PyUnicode_AsUTF8String(obj));
+    if ( PyBytes_Check(obj)) {
+	Py_INCREF(obj);
+return( obj );
+    }
+return( NULL );
+}
+
+static PyObject *PyFFFont_shapeStrings(PyObject *self, PyObject *args) {
+    SplineFont *sf = ((PyFF_Font *) self)->fv->sf;
+    PyObject *strs, *feats, *ret, *glyphs, *obj, *bytes;
+    char *scriptstr = "DFLT", *langstr = "dflt", *text;
+    uint32 *flist, script, lang;
+    struct shaping_plan *plan;
+    struct opentype_str *ot;
+    SplineChar **scs, *sc;
+    const char *pt;
+    int i, j, cnt, fcnt, ch, wasmac;
+
+    if ( !PyArg_ParseTuple(args,"OO|ss", &strs, &feats, &scriptstr, &langstr ))
+return( NULL );
+    if ( !PySequence_Check(strs) || !PySequence_Check(feats) ) {
+	PyErr_Format(PyExc_TypeError, "Expected a sequence of strings and a sequence of feature tags" );
+return( NULL );
+    }
+    if ( (script = StrToTag(scriptstr,NULL))==0xffffffff ||
+	    (lang = StrToTag(langstr,NULL))==0xffffffff )
+return( NULL );
+    if ( sf->cidmaster ) sf = sf->cidmaster;
+
+    fcnt = PySequence_Size(feats);
+    flist = galloc((fcnt+1)*sizeof(uint32));
+    for ( i=0; i<fcnt; ++i ) {
+	obj = PySequence_GetItem(feats,i);
+	bytes = ShapeStringBytes(obj);
+	Py_XDECREF(obj);
+	if ( bytes==NULL ) {
+	    if ( !PyErr_Occurred())
+		PyErr_Format(PyExc_TypeError, "Feature tags must be strings" );
+	    free(flist);
+return( NULL );
+	}
+	flist[i] = StrToTag(PyBytes_AsString(bytes),&wasmac);
+	Py_DECREF(bytes);
+	if ( flist[i]==0xffffffff ) {
+	    free(flist);
+return( NULL );
+	}
+    }
+    flist[i] = 0;
+
+    /* One plan serves for all the strings. Positions are in font units */
+    plan = ShapingPlanCreate(sf,flist,script,lang,true);
+    free(flist);
+    cnt = PySequence_Size(strs);
+    ret = PyTuple_New(cnt);
+    for ( i=0; i<cnt; ++i ) {
+	obj = PySequence_GetItem(strs,i);
+	bytes = ShapeStringBytes(obj);
+	Py_XDECREF(obj);
+	if ( bytes==NULL ) {
+	    if ( !PyErr_Occurred())
+		PyErr_Format(PyExc_TypeError, "The strings to shape must be strings" );
+	    ShapingPlanFree(plan);
+	    Py_DECREF(ret);
+return( NULL );
+	}
+	text = PyBytes_AsString(bytes);
+	scs = galloc((strlen(text)+1)*sizeof(SplineChar *));
+	j = 0;
+	for ( pt=text; (ch=utf8_ildb(&pt))!='\0'; ) {
+	    if ( ch==-1 )
+	break;
+	    /* Characters the font can't show are dropped */
+	    if ( (sc=SFGetChar(sf,ch,NULL))!=NULL )
+		scs[j++] = sc;
+	}
+	scs[j] = NULL;
+	Py_DECREF(bytes);
+	ot = ShapingPlanApply(plan,sf->ascent+sf->descent,scs);
+	free(scs);
+	for ( j=0; ot[j].sc!=NULL; ++j );
+	glyphs = PyTuple_New(j);
+	for ( j=0; ot[j].sc!=NULL; ++j )
+	    PyTuple_SetItem(glyphs,j,Py_BuildValue("(siiii)", ot[j].sc->name,
+		    ot[j].vr.xoff, ot[j].vr.yoff, ot[j].vr.h_adv_off, ot[j].vr.v_adv_off ));
+	free(ot);
+	PyTuple_SetItem(ret,i,glyphs);
+    }
+    ShapingPlanFree(plan);
+return( ret );
+}
+
 static PyObject *PyFFFont_isKerningClass(PyObject *self, PyObject *args) {
     SplineFont *sf = ((PyFF_Font *) self)->fv->sf;
     char *subtable;
@@ -14496,6 +14869,7 @@ struct flaglist gen_flags[] = {
     { "tfm", 0x10000 },
     { "no-flex", 0x40000 },
     { "no-hints", 0x80000 },
+    { "subroutinize", 0x4000000 },
     { "round", 0x200000 },
     { "composites-in-afm", 0x400000 },
     FLAGLIST_EMPTY /* Sentinel */
@@ -14517,6 +14891,7 @@ static PyObject *PyFFFont_Generate(PyObject *self, PyObject *args, PyObject *key
     NameList *rename_to = NULL;
     int layer = fv->active_layer;
     char *layer_str=NULL;
+    int ok;
 
     if ( !PyArg_ParseTupleAndKeywords(args, keywds, "es|sOissi", gen_keywords,
 	    "UTF-8",&filename, &bitmaptype, &flags, &resolution, &subfontdirectory,
@@ -14561,12 +14936,15 @@ return( NULL );
     }
     locfilename = utf82def_copy(filename);
     free(filename);
-    if ( !GenerateScript(fv->sf,locfilename,bitmaptype,iflags,resolution,subfontdirectory,
-	    NULL,fv->normal==NULL?fv->map:fv->normal,rename_to,layer) ) {
+    FF_BEGIN_ALLOW_THREADS
+    ok = GenerateScript(fv->sf,locfilename,bitmaptype,iflags,resolution,subfontdirectory,
+	    NULL,fv->normal==NULL?fv->map:fv->normal,rename_to,layer);
+    FF_END_ALLOW_THREADS
+    free(locfilename);
+    if ( !ok ) {
 	PyErr_Format(PyExc_EnvironmentError, "Font generation failed");
 return( NULL );
     }
-    free(locfilename);
 Py_RETURN( self );
 }
 
@@ -14773,7 +15151,7 @@ static PyObject *PyFFFont_MergeFonts(PyObject *self, PyObject *args) {
 return( NULL );
     locfilename = utf82def_copy(filename);
     free(filename);
-    sf = LoadSplineFont(locfilename,openflags);
+    sf = LoadSplineFont(locfilename,openflags&~of_lazy);
     free(locfilename);
     if ( sf==NULL ) {
 	PyErr_Format(PyExc_EnvironmentError, "No font found in file");
@@ -14797,7 +15175,7 @@ static PyObject *PyFFFont_InterpolateFonts(PyObject *self, PyObject *args) {
 return( NULL );
     locfilename = utf82def_copy(filename);
     free(filename);
-    sf = LoadSplineFont(locfilename,openflags);
+    sf = LoadSplineFont(locfilename,openflags&~of_lazy);
     free(locfilename);
     if ( sf==NULL ) {
 	PyErr_Format(PyExc_EnvironmentError, "No font found in file");
@@ -15574,17 +15952,31 @@ return( NULL );
 Py_RETURN( self );
 }
 
-static PyObject *PyFFFont_autoHint(PyObject *self, PyObject *args) {
+static char *autohint_keywords[] = { "jobs", NULL };
+
+static PyObject *PyFFFont_autoHint(PyObject *self, PyObject *args, PyObject *keywds) {
     FontViewBase *fv = ((PyFF_Font *) self)->fv;
+    int jobs = 1;
 
-    FVAutoHint(fv);
+    if ( !PyArg_ParseTupleAndKeywords(args,keywds,"|i",autohint_keywords,&jobs) )
+return( NULL );
+    /* jobs=0 means use all the processors we've got */
+    FF_BEGIN_ALLOW_THREADS
+    _FVAutoHint(fv,ThreadCount(jobs));
+    FF_END_ALLOW_THREADS
 Py_RETURN( self );
 }
 
-static PyObject *PyFFFont_autoInstr(PyObject *self, PyObject *args) {
+static char *autoinstr_keywords[] = { "jobs", NULL };
+
+static PyObject *PyFFFont_autoInstr(PyObject *self, PyObject *args, PyObject *keywds) {
     FontViewBase *fv = ((PyFF_Font *) self)->fv;
+    int jobs = 1;
 
-    FVAutoInstr(fv);
+    if ( !PyArg_ParseTupleAndKeywords(args,keywds,"|i",autoinstr_keywords,&jobs) )
+return( NULL );
+    /* jobs=0 means use all the processors we've got */
+    _FVAutoInstr(fv,ThreadCount(jobs));
 Py_RETURN( self );
 }
 
@@ -15665,16 +16057,10 @@ Py_RETURN( self );
 static PyObject *PyFFFont_Round(PyFF_Font *self, PyObject *args) {
     double factor=1;
     FontViewBase *fv = self->fv;
-    SplineFont *sf = fv->sf;
-    EncMap *map = fv->map;
-    int i, gid;
 
     if ( !PyArg_ParseTuple(args,"|d",&factor ) )
 return( NULL );
-    for ( i=0; i<map->enccount; ++i ) if ( (gid=map->map[i])!=-1 && sf->glyphs[gid]!=NULL && fv->selected[i] ) {
-	SplineChar *sc = sf->glyphs[gid];
-	SCRound2Int( sc,fv->active_layer,factor);
-    }
+    _FVRound2Int(fv,fv->active_layer,true,false,factor);
 Py_RETURN( self );
 }
 
@@ -15748,7 +16134,9 @@ Py_RETURN( self );
 
 static PyObject *PyFFFont_RemoveOverlap(PyFF_Font *self, PyObject *args) {
 
+    FF_BEGIN_ALLOW_THREADS
     FVOverlap(self->fv,over_remove);
+    FF_END_ALLOW_THREADS
 Py_RETURN( self );
 }
 
@@ -15798,14 +16186,20 @@ return( Py_BuildValue("i", ret ));
 }
 #endif
 
-static PyObject *PyFFFont_validate(PyObject *self, PyObject *args) {
+static char *validate_keywords[] = { "force", "jobs", NULL };
+
+static PyObject *PyFFFont_validate(PyObject *self, PyObject *args, PyObject *keywds) {
     FontViewBase *fv = ((PyFF_Font *) self)->fv;
     SplineFont *sf = fv->sf;
-    int force=false;
+    int force=false, jobs=0, ret;
 
-    if ( !PyArg_ParseTuple(args,"|i",&force) )
+    if ( !PyArg_ParseTupleAndKeywords(args,keywds,"|ii",validate_keywords,&force,&jobs) )
 return( NULL );
-return( Py_BuildValue("i", SFValidate(sf,fv->active_layer,force)));
+    /* jobs=0 means the ThreadCount preference */
+    FF_BEGIN_ALLOW_THREADS
+    ret = _SFValidate(sf,fv->active_layer,force,jobs,NULL,NULL);
+    FF_END_ALLOW_THREADS
+return( Py_BuildValue("i", ret));
 }
 
 static PyMethodDef PyFF_Font_methods[] = {
@@ -15865,6 +16259,7 @@ static PyMethodDef PyFF_Font_methods[] = {
     { "removeLookup", PyFFFont_removeLookup, METH_VARARGS, "Removes the named lookup" },
     { "removeLookupSubtable", PyFFFont_removeLookupSubtable, METH_VARARGS, "Removes the named lookup subtable" },
     { "saveNamelist", PyFFFont_saveNamelist, METH_VARARGS, "Saves the namelist of the current font." },
+    { "shapeStrings", PyFFFont_shapeStrings, METH_VARARGS, "Applies the font's lookups for a set of features to each of a sequence of strings" },
     { "replaceAll", PyFFFont_replaceAll, METH_VARARGS, "Searches for a pattern in the font and replaces it with another everywhere it was found" },
     { "find", PyFFFont_find, METH_VARARGS, "Searches for a pattern in the font and returns an iterator which produces glyphs with that pattern" },
     { "glyphs", PyFFFont_glyphs, METH_VARARGS, "Returns an iterator over all glyphs" },
@@ -15881,8 +16276,8 @@ static PyMethodDef PyFF_Font_methods[] = {
 
     { "addExtrema", (PyCFunction) PyFFFont_AddExtrema, METH_NOARGS, "Add extrema to the contours of the glyph"},
     { "addSmallCaps", (PyCFunction) PyFFFont_addSmallCaps, METH_VARARGS | METH_KEYWORDS, "For selected upper/lower case (latin, greek, cyrillic) characters, add a small caps variant of that glyph"},
-    { "autoHint", PyFFFont_autoHint, METH_NOARGS, "Guess at postscript hints"},
-    { "autoInstr", PyFFFont_autoInstr, METH_NOARGS, "Guess at truetype instructions"},
+    { "autoHint", (PyCFunction) PyFFFont_autoHint, METH_VARARGS | METH_KEYWORDS, "Guess at postscript hints (for selected glyphs, jobs=n hints n glyphs at once)"},
+    { "autoInstr", (PyCFunction) PyFFFont_autoInstr, METH_VARARGS | METH_KEYWORDS, "Guess at truetype instructions (for selected glyphs, jobs=n instructs n glyphs at once)"},
     { "autoWidth", (PyCFunction) PyFFFont_autoWidth, METH_VARARGS | METH_KEYWORDS, "Guess horizontal advance widths for selected glyphs" },
     { "autoTrace", PyFFFont_autoTrace, METH_NOARGS, "Autotrace any background images"},
     { "build", PyFFFont_Build, METH_NOARGS, "If the current glyph is an accented character\nand all components are in the font\nthen build it out of references" },
@@ -15903,7 +16298,7 @@ static PyMethodDef PyFF_Font_methods[] = {
     { "stroke", (PyCFunction)PyFFFont_Stroke, METH_VARARGS, "Strokes the countours in a glyph"},
     { "transform", (PyCFunction)PyFFFont_Transform, METH_VARARGS, "Transform a font by a 6 element matrix." },
     { "nltransform", (PyCFunction)PyFFFont_NLTransform, METH_VARARGS, "Transform a font by non-linear expessions for x and y." },
-    { "validate", PyFFFont_validate, METH_VARARGS, "Check whether a font is valid and return True if it is." },
+    { "validate", (PyCFunction) PyFFFont_validate, METH_VARARGS | METH_KEYWORDS, "Check whether a font is valid and return True if it is." },
 
     PYMETHODDEF_EMPTY /* Sentinel */
 };
@@ -16560,6 +16955,7 @@ static PyMethodDef FontForge_methods[] = {
     { "version", PyFF_Version, METH_NOARGS, "Returns a string containing the current version of FontForge, as 20061116" },
     { "fonts", PyFF_FontTuple, METH_NOARGS, "Returns a tuple of all loaded fonts" },
     { "fontsInFile", PyFF_FontsInFile, METH_VARARGS, "Returns a tuple containing the names of any fonts in an external file"},
+    { "memoryUsage", PyFF_MemoryUsage, METH_NOARGS, "Returns a tuple with an entry for each size of small object allocated, giving the size, the bytes in use and the bytes reserved" },
     { "open", PyFF_OpenFont, METH_VARARGS, "Opens a font and returns it" },
     { "printSetup", PyFF_printSetup, METH_VARARGS, "Prepare to print a font sample (select default printer or file, page size, etc.)" },
     { "parseTTInstrs", PyFF_ParseTTFInstrs, METH_VARARGS, "Takes a string and parses it into a tuple of truetype instruction bytes"},
@@ -16736,6 +17132,8 @@ static void PyFF_PickleTypesInit(void) {
 char *PyFF_PickleMeToString(void *pydata) {
     PyObject *pyobj, *arglist, *result;
     char *ret = NULL;
+    /* Fonts may be saved with the interpreter lock let go */
+    PyGILState_STATE gstate = PyGILState_Ensure();
 
     PyFF_PicklerInit();
     pyobj = pydata;
@@ -16751,13 +17149,15 @@ char *PyFF_PickleMeToString(void *pydata) {
     if ( PyErr_Occurred()!=NULL ) {
 	PyErr_Print();
 	free(ret);
-return( NULL );
-    } else
+	ret = NULL;
+    }
+    PyGILState_Release(gstate);
 return( ret );
 }
 
 void *PyFF_UnPickleMeToObjects(char *str) {
     PyObject *arglist, *result;
+    PyGILState_STATE gstate = PyGILState_Ensure();
 
     PyFF_PicklerInit();
     arglist = PyTuple_New(1);
@@ -16770,8 +17170,9 @@ void *PyFF_UnPickleMeToObjects(char *str) {
     Py_DECREF(arglist);
     if ( PyErr_Occurred()!=NULL ) {
 	PyErr_Print();
-return( NULL );
-    } else
+	result = NULL;
+    }
+    PyGILState_Release(gstate);
 return( result );
 }
 
@@ -17223,23 +17624,36 @@ void PyFF_ScriptString(FontViewBase *fv,SplineChar *sc, int layer, char *str) {
 
 void PyFF_FreeFV(FontViewBase *fv) {
     if ( fv->python_fv_object!=NULL ) {
+	PyGILState_STATE gstate = PyGILState_Ensure();
 	((PyFF_Font *) (fv->python_fv_object))->fv = NULL;
 	Py_DECREF( (PyObject *) (fv->python_fv_object));
+	PyGILState_Release(gstate);
     }
 }
 
 void PyFF_FreeSF(SplineFont *sf) {
-    Py_XDECREF( (PyObject *) (sf->python_persistent));
-    Py_XDECREF( (PyObject *) (sf->python_temporary));
+    if ( sf->python_persistent!=NULL || sf->python_temporary!=NULL ) {
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	Py_XDECREF( (PyObject *) (sf->python_persistent));
+	Py_XDECREF( (PyObject *) (sf->python_temporary));
+	PyGILState_Release(gstate);
+    }
 }
 
 void PyFF_FreeSC(SplineChar *sc) {
+    PyGILState_STATE gstate;
+
+    if ( sc->python_sc_object==NULL && sc->python_persistent==NULL &&
+	    sc->python_temporary==NULL )
+return;
+    gstate = PyGILState_Ensure();
     if ( sc->python_sc_object!=NULL ) {
 	((PyFF_Glyph *) (sc->python_sc_object))->sc = NULL;
 	Py_DECREF( (PyObject *) (sc->python_sc_object));
     }
     Py_XDECREF( (PyObject *) (sc->python_persistent));
     Py_XDECREF( (PyObject *) (sc->python_temporary));
+    PyGILState_Release(gstate);
 }
 
 static void LoadFilesInPythonInitDir(char *dir) {
@@ -17295,14 +17709,22 @@ void PyFF_CallDictFunc(PyObject *dict,char *key,char *argtypes, ... ) {
     char *pt;
     va_list ap;
     int i;
+    PyGILState_STATE gstate;
 
-    if ( dict==NULL || !PyMapping_Check(dict) ||
+    if ( dict==NULL )
+return;
+    /* Fonts may be generated with the interpreter lock let go */
+    gstate = PyGILState_Ensure();
+    if ( !PyMapping_Check(dict) ||
 	    !PyMapping_HasKeyString(dict,key) ||
-	    (func = PyMapping_GetItemString(dict,key))==NULL )
+	    (func = PyMapping_GetItemString(dict,key))==NULL ) {
+	PyGILState_Release(gstate);
 return;
+    }
     if ( !PyCallable_Check(func)) {
 	LogError(_("%s: Is not callable"), key );
 	Py_DECREF(func);
+	PyGILState_Release(gstate);
 return;
     }
     va_start(ap,argtypes);
@@ -17334,6 +17756,7 @@ return;
     Py_XDECREF(result);
     if ( PyErr_Occurred()!=NULL )
 	PyErr_Print();
+    PyGILState_Release(gstate);
 }
 
 void PyFF_InitFontHook(FontViewBase *fv) {
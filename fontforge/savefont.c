@@ -42,6 +42,13 @@ int old_psotb_flags = ps_flag_afm;
 
 int oldformatstate = ff_pfb;
 int oldbitmapstate = 0;
+
+/* The format and flags of the save in progress. The old* variables above */
+/*  are the user's defaults (and what was used last time), they get copied */
+/*  here so that several threads can generate fonts in different formats */
+static ff_thread_local int save_format, save_bitmaps;
+static ff_thread_local int save_ps_flags, save_sfnt_flags, save_psotb_flags;
+
 #if __Mac
 char *savefont_extensions[] = { ".pfa", ".pfb", ".res", "%s.pfb", ".pfa", ".pfb", ".pt3", ".ps",
 	".cid", ".cff", ".cid.cff",
@@ -554,6 +561,7 @@ static int SaveSubFont(SplineFont *sf,char *newname,int32 *sizes,int res,
     temp.uniqueid = 0;
     memset(chars,0,sizeof(chars));
     temp.glyphnames = NULL;
+    temp.glyphunis = NULL;
     used = 0;
     for ( i=0; mapping[i]!=-2; ++i ) if ( (mapping[i]>>8)==subfont ) {
 	k = 0;
@@ -652,17 +660,17 @@ return( 0 );
 	strcat(pt,"]");
     }
 
-    err = !WritePSFont(filename,&temp,subtype,old_ps_flags,&encmap,sf,layer);
+    err = !WritePSFont(filename,&temp,subtype,save_ps_flags,&encmap,sf,layer);
     if ( err )
 	ff_post_error(_("Save Failed"),_("Save Failed"));
-    if ( !err && (old_ps_flags&ps_flag_afm) && ff_progress_next_stage()) {
-	if ( !WriteAfmFile(filename,&temp,oldformatstate,&encmap,old_ps_flags,sf,layer)) {
+    if ( !err && (save_ps_flags&ps_flag_afm) && ff_progress_next_stage()) {
+	if ( !WriteAfmFile(filename,&temp,save_format,&encmap,save_ps_flags,sf,layer)) {
 	    ff_post_error(_("Afm Save Failed"),_("Afm Save Failed"));
 	    err = true;
 	}
     }
-    if ( !err && (old_ps_flags&ps_flag_tfm) ) {
-	if ( !WriteTfmFile(filename,&temp,oldformatstate,&encmap,layer)) {
+    if ( !err && (save_ps_flags&ps_flag_tfm) ) {
+	if ( !WriteTfmFile(filename,&temp,save_format,&encmap,layer)) {
 	    ff_post_error(_("Tfm Save Failed"),_("Tfm Save Failed"));
 	    err = true;
 	}
@@ -720,10 +728,10 @@ return( 1 );
 	sf = sf->cidmaster;
 
     filecnt = 1;
-    if ( (old_ps_flags&ps_flag_afm) )
+    if ( (save_ps_flags&ps_flag_afm) )
 	filecnt = 2;
 #if 0
-    if ( oldbitmapstate==bf_bdf )
+    if ( save_bitmaps==bf_bdf )
 	++filecnt;
 #endif
     path = def2utf8_copy(newname);
@@ -770,55 +778,55 @@ return( false );
 }
 #endif
 
-int _DoSave(SplineFont *sf,char *newname,int32 *sizes,int res,
+static int DoSaveInFormat(SplineFont *sf,char *newname,int32 *sizes,int res,
 	EncMap *map, char *subfontdefinition,int layer) {
     char *path;
     int err=false;
-    int iscid = oldformatstate==ff_cid || oldformatstate==ff_cffcid ||
-	    oldformatstate==ff_otfcid || oldformatstate==ff_otfciddfont;
+    int iscid = save_format==ff_cid || save_format==ff_cffcid ||
+	    save_format==ff_otfcid || save_format==ff_otfciddfont;
     int flags = 0;
 
-    if ( oldformatstate == ff_multiple )
+    if ( save_format == ff_multiple )
 return( WriteMultiplePSFont(sf,newname,sizes,res,subfontdefinition,map,layer));
 
-    if ( oldformatstate<=ff_cffcid )
-	flags = old_ps_flags;
-    else if ( oldformatstate<=ff_ttfdfont )
-	flags = old_sfnt_flags;
-    else if ( oldformatstate!=ff_none )
-	flags = old_sfnt_flags;
+    if ( save_format<=ff_cffcid )
+	flags = save_ps_flags;
+    else if ( save_format<=ff_ttfdfont )
+	flags = save_sfnt_flags;
+    else if ( save_format!=ff_none )
+	flags = save_sfnt_flags;
     else
-	flags = old_sfnt_flags&~(ttf_flag_ofm);
-    if ( oldformatstate<=ff_cffcid && oldbitmapstate==bf_otb )
-	flags = old_psotb_flags;
+	flags = save_sfnt_flags&~(ttf_flag_ofm);
+    if ( save_format<=ff_cffcid && save_bitmaps==bf_otb )
+	flags = save_psotb_flags;
 
     path = def2utf8_copy(newname);
     ff_progress_start_indicator(10,_("Saving font"),
-		oldformatstate==ff_ttf || oldformatstate==ff_ttfsym ||
-		     oldformatstate==ff_ttfmacbin ?_("Saving TrueType Font") :
-		 oldformatstate==ff_otf || oldformatstate==ff_otfdfont ?_("Saving OpenType Font"):
-		 oldformatstate==ff_cid || oldformatstate==ff_cffcid ||
-		  oldformatstate==ff_otfcid || oldformatstate==ff_otfciddfont ?_("Saving CID keyed font") :
-		  oldformatstate==ff_mma || oldformatstate==ff_mmb ?_("Saving multi-master font") :
-		  oldformatstate==ff_svg ?_("Saving SVG font") :
-		  oldformatstate==ff_ufo ?_("Saving Unified Font Object") :
+		save_format==ff_ttf || save_format==ff_ttfsym ||
+		     save_format==ff_ttfmacbin ?_("Saving TrueType Font") :
+		 save_format==ff_otf || save_format==ff_otfdfont ?_("Saving OpenType Font"):
+		 save_format==ff_cid || save_format==ff_cffcid ||
+		  save_format==ff_otfcid || save_format==ff_otfciddfont ?_("Saving CID keyed font") :
+		  save_format==ff_mma || save_format==ff_mmb ?_("Saving multi-master font") :
+		  save_format==ff_svg ?_("Saving SVG font") :
+		  save_format==ff_ufo ?_("Saving Unified Font Object") :
 		 _("Saving PostScript Font"),
 	    path,sf->glyphcnt,1);
     free(path);
-    if ( oldformatstate!=ff_none ) {
+    if ( save_format!=ff_none ) {
 	int oerr = 0;
-	int bmap = oldbitmapstate;
+	int bmap = save_bitmaps;
 	if ( bmap==bf_otb ) bmap = bf_none;
 	if ( strstr(newname,"://")!=NULL ) {
-	    if ( oldformatstate==ff_pfbmacbin || oldformatstate==ff_ttfmacbin ) {
+	    if ( save_format==ff_pfbmacbin || save_format==ff_ttfmacbin ) {
 		ff_post_error(_("Mac Resource Not Remote"),_("You may not save a mac resource file to a remote location"));
 		oerr = true;
-	    } else if ( oldformatstate==ff_ufo ) {
+	    } else if ( save_format==ff_ufo ) {
 		ff_post_error(_("Directory Not Remote"),_("You may not save ufo directory to a remote location"));
 		oerr = true;
 	    }
 	}
-	if ( !oerr ) switch ( oldformatstate ) {
+	if ( !oerr ) switch ( save_format ) {
 	  case ff_mma: case ff_mmb:
 	    sf = sf->mm->instances[0];
 	  case ff_pfa: case ff_pfb: case ff_ptype3: case ff_ptype0:
@@ -828,29 +836,29 @@ return( WriteMultiplePSFont(sf,newname,sizes,res,subfontdefinition,map,layer));
 	    if ( sf->multilayer && CheckIfTransparent(sf))
 return( true );
 #endif
-	    oerr = !WritePSFont(newname,sf,oldformatstate,flags,map,NULL,layer);
+	    oerr = !WritePSFont(newname,sf,save_format,flags,map,NULL,layer);
 	  break;
 	  case ff_ttf: case ff_ttfsym: case ff_otf: case ff_otfcid:
 	  case ff_cff: case ff_cffcid:
-	    oerr = !WriteTTFFont(newname,sf,oldformatstate,sizes,bmap,
+	    oerr = !WriteTTFFont(newname,sf,save_format,sizes,bmap,
 		flags,map,layer);
 	  break;
 	  case ff_woff:
-	    oerr = !WriteWOFFFont(newname,sf,oldformatstate,sizes,bmap,
+	    oerr = !WriteWOFFFont(newname,sf,save_format,sizes,bmap,
 		flags,map,layer);
 	  break;
 	  case ff_pfbmacbin:
-	    oerr = !WriteMacPSFont(newname,sf,oldformatstate,flags,map,layer);
+	    oerr = !WriteMacPSFont(newname,sf,save_format,flags,map,layer);
 	  break;
 	  case ff_ttfmacbin: case ff_ttfdfont: case ff_otfdfont: case ff_otfciddfont:
-	    oerr = !WriteMacTTFFont(newname,sf,oldformatstate,sizes,
+	    oerr = !WriteMacTTFFont(newname,sf,save_format,sizes,
 		    bmap,flags,map,layer);
 	  break;
 	  case ff_svg:
-	    oerr = !WriteSVGFont(newname,sf,oldformatstate,flags,map,layer);
+	    oerr = !WriteSVGFont(newname,sf,save_format,flags,map,layer);
 	  break;
 	  case ff_ufo:
-	    oerr = !WriteUFOFont(newname,sf,oldformatstate,flags,map,layer);
+	    oerr = !WriteUFOFont(newname,sf,save_format,flags,map,layer);
 	  break;
 	}
 	if ( oerr ) {
@@ -859,27 +867,27 @@ return( true );
 	}
     }
     if ( !err && (flags&ps_flag_tfm) ) {
-	if ( !WriteTfmFile(newname,sf,oldformatstate,map,layer)) {
+	if ( !WriteTfmFile(newname,sf,save_format,map,layer)) {
 	    ff_post_error(_("Tfm Save Failed"),_("Tfm Save Failed"));
 	    err = true;
 	}
     }
     if ( !err && (flags&ttf_flag_ofm) ) {
-	if ( !WriteOfmFile(newname,sf,oldformatstate,map,layer)) {
+	if ( !WriteOfmFile(newname,sf,save_format,map,layer)) {
 	    ff_post_error(_("Ofm Save Failed"),_("Ofm Save Failed"));
 	    err = true;
 	}
     }
     if ( !err && (flags&ps_flag_afm) ) {
 	ff_progress_increment(-sf->glyphcnt);
-	if ( !WriteAfmFile(newname,sf,oldformatstate,map,flags,NULL,layer)) {
+	if ( !WriteAfmFile(newname,sf,save_format,map,flags,NULL,layer)) {
 	    ff_post_error(_("Afm Save Failed"),_("Afm Save Failed"));
 	    err = true;
 	}
     }
     if ( !err && (flags&ps_flag_outputfontlog) ) {
 	/*ff_progress_increment(-sf->glyphcnt);*/
-	if ( !WriteFontLog(newname,sf,oldformatstate,map,flags,NULL)) {
+	if ( !WriteFontLog(newname,sf,save_format,map,flags,NULL)) {
 	    ff_post_error(_("FontLog Save Failed"),_("FontLog Save Failed"));
 	    err = true;
 	}
@@ -887,48 +895,48 @@ return( true );
     if ( !err && (flags&ps_flag_pfm) && !iscid ) {
 	ff_progress_change_line1(_("Saving PFM File"));
 	ff_progress_increment(-sf->glyphcnt);
-	if ( !WritePfmFile(newname,sf,oldformatstate==ff_ptype0,map,layer)) {
+	if ( !WritePfmFile(newname,sf,save_format==ff_ptype0,map,layer)) {
 	    ff_post_error(_("Pfm Save Failed"),_("Pfm Save Failed"));
 	    err = true;
 	}
     }
-    if ( oldbitmapstate==bf_otb || oldbitmapstate==bf_sfnt_ms ) {
+    if ( save_bitmaps==bf_otb || save_bitmaps==bf_sfnt_ms ) {
 	char *temp = newname;
 	if ( newname[strlen(newname)-1]=='.' ) {
 	    temp = galloc(strlen(newname)+8);
 	    strcpy(temp,newname);
-	    strcat(temp,oldbitmapstate==bf_otb ? "otb" : "ttf" );
+	    strcat(temp,save_bitmaps==bf_otb ? "otb" : "ttf" );
 	}
-	if ( !WriteTTFFont(temp,sf,ff_none,sizes,oldbitmapstate,flags,map,layer) )
+	if ( !WriteTTFFont(temp,sf,ff_none,sizes,save_bitmaps,flags,map,layer) )
 	    err = true;
 	if ( temp!=newname )
 	    free(temp);
-    } else if ( oldbitmapstate==bf_sfnt_dfont ) {
+    } else if ( save_bitmaps==bf_sfnt_dfont ) {
 	char *temp = newname;
 	if ( newname[strlen(newname)-1]=='.' ) {
 	    temp = galloc(strlen(newname)+8);
 	    strcpy(temp,newname);
 	    strcat(temp,"dfont");
 	}
-	if ( !WriteMacTTFFont(temp,sf,ff_none,sizes,oldbitmapstate,flags,map,layer) )
+	if ( !WriteMacTTFFont(temp,sf,ff_none,sizes,save_bitmaps,flags,map,layer) )
 	    err = true;
 	if ( temp!=newname )
 	    free(temp);
-    } else if ( (oldbitmapstate==bf_bdf || oldbitmapstate==bf_fnt ||
-	    oldbitmapstate==bf_ptype3 ) && !err ) {
+    } else if ( (save_bitmaps==bf_bdf || save_bitmaps==bf_fnt ||
+	    save_bitmaps==bf_ptype3 ) && !err ) {
 	ff_progress_change_line1(_("Saving Bitmap Font(s)"));
 	ff_progress_increment(-sf->glyphcnt);
-	if ( !WriteBitmaps(newname,sf,sizes,res,oldbitmapstate,map))
+	if ( !WriteBitmaps(newname,sf,sizes,res,save_bitmaps,map))
 	    err = true;
-    } else if ( oldbitmapstate==bf_fon && !err ) {
+    } else if ( save_bitmaps==bf_fon && !err ) {
 	if ( !FONFontDump(newname,sf,sizes,res,map))
 	    err = true;
-    } else if ( oldbitmapstate==bf_palm && !err ) {
+    } else if ( save_bitmaps==bf_palm && !err ) {
 	if ( !WritePalmBitmaps(newname,sf,sizes,map))
 	    err = true;
-    } else if ( (oldbitmapstate==bf_nfntmacbin /*|| oldbitmapstate==bf_nfntdfont*/) &&
+    } else if ( (save_bitmaps==bf_nfntmacbin /*|| save_bitmaps==bf_nfntdfont*/) &&
 	    !err ) {
-	if ( !WriteMacBitmaps(newname,sf,sizes,false/*oldbitmapstate==bf_nfntdfont*/,map))
+	if ( !WriteMacBitmaps(newname,sf,sizes,false/*save_bitmaps==bf_nfntdfont*/,map))
 	    err = true;
     }
     free( sizes );
@@ -938,6 +946,14 @@ return( true );
 return( err );
 }
 
+int _DoSave(SplineFont *sf,char *newname,int32 *sizes,int res,
+	EncMap *map, char *subfontdefinition,int layer) {
+    save_format = oldformatstate; save_bitmaps = oldbitmapstate;
+    save_ps_flags = old_ps_flags; save_sfnt_flags = old_sfnt_flags;
+    save_psotb_flags = old_psotb_flags;
+return( DoSaveInFormat(sf,newname,sizes,res,map,subfontdefinition,layer));
+}
+
 void PrepareUnlinkRmOvrlp(SplineFont *sf,char *filename,int layer) {
     int gid;
     SplineChar *sc;
@@ -1021,6 +1037,8 @@ int GenerateScript(SplineFont *sf,char *filename,char *bitmaptype, int fmflags,
     struct sflist *sfl;
     char **former;
 
+    save_ps_flags = old_ps_flags; save_sfnt_flags = old_sfnt_flags;
+    save_psotb_flags = old_psotb_flags;
     if ( sf->bitmaps==NULL ) i = bf_none;
     else if ( strmatch(bitmaptype,"otf")==0 ) i = bf_ttf;
     else if ( strmatch(bitmaptype,"ms")==0 ) i = bf_ttf;
@@ -1032,7 +1050,7 @@ int GenerateScript(SplineFont *sf,char *filename,char *bitmaptype, int fmflags,
 	if ( strmatch(bitmaptype,bitmaps[i])==0 )
     break;
     }
-    oldbitmapstate = i;
+    save_bitmaps = i;
 
     for ( i=0; savefont_extensions[i]!=NULL; ++i ) {
 	if ( strlen( savefont_extensions[i])>0 &&
@@ -1073,7 +1091,7 @@ int GenerateScript(SplineFont *sf,char *filename,char *bitmaptype, int fmflags,
 	else if ( bitmaps[i]==NULL )
 	    i = ff_pfb;
 	else {
-	    oldbitmapstate = i;
+	    save_bitmaps = i;
 	    i = ff_none;
 	}
     }
@@ -1083,125 +1101,131 @@ int GenerateScript(SplineFont *sf,char *filename,char *bitmaptype, int fmflags,
 	if ( i==ff_otf ) i = ff_otfcid;
 	else if ( i==ff_otfdfont ) i = ff_otfciddfont;
     }
-    if ( (i==ff_none || sf->onlybitmaps) && oldbitmapstate==bf_ttf )
-	oldbitmapstate = bf_sfnt_ms;
-    oldformatstate = i;
+    if ( (i==ff_none || sf->onlybitmaps) && save_bitmaps==bf_ttf )
+	save_bitmaps = bf_sfnt_ms;
+    save_format = i;
 
-    if ( oldformatstate==ff_none && end[-1]=='.' &&
-	    (oldbitmapstate==bf_ttf || oldbitmapstate==bf_sfnt_dfont || oldbitmapstate==bf_otb)) {
+    if ( save_format==ff_none && end[-1]=='.' &&
+	    (save_bitmaps==bf_ttf || save_bitmaps==bf_sfnt_dfont || save_bitmaps==bf_otb)) {
 	freeme = galloc(strlen(filename)+8);
 	strcpy(freeme,filename);
 	if ( strmatch(bitmaptype,"otf")==0 )
 	    strcat(freeme,"otf");
-	else if ( oldbitmapstate==bf_otb )
+	else if ( save_bitmaps==bf_otb )
 	    strcat(freeme,"otb");
-	else if ( oldbitmapstate==bf_sfnt_dfont )
+	else if ( save_bitmaps==bf_sfnt_dfont )
 	    strcat(freeme,"dfont");
 	else
 	    strcat(freeme,"ttf");
 	filename = freeme;
     } else if ( sf->onlybitmaps && sf->bitmaps!=NULL &&
-	    (oldformatstate==ff_ttf || oldformatstate==ff_otf) &&
-	    (oldbitmapstate == bf_none || oldbitmapstate==bf_ttf ||
-	     oldbitmapstate==bf_sfnt_dfont || oldbitmapstate==bf_otb)) {
-	if ( oldbitmapstate==ff_ttf )
-	    oldbitmapstate = bf_ttf;
-	oldformatstate = ff_none;
+	    (save_format==ff_ttf || save_format==ff_otf) &&
+	    (save_bitmaps == bf_none || save_bitmaps==bf_ttf ||
+	     save_bitmaps==bf_sfnt_dfont || save_bitmaps==bf_otb)) {
+	if ( save_bitmaps==ff_ttf )
+	    save_bitmaps = bf_ttf;
+	save_format = ff_none;
     }
 
-    if ( oldbitmapstate==bf_sfnt_dfont )
-	oldformatstate = ff_none;
+    if ( save_bitmaps==bf_sfnt_dfont )
+	save_format = ff_none;
 
     if ( fmflags==-1 ) {
 	/* Default to what we did last time */
     } else {
-	if ( oldformatstate==ff_ttf && (fmflags&0x2000))
-	    oldformatstate = ff_ttfsym;
-	if ( oldformatstate<=ff_cffcid ) {
-	    old_ps_flags = 0;
-	    if ( fmflags&1 ) old_ps_flags |= ps_flag_afm;
-	    if ( fmflags&2 ) old_ps_flags |= ps_flag_pfm;
-	    if ( fmflags&0x10000 ) old_ps_flags |= ps_flag_tfm;
-	    if ( fmflags&0x20000 ) old_ps_flags |= ps_flag_nohintsubs;
-	    if ( fmflags&0x40000 ) old_ps_flags |= ps_flag_noflex;
-	    if ( fmflags&0x80000 ) old_ps_flags |= ps_flag_nohints;
-	    if ( fmflags&0x100000 ) old_ps_flags |= ps_flag_restrict256;
-	    if ( fmflags&0x200000 ) old_ps_flags |= ps_flag_round;
-	    if ( fmflags&0x400000 ) old_ps_flags |= ps_flag_afmwithmarks;
+	if ( save_format==ff_ttf && (fmflags&0x2000))
+	    save_format = ff_ttfsym;
+	if ( save_format<=ff_cffcid ) {
+	    save_ps_flags = 0;
+	    if ( fmflags&1 ) save_ps_flags |= ps_flag_afm;
+	    if ( fmflags&2 ) save_ps_flags |= ps_flag_pfm;
+	    if ( fmflags&0x10000 ) save_ps_flags |= ps_flag_tfm;
+	    if ( fmflags&0x20000 ) save_ps_flags |= ps_flag_nohintsubs;
+	    if ( fmflags&0x40000 ) save_ps_flags |= ps_flag_noflex;
+	    if ( fmflags&0x80000 ) save_ps_flags |= ps_flag_nohints;
+	    if ( fmflags&0x100000 ) save_ps_flags |= ps_flag_restrict256;
+	    if ( fmflags&0x200000 ) save_ps_flags |= ps_flag_round;
+	    if ( fmflags&0x400000 ) save_ps_flags |= ps_flag_afmwithmarks;
+	    if ( fmflags&0x4000000 ) save_ps_flags |= ps_flag_subroutinize;
 	    if ( i==bf_otb ) {
-		old_sfnt_flags = 0;
+		save_sfnt_flags = 0;
 		switch ( fmflags&0x90 ) {
 		  case 0x80:
-		    old_sfnt_flags |= ttf_flag_applemode|ttf_flag_otmode;
+		    save_sfnt_flags |= ttf_flag_applemode|ttf_flag_otmode;
 		  break;
 		  case 0x90:
 		    /* Neither */;
 		  break;
 		  case 0x10:
-		    old_sfnt_flags |= ttf_flag_applemode;
+		    save_sfnt_flags |= ttf_flag_applemode;
 		  break;
 		  case 0x00:
-		    old_sfnt_flags |= ttf_flag_otmode;
+		    save_sfnt_flags |= ttf_flag_otmode;
 		  break;
 		}
-		if ( fmflags&4 ) old_sfnt_flags |= ttf_flag_shortps;
-		if ( fmflags&0x20 ) old_sfnt_flags |= ttf_flag_pfed_comments;
-		if ( fmflags&0x40 ) old_sfnt_flags |= ttf_flag_pfed_colors;
-		if ( fmflags&0x200 ) old_sfnt_flags |= ttf_flag_TeXtable;
-		if ( fmflags&0x400 ) old_sfnt_flags |= ttf_flag_ofm;
-		if ( (fmflags&0x800) && !(old_sfnt_flags&ttf_flag_applemode) )
-		    old_sfnt_flags |= ttf_flag_oldkern;
-		if ( fmflags&0x1000 ) old_sfnt_flags |= ttf_flag_brokensize;
-		if ( fmflags&0x2000 ) old_sfnt_flags |= ttf_flag_symbol;
-		if ( fmflags&0x4000 ) old_sfnt_flags |= ttf_flag_dummyDSIG;
-		if ( fmflags&0x800000 ) old_sfnt_flags |= ttf_flag_pfed_lookupnames;
-		if ( fmflags&0x1000000 ) old_sfnt_flags |= ttf_flag_pfed_guides;
-		if ( fmflags&0x2000000 ) old_sfnt_flags |= ttf_flag_pfed_layers;
+		if ( fmflags&4 ) save_sfnt_flags |= ttf_flag_shortps;
+		if ( fmflags&0x20 ) save_sfnt_flags |= ttf_flag_pfed_comments;
+		if ( fmflags&0x40 ) save_sfnt_flags |= ttf_flag_pfed_colors;
+		if ( fmflags&0x200 ) save_sfnt_flags |= ttf_flag_TeXtable;
+		if ( fmflags&0x400 ) save_sfnt_flags |= ttf_flag_ofm;
+		if ( (fmflags&0x800) && !(save_sfnt_flags&ttf_flag_applemode) )
+		    save_sfnt_flags |= ttf_flag_oldkern;
+		if ( fmflags&0x1000 ) save_sfnt_flags |= ttf_flag_brokensize;
+		if ( fmflags&0x2000 ) save_sfnt_flags |= ttf_flag_symbol;
+		if ( fmflags&0x4000 ) save_sfnt_flags |= ttf_flag_dummyDSIG;
+		if ( fmflags&0x800000 ) save_sfnt_flags |= ttf_flag_pfed_lookupnames;
+		if ( fmflags&0x1000000 ) save_sfnt_flags |= ttf_flag_pfed_guides;
+		if ( fmflags&0x2000000 ) save_sfnt_flags |= ttf_flag_pfed_layers;
 	    }
 	} else {
-	    old_sfnt_flags = 0;
+	    save_sfnt_flags = 0;
 		/* Applicable postscript flags */
-	    if ( fmflags&1 ) old_sfnt_flags |= ps_flag_afm;
-	    if ( fmflags&2 ) old_sfnt_flags |= ps_flag_pfm;
-	    if ( fmflags&0x20000 ) old_sfnt_flags |= ps_flag_nohintsubs;
-	    if ( fmflags&0x40000 ) old_sfnt_flags |= ps_flag_noflex;
-	    if ( fmflags&0x80000 ) old_sfnt_flags |= ps_flag_nohints;
-	    if ( fmflags&0x200000 ) old_sfnt_flags |= ps_flag_round;
-	    if ( fmflags&0x400000 ) old_sfnt_flags |= ps_flag_afmwithmarks;
+	    if ( fmflags&1 ) save_sfnt_flags |= ps_flag_afm;
+	    if ( fmflags&2 ) save_sfnt_flags |= ps_flag_pfm;
+	    if ( fmflags&0x20000 ) save_sfnt_flags |= ps_flag_nohintsubs;
+	    if ( fmflags&0x40000 ) save_sfnt_flags |= ps_flag_noflex;
+	    if ( fmflags&0x80000 ) save_sfnt_flags |= ps_flag_nohints;
+	    if ( fmflags&0x200000 ) save_sfnt_flags |= ps_flag_round;
+	    if ( fmflags&0x400000 ) save_sfnt_flags |= ps_flag_afmwithmarks;
+	    if ( fmflags&0x4000000 ) save_sfnt_flags |= ps_flag_subroutinize;
 		/* Applicable truetype flags */
 	    switch ( fmflags&0x90 ) {
 	      case 0x80:
-		old_sfnt_flags |= ttf_flag_applemode|ttf_flag_otmode;
+		save_sfnt_flags |= ttf_flag_applemode|ttf_flag_otmode;
 	      break;
 	      case 0x90:
 		/* Neither */;
 	      break;
 	      case 0x10:
-		old_sfnt_flags |= ttf_flag_applemode;
+		save_sfnt_flags |= ttf_flag_applemode;
 	      break;
 	      case 0x00:
-		old_sfnt_flags |= ttf_flag_otmode;
+		save_sfnt_flags |= ttf_flag_otmode;
 	      break;
 	    }
-	    if ( fmflags&4 ) old_sfnt_flags |= ttf_flag_shortps;
-	    if ( fmflags&8 ) old_sfnt_flags |= ttf_flag_nohints;
-	    if ( fmflags&0x20 ) old_sfnt_flags |= ttf_flag_pfed_comments;
-	    if ( fmflags&0x40 ) old_sfnt_flags |= ttf_flag_pfed_colors;
-	    if ( fmflags&0x100 ) old_sfnt_flags |= ttf_flag_glyphmap;
-	    if ( fmflags&0x200 ) old_sfnt_flags |= ttf_flag_TeXtable;
-	    if ( fmflags&0x400 ) old_sfnt_flags |= ttf_flag_ofm;
-	    if ( (fmflags&0x800) && !(old_sfnt_flags&ttf_flag_applemode) )
-		old_sfnt_flags |= ttf_flag_oldkern;
-	    if ( fmflags&0x1000 ) old_sfnt_flags |= ttf_flag_brokensize;
-	    if ( fmflags&0x2000 ) old_sfnt_flags |= ttf_flag_symbol;
-	    if ( fmflags&0x4000 ) old_sfnt_flags |= ttf_flag_dummyDSIG;
-	    if ( fmflags&0x800000 ) old_sfnt_flags |= ttf_flag_pfed_lookupnames;
-	    if ( fmflags&0x1000000 ) old_sfnt_flags |= ttf_flag_pfed_guides;
-	    if ( fmflags&0x2000000 ) old_sfnt_flags |= ttf_flag_pfed_layers;
+	    if ( fmflags&4 ) save_sfnt_flags |= ttf_flag_shortps;
+	    if ( fmflags&8 ) save_sfnt_flags |= ttf_flag_nohints;
+	    if ( fmflags&0x20 ) save_sfnt_flags |= ttf_flag_pfed_comments;
+	    if ( fmflags&0x40 ) save_sfnt_flags |= ttf_flag_pfed_colors;
+	    if ( fmflags&0x100 ) save_sfnt_flags |= ttf_flag_glyphmap;
+	    if ( fmflags&0x200 ) save_sfnt_flags |= ttf_flag_TeXtable;
+	    if ( fmflags&0x400 ) save_sfnt_flags |= ttf_flag_ofm;
+	    if ( (fmflags&0x800) && !(save_sfnt_flags&ttf_flag_applemode) )
+		save_sfnt_flags |= ttf_flag_oldkern;
+	    if ( fmflags&0x1000 ) save_sfnt_flags |= ttf_flag_brokensize;
+	    if ( fmflags&0x2000 ) save_sfnt_flags |= ttf_flag_symbol;
+	    if ( fmflags&0x4000 ) save_sfnt_flags |= ttf_flag_dummyDSIG;
+	    if ( fmflags&0x800000 ) save_sfnt_flags |= ttf_flag_pfed_lookupnames;
+	    if ( fmflags&0x1000000 ) save_sfnt_flags |= ttf_flag_pfed_guides;
+	    if ( fmflags&0x2000000 ) save_sfnt_flags |= ttf_flag_pfed_layers;
 	}
     }
 
-    if ( oldbitmapstate!=bf_none ) {
+    /* Remember what we did for next time */
+    oldformatstate = save_format; oldbitmapstate = save_bitmaps;
+    old_ps_flags = save_ps_flags; old_sfnt_flags = save_sfnt_flags;
+
+    if ( save_bitmaps!=bf_none ) {
 	if ( sfs!=NULL ) {
 	    for ( sfi=sfs; sfi!=NULL; sfi=sfi->next )
 		sfi->sizes = AllBitmapSizes(sfi->sf);
@@ -1224,13 +1248,13 @@ int GenerateScript(SplineFont *sf,char *filename,char *bitmaptype, int fmflags,
 
     if ( sfs!=NULL ) {
 	int flags = 0;
-	if ( oldformatstate<=ff_cffcid )
-	    flags = old_ps_flags;
+	if ( save_format<=ff_cffcid )
+	    flags = save_ps_flags;
 	else
-	    flags = old_sfnt_flags;
-	ret = WriteMacFamily(filename,sfs,oldformatstate,oldbitmapstate,flags,layer);
+	    flags = save_sfnt_flags;
+	ret = WriteMacFamily(filename,sfs,save_format,save_bitmaps,flags,layer);
     } else {
-	ret = !_DoSave(sf,filename,sizes,res,map,subfontdefinition,layer);
+	ret = !DoSaveInFormat(sf,filename,sizes,res,map,subfontdefinition,layer);
     }
     free(freeme);
 
@@ -1246,7 +1270,7 @@ int GenerateScript(SplineFont *sf,char *filename,char *bitmaptype, int fmflags,
 	    SFTemporaryRestoreGlyphNames(sf,former);
     }
 
-    if ( oldbitmapstate!=bf_none ) {
+    if ( save_bitmaps!=bf_none ) {
 	if ( sfs!=NULL ) {
 	    for ( sfi=sfs; sfi!=NULL; sfi=sfi->next )
 		free(sfi->sizes);
@@ -46,6 +46,7 @@
 #include "plugins.h"
 #include "scripting.h"
 #include "scriptfuncs.h"
+#include "namehash.h"
 
 int no_windowing_ui = false;
 int running_script = false;
@@ -160,12 +161,33 @@ return;
 	    arrayfree( dica->entries[i].val.u.aval );
     }
     free( dica->entries );
+    free( dica->hash );
+}
+
+/* Small dictionaries are searched linearly, once they get bigger than this */
+/*  we hash the names */
+#define DICA_HASH_MIN	16
+
+static void DicaHashEntry(struct dictionary *dica,int i) {
+    int h = hashname(dica->entries[i].name);
+
+    dica->entries[i].hnext = dica->hash[h];
+    dica->hash[h] = i+1;
 }
 
 static int DicaLookup(struct dictionary *dica,char *name,Val *val) {
     int i;
 
     if ( dica!=NULL && dica->entries!=NULL ) {
+	if ( dica->hash!=NULL ) {
+	    for ( i=dica->hash[hashname(name)]-1; i>=0; i=dica->entries[i].hnext-1 )
+		if ( strcmp(dica->entries[i].name,name)==0 ) {
+		    val->type = v_lval;
+		    val->u.lval = &dica->entries[i].val;
+return( true );
+		}
+return( false );
+	}
 	for ( i=0; i<dica->cnt; ++i )
 	    if ( strcmp(dica->entries[i].name,name)==0 ) {
 		val->type = v_lval;
@@ -177,6 +199,7 @@ return( false );
 }
 
 static void DicaNewEntry(struct dictionary *dica,char *name,Val *val) {
+    int i;
 
     if ( dica->entries==NULL ) {
 	dica->max = 10;
@@ -190,6 +213,13 @@ static void DicaNewEntry(struct dictionary *dica,char *name,Val *val) {
     val->type = v_lval;
     val->u.lval = &dica->entries[dica->cnt].val;
     ++dica->cnt;
+    if ( dica->hash!=NULL )
+	DicaHashEntry(dica,dica->cnt-1);
+    else if ( dica->cnt>=DICA_HASH_MIN ) {
+	dica->hash = gcalloc(GN_HSIZE,sizeof(int));
+	for ( i=0; i<dica->cnt; ++i )
+	    DicaHashEntry(dica,i);
+    }
 }
 
 
@@ -2009,9 +2039,9 @@ static void bControlAfmLigatureOutput(Context *c) {
 static void Bitmapper(Context *c,int isavail) {
     int32 *sizes;
     int i;
-    int rasterize = true;
+    int rasterize = true, threads = 0;
 
-    if ( c->a.argc!=2 && (!isavail || c->a.argc!=3))
+    if ( c->a.argc!=2 && (!isavail || (c->a.argc!=3 && c->a.argc!=4)))
 	ScriptError( c, "Wrong number of arguments");
     if ( c->a.vals[1].type!=v_arr )
 	ScriptError( c, "Bad type of argument");
@@ -2019,11 +2049,16 @@ static void Bitmapper(Context *c,int isavail) {
 	if ( c->a.vals[1].u.aval->vals[i].type!=v_int ||
 		c->a.vals[1].u.aval->vals[i].u.ival<=2 )
 	    ScriptError( c, "Bad type of array component");
-    if ( c->a.argc==3 ) {
+    if ( c->a.argc>=3 ) {
 	if ( c->a.vals[2].type!=v_int )
 	    ScriptError( c, "Bad type of argument");
 	rasterize = c->a.vals[2].u.ival;
     }
+    if ( c->a.argc==4 ) {
+	if ( c->a.vals[3].type!=v_int )
+	    ScriptError( c, "Bad type of argument");
+	threads = c->a.vals[3].u.ival;
+    }
     sizes = galloc((c->a.vals[1].u.aval->argc+1)*sizeof(int32));
     for ( i=0; i<c->a.vals[1].u.aval->argc; ++i ) {
 	sizes[i] = c->a.vals[1].u.aval->vals[i].u.ival;
@@ -2032,7 +2067,7 @@ static void Bitmapper(Context *c,int isavail) {
     }
     sizes[i] = 0;
 
-    if ( !BitmapControl(c->curfv,sizes,isavail,rasterize) )
+    if ( !_BitmapControl(c->curfv,sizes,isavail,rasterize,threads) )
 	ScriptError(c,"Bitmap operation failed");		/* Storage leak here longjmp avoids free */
     free(sizes);
 }
@@ -4043,6 +4078,7 @@ return;
 	UndoesFree(layers[layer].undoes);
     free(layers);
     dest->orig_pos = opos; dest->unicodeenc = uenc;
+    SFHashUnicode(dest->parent,dest,uenc);
     dest->dependents = scl;
     dest->namechanged = true;
 
@@ -4989,10 +5025,6 @@ static void bMakeLine(Context *c) {
 
 static void bRoundToInt(Context *c) {
     real factor = 1.0;
-    int i, gid;
-    FontViewBase *fv = c->curfv;
-    SplineFont *sf = fv->sf;
-    EncMap *map = fv->map;
 
     if ( c->a.argc!=1 && c->a.argc!=2 )
 	ScriptError( c, "Wrong number of arguments");
@@ -5004,10 +5036,7 @@ static void bRoundToInt(Context *c) {
 	else
 	    ScriptError( c, "Bad type for argument" );
     }
-    for ( i=0; i<map->enccount; ++i ) if ( (gid=map->map[i])!=-1 && sf->glyphs[gid]!=NULL && fv->selected[i] ) {
-	SplineChar *sc = sf->glyphs[gid];
-	SCRound2Int( sc,ly_fore,factor);
-    }
+    _FVRound2Int(c->curfv,ly_fore,true,false,factor);
 }
 
 static void bRoundToCluster(Context *c) {
@@ -5168,7 +5197,7 @@ static void bMergeFonts(Context *c) {
     }
     t = script2utf8_copy(c->a.vals[1].u.sval);
     locfilename = utf82def_copy(t);
-    sf = LoadSplineFont(locfilename,openflags);
+    sf = LoadSplineFont(locfilename,openflags&~of_lazy);
     free(t); free(locfilename);
     if ( sf==NULL )
 	ScriptErrorString(c,"Can't find font", c->a.vals[1].u.sval);
@@ -5200,7 +5229,7 @@ static void bInterpolateFonts(Context *c) {
 	percent = c->a.vals[1].u.fval;
     t = script2utf8_copy(c->a.vals[2].u.sval);
     locfilename = utf82def_copy(t);
-    sf = LoadSplineFont(locfilename,openflags);
+    sf = LoadSplineFont(locfilename,openflags&~of_lazy);
     free(t); free(locfilename);
     if ( sf==NULL )
 	ScriptErrorString(c,"Can't find font", c->a.vals[2].u.sval);
@@ -5278,9 +5307,17 @@ static void bDefaultRoundToGrid(Context *c) {
 }
 
 static void bAutoHint(Context *c) {
-    if ( c->a.argc!=1 )
+    int threads = 1;
+
+    if ( c->a.argc!=1 && c->a.argc!=2 )
 	ScriptError( c, "Wrong number of arguments");
-    FVAutoHint(c->curfv);
+    else if ( c->a.argc==2 ) {
+	if ( c->a.vals[1].type!=v_int )
+	    ScriptError( c, "Bad type for argument" );
+	/* AutoHint(0) means use all the processors we've got */
+	threads = ThreadCount(c->a.vals[1].u.ival);
+    }
+    _FVAutoHint(c->curfv,threads);
 }
 
 static void bSubstitutionPoints(Context *c) {
@@ -5302,9 +5339,17 @@ static void bDontAutoHint(Context *c) {
 }
 
 static void bAutoInstr(Context *c) {
-    if ( c->a.argc!=1 )
+    int threads = 1;
+
+    if ( c->a.argc!=1 && c->a.argc!=2 )
 	ScriptError( c, "Wrong number of arguments");
-    FVAutoInstr(c->curfv);
+    else if ( c->a.argc==2 ) {
+	if ( c->a.vals[1].type!=v_int )
+	    ScriptError( c, "Bad type for argument" );
+	/* AutoInstr(0) means use all the processors we've got */
+	threads = ThreadCount(c->a.vals[1].u.ival);
+    }
+    _FVAutoInstr(c->curfv,threads);
 }
 
 static void TableAddInstrs(SplineFont *sf, uint32 tag,int replace,
@@ -7079,6 +7124,87 @@ static void bGetLookups(Context *c) {
     }
 }
 
+static void bShapeStrings(Context *c) {
+    SplineFont *sf = c->curfv->sf;
+    Array *strs, *feats, *ret, *glyphs, *g;
+    uint32 *flist, script, lang=DEFAULT_LANG;
+    struct shaping_plan *plan;
+    struct opentype_str *ot;
+    SplineChar **scs, *sc;
+    const char *pt;
+    int i, j, cnt, ch, wasmac;
+
+    if ( sf->cidmaster ) sf = sf->cidmaster;
+
+    if ( c->a.argc!=4 && c->a.argc!=5 )
+	ScriptError( c, "Wrong number of arguments");
+    else if ( c->a.vals[1].type!=v_arr && c->a.vals[1].type!=v_arrfree )
+	ScriptError( c, "Bad type for first argument");
+    else if ( c->a.vals[2].type!=v_arr && c->a.vals[2].type!=v_arrfree )
+	ScriptError( c, "Bad type for second argument");
+    else if ( c->a.vals[3].type!=v_str || (c->a.argc==5 && c->a.vals[4].type!=v_str))
+	ScriptError( c, "Bad type for argument");
+    strs = c->a.vals[1].u.aval;
+    feats = c->a.vals[2].u.aval;
+    for ( i=0; i<strs->argc; ++i )
+	if ( strs->vals[i].type!=v_str )
+	    ScriptError( c, "The strings to shape must be strings");
+    for ( i=0; i<feats->argc; ++i )
+	if ( feats->vals[i].type!=v_str )
+	    ScriptError( c, "Feature tags must be strings");
+    script = ParseTag(c,&c->a.vals[3],false,&wasmac);
+    if ( c->a.argc==5 )
+	lang = ParseTag(c,&c->a.vals[4],false,&wasmac);
+
+    flist = galloc((feats->argc+1)*sizeof(uint32));
+    for ( i=0; i<feats->argc; ++i )
+	flist[i] = ParseTag(c,&feats->vals[i],true,&wasmac);
+    flist[i] = 0;
+
+    /* One plan serves for all the strings. Positions are in font units */
+    plan = ShapingPlanCreate(sf,flist,script,lang,true);
+    ret = galloc(sizeof(Array));
+    ret->argc = strs->argc;
+    ret->vals = galloc(strs->argc*sizeof(Val));
+    for ( i=0; i<strs->argc; ++i ) {
+	scs = galloc((strlen(strs->vals[i].u.sval)+1)*sizeof(SplineChar *));
+	cnt = 0;
+	for ( pt=strs->vals[i].u.sval; (ch=utf8_ildb(&pt))!='\0'; ) {
+	    if ( ch==-1 )
+	break;
+	    /* Characters the font can't show are dropped */
+	    if ( (sc=SFGetChar(sf,ch,NULL))!=NULL )
+		scs[cnt++] = sc;
+	}
+	scs[cnt] = NULL;
+	ot = ShapingPlanApply(plan,sf->ascent+sf->descent,scs);
+	free(scs);
+	for ( cnt=0; ot[cnt].sc!=NULL; ++cnt );
+	ret->vals[i].type = v_arr;
+	ret->vals[i].u.aval = glyphs = galloc(sizeof(Array));
+	glyphs->argc = cnt;
+	glyphs->vals = galloc(cnt*sizeof(Val));
+	for ( j=0; j<cnt; ++j ) {
+	    glyphs->vals[j].type = v_arr;
+	    glyphs->vals[j].u.aval = g = galloc(sizeof(Array));
+	    g->argc = 5;
+	    g->vals = galloc(5*sizeof(Val));
+	    g->vals[0].type = v_str;
+	    g->vals[0].u.sval = copy(ot[j].sc->name);
+	    g->vals[1].type = g->vals[2].type = g->vals[3].type = g->vals[4].type = v_int;
+	    g->vals[1].u.ival = ot[j].vr.xoff;
+	    g->vals[2].u.ival = ot[j].vr.yoff;
+	    g->vals[3].u.ival = ot[j].vr.h_adv_off;
+	    g->vals[4].u.ival = ot[j].vr.v_adv_off;
+	}
+	free(ot);
+    }
+    ShapingPlanFree(plan);
+    free(flist);
+    c->return_val.type = v_arrfree;
+    c->return_val.u.aval = ret;
+}
+
 static void bAddLookupSubtable(Context *c) {
     int isgpos;
     OTLookup *otl, *test;
@@ -7425,6 +7551,8 @@ static void bCharInfo(Context *c) {
     sc = gid==-1 ? NULL : sf->glyphs[gid];
     if ( sc==NULL )
 	sc = SCBuildDummy(&dummy,sf,map,found);
+    else if ( sc->lazy )
+	SFDLoadLazyGlyph(sc);
 
     c->return_val.type = v_int;
     if ( c->a.argc==3 ) {
@@ -7646,6 +7774,8 @@ static void bGetPosSub(Context *c) {
     sc = gid==-1 ? NULL : sf->glyphs[gid];
     if ( sc==NULL )
 	sc = SCBuildDummy(&dummy,sf,map,found);
+    else if ( sc->lazy )
+	SFDLoadLazyGlyph(sc);
 
     if ( c->a.argc!=2 )
 	ScriptError( c, "Wrong number of arguments");
@@ -7968,22 +8098,47 @@ static void bCompareFonts(Context *c) {
     fclose( diffs );
 }
 
+static struct validatestats last_validate;
+
 static void bValidate(Context *c) {
-    int force = false;
+    int force = false, threads = 0;
+    char *cachefile = NULL;
 
-    if ( c->a.argc>2 )
+    if ( c->a.argc>4 )
 	ScriptError( c, "Wrong number of arguments");
-    if ( c->a.argc==2 ) {
+    if ( c->a.argc>=2 ) {
 	if ( c->a.vals[1].type!=v_int )
 	    ScriptError( c, "Bad type for argument");
 	force = c->a.vals[1].u.ival;
     }
+    if ( c->a.argc==4 ) {
+	if ( c->a.vals[3].type!=v_int )
+	    ScriptError( c, "Bad type for argument");
+	threads = c->a.vals[3].u.ival;
+    }
+    if ( c->a.argc>=3 ) {
+	if ( c->a.vals[2].type==v_str ) {
+	    char *t = script2utf8_copy(c->a.vals[2].u.sval);
+	    cachefile = utf82def_copy(t);
+	    free(t);
+	} else if ( c->a.vals[2].type!=v_int )
+	    ScriptError( c, "Bad type for argument");
+	else if ( c->a.vals[2].u.ival ) {
+	    cachefile = SFValidationCacheName(c->curfv->sf);
+	    if ( cachefile==NULL )
+		ScriptError( c, "This font has no file beside which to keep a validation cache");
+	}
+    }
 
     c->return_val.type = v_int;
-    c->return_val.u.ival = SFValidate(c->curfv->sf, ly_fore, force );
+    c->return_val.u.ival = _SFValidate(c->curfv->sf, ly_fore, force, threads, cachefile, &last_validate );
+    free(cachefile);
 }
 
-static struct builtins { char *name; void (*func)(Context *); int nofontok; } builtins[] = {
+/* lazyok means the command only needs what we know about a font's glyphs */
+/*  before they have been fully read in (see of_lazy). Anything else reads */
+/*  all the glyphs of any lazily opened fonts before it is called */
+static struct builtins { char *name; void (*func)(Context *); int nofontok, lazyok; } builtins[] = {
 /* Generic utilities */
     { "Print", bPrint, 1 },
     { "Error", bError, 1 },
@@ -8058,7 +8213,7 @@ static struct builtins { char *name; void (*func)(Context *); int nofontok; } bu
     { "FontsInFile", bFontsInFile, 1 },
     { "Open", bOpen, 1 },
     { "New", bNew, 1 },
-    { "Close", bClose, 0 },
+    { "Close", bClose, 0, 1 },
     { "Revert", bRevert, 0 },
     { "RevertToBackup", bRevertToBackup, 0 },
     { "Save", bSave, 0 },
@@ -8097,17 +8252,17 @@ static struct builtins { char *name; void (*func)(Context *); int nofontok; } bu
     { "CopyFgToBg", bCopyFgToBg, 0 },
     { "UnlinkReference", bUnlinkReference, 0 },
     { "Join", bJoin, 0 },
-    { "SelectAll", bSelectAll, 0 },
-    { "SelectNone", bSelectNone, 0 },
-    { "SelectInvert", bSelectInvert, 0 },
-    { "SelectMore", bSelectMore, 0 },
-    { "SelectFewer", bSelectFewer, 0 },
-    { "Select", bSelect, 0 },
+    { "SelectAll", bSelectAll, 0, 1 },
+    { "SelectNone", bSelectNone, 0, 1 },
+    { "SelectInvert", bSelectInvert, 0, 1 },
+    { "SelectMore", bSelectMore, 0, 1 },
+    { "SelectFewer", bSelectFewer, 0, 1 },
+    { "Select", bSelect, 0, 1 },
     { "SelectMoreSingletons", bSelectMoreSingletons, 0 },
     { "SelectFewerSingletons", bSelectFewerSingletons, 0 },
     { "SelectSingletons", bSelectSingletons, 0 },
     { "SelectAllInstancesOf", bSelectAllInstancesOf, 0 },
-    { "SelectIf", bSelectIf, 0 },
+    { "SelectIf", bSelectIf, 0, 1 },
     { "SelectSingletonsIf", bSelectSingletonsIf, 0 },
     { "SelectMoreSingletonsIf", bSelectMoreSingletonsIf, 0 },
     { "SelectMoreIf", bSelectMoreIf, 0 },
@@ -8134,10 +8289,10 @@ static struct builtins { char *name; void (*func)(Context *); int nofontok; } bu
     { "SetGasp", bSetGasp, 0 },
     { "SetFontOrder", bSetFontOrder, 0 },
     { "SetFontHasVerticalMetrics", bSetFontHasVerticalMetrics, 0 },
-    { "SetFontNames", bSetFontNames, 0 },
+    { "SetFontNames", bSetFontNames, 0, 1 },
     { "SetFondName", bSetFondName, 0 },
-    { "SetTTFName", bSetTTFName, 0 },
-    { "GetTTFName", bGetTTFName, 0 },
+    { "SetTTFName", bSetTTFName, 0, 1 },
+    { "GetTTFName", bGetTTFName, 0, 1 },
     { "SetItalicAngle", bSetItalicAngle, 0 },
     { "SetMacStyle", bSetMacStyle, 0 },
     { "SetPanose", bSetPanose, 0 },
@@ -8210,6 +8365,7 @@ static struct builtins { char *name; void (*func)(Context *); int nofontok; } bu
     { "GetLookups", bGetLookups, 0 },
     { "GetLookupSubtables", bGetLookupSubtables, 0 },
     { "GetLookupInfo", bGetLookupInfo, 0 },
+    { "ShapeStrings", bShapeStrings, 0 },
     { "AddLookupSubtable", bAddLookupSubtable, 0 },
     { "GetLookupOfSubtable", bGetLookupOfSubtable, 0 },
     { "GetSubtableOfAnchorClass", bGetSubtableOfAnchorClass, 0 },
@@ -8249,11 +8405,11 @@ static struct builtins { char *name; void (*func)(Context *); int nofontok; } bu
     { "ClearCharCounterMasks", bClearCharCounterMasks, 0 },
     { "SetCharCounterMask", bSetCharCounterMask, 0 },
     { "ReplaceCharCounterMasks", bReplaceCharCounterMasks, 0 },
-    { "ClearPrivateEntry", bClearPrivateEntry, 0 },
+    { "ClearPrivateEntry", bClearPrivateEntry, 0, 1 },
     { "PrivateGuess", bPrivateGuess, 0 },
-    { "ChangePrivateEntry", bChangePrivateEntry, 0 },
-    { "HasPrivateEntry", bHasPrivateEntry, 0 },
-    { "GetPrivateEntry", bGetPrivateEntry, 0 },
+    { "ChangePrivateEntry", bChangePrivateEntry, 0, 1 },
+    { "HasPrivateEntry", bHasPrivateEntry, 0, 1 },
+    { "GetPrivateEntry", bGetPrivateEntry, 0, 1 },
     { "AutoInstr", bAutoInstr, 0 },
     { "AddInstrs", bAddInstrs, 0 },
     { "FindOrAddCvtIndex", bFindOrAddCvtIndex, 0 },
@@ -8293,14 +8449,14 @@ static struct builtins { char *name; void (*func)(Context *); int nofontok; } bu
     { "CIDFlatten", bCIDFlatten, 0 },
     { "CIDFlattenByCMap", bCIDFlattenByCMap, 0 },
 /* ***** */
-    { "CharCnt", bCharCnt, 0 },
-    { "InFont", bInFont, 0 },
+    { "CharCnt", bCharCnt, 0, 1 },
+    { "InFont", bInFont, 0, 1 },
     { "DrawsSomething", bDrawsSomething, 0 },
     { "WorthOutputting", bWorthOutputting, 0 },
-    { "CharInfo", bCharInfo, 0 },
-    { "GlyphInfo", bCharInfo, 0 },
+    { "CharInfo", bCharInfo, 0, 1 },
+    { "GlyphInfo", bCharInfo, 0, 1 },
     { "GetAnchorPoints", bGetAnchorPoints, 0 },
-    { "GetPosSub", bGetPosSub, 0 },
+    { "GetPosSub", bGetPosSub, 0, 1 },
     { "SetGlyphTeX", bSetGlyphTeX, 0 },
     { "CompareGlyphs", bCompareGlyphs, 0 },
     { "CompareFonts", bCompareFonts, 0 },
@@ -8308,20 +8464,58 @@ static struct builtins { char *name; void (*func)(Context *); int nofontok; } bu
     { NULL, 0, 0 }
 };
 
+static void LoadLazyFonts(void) {
+    FontViewBase *fv;
+
+    for ( fv=FontViewFirst(); fv!=NULL; fv=fv->next )
+	if ( fv->sf->lazy!=NULL )
+	    SFDLoadLazyGlyphs(fv->sf);
+}
+
 static struct builtins *userdefined=NULL;
 static int ud_cnt=0, ud_max=0;
 
+/* There are several hundred builtins, so hash their names rather than */
+/*  searching through the list every time a function gets called */
+static struct builtinbucket {
+    struct builtins *func;
+    struct builtinbucket *next;
+} *builtinhash[GN_HSIZE], *builtinbuckets;
+
+static struct builtins *BuiltinLookup(const char *name) {
+    struct builtinbucket *test;
+    int i;
+
+    if ( builtinbuckets==NULL ) {
+	int h;
+	for ( i=0; builtins[i].name!=NULL; ++i );
+	builtinbuckets = gcalloc(i,sizeof(struct builtinbucket));
+	/* Insert backwards so that if a name appears twice we find the first */
+	while ( --i>=0 ) {
+	    h = hashname(builtins[i].name);
+	    builtinbuckets[i].func = &builtins[i];
+	    builtinbuckets[i].next = builtinhash[h];
+	    builtinhash[h] = &builtinbuckets[i];
+	}
+    }
+    for ( test=builtinhash[hashname(name)]; test!=NULL; test=test->next )
+	if ( strcmp(test->func->name,name)==0 )
+return( test->func );
+
+return( NULL );
+}
+
 int AddScriptingCommand(char *name,void (*func)(Context *),int needs_font ) {
     int i;
 
-    for ( i=0; builtins[i].name!=NULL; ++i )
-	if ( strcmp(builtins[i].name,name)==0 )
+    if ( BuiltinLookup(name)!=NULL )
 return( 0 );			/* Can't supercede a built in function */
 
     for ( i=0; i<ud_cnt; ++i )
 	if ( strcmp(userdefined[i].name,name)==0 ) {
 	    userdefined[i].func = func;
 	    userdefined[i].nofontok = !needs_font;
+	    userdefined[i].lazyok = false;
 return( 2 );
 	}
 
@@ -8330,6 +8524,8 @@ return( 2 );
     userdefined[ud_cnt].name = copy(name);
     userdefined[ud_cnt].func = func;
     userdefined[ud_cnt].nofontok = !needs_font;
+    userdefined[ud_cnt].lazyok = false;
+    ++ud_cnt;
 return( true );
 }
 
@@ -8345,6 +8541,34 @@ return( NULL );
 
 /* ******************************* Interpreter ****************************** */
 
+/* A script is only lexed once. The first time it is run (or called) we turn */
+/*  it into an array of tokens, and after that the interpreter reads tokens */
+/*  from the array rather than from the file. So loops don't relex their */
+/*  bodies each time round, and script functions called in a loop don't get */
+/*  reread. While compiling we also look up any names which are builtin */
+/*  functions, and find the endloop of each loop and the else/elseif/endif */
+/*  of each if, so the interpreter can jump over code rather than lex it */
+struct sctoken {
+    enum token_type tok;
+    int lineno;
+    Val val;			/* For numbers */
+    char *text;			/* For names and strings */
+    struct builtins *func;	/* For names of builtin functions */
+    int match;			/* while, foreach: the endloop. if, elseif: the next */
+				/*  else/elseif/endif. else: the endif. -1 if none */
+};
+
+struct compiledscript {
+    char *filename;
+    time_t mtime;
+    off_t size;
+    int cnt;
+    struct sctoken *toks;
+    struct compiledscript *next;
+};
+
+static struct compiledscript *compiled_scripts = NULL;
+
 static void expr(Context*,Val *val);
 
 static int _cgetc(Context *c) {
@@ -8392,18 +8616,37 @@ static void cungetc(int ch,Context *c) {
 }
 
 static long ctell(Context *c) {
-    long pos = ftell(c->script);
+    long pos;
+
+    if ( c->compiled!=NULL )
+return( c->tokpos );
+    pos = ftell(c->script);
     if ( c->ungotch )
 	--pos;
 return( pos );
 }
 
 static void cseek(Context *c,long pos) {
-    fseek(c->script,pos,SEEK_SET);
+    if ( c->compiled!=NULL )
+	c->tokpos = pos;
+    else
+	fseek(c->script,pos,SEEK_SET);
     c->ungotch = 0;
     c->backedup = false;
 }
 
+/* While compiling we don't want lexical errors to stop everything, they */
+/*  should only be reported if the interpreter actually gets there. So just */
+/*  give up on the compilation and interpret the file as we used to */
+static enum token_type LexError(Context *c,const char *msg) {
+    if ( c->compiling ) {
+	c->lexerror = true;
+return( tt_eof );
+    }
+    ScriptError( c, msg );
+return( tt_error );
+}
+
 enum token_type ff_NextToken(Context *c) {
     int ch, nch;
     enum token_type tok = tt_error;
@@ -8411,6 +8654,18 @@ enum token_type ff_NextToken(Context *c) {
     if ( c->backedup ) {
 	c->backedup = false;
 return( c->tok );
+    }
+    if ( c->compiled!=NULL ) {
+	struct sctoken *t = &c->compiled->toks[c->tokpos];
+	if ( t->tok!=tt_eof )		/* Reading past the end keeps giving eof */
+	    ++c->tokpos;
+	c->lineno = t->lineno;
+	c->tok_func = t->func;
+	if ( t->tok==tt_name || t->tok==tt_string )
+	    strcpy(c->tok_text,t->text);
+	else if ( t->tok==tt_number || t->tok==tt_unicode || t->tok==tt_real )
+	    c->tok_val = t->val;
+return( c->tok = t->tok );
     }
     do {
 	ch = cgetc(c);
@@ -8430,7 +8685,7 @@ return( c->tok );
 	    cungetc(ch,c);
 	    tok = tt_name;
 	    if ( toolong )
-		ScriptError( c, "Name too long" );
+		tok = LexError( c, "Name too long" );
 	    else {
 		int i;
 		for ( i=0; keywords[i].name!=NULL; ++i )
@@ -8542,7 +8797,7 @@ return( c->tok );
 		cungetc(ch,c);
 	    tok = tt_string;
 	    if ( toolong )
-		ScriptError( c, "String too long" );
+		tok = LexError( c, "String too long" );
 	} else switch( ch ) {
 	  case EOF:
 	    tok = tt_eof;
@@ -8692,6 +8947,11 @@ return( c->tok );
 		cungetc(ch,c);
 	  break;
 	  default:
+	    if ( c->compiling ) {
+		c->lexerror = true;
+		tok = tt_eof;
+	  break;
+	    }
 	    LogError( _("%s:%d Unexpected character %c (%d)\n"),
 		    c->filename, c->lineno, ch, ch);
 	    traceback(c);
@@ -8699,6 +8959,7 @@ return( c->tok );
     } while ( tok==tt_error );
 
     c->tok = tok;
+    c->tok_func = NULL;
 return( tok );
 }
 
@@ -8709,16 +8970,142 @@ void ff_backuptok(Context *c) {
     c->backedup = true;
 }
 
+static void CompiledScriptFree(struct compiledscript *cs) {
+    int i;
+
+    for ( i=0; i<cs->cnt; ++i )
+	free(cs->toks[i].text);
+    free(cs->toks);
+    free(cs->filename);
+    free(cs);
+}
+
+static void CompiledFindMatches(struct compiledscript *cs) {
+    int *loops, *ifs;
+    int lcnt=0, icnt=0, i;
+    struct sctoken *t;
+
+    /* The interpreter skips code by counting while/foreach/endloop (for */
+    /*  loops) and if/endif (for conditionals) and nothing else. Do the same */
+    loops = galloc(cs->cnt*sizeof(int));
+    ifs = galloc(cs->cnt*sizeof(int));	/* Last branch token of each open if */
+    for ( i=0; i<cs->cnt; ++i ) {
+	t = &cs->toks[i];
+	t->match = -1;
+	if ( t->tok==tt_while || t->tok==tt_foreach )
+	    loops[lcnt++] = i;
+	else if ( t->tok==tt_endloop ) {
+	    if ( lcnt>0 )
+		cs->toks[loops[--lcnt]].match = i;
+	} else if ( t->tok==tt_if )
+	    ifs[icnt++] = i;
+	else if ( t->tok==tt_elseif || t->tok==tt_else ) {
+	    if ( icnt>0 ) {
+		cs->toks[ifs[icnt-1]].match = i;
+		ifs[icnt-1] = i;
+	    }
+	} else if ( t->tok==tt_endif ) {
+	    if ( icnt>0 )
+		cs->toks[ifs[--icnt]].match = i;
+	}
+    }
+    free(loops); free(ifs);
+}
+
+/* Tokenizes the rest of c->script. Returns NULL if the script had a lexical */
+/*  error, in which case the caller should rewind and interpret it the old */
+/*  way so the error gets reported at the proper time */
+static struct compiledscript *CompileScript(Context *c) {
+    Context cc;
+    struct compiledscript *cs;
+    struct sctoken *t;
+    int max = 0;
+
+    if ( verbose>0 )		/* Verbose mode echoes the script as it is read */
+return( NULL );
+
+    memset(&cc,0,sizeof(cc));
+    cc.script = c->script;
+    cc.filename = c->filename;
+    cc.lineno = c->lineno;
+    cc.compiling = true;
+    cs = gcalloc(1,sizeof(struct compiledscript));
+    forever {
+	if ( cs->cnt>=max )
+	    cs->toks = grealloc(cs->toks,(max+=1000)*sizeof(struct sctoken));
+	t = &cs->toks[cs->cnt++];
+	memset(t,0,sizeof(*t));
+	t->tok = ff_NextToken(&cc);
+	if ( cc.lexerror ) {
+	    --cs->cnt;
+	    CompiledScriptFree(cs);
+return( NULL );
+	}
+	t->lineno = cc.lineno;
+	if ( t->tok==tt_name ) {
+	    t->text = copy(cc.tok_text);
+	    t->func = BuiltinLookup(cc.tok_text);
+	} else if ( t->tok==tt_string )
+	    t->text = copy(cc.tok_text);
+	else if ( t->tok==tt_number || t->tok==tt_unicode || t->tok==tt_real )
+	    t->val = cc.tok_val;
+	else if ( t->tok==tt_eof )
+    break;
+    }
+    CompiledFindMatches(cs);
+return( cs );
+}
+
+/* Script files called as functions are compiled the first time they are */
+/*  called, and we keep them around until the file changes */
+static struct compiledscript *CompiledScriptFile(char *filename) {
+    struct compiledscript *cs, *prev;
+    struct stat sb;
+    Context cc;
+
+    if ( stat(filename,&sb)==-1 )
+return( NULL );
+    for ( prev=NULL, cs=compiled_scripts; cs!=NULL; prev=cs, cs=cs->next )
+	if ( strcmp(cs->filename,filename)==0 )
+    break;
+    if ( cs!=NULL ) {
+	if ( cs->mtime==sb.st_mtime && cs->size==sb.st_size )
+return( cs );
+	if ( prev==NULL )
+	    compiled_scripts = cs->next;
+	else
+	    prev->next = cs->next;
+	CompiledScriptFree(cs);
+    }
+
+    memset(&cc,0,sizeof(cc));
+    cc.filename = filename;
+    cc.lineno = 1;
+    cc.script = fopen(filename,"r");
+    if ( cc.script==NULL )
+return( NULL );
+    cs = CompileScript(&cc);
+    fclose(cc.script);
+    if ( cs==NULL )
+return( NULL );
+    cs->filename = copy(filename);
+    cs->mtime = sb.st_mtime;
+    cs->size = sb.st_size;
+    cs->next = compiled_scripts;
+    compiled_scripts = cs;
+return( cs );
+}
+
 #define PE_ARG_MAX	25
 
-static void docall(Context *c,char *name,Val *val) {
+static void docall(Context *c,char *name,struct builtins *found,Val *val) {
     /* Be prepared for c->donteval */
+    /* found is the builtin called name if the compiler has already looked it up */
     Val args[PE_ARG_MAX];
     Array *dontfree[PE_ARG_MAX];
     int i;
     enum token_type tok;
     Context sub;
-    struct builtins *found;
 
     tok = ff_NextToken(c);
     dontfree[0] = NULL;
@@ -8778,12 +9165,8 @@ static void docall(Context *c,char *name,Val *val) {
 	    printf(")\n");
 	}
 
-	found = NULL;
-	for ( i=0; builtins[i].name!=NULL; ++i )
-	    if ( strcmp(builtins[i].name,name)==0 ) {
-		found = &builtins[i];
-	break;
-	    }
+	if ( found==NULL )
+	    found = BuiltinLookup(name);
 	if ( found==NULL && userdefined!=NULL ) {
 	    for ( i=0; i<ud_cnt; ++i )
 		if ( strcmp(userdefined[i].name,name)==0 ) {
@@ -8796,6 +9179,8 @@ static void docall(Context *c,char *name,Val *val) {
 		fflush(stdout);
 	    if ( sub.curfv==NULL && !found->nofontok )
 		ScriptError(&sub,"This command requires an active font");
+	    if ( !found->nofontok && !found->lazyok )
+		LoadLazyFonts();
 	    (found->func)(&sub);
 	} else {
 	    if ( strchr(name,'/')==NULL && strchr(c->filename,'/')!=NULL ) {
@@ -8805,8 +9190,9 @@ static void docall(Context *c,char *name,Val *val) {
 		pt = strrchr(sub.filename,'/');
 		strcpy(pt+1,name);
 	    }
-	    sub.script = fopen(sub.filename,"r");
-	    if ( sub.script==NULL ) {
+	    if ( (sub.compiled = CompiledScriptFile(sub.filename))==NULL )
+		sub.script = fopen(sub.filename,"r");
+	    if ( sub.compiled==NULL && sub.script==NULL ) {
 		if ( sub.filename==name )
 		    ScriptError(&sub, "No built-in function or script-file");
 		else {
@@ -8820,7 +9206,9 @@ static void docall(Context *c,char *name,Val *val) {
 		    ff_backuptok(&sub);
 		    ff_statement(&sub);
 		}
-		fclose(sub.script); sub.script = NULL;
+		if ( sub.script!=NULL ) {
+		    fclose(sub.script); sub.script = NULL;
+		}
 	    }
 	    if ( sub.filename!=name )
 		free( sub.filename );
@@ -8875,12 +9263,13 @@ static void handlename(Context *c,Val *val) {
     int temp;
     char *pt;
     SplineFont *sf;
+    struct builtins *func = c->tok_func;
 
     strcpy(name,c->tok_text);
     val->type = v_void;
     tok = ff_NextToken(c);
     if ( tok==tt_lparen ) {
-	docall(c,name,val);
+	docall(c,name,func,val);
     } else if ( c->donteval ) {
 	ff_backuptok(c);
     } else {
@@ -9017,6 +9406,17 @@ static void handlename(Context *c,Val *val) {
 		if ( c->curfv==NULL ) ScriptError(c,"No current font");
 		val->type = v_int;
 		val->u.ival = ValidatePrivate(c->curfv->sf);
+	    } else if ( strcmp(name,"$validationStats")==0 ) {
+		val->type = v_arrfree;
+		val->u.aval = galloc(sizeof(Array));
+		val->u.aval->argc = 3;
+		val->u.aval->vals = galloc((3+1)*sizeof(Val));
+		val->u.aval->vals[0].type = v_int;
+		val->u.aval->vals[0].u.ival = last_validate.validated;
+		val->u.aval->vals[1].type = v_int;
+		val->u.aval->vals[1].u.ival = last_validate.cached;
+		val->u.aval->vals[2].type = v_real;
+		val->u.aval->vals[2].u.fval = last_validate.seconds;
 	    } else if ( strcmp(name,"$bitmaps")==0 ) {
 		SplineFont *sf;
 		BDFFont *bdf;
@@ -9209,13 +9609,13 @@ static void term(Context *c,Val *val) {
 	    }
 	} else if ( tok==tt_lparen ) {
 	    if ( c->donteval ) {
-		docall(c,NULL,val);
+		docall(c,NULL,NULL,val);
 	    } else {
 		dereflvalif(val);
 		if ( val->type!=v_str ) {
 		    ScriptError(c,"Expected string to hold filename in procedure call");
 		} else
-		    docall(c,val->u.sval,val);
+		    docall(c,val->u.sval,NULL,val);
 	    }
 	} else if ( tok==tt_lbracket ) {
 	    expr(c,&temp);
@@ -9575,6 +9975,24 @@ static void expr(Context *c,Val *val) {
     assign(c,val);
 }
 
+/* In a compiled script the token at pos knows where its block ends, so */
+/*  rather than scanning for the end we can jump straight past it. Returns */
+/*  false if we must scan the old way */
+static int CompiledSkipBlock(Context *c,long pos) {
+    struct sctoken *toks;
+
+    if ( c->compiled==NULL || pos<0 )
+return( false );
+    toks = c->compiled->toks;
+    while ( toks[pos].match!=-1 && toks[pos].tok!=tt_endif && toks[pos].tok!=tt_endloop )
+	pos = toks[pos].match;
+    if ( toks[pos].tok!=tt_endif && toks[pos].tok!=tt_endloop )
+return( false );
+    cseek(c,pos+1);
+    c->lineno = toks[pos].lineno;
+return( true );
+}
+
 static void doforeach(Context *c) {
     long here = ctell(c);
     int lineno = c->lineno;
@@ -9616,7 +10034,7 @@ static void doforeach(Context *c) {
     c->broken = false;
 
     nest = 0;
-    while ( (tok=ff_NextToken(c))!=tt_endloop || nest>0 ) {
+    if ( !CompiledSkipBlock(c,here-1) ) while ( (tok=ff_NextToken(c))!=tt_endloop || nest>0 ) {
 	if ( tok==tt_eof )
 	    ScriptError(c,"End of file found in foreach loop" );
 	else if ( tok==tt_while ) ++nest;
@@ -9666,7 +10084,7 @@ static void dowhile(Context *c) {
     c->broken = false;
 
     nest = 0;
-    while ( (tok=ff_NextToken(c))!=tt_endloop || nest>0 ) {
+    if ( !CompiledSkipBlock(c,here-1) ) while ( (tok=ff_NextToken(c))!=tt_endloop || nest>0 ) {
 	if ( tok==tt_eof )
 	    ScriptError(c,"End of file found in while loop" );
 	else if ( tok==tt_while ) ++nest;
@@ -9679,6 +10097,7 @@ static void doif(Context *c) {
     enum token_type tok;
     Val val;
     int nest;
+    long branch = c->compiled!=NULL ? c->tokpos-1 : -1;	/* current if/elseif token */
 
     while ( 1 ) {
 	tok=ff_NextToken(c);
@@ -9699,6 +10118,9 @@ static void doif(Context *c) {
 		ScriptError(c,"End of file found in if ff_statement" );
 	    if ( !c->donteval )
     break;
+	} else if ( c->compiled!=NULL && c->compiled->toks[branch].match!=-1 ) {
+	    cseek(c,c->compiled->toks[branch].match);
+	    tok = ff_NextToken(c);
 	} else {
 	    nest = 0;
 	    while ( ((tok=ff_NextToken(c))!=tt_endif && tok!=tt_else && tok!=tt_elseif ) || nest>0 ) {
@@ -9708,6 +10130,8 @@ static void doif(Context *c) {
 		else if ( tok==tt_endif ) --nest;
 	    }
 	}
+	if ( c->compiled!=NULL )
+	    branch = c->tokpos-1;
 	if ( tok==tt_else ) {
 	    while ( (tok=ff_NextToken(c))!=tt_endif && tok!=tt_eof && !c->returned && !c->broken ) {
 		ff_backuptok(c);
@@ -9719,7 +10143,7 @@ static void doif(Context *c) {
     }
     if ( c->returned || c->broken )
 return;
-    if ( tok!=tt_endif && tok!=tt_eof ) {
+    if ( tok!=tt_endif && tok!=tt_eof && !CompiledSkipBlock(c,branch) ) {
 	nest = 0;
 	while ( (tok=ff_NextToken(c))!=tt_endif || nest>0 ) {
 	    if ( tok==tt_eof )
@@ -9889,12 +10313,20 @@ void ProcessNativeScript(int argc, char *argv[], FILE *script) {
     if ( c.script==NULL )
 	ScriptError(&c, "No such file");
     else {
+	long start = ftell(c.script);
+	c.lineno = 1;
+	/* Tokenize the whole script up front so loops and function calls */
+	/*  don't have to lex the same text over and over */
+	if ( (c.compiled = CompileScript(&c))==NULL )
+	    fseek(c.script,start,SEEK_SET);
 	c.lineno = 1;
 	while ( !c.returned && !c.broken && (tok = ff_NextToken(&c))!=tt_eof ) {
 	    ff_backuptok(&c);
 	    ff_statement(&c);
 	}
 	fclose(c.script);
+	if ( c.compiled!=NULL )
+	    CompiledScriptFree(c.compiled);
     }
     for ( i=0; i<c.a.argc; ++i )
 	free(c.a.vals[i].u.sval);
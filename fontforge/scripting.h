@@ -38,11 +38,14 @@
 struct dictentry {
     char *name;
     Val val;
+    int hnext;			/* Next entry (+1) in the same hash bucket */
 };
 
 struct dictionary {
     struct dictentry *entries;
     int cnt, max;
+    int *hash;			/* First entry (+1) in each bucket. Only built */
+				/*  once the dictionary gets big */
 };
 
 typedef struct array {
@@ -68,6 +71,9 @@ enum token_type { tt_name, tt_string, tt_number, tt_unicode, tt_real,
 	tt_error = -1
 };
 
+struct builtins;
+struct compiledscript;
+
 typedef struct context {
     struct context *caller;		/* The context of the script that called us */
     Array a;				/* The argument array */
@@ -78,6 +84,8 @@ typedef struct context {
     unsigned int donteval: 1;		/* Irrelevant for user defined funcs */
     unsigned int returned: 1;		/* Irrelevant for user defined funcs */
     unsigned int broken: 1;		/* Irrelevant for user defined funcs */
+    unsigned int compiling: 1;		/* Irrelevant for user defined funcs */
+    unsigned int lexerror: 1;		/* Irrelevant for user defined funcs */
     char tok_text[TOK_MAX+1];		/* Irrelevant for user defined funcs */
     enum token_type tok;		/* Irrelevant for user defined funcs */
     Val tok_val;			/* Irrelevant for user defined funcs */
@@ -91,6 +99,9 @@ typedef struct context {
     int ungotch;			/* Irrelevant for user defined funcs */
     FontViewBase *curfv;		/* Current fontview */
     jmp_buf *err_env;			/* place to longjump to on an error */
+    struct compiledscript *compiled;	/* Irrelevant for user defined funcs */
+    int tokpos;				/* Irrelevant for user defined funcs */
+    struct builtins *tok_func;		/* Irrelevant for user defined funcs */
 } Context;
 
 void arrayfree(Array *);
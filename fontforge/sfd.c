@@ -37,6 +37,7 @@
 #include <gwidget.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <limits.h>		/* For NAME_MAX or _POSIX_NAME_MAX */
 #ifndef NAME_MAX
@@ -337,13 +338,192 @@ return( NULL );
 return( ret );
 }
 
+/* Reading an sfd file a character at a time through stdio (with all the */
+/*  locking and ungetc-ing that implies) was most of the time it took to */
+/*  load a font. So when we parse a file we read the rest of it into memory */
+/*  in one go and the routines below take characters from there. The FILE */
+/*  is still what gets passed around, it's just used to find the buffer. */
+/*  Anything we haven't got a buffer for is read through stdio as before */
+struct sfdbuffer {
+    FILE *sfd;
+    unsigned char *base, *pt, *end;
+    long offset;		/* File position corresponding to base */
+    struct sfdbuffer *next;
+};
+static ff_thread_local struct sfdbuffer *sfdbuffers = NULL;
+
+static struct sfdbuffer *SFDBufferFind(FILE *sfd) {
+    struct sfdbuffer *buf;
+
+    if ( sfdbuffers!=NULL && sfdbuffers->sfd==sfd )
+return( sfdbuffers );
+    for ( buf=sfdbuffers; buf!=NULL; buf=buf->next )
+	if ( buf->sfd==sfd )
+return( buf );
+
+return( NULL );
+}
+
+/* Reads at most limit bytes into the buffer, or the rest of the file if */
+/*  limit is negative */
+static void _SFDBufferOpen(FILE *sfd,long limit) {
+    struct sfdbuffer *buf;
+    struct stat sb;
+    long pos;
+    size_t len, max;
+
+    if ( SFDBufferFind(sfd)!=NULL || (pos = ftell(sfd))==-1 )
+return;
+    if ( limit>=0 )
+	max = limit;
+    else if ( fstat(fileno(sfd),&sb)!=-1 && S_ISREG(sb.st_mode) && sb.st_size>=pos )
+	max = sb.st_size-pos+1;		/* +1 so a complete read comes up short */
+    else
+	max = 64*1024;
+    buf = gcalloc(1,sizeof(struct sfdbuffer));
+    buf->base = galloc(max+1);
+    len = 0;
+    forever {
+	len += fread(buf->base+len,1,max-len,sfd);
+	if ( len<max || limit>=0 )
+    break;
+	buf->base = grealloc(buf->base,max*=2);
+    }
+    buf->sfd = sfd;
+    buf->offset = pos;
+    buf->pt = buf->base;
+    buf->end = buf->base+len;
+    buf->next = sfdbuffers;
+    sfdbuffers = buf;
+}
+
+static void SFDBufferOpen(FILE *sfd) {
+    _SFDBufferOpen(sfd,-1);
+}
+
+/* Leaves the FILE positioned where parsing stopped */
+static void SFDBufferClose(FILE *sfd) {
+    struct sfdbuffer *buf, *prev;
+
+    for ( prev=NULL, buf=sfdbuffers; buf!=NULL && buf->sfd!=sfd; prev=buf, buf=buf->next );
+    if ( buf==NULL )
+return;
+    if ( prev==NULL )
+	sfdbuffers = buf->next;
+    else
+	prev->next = buf->next;
+    fseek(sfd,buf->offset+(buf->pt-buf->base),SEEK_SET);
+    free(buf->base);
+    free(buf);
+}
+
+static FILE *sfdopen(const char *filename) {
+    FILE *sfd = fopen(filename,"r");
+
+    if ( sfd!=NULL )
+	SFDBufferOpen(sfd);
+return( sfd );
+}
+
+static void sfdclose(FILE *sfd) {
+    SFDBufferClose(sfd);
+    fclose(sfd);
+}
+
+static int sfdgetc(FILE *sfd) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
+
+    if ( buf==NULL )
+return( getc(sfd));
+return( buf->pt<buf->end ? *buf->pt++ : EOF );
+}
+
+/* Only ever called to push back the character just read */
+static void sfdungetc(int ch,FILE *sfd) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
+
+    if ( buf==NULL )
+	ungetc(ch,sfd);
+    else if ( ch!=EOF && buf->pt>buf->base )
+	--buf->pt;
+}
+
+static long sfdtell(FILE *sfd) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
+
+    if ( buf==NULL )
+return( ftell(sfd));
+return( buf->offset+(buf->pt-buf->base) );
+}
+
+static void sfdseek(FILE *sfd,long pos) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
+
+    if ( buf==NULL )
+	fseek(sfd,pos,SEEK_SET);
+    else if ( pos>=buf->offset && pos<=buf->offset+(buf->end-buf->base) )
+	buf->pt = buf->base + (pos-buf->offset);
+    else {
+	/* Before the start of the buffer, read it again from there */
+	SFDBufferClose(sfd);
+	fseek(sfd,pos,SEEK_SET);
+	SFDBufferOpen(sfd);
+    }
+}
+
+static size_t sfdread(void *data,size_t size,size_t cnt,FILE *sfd) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
+
+    if ( buf==NULL )
+return( fread(data,size,cnt,sfd));
+    if ( size*cnt > buf->end-buf->pt )
+	cnt = (buf->end-buf->pt)/size;
+    memcpy(data,buf->pt,size*cnt);
+    buf->pt += size*cnt;
+return( cnt );
+}
+
+static char *sfdgets(char *str,int size,FILE *sfd) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
+    char *pt = str, *end = str+size-1;
+
+    if ( buf==NULL )
+return( fgets(str,size,sfd));
+    if ( buf->pt>=buf->end )
+return( NULL );
+    while ( pt<end && buf->pt<buf->end ) {
+	if ( (*pt++ = *buf->pt++)=='\n' )
+    break;
+    }
+    *pt = '\0';
+return( str );
+}
+
+static int sfdeof(FILE *sfd) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
+
+    if ( buf==NULL )
+return( feof(sfd));
+return( buf->pt>=buf->end );
+}
+
 /* Long lines can be broken by inserting \\\n (backslash newline) */
 /*  into the line. I don't think this is ever ambiguous as I don't */
 /*  think a line can end with backslash */
 /* UPDATE: it can... that's handled in getquotedeol() below. */
 static int nlgetc(FILE *sfd) {
+    struct sfdbuffer *buf = SFDBufferFind(sfd);
     int ch, ch2;
 
+    if ( buf!=NULL ) {
+	while ( buf->pt<buf->end ) {
+	    ch = *buf->pt++;
+	    if ( ch!='\\' || buf->pt>=buf->end || *buf->pt!='\n' )
+return( ch );
+	    ++buf->pt;
+	}
+return( EOF );
+    }
     ch=getc(sfd);
     if ( ch!='\\' )
 return( ch );
@@ -362,7 +542,7 @@ static char *SFDReadUTF7Str(FILE *sfd) {
     ch1 = nlgetc(sfd);
     while ( isspace(ch1) && ch1!='\n' && ch1!='\r') ch1 = nlgetc(sfd);
     if ( ch1=='\n' || ch1=='\r' )
-	ungetc(ch1,sfd);
+	sfdungetc(ch1,sfd);
     if ( ch1!='"' )
 return( NULL );
     pt = NULL;
@@ -391,17 +571,17 @@ return( NULL );
 		ch1 = inbase64[ch1];
 		ch2 = inbase64[c = nlgetc(sfd)];
 		if ( ch2==-1 ) {
-		    ungetc(c, sfd);
+		    sfdungetc(c, sfd);
 		    ch2 = ch3 = ch4 = 0;
 		} else {
 		    ch3 = inbase64[c = nlgetc(sfd)];
 		    if ( ch3==-1 ) {
-			ungetc(c, sfd);
+			sfdungetc(c, sfd);
 			ch3 = ch4 = 0;
 		    } else {
 			ch4 = inbase64[c = nlgetc(sfd)];
 			if ( ch4==-1 ) {
-			    ungetc(c, sfd);
+			    sfdungetc(c, sfd);
 			    ch4 = 0;
 			}
 		    }
@@ -1264,8 +1444,8 @@ return;
 
 static void *SFDUnPickle(FILE *sfd) {
     int ch, quoted;
-    static int max = 0;
-    static char *buf = NULL;
+    static ff_thread_local int max = 0;
+    static ff_thread_local char *buf = NULL;
     char *pt, *end;
     int cnt;
 
@@ -1961,6 +2141,201 @@ static void SFDFpstClassNamesOut(FILE *sfd,int class_cnt,char **classnames,char
     }
 }
 
+/* In an sfdir each glyph lives in a file of its own, and writing all those */
+/*  files is most of the time it takes to save a big font. So we format the */
+/*  glyphs into memory on several threads at once, and only replace a file */
+/*  when its contents have changed (which is also what anyone keeping the */
+/*  font under version control wants to see). We can't just trust */
+/*  sc->changed to tell us that, a glyph file also records the glyph's gid */
+/*  and encoding, and those of any glyphs it refers to, and other edits can */
+/*  change those. But a glyph which is marked changed must be written */
+struct sfdirglyph {
+    SplineChar *sc;
+    char *filename;
+    unsigned int written: 1;	/* We replaced the file's contents */
+    unsigned int err: 1;
+};
+
+struct sfdirdump {
+    struct sfdirglyph *glyphs;
+    EncMap *map;
+    int *newgids;
+};
+
+static char *SFDGlyphText(SplineChar *sc,EncMap *map,int *newgids,size_t *len) {
+    char *data = NULL;
+    FILE *mem;
+
+#ifndef _NO_OPEN_MEMSTREAM
+    mem = open_memstream(&data,len);
+    if ( mem==NULL )
+return( NULL );
+    SFDDumpChar(mem,sc,map,newgids,true,1);
+    if ( ferror(mem) ) {
+	fclose(mem);
+	free(data);
+return( NULL );
+    }
+    if ( fclose(mem) ) {
+	free(data);
+return( NULL );
+    }
+#else
+    mem = tmpfile();
+    if ( mem==NULL )
+return( NULL );
+    SFDDumpChar(mem,sc,map,newgids,true,1);
+    *len = ftell(mem);
+    rewind(mem);
+    data = galloc(*len+1);
+    if ( ferror(mem) || fread(data,1,*len,mem)!=*len ) {
+	free(data);
+	data = NULL;
+    }
+    fclose(mem);
+#endif
+return( data );
+}
+
+static int SFDFileMatches(char *filename,char *data,size_t len) {
+    FILE *file = fopen(filename,"r");
+    char buffer[4096];
+    size_t off = 0, n;
+    int ret = true;
+
+    if ( file==NULL )
+return( false );
+    while ( (n = fread(buffer,1,sizeof(buffer),file))>0 ) {
+	if ( off+n>len || memcmp(buffer,data+off,n)!=0 ) {
+	    ret = false;
+    break;
+	}
+	off += n;
+    }
+    if ( ferror(file) || off!=len )
+	ret = false;
+    fclose(file);
+return( ret );
+}
+
+static void SFDDumpGlyphFile(void *_sd,int index) {
+    struct sfdirdump *sd = _sd;
+    struct sfdirglyph *sg = &sd->glyphs[index];
+    char *data;
+    size_t len;
+    FILE *gsfd;
+
+    data = SFDGlyphText(sg->sc,sd->map,sd->newgids,&len);
+    if ( data==NULL ) {
+	sg->err = true;
+return;
+    }
+    if ( !sg->sc->changed && SFDFileMatches(sg->filename,data,len) ) {
+	free(data);
+return;
+    }
+    gsfd = fopen(sg->filename,"w");
+    if ( gsfd==NULL )
+	sg->err = true;
+    else {
+	if ( fwrite(data,1,len,gsfd)!=len || ferror(gsfd) )
+	    sg->err = true;
+	if ( fclose(gsfd) )
+	    sg->err = true;
+	sg->written = true;
+    }
+    free(data);
+}
+
+static int SFDSyncFile(char *filename) {
+#if !defined(__MINGW32__)
+    int fd = open(filename,O_RDONLY);
+    int ret;
+
+    if ( fd==-1 )
+return( false );
+    ret = fsync(fd)==0;
+    close(fd);
+return( ret );
+#else
+return( true );
+#endif
+}
+
+static int strpcmp(const void *_s1,const void *_s2) {
+    const char * const *s1 = _s1, * const *s2 = _s2;
+return( strcmp(*s1,*s2) );
+}
+
+/* Glyph files left over from glyphs which are no longer in the font */
+static void SFDRemoveStaleGlyphs(char *dirname,struct sfdirglyph *glyphs,int cnt) {
+    DIR *dir;
+    struct dirent *ent;
+    char **names, *buffer, *pt, *name;
+    int i, dlen = strlen(dirname);
+
+    dir = opendir(dirname);
+    if ( dir==NULL )
+return;
+    names = galloc((cnt+1)*sizeof(char *));
+    for ( i=0; i<cnt; ++i )
+	names[i] = glyphs[i].filename+dlen+1;
+    qsort(names,cnt,sizeof(char *),strpcmp);
+    buffer = galloc(dlen+1+NAME_MAX+1);
+    while ( (ent = readdir(dir))!=NULL ) {
+	pt = strrchr(ent->d_name,EXT_CHAR);
+	if ( pt==NULL || strcmp(pt,GLYPH_EXT)!=0 )
+    continue;
+	name = ent->d_name;
+	if ( bsearch(&name,names,cnt,sizeof(char *),strpcmp)==NULL ) {
+	    sprintf( buffer,"%s/%s", dirname, ent->d_name );
+	    unlink( buffer );
+	}
+    }
+    free(buffer);
+    free(names);
+    closedir(dir);
+}
+
+static int SFDDumpGlyphFiles(SplineFont *sf,EncMap *map,int *newgids,
+	char *dirname) {
+    struct sfdirdump sd;
+    struct sfdirglyph *sg;
+    int i, cnt, threads, err = false;
+
+    sd.glyphs = gcalloc(sf->glyphcnt+1,sizeof(struct sfdirglyph));
+    sd.map = map;
+    sd.newgids = newgids;
+    threads = ThreadCount(0);
+    for ( i=cnt=0; i<sf->glyphcnt; ++i ) if ( !SFDOmit(sf->glyphs[i]) ) {
+	sg = &sd.glyphs[cnt++];
+	sg->sc = sf->glyphs[i];
+	sg->filename = galloc(strlen(dirname)+2*strlen(sg->sc->name)+20);
+	appendnames(sg->filename,dirname,"/",sg->sc->name,GLYPH_EXT );
+#ifndef _NO_PYTHON
+	if ( sg->sc->python_persistent!=NULL )
+	    threads = 1;		/* Pickling calls into python, which is not thread safe */
+#endif
+    }
+    if ( !ThreadedForEach(cnt,threads,true,SFDDumpGlyphFile,&sd))
+	err = true;
+    for ( i=0; i<cnt; ++i ) {
+	sg = &sd.glyphs[i];
+	if ( sg->err )
+	    err = true;
+	else if ( sg->written && !SFDSyncFile(sg->filename))
+	    err = true;
+    }
+    /* If the user cancelled then some glyphs will not have been written, */
+    /*  but their old files still belong to glyphs in the font so they stay */
+    SFDRemoveStaleGlyphs(dirname,sd.glyphs,cnt);
+    SFDSyncFile(dirname);
+    for ( i=0; i<cnt; ++i )
+	free(sd.glyphs[i].filename);
+    free(sd.glyphs);
+return( err );
+}
+
 static int SFD_Dump(FILE *sfd,SplineFont *sf,EncMap *map,EncMap *normal,
 	int todir, char *dirname) {
     int i, j, realcnt;
@@ -2481,6 +2856,7 @@ static int SFD_Dump(FILE *sfd,SplineFont *sf,EncMap *map,EncMap *normal,
 		free(fontprops);
 		free(subfont);
 	    }
+	    SFDRemoveStaleGlyphs(dirname,NULL,0);	/* In case it used to be an ordinary font */
 	} else {
 	    int max;
 	    for ( i=max=0; i<sf->subfontcnt; ++i )
@@ -2510,29 +2886,15 @@ static int SFD_Dump(FILE *sfd,SplineFont *sf,EncMap *map,EncMap *normal,
 			newgids[i] = realcnt++;
 	    }
 	}
-	if ( !todir )
+	if ( todir )
+	    err |= SFDDumpGlyphFiles(sf,map,newgids,dirname);
+	else {
 	    fprintf(sfd, "BeginChars: %d %d\n", enccount, realcnt );
-	for ( i=0; i<sf->glyphcnt; ++i ) {
-	    if ( !SFDOmit(sf->glyphs[i]) ) {
-		if ( !todir )
-		SFDDumpChar(sfd,sf->glyphs[i],map,newgids,todir,1);
-		else {
-		    char *glyphfile = galloc(strlen(dirname)+2*strlen(sf->glyphs[i]->name)+20);
-		    FILE *gsfd;
-		    appendnames(glyphfile,dirname,"/",sf->glyphs[i]->name,GLYPH_EXT );
-		    gsfd = fopen(glyphfile,"w");
-		    if ( gsfd!=NULL ) {
-			SFDDumpChar(gsfd,sf->glyphs[i],map,newgids,todir,1);
-			if ( ferror(gsfd)) err = true;
-			if ( fclose(gsfd)) err = true;
-		    } else
-			err = true;
-		    free(glyphfile);
-		}
+	    for ( i=0; i<sf->glyphcnt; ++i ) {
+		if ( !SFDOmit(sf->glyphs[i]) )
+		    SFDDumpChar(sfd,sf->glyphs[i],map,newgids,todir,1);
+		ff_progress_next();
 	    }
-	    ff_progress_next();
-	}
-	if ( !todir ) {
 	    fprintf(sfd, "EndChars\n" );
 #if 0
 	    for ( i=0; i<map->enccount; ++i ) {
@@ -2648,6 +3010,7 @@ static int SFD_MMDump(FILE *sfd,SplineFont *sf,EncMap *map,EncMap *normal,
 	for ( i=0; i<mm->instance_count; ++i )
 	    err |= SFD_MIDump(mm->instances[i],map,normal,dirname,i+1);
 	err |= SFD_MIDump(mm->normal,map,normal,dirname,0);
+	SFDRemoveStaleGlyphs(dirname,NULL,0);	/* In case it used to be an ordinary font */
     } else {
 	for ( i=max=0; i<mm->instance_count; ++i )
 	    if ( max<mm->instances[i]->glyphcnt )
@@ -2706,8 +3069,9 @@ return;
 	if ( pt==NULL )
     continue;
 	sprintf( buffer,"%s/%s", filename, ent->d_name );
+	/* Glyph files are left alone, we only rewrite those which change and */
+	/*  remove the stale ones once we know what glyphs the font has */
 	if ( strcmp(pt,".props")==0 ||
-		strcmp(pt,GLYPH_EXT)==0 ||
 		strcmp(pt,BITMAP_EXT)==0 )
 	    unlink( buffer );
 	else if ( strcmp(pt,STRIKE_EXT)==0 ||
@@ -2751,7 +3115,7 @@ return;
 		sprintf( markerfile,"%s/" FONT_PROPS, buffer );
 	    if ( !GFileExists(markerfile)) {
 		sprintf( markerfile, "rm -rf %s", buffer );
-		system( buffer );
+		system( markerfile );
 	    }
 	}
     }
@@ -2760,10 +3124,31 @@ return;
     closedir(dir);
 }
 
+static int SFDDumpFont(FILE *sfd,SplineFont *sf,EncMap *map,EncMap *normal,
+	int todir,char *filename) {
+    CLocaleSave oldloc;
+    int i, gc;
+    int err = false;
+
+    SwitchToCLocale(&oldloc);
+    if ( sf->cidmaster!=NULL ) {
+	sf=sf->cidmaster;
+	gc = 1;
+	for ( i=0; i<sf->subfontcnt; ++i )
+	    if ( sf->subfonts[i]->glyphcnt > gc )
+		gc = sf->subfonts[i]->glyphcnt;
+	map = EncMap1to1(gc);
+	err = SFDDump(sfd,sf,map,NULL,todir,filename);
+	EncMapFree(map);
+    } else
+	err = SFDDump(sfd,sf,map,normal,todir,filename);
+    SwitchFromCLocale(&oldloc);
+    if ( ferror(sfd) ) err = true;
+return( err );
+}
+
 int SFDWrite(char *filename,SplineFont *sf,EncMap *map,EncMap *normal,int todir) {
     FILE *sfd;
-    char oldloc[24];
-    int i, gc;
     char *tempfilename = filename;
     int err = false;
 
@@ -2782,21 +3167,7 @@ int SFDWrite(char *filename,SplineFont *sf,EncMap *map,EncMap *normal,int todir)
     if ( sfd==NULL )
 return( 0 );
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
-    if ( sf->cidmaster!=NULL ) {
-	sf=sf->cidmaster;
-	gc = 1;
-	for ( i=0; i<sf->subfontcnt; ++i )
-	    if ( sf->subfonts[i]->glyphcnt > gc )
-		gc = sf->subfonts[i]->glyphcnt;
-	map = EncMap1to1(gc);
-	err = SFDDump(sfd,sf,map,NULL,todir,filename);
-	EncMapFree(map);
-    } else
-	err = SFDDump(sfd,sf,map,normal,todir,filename);
-    setlocale(LC_NUMERIC,oldloc);
-    if ( ferror(sfd) ) err = true;
+    err = SFDDumpFont(sfd,sf,map,normal,todir,filename);
     if ( !err && !todir && strstr(filename,"://")!=NULL )
 	err = !URLFromFile(filename,sfd);
     if ( fclose(sfd) ) err = true;
@@ -2805,6 +3176,28 @@ return( 0 );
 return( !err );
 }
 
+/* Write the sfd into memory, and then compress it straight into the file */
+static int SFDWriteCompressed(char *filename,SplineFont *sf,EncMap *map,
+	EncMap *normal,int compression) {
+    FILE *sfd, *out;
+    int err;
+
+    if ( (sfd = MemTmpFile())==NULL )
+return( false );
+    err = SFDDumpFont(sfd,sf,map,normal,false,sf->filename);
+    if ( !err ) {
+	if ( (out = fopen(filename,"wb"))==NULL )
+	    err = true;
+	else {
+	    if ( !CompressStream(out,sfd,compression) )
+		err = true;
+	    if ( fclose(out) ) err = true;
+	}
+    }
+    fclose(sfd);
+return( !err );
+}
+
 int SFDWriteBak(SplineFont *sf,EncMap *map,EncMap *normal) {
     char *buf, *buf2=NULL/*, *pt, *bpt*/;
     extern struct compressors compressors[];
@@ -2842,8 +3235,9 @@ int SFDWriteBak(SplineFont *sf,EncMap *map,EncMap *normal) {
 	}
 	free(buf);
 
-	ret = SFDWrite(sf->filename,sf,map,normal,false);
-	if ( ret && sf->compression!=0 ) {
+	if ( sf->compression!=0 && InProcessCompression(sf->compression-1))
+	    ret = SFDWriteCompressed(buf2,sf,map,normal,sf->compression-1);
+	else if ( (ret = SFDWrite(sf->filename,sf,map,normal,false)) && sf->compression!=0 ) {
 	    unlink(buf2);
 	    buf = galloc(strlen(sf->filename)+40);
 	    sprintf( buf, "%s %s", compressors[sf->compression-1].recomp, sf->filename );
@@ -2870,7 +3264,7 @@ static char *getquotedeol(FILE *sfd) {
 	    /* We can't use nlgetc() here, because it would misinterpret */
 	    /* double backslash at the end of line. Multiline strings,   */
 	    /* broken with backslash + newline, are just handled above.  */
-	    ch = getc(sfd);
+	    ch = sfdgetc(sfd);
 	    if ( ch=='n' ) ch='\n';
 	    /* else if ( ch=='\\' ) ch=='\\'; */ /* second backslash of '\\' */
 
@@ -2921,7 +3315,7 @@ static int getprotectedname(FILE *sfd, char *tokbuf) {
     if ( pt==tokbuf && ch!=EOF )
 	*pt++ = ch;
     else
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
     *pt='\0';
 return( pt!=tokbuf?1:ch==EOF?-1: 0 );
 }
@@ -2930,7 +3324,7 @@ static int getname(FILE *sfd, char *tokbuf) {
     int ch;
 
     while ( isspace(ch = nlgetc(sfd)));
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
 return( getprotectedname(sfd,tokbuf));
 }
 
@@ -2950,19 +3344,26 @@ return( tag );
 static int getint(FILE *sfd, int *val) {
     char tokbuf[100]; int ch;
     char *pt=tokbuf, *end = tokbuf+100-2;
+    int digits = 0, neg = false, n = 0;
 
     while ( isspace(ch = nlgetc(sfd)));
     if ( ch=='-' || ch=='+' ) {
+	neg = ch=='-';
 	*pt++ = ch;
 	ch = nlgetc(sfd);
     }
     while ( isdigit(ch)) {
 	if ( pt<end ) *pt++ = ch;
+	n = 10*n + ch-'0';
+	++digits;
 	ch = nlgetc(sfd);
     }
     *pt='\0';
-    ungetc(ch,sfd);
-    *val = strtol(tokbuf,NULL,10);
+    sfdungetc(ch,sfd);
+    if ( digits<=9 )		/* Can't overflow, don't bother with strtol */
+	*val = neg ? -n : n;
+    else
+	*val = strtol(tokbuf,NULL,10);
 return( pt!=tokbuf?1:ch==EOF?-1: 0 );
 }
 
@@ -2984,7 +3385,7 @@ static int getlonglong(FILE *sfd, long *val) {
 	ch = nlgetc(sfd);
     }
     *pt='\0';
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
 #ifdef _HAS_LONGLONG
     *val = strtoll(tokbuf,NULL,10);
 #else
@@ -3009,7 +3410,7 @@ static int gethex(FILE *sfd, uint32 *val) {
 	if ( ch=='x' || ch=='X' )
 	    ch = nlgetc(sfd);
 	else {
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    ch = '0';
 	}
     }
@@ -3018,7 +3419,7 @@ static int gethex(FILE *sfd, uint32 *val) {
 	ch = nlgetc(sfd);
     }
     *pt='\0';
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
     *val = strtoul(tokbuf,NULL,16);
 return( pt!=tokbuf?1:ch==EOF?-1: 0 );
 }
@@ -3029,7 +3430,7 @@ static int gethexints(FILE *sfd, uint32 *val, int cnt) {
     for ( i=0; i<cnt; ++i ) {
 	if ( i!=0 ) {
 	    ch = nlgetc(sfd);
-	    if ( ch!='.' ) ungetc(ch,sfd);
+	    if ( ch!='.' ) sfdungetc(ch,sfd);
 	}
 	if ( !gethex(sfd,&val[i]))
 return( false );
@@ -3051,19 +3452,42 @@ static int getusint(FILE *sfd, uint16 *val) {
 return( ret );
 }
 
-static int getreal(FILE *sfd, real *val) {
+/* Exactly representable, so dividing by one of these is correctly rounded */
+static const double sfd_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+	1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+static int getdouble(FILE *sfd, double *val) {
     char tokbuf[100];
     int ch;
     char *pt=tokbuf, *end = tokbuf+100-2, *nend;
+    double mant = 0;
+    int digits = 0, frac = -1, simple = true;
 
     while ( isspace(ch = nlgetc(sfd)));
     if ( ch!='e' && ch!='E' )		/* real's can't begin with exponants */
 	while ( isdigit(ch) || ch=='-' || ch=='+' || ch=='e' || ch=='E' || ch=='.' || ch==',' ) {
 	    if ( pt<end ) *pt++ = ch;
+	    if ( isdigit(ch) ) {
+		mant = 10*mant + (ch-'0');
+		++digits;
+		if ( frac>=0 ) ++frac;
+	    } else if ( ch=='.' && frac<0 )
+		frac = 0;
+	    else if ( ch!='-' || pt!=tokbuf+1 )
+		simple = false;
 	    ch = nlgetc(sfd);
 	}
     *pt='\0';
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
+    /* Almost everything in an sfd file is a short decimal number. With at */
+    /*  most 15 digits the mantissa is exact, and one division by an exact */
+    /*  power of ten gives the same answer strtod would, only much faster */
+    if ( simple && digits>0 && digits<=15 ) {
+	if ( frac>0 )
+	    mant /= sfd_pow10[frac];
+	*val = *tokbuf=='-' ? -mant : mant;
+return( 1 );
+    }
     *val = strtod(tokbuf,&nend);
     /* Beware of different locals! */
     if ( *nend!='\0' ) {
@@ -3076,6 +3500,52 @@ static int getreal(FILE *sfd, real *val) {
 return( pt!=tokbuf && *nend=='\0'?1:ch==EOF?-1: 0 );
 }
 
+static int getreal(FILE *sfd, real *val) {
+    double dval;
+    int ret = getdouble(sfd,&dval);
+
+    *val = dval;
+return( ret );
+}
+
+/* Reads " dx=%d dy=%d dh=%d dv=%d" */
+static void getvr(FILE *sfd, struct vr *vr) {
+    static const char keys[] = "dx=dy=dh=dv=";
+    int16 *vals[4];
+    int i, j, ch;
+
+    vals[0] = &vr->xoff; vals[1] = &vr->yoff;
+    vals[2] = &vr->h_adv_off; vals[3] = &vr->v_adv_off;
+    for ( i=0; i<4; ++i ) {
+	while ( isspace(ch = nlgetc(sfd)));
+	for ( j=0; ch==keys[3*i+j]; ) {
+	    if ( ++j==3 )
+	break;
+	    ch = nlgetc(sfd);
+	}
+	if ( j!=3 ) {
+	    sfdungetc(ch,sfd);
+return;
+	}
+	if ( getsint(sfd,vals[i])!=1 )
+return;
+    }
+}
+
+/* Reads "%d,%d>" (the '<' has already been read) */
+static void getmacfeat(FILE *sfd, int *feat, int *setting) {
+    int ch;
+
+    getint(sfd,feat);
+    if ( (ch = nlgetc(sfd))!=',' ) {
+	sfdungetc(ch,sfd);
+return;
+    }
+    getint(sfd,setting);
+    if ( (ch = nlgetc(sfd))!='>' )
+	sfdungetc(ch,sfd);
+}
+
 /* Don't use nlgetc here. We carefully control newlines when dumping in 85 */
 /*  but backslashes can occur at end of line. */
 static int Dec85(struct enc85 *dec) {
@@ -3083,15 +3553,15 @@ static int Dec85(struct enc85 *dec) {
     unsigned int val;
 
     if ( dec->pos<0 ) {
-	while ( isspace(ch1=getc(dec->sfd)));
+	while ( isspace(ch1=sfdgetc(dec->sfd)));
 	if ( ch1=='z' ) {
 	    dec->sofar[0] = dec->sofar[1] = dec->sofar[2] = dec->sofar[3] = 0;
 	    dec->pos = 3;
 	} else {
-	    while ( isspace(ch2=getc(dec->sfd)));
-	    while ( isspace(ch3=getc(dec->sfd)));
-	    while ( isspace(ch4=getc(dec->sfd)));
-	    while ( isspace(ch5=getc(dec->sfd)));
+	    while ( isspace(ch2=sfdgetc(dec->sfd)));
+	    while ( isspace(ch3=sfdgetc(dec->sfd)));
+	    while ( isspace(ch4=sfdgetc(dec->sfd)));
+	    while ( isspace(ch5=sfdgetc(dec->sfd)));
 	    val = ((((ch1-'!')*85+ ch2-'!')*85 + ch3-'!')*85 + ch4-'!')*85 + ch5-'!';
 	    dec->sofar[3] = val>>24;
 	    dec->sofar[2] = val>>16;
@@ -3180,7 +3650,7 @@ static ImageList *SFDGetImage(FILE *sfd) {
     getreal(sfd,&img->xscale);
     getreal(sfd,&img->yscale);
     while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
     rlelen = 0;
     if ( isdigit(ch))
 	getint(sfd,&rlelen);
@@ -3377,7 +3847,7 @@ static struct ttf_table *SFDGetShortTable(FILE *sfd, SplineFont *sf,struct ttf_t
 		}
 		sf->cvt_names[i] = SFDReadUTF7Str(sfd);
 	    } else
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 	}
     }
 
@@ -3467,7 +3937,7 @@ static void SFDGetHintMask(FILE *sfd,HintMask *hintmask) {
 	else if ( ch>='A' && ch<='F' )
 	    ch -= 'A'-10;
 	else {
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
     break;
 	}
 	if ( nibble<2*HntMax/8 )
@@ -3485,7 +3955,13 @@ static void SFDGetSpiros(FILE *sfd,SplineSet *cur) {
     ch = nlgetc(sfd);		/* i */
     ch = nlgetc(sfd);		/* r */
     ch = nlgetc(sfd);		/* o */
-    while ( fscanf(sfd,"%lg %lg %c", &cp.x, &cp.y, &cp.ty )==3 ) {
+    forever {
+	if ( getdouble(sfd,&cp.x)!=1 || getdouble(sfd,&cp.y)!=1 )
+    break;
+	while ( isspace(ch=nlgetc(sfd)));
+	if ( ch==EOF )
+    break;
+	cp.ty = ch;
 	if ( cur!=NULL ) {
 	    if ( cur->spiro_cnt>=cur->spiro_max )
 		cur->spiros = grealloc(cur->spiros,(cur->spiro_max+=10)*sizeof(spiro_cp));
@@ -3508,7 +3984,7 @@ static void SFDGetSpiros(FILE *sfd,SplineSet *cur) {
 	ch = nlgetc(sfd);		/* r */
 	ch = nlgetc(sfd);		/* o */
     } else
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 }
 
 static SplineSet *SFDGetSplineSet(SplineFont *sf,FILE *sfd,int order2) {
@@ -3532,7 +4008,7 @@ static SplineSet *SFDGetSplineSet(SplineFont *sf,FILE *sfd,int order2) {
 	if ( ch=='E' || ch=='e' || ch==EOF )
     break;
 	if ( ch=='S' ) {
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    SFDGetSpiros(sfd,cur);
     continue;
 	} else if ( ch=='N' ) {
@@ -3634,13 +4110,13 @@ static SplineSet *SFDGetSplineSet(SplineFont *sf,FILE *sfd,int order2) {
 		pt->hintmask = chunkalloc(sizeof(HintMask));
 		SFDGetHintMask(sfd,pt->hintmask);
 	    } else if ( ch!=',' )
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 	    else {
 		ch = nlgetc(sfd);
 		if ( ch==',' )
 		    pt->ttfindex = 0xfffe;
 		else {
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    getint(sfd,&val);
 		    pt->ttfindex = val;
 		    nlgetc(sfd);	/* skip comma */
@@ -3649,9 +4125,9 @@ static SplineSet *SFDGetSplineSet(SplineFont *sf,FILE *sfd,int order2) {
 		}
 		ch = nlgetc(sfd);
 		if ( ch=='\r' || ch=='\n' )
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		else {
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    getint(sfd,&val);
 		    pt->nextcpindex = val;
 		    if ( val!=-1 )
@@ -3892,7 +4368,7 @@ static HintInstance *SFDReadHintInstances(FILE *sfd, StemInfo *stem) {
 	while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
     }
     if ( ch!='<' ) {
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 return(NULL);
     }
     while ( getreal(sfd,&begin)==1 && getreal(sfd,&end)) {
@@ -3907,7 +4383,7 @@ return(NULL);
     }
     while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
     if ( ch!='>' )
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 return( head );
 }
 
@@ -3994,7 +4470,7 @@ static DeviceTable *SFDReadDeviceTable(FILE *sfd,DeviceTable *adjust) {
 	if ( ch=='}' )
 return(NULL);
 	else
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	if ( adjust==NULL )
 	    adjust = chunkalloc(sizeof(DeviceTable));
 	getint(sfd,&first);
@@ -4010,14 +4486,14 @@ return(NULL);
 	adjust->corrections = galloc(len);
 	for ( i=0; i<len; ++i ) {
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    if ( ch!=',' ) ungetc(ch,sfd);
+	    if ( ch!=',' ) sfdungetc(ch,sfd);
 	    getint(sfd,&junk);
 	    adjust->corrections[i] = junk;
 	}
 	while ( (ch=nlgetc(sfd))==' ' );
-	if ( ch!='}' ) ungetc(ch,sfd);
+	if ( ch!='}' ) sfdungetc(ch,sfd);
     } else
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 return( adjust );
 }
 
@@ -4037,7 +4513,7 @@ static ValDevTab *SFDReadValDevTab(FILE *sfd) {
 	    buf[0]=ch;
 	    for ( j=1; j<3; ++j ) buf[j]=nlgetc(sfd);
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    if ( ch!='=' ) ungetc(ch,sfd);
+	    if ( ch!='=' ) sfdungetc(ch,sfd);
 	    SFDReadDeviceTable(sfd,
 		    strcmp(buf,"ddx")==0 ? &vdt.xadjust :
 		    strcmp(buf,"ddy")==0 ? &vdt.yadjust :
@@ -4045,7 +4521,7 @@ static ValDevTab *SFDReadValDevTab(FILE *sfd) {
 		    strcmp(buf,"ddv")==0 ? &vdt.yadv :
 			(&vdt.xadjust) + i );
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    if ( ch!=']' ) ungetc(ch,sfd);
+	    if ( ch!=']' ) sfdungetc(ch,sfd);
 	    else
 	break;
 	}
@@ -4056,7 +4532,7 @@ static ValDevTab *SFDReadValDevTab(FILE *sfd) {
 return( v );
 	}
     } else
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 return( NULL );
 }
 #else
@@ -4069,19 +4545,19 @@ static void SFDSkipDeviceTable(FILE *sfd) {
 	if ( ch=='}' )
 return;
 	else
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	getint(sfd,&first);
 	ch = nlgetc(sfd);		/* Should be '-' */
 	getint(sfd,&last);
 	for ( i=0; i<=last-first; ++i ) {
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    if ( ch!=',' ) ungetc(ch,sfd);
+	    if ( ch!=',' ) sfdungetc(ch,sfd);
 	    getint(sfd,&junk);
 	}
 	while ( (ch=nlgetc(sfd))==' ' );
-	if ( ch!='}' ) ungetc(ch,sfd);
+	if ( ch!='}' ) sfdungetc(ch,sfd);
     } else
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 }
 
 static void SFDSkipValDevTab(FILE *sfd) {
@@ -4096,12 +4572,12 @@ static void SFDSkipValDevTab(FILE *sfd) {
 	    for ( j=0; j<3; ++j ) ch=nlgetc(sfd);
 	    SFDSkipDeviceTable(sfd);
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    if ( ch!=']' ) ungetc(ch,sfd);
+	    if ( ch!=']' ) sfdungetc(ch,sfd);
 	    else
 	break;
 	}
     } else
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 }
 #endif
 
@@ -4140,7 +4616,7 @@ return( lastap );
     }
     getsint(sfd,&ap->lig_index);
     ch = nlgetc(sfd);
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
     if ( ch==' ' ) {
 #ifdef FONTFORGE_CONFIG_DEVICETABLES
 	SFDReadDeviceTable(sfd,&ap->xadjust);
@@ -4150,7 +4626,7 @@ return( lastap );
 	SFDSkipDeviceTable(sfd);
 #endif
 	ch = nlgetc(sfd);
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	if ( isdigit(ch)) {
 	    getsint(sfd,(int16 *) &ap->ttf_pt_index);
 	    ap->has_ttf_pt = true;
@@ -4187,7 +4663,7 @@ static RefChar *SFDGetRef(FILE *sfd, int was_enc) {
     getreal(sfd,&rf->transform[4]);
     getreal(sfd,&rf->transform[5]);
     while ( (ch=nlgetc(sfd))==' ');
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
     if ( isdigit(ch) ) {
 	getint(sfd,&temp);
 	rf->use_my_metrics = temp&1;
@@ -4200,7 +4676,7 @@ static RefChar *SFDGetRef(FILE *sfd, int was_enc) {
 	    if ( ch=='O' )
 		rf->point_match_out_of_date = true;
 	    else
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 	}
     }
 return( rf );
@@ -4328,19 +4804,19 @@ static struct glyphvariants *SFDParseGlyphComposition(FILE *sfd,
 	getname(sfd,tok);
 	gv->parts[i].component = copy(tok);
 	while ( (ch=nlgetc(sfd))==' ' );
-	if ( ch!='%' ) ungetc(ch,sfd);
+	if ( ch!='%' ) sfdungetc(ch,sfd);
 	getint(sfd,&temp);
 	gv->parts[i].is_extender = temp;
 	while ( (ch=nlgetc(sfd))==' ' );
-	if ( ch!=',' ) ungetc(ch,sfd);
+	if ( ch!=',' ) sfdungetc(ch,sfd);
 	getint(sfd,&temp);
 	gv->parts[i].startConnectorLength=temp;
 	while ( (ch=nlgetc(sfd))==' ' );
-	if ( ch!=',' ) ungetc(ch,sfd);
+	if ( ch!=',' ) sfdungetc(ch,sfd);
 	getint(sfd,&temp);
 	gv->parts[i].endConnectorLength = temp;
 	while ( (ch=nlgetc(sfd))==' ' );
-	if ( ch!=',' ) ungetc(ch,sfd);
+	if ( ch!=',' ) sfdungetc(ch,sfd);
 	getint(sfd,&temp);
 	gv->parts[i].fullAdvance = temp;
     }
@@ -4357,13 +4833,13 @@ static void SFDParseVertexKern(FILE *sfd, struct mathkernvertex *vertex) {
 	SFDParseMathValueRecord(sfd,&vertex->mkd[i].height,&vertex->mkd[i].height_adjusts);
 	while ( (ch=nlgetc(sfd))==' ' );
 	if ( ch!=EOF && ch!=',' )
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	SFDParseMathValueRecord(sfd,&vertex->mkd[i].kern,&vertex->mkd[i].kern_adjusts);
 #else
 	SFDParseMathValueRecord(sfd,&vertex->mkd[i].height);
 	while ( (ch=nlgetc(sfd))==' ' );
 	if ( ch!=EOF && ch!=',' )
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	SFDParseMathValueRecord(sfd,&vertex->mkd[i].kern);
 #endif
     }
@@ -4376,12 +4852,12 @@ static struct gradient *SFDParseGradient(FILE *sfd,char *tok) {
 
     getreal(sfd,&grad->start.x);
     while ( isspace(ch=nlgetc(sfd)));
-    if ( ch!=';' ) ungetc(ch,sfd);
+    if ( ch!=';' ) sfdungetc(ch,sfd);
     getreal(sfd,&grad->start.y);
 
     getreal(sfd,&grad->stop.x);
     while ( isspace(ch=nlgetc(sfd)));
-    if ( ch!=';' ) ungetc(ch,sfd);
+    if ( ch!=';' ) sfdungetc(ch,sfd);
     getreal(sfd,&grad->stop.y);
 
     getreal(sfd,&grad->radius);
@@ -4397,12 +4873,12 @@ static struct gradient *SFDParseGradient(FILE *sfd,char *tok) {
     grad->grad_stops = gcalloc(grad->stop_cnt,sizeof(struct grad_stops));
     for ( i=0; i<grad->stop_cnt; ++i ) {
 	while ( isspace(ch=nlgetc(sfd)));
-	if ( ch!='{' ) ungetc(ch,sfd);
+	if ( ch!='{' ) sfdungetc(ch,sfd);
 	getreal( sfd, &grad->grad_stops[i].offset );
 	gethex( sfd, &grad->grad_stops[i].col );
 	getreal( sfd, &grad->grad_stops[i].opacity );
 	while ( isspace(ch=nlgetc(sfd)));
-	if ( ch!='}' ) ungetc(ch,sfd);
+	if ( ch!='}' ) sfdungetc(ch,sfd);
     }
 return( grad );
 }
@@ -4416,11 +4892,11 @@ static struct pattern *SFDParsePattern(FILE *sfd,char *tok) {
 
     getreal(sfd,&pat->width);
     while ( isspace(ch=nlgetc(sfd)));
-    if ( ch!=';' ) ungetc(ch,sfd);
+    if ( ch!=';' ) sfdungetc(ch,sfd);
     getreal(sfd,&pat->height);
 
     while ( isspace(ch=nlgetc(sfd)));
-    if ( ch!='[' ) ungetc(ch,sfd);
+    if ( ch!='[' ) sfdungetc(ch,sfd);
     getreal(sfd,&pat->transform[0]);
     getreal(sfd,&pat->transform[1]);
     getreal(sfd,&pat->transform[2]);
@@ -4428,7 +4904,7 @@ static struct pattern *SFDParsePattern(FILE *sfd,char *tok) {
     getreal(sfd,&pat->transform[4]);
     getreal(sfd,&pat->transform[5]);
     while ( isspace(ch=nlgetc(sfd)));
-    if ( ch!=']' ) ungetc(ch,sfd);
+    if ( ch!=']' ) sfdungetc(ch,sfd);
 return( pat );
 }
 #endif
@@ -4450,30 +4926,72 @@ static void SFDConsumeUntil( FILE *sfd, char** terminators ) {
     }
 }
 
-static int orig_pos;
+static ff_thread_local int orig_pos;
 
-static SplineChar *SFDGetChar(FILE *sfd,SplineFont *sf, int had_sf_layer_cnt) {
-    SplineChar *sc;
-    char tok[2000], ch;
-    RefChar *lastr=NULL, *ref;
-    ImageList *lasti=NULL, *img;
-    AnchorPoint *lastap = NULL;
-    int isliga, ispos, issubs, ismult, islcar, ispair, temp, i;
-    PST *last = NULL;
-    uint32 script = 0;
-    int current_layer = ly_fore;
-    int multilayer = sf->multilayer;
-    int had_old_dstems = false;
-    SplineFont *sli_sf = sf->cidmaster ? sf->cidmaster : sf;
+static void SFDGetCharEncoding(FILE *sfd,SplineFont *sf,SplineChar *sc) {
+    int enc, ch;
+
+    getint(sfd,&enc);
+    getint(sfd,&sc->unicodeenc);
+    while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
+    sfdungetc(ch,sfd);
+    if ( ch!='\n' && ch!='\r' ) {
+	getint(sfd,&sc->orig_pos);
+	if ( sc->orig_pos==65535 )
+	    sc->orig_pos = orig_pos++;
+	    /* An old mark meaning: "I don't know" */
+	if ( sc->orig_pos<sf->glyphcnt && sf->glyphs[sc->orig_pos]!=NULL )
+	    sc->orig_pos = sf->glyphcnt;
+	if ( sc->orig_pos>=sf->glyphcnt ) {
+	    if ( sc->orig_pos>=sf->glyphmax )
+		sf->glyphs = grealloc(sf->glyphs,(sf->glyphmax = sc->orig_pos+10)*sizeof(SplineChar *));
+	    memset(sf->glyphs+sf->glyphcnt,0,(sc->orig_pos+1-sf->glyphcnt)*sizeof(SplineChar *));
+	    sf->glyphcnt = sc->orig_pos+1;
+	}
+	if ( sc->orig_pos+1 > orig_pos )
+	    orig_pos = sc->orig_pos+1;
+    } else if ( sf->cidmaster!=NULL ) {		/* In cid fonts the orig_pos is just the cid */
+	sc->orig_pos = enc;
+    } else {
+	sc->orig_pos = orig_pos++;
+    }
+    SFDSetEncMap(sf,sc->orig_pos,enc);
+}
+
+static void SFDGetAltUnis(FILE *sfd,SplineChar *sc,int isaltuni2) {
     struct altuni *altuni;
-    int oldback = false;
+    uint32 uni[3];
+    int u;
+
+    forever {
+	if ( isaltuni2 ) {
+	    if ( !gethexints(sfd,uni,3) )
+    break;
+	} else {
+	    if ( getint(sfd,&u)!=1 )
+    break;
+	    uni[0] = u; uni[1] = -1; uni[2] = 0;
+	}
+	altuni = chunkalloc(sizeof(struct altuni));
+	altuni->unienc = uni[0];
+	altuni->vs = uni[1];
+	altuni->fid = uni[2];
+	altuni->next = sc->altuni;
+	sc->altuni = altuni;
+    }
+}
+
+/* Reads the "StartChar: name" line and creates the glyph */
+static SplineChar *SFDStartChar(FILE *sfd,SplineFont *sf,char *tok) {
+    SplineChar *sc;
+    int ch;
 
     if ( getname(sfd,tok)!=1 )
 return( NULL );
     if ( strcmp(tok,"StartChar:")!=0 )
 return( NULL );
     while ( isspace(ch=nlgetc(sfd)));
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
     sc = SFSplineCharCreate(sf);
     if ( ch!='"' ) {
 	if ( getname(sfd,tok)!=1 ) {
@@ -4490,58 +5008,37 @@ return( NULL );
     }
     sc->vwidth = sf->ascent+sf->descent;
     sc->parent = sf;
+return( sc );
+}
+
+static SplineChar *SFDReadChar(FILE *sfd,SplineFont *sf, int had_sf_layer_cnt) {
+    SplineChar *sc;
+    char tok[2000], ch;
+    RefChar *lastr=NULL, *ref;
+    ImageList *lasti=NULL, *img;
+    AnchorPoint *lastap = NULL;
+    int isliga, ispos, issubs, ismult, islcar, ispair, temp, i;
+    PST *last = NULL;
+    uint32 script = 0;
+    int current_layer = ly_fore;
+    int multilayer = sf->multilayer;
+    int had_old_dstems = false;
+    SplineFont *sli_sf = sf->cidmaster ? sf->cidmaster : sf;
+    int oldback = false;
+
+    if ( (sc = SFDStartChar(sfd,sf,tok))==NULL )
+return( NULL );
     while ( 1 ) {
 	if ( getname(sfd,tok)!=1 ) {
 	    SplineCharFree(sc);
 return( NULL );
 	}
 	if ( strmatch(tok,"Encoding:")==0 ) {
-	    int enc;
-	    getint(sfd,&enc);
-	    getint(sfd,&sc->unicodeenc);
-	    while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
-	    ungetc(ch,sfd);
-	    if ( ch!='\n' && ch!='\r' ) {
-		getint(sfd,&sc->orig_pos);
-		if ( sc->orig_pos==65535 )
-		    sc->orig_pos = orig_pos++;
-		    /* An old mark meaning: "I don't know" */
-		if ( sc->orig_pos<sf->glyphcnt && sf->glyphs[sc->orig_pos]!=NULL )
-		    sc->orig_pos = sf->glyphcnt;
-		if ( sc->orig_pos>=sf->glyphcnt ) {
-		    if ( sc->orig_pos>=sf->glyphmax )
-			sf->glyphs = grealloc(sf->glyphs,(sf->glyphmax = sc->orig_pos+10)*sizeof(SplineChar *));
-		    memset(sf->glyphs+sf->glyphcnt,0,(sc->orig_pos+1-sf->glyphcnt)*sizeof(SplineChar *));
-		    sf->glyphcnt = sc->orig_pos+1;
-		}
-		if ( sc->orig_pos+1 > orig_pos )
-		    orig_pos = sc->orig_pos+1;
-	    } else if ( sf->cidmaster!=NULL ) {		/* In cid fonts the orig_pos is just the cid */
-		sc->orig_pos = enc;
-	    } else {
-		sc->orig_pos = orig_pos++;
-	    }
-	    SFDSetEncMap(sf,sc->orig_pos,enc);
+	    SFDGetCharEncoding(sfd,sf,sc);
 	} else if ( strmatch(tok,"AltUni:")==0 ) {
-	    int uni;
-	    while ( getint(sfd,&uni)==1 ) {
-		altuni = chunkalloc(sizeof(struct altuni));
-		altuni->unienc = uni;
-		altuni->vs = -1;
-		altuni->fid = 0;
-		altuni->next = sc->altuni;
-		sc->altuni = altuni;
-	    }
+	    SFDGetAltUnis(sfd,sc,false);
 	} else if ( strmatch(tok,"AltUni2:")==0 ) {
-	    uint32 uni[3];
-	    while ( gethexints(sfd,uni,3) ) {
-		altuni = chunkalloc(sizeof(struct altuni));
-		altuni->unienc = uni[0];
-		altuni->vs = uni[1];
-		altuni->fid = uni[2];
-		altuni->next = sc->altuni;
-		sc->altuni = altuni;
-	    }
+	    SFDGetAltUnis(sfd,sc,true);
 	} else if ( strmatch(tok,"OldEncoding:")==0 ) {
 	    int old_enc;		/* Obsolete info */
 	    getint(sfd,&old_enc);
@@ -4551,7 +5048,7 @@ return( NULL );
             if ( ch=='\n' || ch=='\r' )
                 script = 0;
             else {
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		script = gettag(sfd);
             }
 	} else if ( strmatch(tok,"Width:")==0 ) {
@@ -4586,7 +5083,7 @@ return( NULL );
 	    getsint(sfd,&sc->tex_height);
 	    getsint(sfd,&sc->tex_depth);
 	    while ( isspace(ch=nlgetc(sfd)) && ch!='\n' && ch!='\r');
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    if ( ch!='\n' && ch!='\r' ) {
 		int16 old_tex;
 		/* Used to store two extra values here */
@@ -4679,14 +5176,14 @@ return( NULL );
 	    for ( i=0; i<sc->countermask_cnt; ++i ) {
 		int ch;
 		while ( (ch=nlgetc(sfd))==' ' );
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		SFDGetHintMask(sfd,&sc->countermasks[i]);
 	    }
 	} else if ( strmatch(tok,"AnchorPoint:")==0 ) {
 	    lastap = SFDReadAnchorPoints(sfd,sc,&sc->anchor,lastap);
 	} else if ( strmatch(tok,"Fore")==0 ) {
 	    while ( isspace(ch = nlgetc(sfd)));
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    if ( ch!='I' && ch!='R' && ch!='S' && ch!='V') {
 		/* Old format, without a SplineSet token */
 		sc->layers[ly_fore].splines = SFDGetSplineSet(sf,sfd,sc->layers[ly_fore].order2);
@@ -4700,7 +5197,7 @@ return( NULL );
 	    sc->python_persistent = SFDUnPickle(sfd);
 	} else if ( strmatch(tok,"Back")==0 ) {
 	    while ( isspace(ch=nlgetc(sfd)));
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    if ( ch!='I' && ch!='R' && ch!='S' && ch!='V') {
 		/* Old format, without a SplineSet token */
 		sc->layers[ly_back].splines = SFDGetSplineSet(sf,sfd,sc->layers[ly_back].order2);
@@ -4752,7 +5249,7 @@ return( NULL );
 		if ( caps[i]==NULL ) --i;
 		linecap = i;
 		while ( (ch=nlgetc(sfd))==' ' || ch=='[' );
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		getreal(sfd,&trans[0]);
 		getreal(sfd,&trans[1]);
 		getreal(sfd,&trans[2]);
@@ -4768,7 +5265,7 @@ return( NULL );
 		    if ( i<DASH_MAX )
 			dashes[i] = 0;
 		} else {
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    memset(dashes,0,sizeof(dashes));
 		}
 		sc->layers[layer].dofill = dofill;
@@ -4900,7 +5397,7 @@ return( NULL );
 
 	    if ( sf->sfd_version<2 )
 		LogError(_("Found an new style kerning pair inside a version 1 (or lower) sfd file.\n") );
-	    while ( fscanf(sfd,"%d %d", &index, &off )==2 ) {
+	    while ( getint(sfd,&index)==1 && getint(sfd,&off)==1 ) {
 		sub = SFFindLookupSubtableAndFreeName(sf,SFDReadUTF7Str(sfd));
 		if ( sub==NULL ) {
 		    LogError(_("KernPair with no subtable name.\n"));
@@ -4914,7 +5411,7 @@ return( NULL );
 		kp->next = NULL;
 #ifdef FONTFORGE_CONFIG_DEVICETABLES
 		while ( (ch=nlgetc(sfd))==' ' );
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		if ( ch=='{' ) {
 		    kp->adjust=chunkalloc(sizeof(DeviceTable));
 		    SFDReadDeviceTable(sfd,kp->adjust);
@@ -4948,9 +5445,9 @@ exit(1);
 	    if ( strmatch(tok,"KernsSLIF:")==0 || strmatch(tok,"KernsSLIFO:")==0 ||
 		    strmatch(tok,"VKernsSLIF:")==0 || strmatch(tok,"VKernsSLIFO:")==0 )
 		hassli=2;
-	    while ( (hassli==1 && fscanf(sfd,"%d %d %d", &index, &off, &sli )==3) ||
-		    (hassli==2 && fscanf(sfd,"%d %d %d %d", &index, &off, &sli, &flags )==4) ||
-		    (hassli==0 && fscanf(sfd,"%d %d", &index, &off )==2) ) {
+	    while ( getint(sfd,&index)==1 && getint(sfd,&off)==1 &&
+		    (hassli==0 || getint(sfd,&sli)==1) &&
+		    (hassli!=2 || getint(sfd,&flags)==1) ) {
 		if ( !hassli )
 		    sli = SFFindBiggestScriptLangIndex(sli_sf,
 			    script!=0?script:SCScriptFromUnicode(sc),DEFAULT_LANG);
@@ -4977,7 +5474,7 @@ exit(1);
 		kp->kp.next = NULL;
 #ifdef FONTFORGE_CONFIG_DEVICETABLES
 		while ( (ch=nlgetc(sfd))==' ' );
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		if ( ch=='{' ) {
 		    kp->kp.adjust=chunkalloc(sizeof(DeviceTable));
 		    SFDReadDeviceTable(sfd,kp->kp.adjust);
@@ -5029,21 +5526,21 @@ exit(1);
 		while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
 		if ( isdigit(ch)) {
 		    int temp;
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    getint(sfd,&temp);
 		    ((PST1 *) pst)->flags = temp;
 		    while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
 		} else
 		    ((PST1 *) pst)->flags = 0 /*PSTDefaultFlags(type,sc)*/;
 		if ( isdigit(ch)) {
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    getusint(sfd,&((PST1 *) pst)->script_lang_index);
 		    while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
 		} else
 		    ((PST1 *) pst)->script_lang_index = SFFindBiggestScriptLangIndex(sf,
 			    script!=0?script:SCScriptFromUnicode(sc),DEFAULT_LANG);
 		if ( ch=='\'' ) {
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    ((PST1 *) pst)->tag = gettag(sfd);
 		} else if ( ch=='<' ) {
 		    getint(sfd,&temp);
@@ -5054,7 +5551,7 @@ exit(1);
 		    nlgetc(sfd);	/* close '>' */
 		    ((PST1 *) pst)->macfeature = true;
 		} else
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		if ( type==pst_lcaret ) {
 		/* These are meaningless for lcarets, set them to innocuous values */
 		    ((PST1 *) pst)->script_lang_index = SLI_UNKNOWN;
@@ -5085,9 +5582,7 @@ exit(1);
 	    last = pst;
 	    pst->type = type;
 	    if ( pst->type==pst_position ) {
-		fscanf( sfd, " dx=%hd dy=%hd dh=%hd dv=%hd",
-			&pst->u.pos.xoff, &pst->u.pos.yoff,
-			&pst->u.pos.h_adv_off, &pst->u.pos.v_adv_off);
+		getvr(sfd,&pst->u.pos);
 #ifdef FONTFORGE_CONFIG_DEVICETABLES
 		pst->u.pos.adjust = SFDReadValDevTab(sfd);
 #else
@@ -5098,17 +5593,13 @@ exit(1);
 		getname(sfd,tok);
 		pst->u.pair.paired = copy(tok);
 		pst->u.pair.vr = chunkalloc(sizeof(struct vr [2]));
-		fscanf( sfd, " dx=%hd dy=%hd dh=%hd dv=%hd",
-			&pst->u.pair.vr[0].xoff, &pst->u.pair.vr[0].yoff,
-			&pst->u.pair.vr[0].h_adv_off, &pst->u.pair.vr[0].v_adv_off);
+		getvr(sfd,&pst->u.pair.vr[0]);
 #ifdef FONTFORGE_CONFIG_DEVICETABLES
 		pst->u.pair.vr[0].adjust = SFDReadValDevTab(sfd);
 #else
 		SFDSkipValDevTab(sfd);
 #endif
-		fscanf( sfd, " dx=%hd dy=%hd dh=%hd dv=%hd",
-			&pst->u.pair.vr[1].xoff, &pst->u.pair.vr[1].yoff,
-			&pst->u.pair.vr[1].h_adv_off, &pst->u.pair.vr[1].v_adv_off);
+		getvr(sfd,&pst->u.pair.vr[1]);
 #ifdef FONTFORGE_CONFIG_DEVICETABLES
 		pst->u.pair.vr[0].adjust = SFDReadValDevTab(sfd);
 #else
@@ -5117,10 +5608,10 @@ exit(1);
 		ch = nlgetc(sfd);
 	    } else if ( pst->type==pst_lcaret ) {
 		int i;
-		fscanf( sfd, " %d", &pst->u.lcaret.cnt );
+		getint(sfd,&pst->u.lcaret.cnt);
 		pst->u.lcaret.carets = galloc(pst->u.lcaret.cnt*sizeof(int16));
 		for ( i=0; i<pst->u.lcaret.cnt; ++i )
-		    fscanf( sfd, " %hd", &pst->u.lcaret.carets[i]);
+		    getsint(sfd,&pst->u.lcaret.carets[i]);
 		geteol(sfd,tok);
 	    } else {
 		geteol(sfd,tok);
@@ -5175,6 +5666,112 @@ return( sc );
     }
 }
 
+/* A font read with of_arena gets the glyph's chunks from its own arena */
+static SplineChar *SFDGetChar(FILE *sfd,SplineFont *sf, int had_sf_layer_cnt) {
+    struct chunkarena *old;
+    SplineChar *sc;
+
+    if ( sf->arena==NULL )
+return( SFDReadChar(sfd,sf,had_sf_layer_cnt));
+    old = ChunkArenaUse(sf->arena);
+    sc = SFDReadChar(sfd,sf,had_sf_layer_cnt);
+    ChunkArenaUse(old);
+return( sc );
+}
+
+/* When a font is opened with of_lazy we only look at the start of each */
+/*  glyph, enough to know its name, encoding and advance width, and then */
+/*  skip to the end of it. We remember where it was so we can read it */
+/*  properly when someone wants it (see SFDLoadLazyGlyph). Only the file */
+/*  stays open, not the buffer we parsed it from, we read each glyph's */
+/*  bytes back in from the file when we need them */
+struct sfd_lazy {
+    FILE *sfd;		/* Kept open for an sfd file */
+    long *pos;		/* Where each glyph's StartChar is in sfd */
+    long *end;		/* And where its EndChar line ends */
+    char **files;	/* Or the file each glyph is in for an sfdir */
+    int max;		/* Size of the above arrays */
+    int remaining;	/* Glyphs we have not yet read */
+    int had_layer_cnt;
+};
+
+static int SFDSkipToEndChar(FILE *sfd,char *tok) {
+    int len, atstart = false;
+
+    while ( sfdgets(tok,2000,sfd)!=NULL ) {
+	len = strlen(tok);
+	if ( atstart && strncmp(tok,"EndChar",7)==0 && (tok[7]=='\0' || isspace(tok[7])) )
+return( true );
+	atstart = len>0 && tok[len-1]=='\n';
+    }
+return( false );
+}
+
+static SplineChar *SFDIndexChar(FILE *sfd,SplineFont *sf,struct sfd_lazy *lazy,
+	char *filename) {
+    SplineChar *sc;
+    char tok[2000];
+    long pos = sfdtell(sfd);
+    int seen_width = false;
+
+    if ( (sc = SFDStartChar(sfd,sf,tok))==NULL )
+return( NULL );
+    forever {
+	if ( getname(sfd,tok)!=1 ) {
+	    SplineCharFree(sc);
+return( NULL );
+	}
+	if ( strmatch(tok,"Encoding:")==0 ) {
+	    SFDGetCharEncoding(sfd,sf,sc);
+	} else if ( strmatch(tok,"AltUni:")==0 ) {
+	    SFDGetAltUnis(sfd,sc,false);
+	} else if ( strmatch(tok,"AltUni2:")==0 ) {
+	    SFDGetAltUnis(sfd,sc,true);
+	} else if ( strmatch(tok,"Width:")==0 ) {
+	    getsint(sfd,&sc->width);
+	    seen_width = true;
+	} else if ( strmatch(tok,"VWidth:")==0 ) {
+	    getsint(sfd,&sc->vwidth);
+	} else if ( strmatch(tok,"EndChar")==0 ) {
+    break;
+	} else if ( seen_width ) {
+	    /* We've got everything we want, the rest is outlines, hints, */
+	    /*  instructions, undoes... none of which we need to look at */
+	    if ( !SFDSkipToEndChar(sfd,tok) ) {
+		SplineCharFree(sc);
+return( NULL );
+	    }
+    break;
+	} else {
+	    geteol(sfd,tok);
+	}
+    }
+    if ( sc->orig_pos>=sf->glyphcnt ) {
+	SplineCharFree(sc);
+return( NULL );
+    }
+    if ( sf->glyphmax>lazy->max ) {
+	if ( filename!=NULL ) {
+	    lazy->files = grealloc(lazy->files,sf->glyphmax*sizeof(char *));
+	    memset(lazy->files+lazy->max,0,(sf->glyphmax-lazy->max)*sizeof(char *));
+	} else {
+	    lazy->pos = grealloc(lazy->pos,sf->glyphmax*sizeof(long));
+	    lazy->end = grealloc(lazy->end,sf->glyphmax*sizeof(long));
+	}
+	lazy->max = sf->glyphmax;
+    }
+    if ( filename!=NULL )
+	lazy->files[sc->orig_pos] = copy(filename);
+    else {
+	lazy->pos[sc->orig_pos] = pos;
+	lazy->end[sc->orig_pos] = sfdtell(sfd);
+    }
+    sf->glyphs[sc->orig_pos] = sc;
+    sc->lazy = true;
+    ++lazy->remaining;
+return( sc );
+}
+
 static int SFDGetBitmapProps(FILE *sfd,BDFFont *bdf,char *tok) {
     int pcnt;
     int i;
@@ -5230,7 +5827,7 @@ return( 0 );
     if ( getint(sfd,&ymin)!=1 )
 return( 0 );
     while ( (ch=nlgetc(sfd))==' ');
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
     if ( ch=='\n' || ch=='\r' || getint(sfd,&ymax)!=1 ) {
 	/* Old style format, no orig_pos given, shift everything by 1 */
 	ymax = ymin;
@@ -5242,7 +5839,7 @@ return( 0 );
 	orig = map->map[enc];
     } else {
 	while ( (ch=nlgetc(sfd))==' ');
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	if ( ch!='\n' && ch!='\r' )
 	    getint(sfd,&vwidth);
     }
@@ -5365,7 +5962,7 @@ return( 0 );
     else if ( depth!=1 && depth!=2 && depth!=4 && depth!=8 )
 return( 0 );
     while ( (ch = nlgetc(sfd))==' ' );
-    ungetc(ch,sfd);		/* old sfds don't have a foundry */
+    sfdungetc(ch,sfd);		/* old sfds don't have a foundry */
     if ( ch!='\n' && ch!='\r' ) {
 	getname(sfd,tok);
 	bdf->foundry = copy(tok);
@@ -5417,11 +6014,11 @@ return( 0 );
 	    else if ( strcmp(pt,BITMAP_EXT)==0 ) {
 		FILE *gsfd;
 		sprintf(name,"%s/%s", dirname, ent->d_name);
-		gsfd = fopen(name,"r");
+		gsfd = sfdopen(name);
 		if ( gsfd!=NULL ) {
 		    if ( getname(gsfd,tok) && strcmp(tok,"BDFChar:")==0)
 			SFDGetBitmapChar(gsfd,bdf);
-		    fclose(gsfd);
+		    sfdclose(gsfd);
 		    ff_progress_next();
 		}
 	    }
@@ -5493,15 +6090,94 @@ return( sc );
 return( matched );
 }
 
-static void SFDFixupRefs(SplineFont *sf) {
-    int i, isv;
+/* Turn the glyph indices we read for references and kern pairs into */
+/*  pointers to the glyphs themselves */
+static void SFDFixupGlyphPointers(SplineFont *sf,SplineFont *cidmaster,SplineChar *sc) {
+    int isv, layer, l;
     RefChar *refs, *rnext, *rprev;
-    /*int isautorecovery = sf->changed;*/
     KernPair *kp, *prev, *next;
-    EncMap *map = sf->map;
+    EncMap *map = cidmaster->map;
+    SplineFont *ksf;
+
+    for ( layer = 0; layer<sc->layer_cnt; ++layer ) {
+	rprev = NULL;
+	for ( refs = sc->layers[layer].refs; refs!=NULL; refs=rnext ) {
+	    rnext = refs->next;
+	    if ( refs->encoded ) {		/* Old sfd format */
+		if ( refs->orig_pos<map->encmax && map->map[refs->orig_pos]!=-1 )
+		    refs->orig_pos = map->map[refs->orig_pos];
+		else
+		    refs->orig_pos = sf->glyphcnt;
+		refs->encoded = false;
+	    }
+	    if ( refs->orig_pos<sf->glyphcnt && refs->orig_pos>=0 )
+		refs->sc = sf->glyphs[refs->orig_pos];
+	    if ( refs->sc!=NULL ) {
+		refs->unicode_enc = refs->sc->unicodeenc;
+		refs->adobe_enc = getAdobeEnc(refs->sc->name);
+		rprev = refs;
+		if ( refs->use_my_metrics ) {
+		    if ( sc->width != refs->sc->width ) {
+			LogError(_("Bad sfd file. Glyph %s has width %d even though it should be\n  bound to the width of %s which is %d.\n"),
+				sc->name, sc->width, refs->sc->name, refs->sc->width );
+			sc->width = refs->sc->width;
+		    }
+		}
+	    } else {
+		RefCharFree(refs);
+		if ( rprev!=NULL )
+		    rprev->next = rnext;
+		else
+		    sc->layers[layer].refs = rnext;
+	    }
+	}
+    }
+    for ( isv=0; isv<2; ++isv ) {
+	for ( prev = NULL, kp=isv?sc->vkerns : sc->kerns; kp!=NULL; kp=next ) {
+	    int index = (intpt) (kp->sc);
+	    next = kp->next;
+	    if ( !kp->kcid ) {	/* It's encoded (old sfds), else orig */
+		if ( index>=map->encmax || map->map[index]==-1 )
+		    index = sf->glyphcnt;
+		else
+		    index = map->map[index];
+	    }
+	    kp->kcid = false;
+	    ksf = sf;
+	    if ( cidmaster!=sf ) {
+		for ( l=0; l<cidmaster->subfontcnt; ++l ) {
+		    ksf = cidmaster->subfonts[l];
+		    if ( index<ksf->glyphcnt && ksf->glyphs[index]!=NULL )
+	    break;
+		}
+	    }
+	    if ( index>=ksf->glyphcnt || ksf->glyphs[index]==NULL ) {
+		IError( "Bad kerning information in glyph %s\n", sc->name );
+		kp->sc = NULL;
+	    } else
+		kp->sc = ksf->glyphs[index];
+	    if ( kp->sc!=NULL )
+		prev = kp;
+	    else{
+		if ( prev!=NULL )
+		    prev->next = next;
+		else if ( isv )
+		    sc->vkerns = next;
+		else
+		    sc->kerns = next;
+		chunkfree(kp,sizeof(KernPair));
+	    }
+	}
+    }
+}
+
+static void SFDFixupRefs(SplineFont *sf) {
+    int i;
+    RefChar *refs;
+    /*int isautorecovery = sf->changed;*/
     int layer;
-    int k,l;
-    SplineFont *cidmaster = sf, *ksf;
+    int k;
+    SplineFont *cidmaster = sf;
 
     k = 1;
     if ( sf->subfontcnt!=0 )
@@ -5517,81 +6193,12 @@ static void SFDFixupRefs(SplineFont *sf) {
 	    /*  by another character then we need to fix up that other char too*/
 	    /*if ( isautorecovery && !sc->changed )*/
 	/*continue;*/
-	    for ( layer = 0; layer<sc->layer_cnt; ++layer ) {
-		rprev = NULL;
-		for ( refs = sc->layers[layer].refs; refs!=NULL; refs=rnext ) {
-		    rnext = refs->next;
-		    if ( refs->encoded ) {		/* Old sfd format */
-			if ( refs->orig_pos<map->encmax && map->map[refs->orig_pos]!=-1 )
-			    refs->orig_pos = map->map[refs->orig_pos];
-			else
-			    refs->orig_pos = sf->glyphcnt;
-			refs->encoded = false;
-		    }
-		    if ( refs->orig_pos<sf->glyphcnt && refs->orig_pos>=0 )
-			refs->sc = sf->glyphs[refs->orig_pos];
-		    if ( refs->sc!=NULL ) {
-			refs->unicode_enc = refs->sc->unicodeenc;
-			refs->adobe_enc = getAdobeEnc(refs->sc->name);
-			rprev = refs;
-			if ( refs->use_my_metrics ) {
-			    if ( sc->width != refs->sc->width ) {
-				LogError(_("Bad sfd file. Glyph %s has width %d even though it should be\n  bound to the width of %s which is %d.\n"),
-					sc->name, sc->width, refs->sc->name, refs->sc->width );
-				sc->width = refs->sc->width;
-			    }
-			}
-		    } else {
-			RefCharFree(refs);
-			if ( rprev!=NULL )
-			    rprev->next = rnext;
-			else
-			    sc->layers[layer].refs = rnext;
-		    }
-		}
-	    }
+	    SFDFixupGlyphPointers(sf,cidmaster,sc);
 	    /* In old sfd files we used a peculiar idiom to represent a multiply */
 	    /*  encoded glyph. Fix it up now. Remove the fake glyph and adjust the*/
 	    /*  map */
 	    /*if ( isautorecovery && !sc->changed )*/
 	/*continue;*/
-	    for ( isv=0; isv<2; ++isv ) {
-		for ( prev = NULL, kp=isv?sc->vkerns : sc->kerns; kp!=NULL; kp=next ) {
-		    int index = (intpt) (kp->sc);
-		    next = kp->next;
-		    if ( !kp->kcid ) {	/* It's encoded (old sfds), else orig */
-			if ( index>=map->encmax || map->map[index]==-1 )
-			    index = sf->glyphcnt;
-			else
-			    index = map->map[index];
-		    }
-		    kp->kcid = false;
-		    ksf = sf;
-		    if ( cidmaster!=sf ) {
-			for ( l=0; l<cidmaster->subfontcnt; ++l ) {
-			    ksf = cidmaster->subfonts[l];
-			    if ( index<ksf->glyphcnt && ksf->glyphs[index]!=NULL )
-		    break;
-			}
-		    }
-		    if ( index>=ksf->glyphcnt || ksf->glyphs[index]==NULL ) {
-			IError( "Bad kerning information in glyph %s\n", sc->name );
-			kp->sc = NULL;
-		    } else
-			kp->sc = ksf->glyphs[index];
-		    if ( kp->sc!=NULL )
-			prev = kp;
-		    else{
-			if ( prev!=NULL )
-			    prev->next = next;
-			else if ( isv )
-			    sc->vkerns = next;
-			else
-			    sc->kerns = next;
-			chunkfree(kp,sizeof(KernPair));
-		    }
-		}
-	    }
 	    if ( SCDuplicate(sc)!=sc ) {
 		SplineChar *base = SCDuplicate(sc);
 		int orig = sc->orig_pos, enc = sf->map->backmap[orig], uni = sc->unicodeenc;
@@ -5620,6 +6227,115 @@ static void SFDFixupRefs(SplineFont *sf) {
     }
 }
 
+void SFDLazyFree(struct sfd_lazy *lazy) {
+    int i;
+
+    if ( lazy==NULL )
+return;
+    if ( lazy->sfd!=NULL )
+	sfdclose(lazy->sfd);
+    if ( lazy->files!=NULL ) {
+	for ( i=0; i<lazy->max; ++i )
+	    free(lazy->files[i]);
+	free(lazy->files);
+    }
+    free(lazy->pos);
+    free(lazy->end);
+    chunkfree(lazy,sizeof(struct sfd_lazy));
+}
+
+static void SFDCheckOnlyBitmaps(SplineFont *sf);
+
+/* Read in the rest of a glyph which we only indexed when the font was */
+/*  opened. Other glyphs (and the font's bitmaps) may already point to */
+/*  this one, so the SplineChar stays where it is and we just fill it in */
+void SFDLoadLazyGlyph(SplineChar *stub) {
+    SplineFont *sf;
+    struct sfd_lazy *lazy;
+    SplineChar *sc;
+    struct splinecharlist *dependents;
+    struct altuni *altuni;
+    RefChar *refs;
+    FILE *sfd;
+    CLocaleSave oldloc;
+    int gid, layer;
+
+    if ( stub==NULL || !stub->lazy || (lazy = stub->parent->lazy)==NULL )
+return;
+    sf = stub->parent;
+    gid = stub->orig_pos;
+    /* Clear this first, so that a glyph which (wrongly) refers to itself */
+    /*  does not send us round in circles */
+    stub->lazy = false;
+    --lazy->remaining;
+
+    if ( lazy->files!=NULL )
+	sfd = sfdopen(lazy->files[gid]);
+    else {
+	/* Just this glyph's bytes go into the buffer */
+	sfd = lazy->sfd;
+	if ( fseek(sfd,lazy->pos[gid],SEEK_SET)!=-1 )
+	    _SFDBufferOpen(sfd,lazy->end[gid]-lazy->pos[gid]);
+	else
+	    sfd = NULL;
+    }
+    sc = NULL;
+    if ( sfd!=NULL ) {
+	SwitchToCLocale(&oldloc);
+	sf->glyphs[gid] = NULL;		/* Or SFDGetChar would think the slot was taken */
+	sc = SFDGetChar(sfd,sf,lazy->had_layer_cnt);
+	if ( sc!=NULL && sc->orig_pos!=gid && sc->orig_pos<sf->glyphcnt &&
+		sf->glyphs[sc->orig_pos]==sc )
+	    sf->glyphs[sc->orig_pos] = NULL;
+	sf->glyphs[gid] = stub;
+	SwitchFromCLocale(&oldloc);
+	if ( lazy->files!=NULL )
+	    sfdclose(sfd);
+	else
+	    SFDBufferClose(sfd);	/* Before any references are read */
+    }
+    if ( sc==NULL || sc->orig_pos!=gid ) {
+	/* Someone changed the file under us */
+	IError("Could not reread glyph %s from %s", stub->name, sf->filename );
+	SplineCharFree(sc);
+    } else {
+	/* Keep the stub's dependents, and its alternate unicode values as */
+	/*  those will have been added to after we indexed the glyph */
+	dependents = stub->dependents; stub->dependents = NULL;
+	altuni = stub->altuni; stub->altuni = NULL;
+	SplineCharFreeContents(stub);
+	AltUniFree(sc->altuni);
+	*stub = *sc;
+	stub->dependents = dependents;
+	stub->altuni = altuni;
+	chunkfree(sc,sizeof(SplineChar));
+
+	SFDFixupGlyphPointers(sf,sf,stub);
+	for ( layer=0; layer<stub->layer_cnt; ++layer )
+	    for ( refs = stub->layers[layer].refs; refs!=NULL; refs=refs->next )
+		SFDLoadLazyGlyph(refs->sc);
+	for ( layer=0; layer<stub->layer_cnt; ++layer )
+	    for ( refs = stub->layers[layer].refs; refs!=NULL; refs=refs->next )
+		SFDFixupRef(stub,refs,layer);
+    }
+
+    /* Check sf->lazy again, loading the references may have finished it off */
+    if ( (lazy = sf->lazy)!=NULL && lazy->remaining==0 ) {
+	/* That was the last one, the font is now just like any other */
+	sf->lazy = NULL;
+	SFDLazyFree(lazy);
+	SFDCheckOnlyBitmaps(sf);
+    }
+}
+
+void SFDLoadLazyGlyphs(SplineFont *sf) {
+    int i;
+
+    for ( i=0; i<sf->glyphcnt && sf->lazy!=NULL; ++i )
+	if ( sf->glyphs[i]!=NULL && sf->glyphs[i]->lazy )
+	    SFDLoadLazyGlyph(sf->glyphs[i]);
+}
+
 /* When we recover from an autosaved file we must be careful. If that file */
 /*  contains a character that is refered to by another character then the */
 /*  dependent list will contain a dead pointer without this routine. Similarly*/
@@ -5721,17 +6437,17 @@ static void SFDGetDesignSize(FILE *sfd,SplineFont *sf) {
 
     getsint(sfd,(int16 *) &sf->design_size);
     while ( (ch=nlgetc(sfd))==' ' );
-    ungetc(ch,sfd);
+    sfdungetc(ch,sfd);
     if ( isdigit(ch)) {
 	getsint(sfd,(int16 *) &sf->design_range_bottom);
 	while ( (ch=nlgetc(sfd))==' ' );
 	if ( ch!='-' )
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	getsint(sfd,(int16 *) &sf->design_range_top);
 	getsint(sfd,(int16 *) &sf->fontstyle_id);
 	forever {
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    if ( !isdigit(ch))
 	break;
 	    cur = chunkalloc(sizeof(struct otfname));
@@ -5752,7 +6468,7 @@ static void SFDGetOtfFeatName(FILE *sfd,SplineFont *sf) {
     fn->tag = gettag(sfd);
     forever {
 	while ( (ch=nlgetc(sfd))==' ' );
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	if ( !isdigit(ch))
     break;
 	cur = chunkalloc(sizeof(struct otfname));
@@ -5835,11 +6551,11 @@ return( NULL );
 	if ( ch!='\'' )
 return( NULL );
 
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	tag = gettag(sfd);
 return( (OTLookup *) (intpt) tag );
     } else {
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	name = SFDReadUTF7Str(sfd);
 	if ( name==NULL )
 return( NULL );
@@ -5868,7 +6584,8 @@ static void SFDParseChainContext(FILE *sfd,SplineFont *sf,FPST *fpst, char *tok,
 		    strmatch(tok,"class")==0 ? pst_class :
 		    strmatch(tok,"coverage")==0 ? pst_coverage : pst_reversecoverage;
     if ( old ) {
-	fscanf(sfd, "%hu %hu", &((FPST1 *) fpst)->flags, &((FPST1 *) fpst)->script_lang_index );
+	getusint(sfd,&((FPST1 *) fpst)->flags);
+	getusint(sfd,&((FPST1 *) fpst)->script_lang_index);
 	if ( ((FPST1 *) fpst)->script_lang_index>=((SplineFont1 *) sli_sf)->sli_cnt && ((FPST1 *) fpst)->script_lang_index!=SLI_NESTED ) {
 	    static int complained=false;
 	    if ( ((SplineFont1 *) sli_sf)->sli_cnt==0 )
@@ -5889,15 +6606,16 @@ static void SFDParseChainContext(FILE *sfd,SplineFont *sf,FPST *fpst, char *tok,
 	}
 	while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
 	if ( ch=='\'' ) {
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    ((FPST1 *) fpst)->tag = gettag(sfd);
 	} else
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
     } else {
 	fpst->subtable = SFFindLookupSubtableAndFreeName(sf,SFDReadUTF7Str(sfd));
 	fpst->subtable->fpst = fpst;
     }
-    fscanf(sfd, "%hu %hu %hu %hu", &fpst->nccnt, &fpst->bccnt, &fpst->fccnt, &fpst->rule_cnt );
+    getusint(sfd,&fpst->nccnt); getusint(sfd,&fpst->bccnt);
+    getusint(sfd,&fpst->fccnt); getusint(sfd,&fpst->rule_cnt);
     if ( fpst->nccnt!=0 || fpst->bccnt!=0 || fpst->fccnt!=0 ) {
 	fpst->nclass = galloc(fpst->nccnt*sizeof(char *));
 	fpst->nclassnames = gcalloc(fpst->nccnt,sizeof(char *));
@@ -5920,7 +6638,7 @@ static void SFDParseChainContext(FILE *sfd,SplineFont *sf,FPST *fpst, char *tok,
 	    getint(sfd,&temp);
 	    (&fpst->nclass)[j][i] = galloc(temp+1); (&fpst->nclass)[j][i][temp] = '\0';
 	    nlgetc(sfd);	/* skip space */
-	    fread((&fpst->nclass)[j][i],1,temp,sfd);
+	    sfdread((&fpst->nclass)[j][i],1,temp,sfd);
 	}
     }
 
@@ -5934,11 +6652,13 @@ static void SFDParseChainContext(FILE *sfd,SplineFont *sf,FPST *fpst, char *tok,
 		(&fpst->rules[i].u.glyph.names)[j] = galloc(temp+1);
 		(&fpst->rules[i].u.glyph.names)[j][temp] = '\0';
 		nlgetc(sfd);	/* skip space */
-		fread((&fpst->rules[i].u.glyph.names)[j],1,temp,sfd);
+		sfdread((&fpst->rules[i].u.glyph.names)[j],1,temp,sfd);
 	    }
 	  break;
 	  case pst_class:
-	    fscanf( sfd, "%d %d %d", &fpst->rules[i].u.class.ncnt, &fpst->rules[i].u.class.bcnt, &fpst->rules[i].u.class.fcnt );
+	    getint(sfd,&fpst->rules[i].u.class.ncnt);
+	    getint(sfd,&fpst->rules[i].u.class.bcnt);
+	    getint(sfd,&fpst->rules[i].u.class.fcnt);
 	    for ( j=0; j<3; ++j ) {
 		getname(sfd,tok);
 		(&fpst->rules[i].u.class.nclasses)[j] = galloc((&fpst->rules[i].u.class.ncnt)[j]*sizeof(uint16));
@@ -5949,7 +6669,9 @@ static void SFDParseChainContext(FILE *sfd,SplineFont *sf,FPST *fpst, char *tok,
 	  break;
 	  case pst_coverage:
 	  case pst_reversecoverage:
-	    fscanf( sfd, "%d %d %d", &fpst->rules[i].u.coverage.ncnt, &fpst->rules[i].u.coverage.bcnt, &fpst->rules[i].u.coverage.fcnt );
+	    getint(sfd,&fpst->rules[i].u.coverage.ncnt);
+	    getint(sfd,&fpst->rules[i].u.coverage.bcnt);
+	    getint(sfd,&fpst->rules[i].u.coverage.fcnt);
 	    for ( j=0; j<3; ++j ) {
 		(&fpst->rules[i].u.coverage.ncovers)[j] = galloc((&fpst->rules[i].u.coverage.ncnt)[j]*sizeof(char *));
 		for ( k=0; k<(&fpst->rules[i].u.coverage.ncnt)[j]; ++k ) {
@@ -5958,7 +6680,7 @@ static void SFDParseChainContext(FILE *sfd,SplineFont *sf,FPST *fpst, char *tok,
 		    (&fpst->rules[i].u.coverage.ncovers)[j][k] = galloc(temp+1);
 		    (&fpst->rules[i].u.coverage.ncovers)[j][k][temp] = '\0';
 		    nlgetc(sfd);	/* skip space */
-		    fread((&fpst->rules[i].u.coverage.ncovers)[j][k],1,temp,sfd);
+		    sfdread((&fpst->rules[i].u.coverage.ncovers)[j][k],1,temp,sfd);
 		}
 	    }
 	  break;
@@ -5984,7 +6706,7 @@ static void SFDParseChainContext(FILE *sfd,SplineFont *sf,FPST *fpst, char *tok,
 	    fpst->rules[i].u.rcoverage.replacements = galloc(temp+1);
 	    fpst->rules[i].u.rcoverage.replacements[temp] = '\0';
 	    nlgetc(sfd);	/* skip space */
-	    fread(fpst->rules[i].u.rcoverage.replacements,1,temp,sfd);
+	    sfdread(fpst->rules[i].u.rcoverage.replacements,1,temp,sfd);
 	  break;
 	}
     }
@@ -6031,7 +6753,7 @@ static void SFDParseStateMachine(FILE *sfd,SplineFont *sf,ASM *sm, char *tok,int
 	getint(sfd,&temp);
 	sm->classes[i] = galloc(temp+1); sm->classes[i][temp] = '\0';
 	nlgetc(sfd);	/* skip space */
-	fread(sm->classes[i],1,temp,sfd);
+	sfdread(sm->classes[i],1,temp,sfd);
     }
 
     sm->state = galloc(sm->class_cnt*sm->state_cnt*sizeof(struct asm_state));
@@ -6048,7 +6770,7 @@ static void SFDParseStateMachine(FILE *sfd,SplineFont *sf,ASM *sm, char *tok,int
 	    else {
 		sm->state[i].u.insert.mark_ins = galloc(temp+1); sm->state[i].u.insert.mark_ins[temp] = '\0';
 		nlgetc(sfd);	/* skip space */
-		fread(sm->state[i].u.insert.mark_ins,1,temp,sfd);
+		sfdread(sm->state[i].u.insert.mark_ins,1,temp,sfd);
 	    }
 	    getint(sfd,&temp);
 	    if ( temp==0 )
@@ -6056,7 +6778,7 @@ static void SFDParseStateMachine(FILE *sfd,SplineFont *sf,ASM *sm, char *tok,int
 	    else {
 		sm->state[i].u.insert.cur_ins = galloc(temp+1); sm->state[i].u.insert.cur_ins[temp] = '\0';
 		nlgetc(sfd);	/* skip space */
-		fread(sm->state[i].u.insert.cur_ins,1,temp,sfd);
+		sfdread(sm->state[i].u.insert.cur_ins,1,temp,sfd);
 	    }
 	} else if ( sm->type == asm_kern ) {
 	    int j;
@@ -6151,7 +6873,7 @@ static char *SFDParseMMSubroutine(FILE *sfd) {
     const char *endtok = "EndMMSubroutine";
     int len = 0, blen, first=true;
 
-    while ( fgets(buffer,sizeof(buffer),sfd)!=NULL ) {
+    while ( sfdgets(buffer,sizeof(buffer),sfd)!=NULL ) {
 	if ( strncmp(buffer,endtok,strlen(endtok))==0 )
     break;
 	if ( first ) {
@@ -6203,10 +6925,10 @@ static void SFDSizeMap(EncMap *map,int glyphcnt,int enccnt) {
 }
 
 static SplineFont *SFD_GetFont(FILE *sfd,SplineFont *cidmaster,char *tok,
-	int fromdir, char *dirname, float sfdversion);
+	int fromdir, char *dirname, float sfdversion, int lazy);
 
 static SplineFont *SFD_FigureDirType(SplineFont *sf,char *tok, char *dirname,
-	Encoding *enc, struct remap *remap,int had_layer_cnt) {
+	Encoding *enc, struct remap *remap,int had_layer_cnt,int lazy) {
     /* In a sfdir a directory will either contain glyph files */
     /*                                            subfont dirs */
     /*                                            instance dirs */
@@ -6249,6 +6971,10 @@ return( sf );
 	    sf->map->remap = remap;
 	}
 	SFDSizeMap(sf->map,sf->glyphcnt,enc->char_cnt>gc?enc->char_cnt:gc);
+	if ( lazy && sf->cidmaster==NULL && sf->mm==NULL && sf->sfd_version>=2 ) {
+	    sf->lazy = chunkalloc(sizeof(struct sfd_lazy));
+	    sf->lazy->had_layer_cnt = had_layer_cnt;
+	}
 
 	while ( (ent=readdir(dir))!=NULL ) {
 	    pt = strrchr(ent->d_name,EXT_CHAR);
@@ -6257,11 +6983,14 @@ return( sf );
 	    else if ( strcmp(pt,GLYPH_EXT)==0 ) {
 		FILE *gsfd;
 		sprintf(name,"%s/%s", dirname, ent->d_name);
-		gsfd = fopen(name,"r");
+		gsfd = sfdopen(name);
 		if ( gsfd!=NULL ) {
-		    SFDGetChar(gsfd,sf,had_layer_cnt);
+		    if ( sf->lazy!=NULL )
+			SFDIndexChar(gsfd,sf,sf->lazy,name);
+		    else
+			SFDGetChar(gsfd,sf,had_layer_cnt);
 		    ff_progress_next();
-		    fclose(gsfd);
+		    sfdclose(gsfd);
 		}
 	    }
 	}
@@ -6281,12 +7010,12 @@ return( sf );
 		FILE *ssfd;
 		sprintf(name,"%s/%s", dirname, ent->d_name);
 		sprintf(props,"%s/" FONT_PROPS, name);
-		ssfd = fopen(props,"r");
+		ssfd = sfdopen(props);
 		if ( ssfd!=NULL ) {
 		    if ( i!=0 )
 			ff_progress_next_stage();
-		    sf->subfonts[i++] = SFD_GetFont(ssfd,sf,tok,true,name,sf->sfd_version);
-		    fclose(ssfd);
+		    sf->subfonts[i++] = SFD_GetFont(ssfd,sf,tok,true,name,sf->sfd_version,false);
+		    sfdclose(ssfd);
 		}
 	    }
 	}
@@ -6306,10 +7035,10 @@ return( sf );
 		    ff_progress_next_stage();
 		sprintf(name,"%s/%s", dirname, ent->d_name);
 		sprintf(props,"%s/" FONT_PROPS, name);
-		ssfd = fopen(props,"r");
+		ssfd = sfdopen(props);
 		if ( ssfd!=NULL ) {
 		    SplineFont *mmsf;
-		    mmsf = SFD_GetFont(ssfd,NULL,tok,true,name,sf->sfd_version);
+		    mmsf = SFD_GetFont(ssfd,NULL,tok,true,name,sf->sfd_version,false);
 		    if ( ipos!=0 ) {
 			EncMapFree(mmsf->map);
 			mmsf->map=NULL;
@@ -6319,7 +7048,7 @@ return( sf );
 			mm->normal = mmsf;
 		    else
 			mm->instances[ipos-1] = mmsf;
-		    fclose(ssfd);
+		    sfdclose(ssfd);
 		}
 	    }
 	}
@@ -6346,11 +7075,11 @@ return( sf );
 		FILE *ssfd;
 		sprintf(name,"%s/%s", dirname, ent->d_name);
 		sprintf(props,"%s/" STRIKE_PROPS, name);
-		ssfd = fopen(props,"r");
+		ssfd = sfdopen(props);
 		if ( ssfd!=NULL ) {
 		    if ( getname(ssfd,tok)==1 && strcmp(tok,"BitmapFont:")==0 )
 			SFDGetBitmapFont(ssfd,sf,true,name);
-		    fclose(ssfd);
+		    sfdclose(ssfd);
 		}
 	    }
 	}
@@ -6392,7 +7121,7 @@ static void SFDParseLookup(FILE *sfd,SplineFont *sf,OTLookup *otl) {
 	lastsub = NULL;
 	while ( (subname = SFDReadUTF7Str(sfd))!=NULL ) {
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    sub = chunkalloc(sizeof(struct lookup_subtable));
 	    sub->subtable_name = subname;
 	    sub->lookup = otl;
@@ -6404,7 +7133,7 @@ static void SFDParseLookup(FILE *sfd,SplineFont *sf,OTLookup *otl) {
 		    while ( (ch=nlgetc(sfd))==' ' );
 			/* slurp final paren */
 		} else
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		sub->per_glyph_pst_or_kern = true;
 	      break;
 	      case gsub_multiple: case gsub_alternate: case gsub_ligature:
@@ -6429,7 +7158,7 @@ static void SFDParseLookup(FILE *sfd,SplineFont *sf,OTLookup *otl) {
 		    sub->dontautokern     = ((ch-'0')&4)?1:0;
 		    nlgetc(sfd);	/* slurp final bracket */
 		} else {
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		}
 		sub->per_glyph_pst_or_kern = true;
 	      break;
@@ -6463,11 +7192,11 @@ static void SFDParseLookup(FILE *sfd,SplineFont *sf,OTLookup *otl) {
 	    lastfl = fl;
 	    if ( ch=='<' ) {
 		int ft=0,fs=0;
-		fscanf(sfd,"%d,%d>", &ft, &fs );
+		getmacfeat(sfd,&ft,&fs);
 		fl->ismac = true;
 		fl->featuretag = (ft<<16) | fs;
 	    } else if ( ch=='\'' ) {
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		fl->featuretag = gettag(sfd);
 	    }
 	    while ( (ch=nlgetc(sfd))==' ' );
@@ -6484,7 +7213,7 @@ static void SFDParseLookup(FILE *sfd,SplineFont *sf,OTLookup *otl) {
 			lastsl->next = sl;
 		    lastsl = sl;
 		    if ( ch=='\'' ) {
-			ungetc(ch,sfd);
+			sfdungetc(ch,sfd);
 			sl->script = gettag(sfd);
 		    }
 		    while ( (ch=nlgetc(sfd))==' ' );
@@ -6495,7 +7224,7 @@ static void SFDParseLookup(FILE *sfd,SplineFont *sf,OTLookup *otl) {
 			    if ( ch=='>' )
 			break;
 			    if ( ch=='\'' ) {
-				ungetc(ch,sfd);
+				sfdungetc(ch,sfd);
 			        if ( lcnt>=lmax )
 				    langs = grealloc(langs,(lmax+=10)*sizeof(uint32));
 				langs[lcnt++] = gettag(sfd);
@@ -6556,7 +7285,7 @@ static struct baselangextent *ParseBaseLang(FILE *sfd) {
     if ( ch=='{' ) {
 	bl = chunkalloc(sizeof(struct baselangextent));
 	while ( (ch=nlgetc(sfd))==' ' );
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	if ( ch=='\'' )
 	    bl->lang = gettag(sfd);		/* Lang or Feature tag, or nothing */
 	getsint(sfd,&bl->descent);
@@ -6564,7 +7293,7 @@ static struct baselangextent *ParseBaseLang(FILE *sfd) {
 	last = NULL;
 	while ( (ch=nlgetc(sfd))==' ' );
 	while ( ch=='{' ) {
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    cur = ParseBaseLang(sfd);
 	    if ( last==NULL )
 		bl->features = cur;
@@ -6573,7 +7302,7 @@ static struct baselangextent *ParseBaseLang(FILE *sfd) {
 	    last = cur;
 	    while ( (ch=nlgetc(sfd))==' ' );
 	}
-	if ( ch!='}' ) ungetc(ch,sfd);
+	if ( ch!='}' ) sfdungetc(ch,sfd);
 return( bl );
     }
 return( NULL );
@@ -6599,7 +7328,7 @@ return(NULL);
     while ( (ch=nlgetc(sfd))==' ' );
     last = NULL;
     while ( ch=='{' ) {
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	cur = ParseBaseLang(sfd);
 	if ( last==NULL )
 	    bs->langs = cur;
@@ -6634,7 +7363,7 @@ static OTLookup **SFDLookupList(FILE *sfd,SplineFont *sf) {
 	while ( (ch=nlgetc(sfd))==' ' );
 	if ( ch=='\n' || ch==EOF )
     break;
-	ungetc(ch,sfd);
+	sfdungetc(ch,sfd);
 	name = SFDReadUTF7Str(sfd);
 	otl = SFFindLookup(sf,name);
 	free(name);
@@ -6677,7 +7406,7 @@ static void SFDParseJustify(FILE *sfd, SplineFont *sf, char *tok) {
 	break;
 	    if ( strcmp(tok,"JstfExtender:")==0 ) {
 		while ( (ch=nlgetc(sfd))==' ' );
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		geteol(sfd,tok);
 		cur->extenders = copy(tok);
 	    } else if ( strcmp(tok,"JstfLang:")==0 ) {
@@ -6731,8 +7460,12 @@ static void SFDParseJustify(FILE *sfd, SplineFont *sf, char *tok) {
     }
 }
 
+/* The arena for the file we are reading (of_arena). Every font we make */
+/*  from it (subfonts, mm instances) takes a ref */
+static ff_thread_local struct chunkarena *sfd_arena;
+
 static SplineFont *SFD_GetFont(FILE *sfd,SplineFont *cidmaster,char *tok,
-	int fromdir, char *dirname, float sfdversion) {
+	int fromdir, char *dirname, float sfdversion, int lazy) {
     SplineFont *sf;
     int realcnt, i, eof, mappos=-1, ch;
     struct table_ordering *lastord = NULL;
@@ -6764,6 +7497,7 @@ static SplineFont *SFD_GetFont(FILE *sfd,SplineFont *cidmaster,char *tok,
 	sf = grealloc(sf,sizeof(SplineFont1));
 	memset(((uint8 *) sf) + sizeof(SplineFont),0,sizeof(SplineFont1)-sizeof(SplineFont));
     }
+    sf->arena = ChunkArenaRef(sfd_arena);
     sf->sfd_version = sfdversion;
     sf->cidmaster = cidmaster;
     sf->uni_interp = ui_unset;
@@ -7009,7 +7743,7 @@ static SplineFont *SFD_GetFont(FILE *sfd,SplineFont *cidmaster,char *tok,
 	    sf->layers[layer].background = layer==ly_back;
 	/* Used briefly, now background is after layer name */
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    if ( ch!='"' ) {
 		getint(sfd,&bk);
 		sf->layers[layer].background = bk;
@@ -7017,7 +7751,7 @@ static SplineFont *SFD_GetFont(FILE *sfd,SplineFont *cidmaster,char *tok,
 	/* end of section for obsolete format */
 	    sf->layers[layer].name = SFDReadUTF7Str(sfd);
 	    while ( (ch=nlgetc(sfd))==' ' );
-	    ungetc(ch,sfd);
+	    sfdungetc(ch,sfd);
 	    if ( ch!='\n' ) {
 		getint(sfd,&bk);
 		sf->layers[layer].background = bk;
@@ -7194,12 +7928,12 @@ exit(1);
 	    sf->mark_classes[0] = NULL; sf->mark_class_names[0] = NULL;
 	    for ( i=1; i<sf->mark_class_cnt; ++i ) {	/* Class 0 is unused */
 		int temp;
-		while ( (temp=nlgetc(sfd))=='\n' || temp=='\r' ); ungetc(temp,sfd);
+		while ( (temp=nlgetc(sfd))=='\n' || temp=='\r' ); sfdungetc(temp,sfd);
 		sf->mark_class_names[i] = SFDReadUTF7Str(sfd);
 		getint(sfd,&temp);
 		sf->mark_classes[i] = galloc(temp+1); sf->mark_classes[i][temp] = '\0';
 		nlgetc(sfd);	/* skip space */
-		fread(sf->mark_classes[i],1,temp,sfd);
+		sfdread(sf->mark_classes[i],1,temp,sfd);
 	    }
 	} else if ( strmatch(tok,"MarkAttachSets:")==0 ) {
 	    getint(sfd,&sf->mark_set_cnt);
@@ -7207,12 +7941,12 @@ exit(1);
 	    sf->mark_set_names = galloc(sf->mark_set_cnt*sizeof(char *));
 	    for ( i=0; i<sf->mark_set_cnt; ++i ) {	/* Set 0 is used */
 		int temp;
-		while ( (temp=nlgetc(sfd))=='\n' || temp=='\r' ); ungetc(temp,sfd);
+		while ( (temp=nlgetc(sfd))=='\n' || temp=='\r' ); sfdungetc(temp,sfd);
 		sf->mark_set_names[i] = SFDReadUTF7Str(sfd);
 		getint(sfd,&temp);
 		sf->mark_sets[i] = galloc(temp+1); sf->mark_sets[i][temp] = '\0';
 		nlgetc(sfd);	/* skip space */
-		fread(sf->mark_sets[i],1,temp,sfd);
+		sfdread(sf->mark_sets[i],1,temp,sfd);
 	    }
 	} else if ( strmatch(tok,"KernClass2:")==0 || strmatch(tok,"VKernClass2:")==0 ||
 		strmatch(tok,"KernClass:")==0 || strmatch(tok,"VKernClass:")==0 ) {
@@ -7230,7 +7964,7 @@ exit(1);
 	    if ( ch=='+' )
 		classstart = 0;
 	    else
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 	    getint(sfd,&kc->second_cnt);
 	    if ( old ) {
 		getint(sfd,&temp); ((KernClass1 *) kc)->sli = temp;
@@ -7258,14 +7992,14 @@ exit(1);
 		getint(sfd,&temp);
 		kc->firsts[i] = galloc(temp+1); kc->firsts[i][temp] = '\0';
 		nlgetc(sfd);	/* skip space */
-		fread(kc->firsts[i],1,temp,sfd);
+		sfdread(kc->firsts[i],1,temp,sfd);
 	    }
 	    kc->seconds[0] = NULL;
 	    for ( i=1; i<kc->second_cnt; ++i ) {
 		getint(sfd,&temp);
 		kc->seconds[i] = galloc(temp+1); kc->seconds[i][temp] = '\0';
 		nlgetc(sfd);	/* skip space */
-		fread(kc->seconds[i],1,temp,sfd);
+		sfdread(kc->seconds[i],1,temp,sfd);
 	    }
 	    for ( i=0; i<kc->first_cnt*kc->second_cnt; ++i ) {
 		getint(sfd,&temp);
@@ -7373,14 +8107,14 @@ exit(1);
 			((AnchorClass1 *) an)->feature_tag = (tok[0]<<24) | (tok[1]<<16) | (tok[2]<<8) | tok[3];
 		    }
 		    while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    if ( isdigit(ch)) {
 			int temp;
 			getint(sfd,&temp);
 			((AnchorClass1 *) an)->flags = temp;
 		    }
 		    while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    if ( isdigit(ch)) {
 			int temp;
 			getint(sfd,&temp);
@@ -7388,7 +8122,7 @@ exit(1);
 		    } else
 			((AnchorClass1 *) an)->script_lang_index = 0xffff;		/* Will be fixed up later */
 		    while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    if ( isdigit(ch)) {
 			int temp;
 			getint(sfd,&temp);
@@ -7398,7 +8132,7 @@ exit(1);
 		} else
 		    an->subtable = SFFindLookupSubtableAndFreeName(sf,SFDReadUTF7Str(sfd));
 		while ( (ch=nlgetc(sfd))==' ' || ch=='\t' );
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 		if ( isdigit(ch) ) {
 		    /* Early versions of SfdFormat 2 had a number here */
 		    int temp;
@@ -7459,11 +8193,11 @@ exit( 1 );
 	    for ( i=0; i<temp; ++i ) {
 		while ( isspace((ch=nlgetc(sfd))) );
 		if ( ch=='\'' ) {
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    ord->ordered_features[i] = gettag(sfd);
 		} else if ( ch=='<' ) {
 		    int f,s;
-		    fscanf(sfd,"%d,%d>", &f, &s );
+		    getmacfeat(sfd,&f,&s);
 		    ord->ordered_features[i] = (f<<16)|s;
 		}
 	    }
@@ -7484,7 +8218,7 @@ exit( 1 );
 	    getint(sfd,&mm->axis_count);
 	    ch = nlgetc(sfd);
 	    if ( ch!=' ' )
-		ungetc(ch,sfd);
+		sfdungetc(ch,sfd);
 	    else { int temp;
 		getint(sfd,&temp);
 		mm->apple = temp;
@@ -7527,11 +8261,11 @@ exit( 1 );
 		for ( i=0; i<points; ++i ) {
 		    getreal(sfd,&mm->axismaps[index].blends[i]);
 		    while ( (ch=nlgetc(sfd))!=EOF && isspace(ch));
-		    ungetc(ch,sfd);
+		    sfdungetc(ch,sfd);
 		    if ( (ch=nlgetc(sfd))!='=' )
-			ungetc(ch,sfd);
+			sfdungetc(ch,sfd);
 		    else if ( (ch=nlgetc(sfd))!='>' )
-			ungetc(ch,sfd);
+			sfdungetc(ch,sfd);
 		    getreal(sfd,&mm->axismaps[index].designs[i]);
 		}
 		lastaxismap = &mm->axismaps[index];
@@ -7608,13 +8342,13 @@ exit( 1 );
     }
 
     if ( fromdir )
-	sf = SFD_FigureDirType(sf,tok,dirname,enc,remap,had_layer_cnt);
+	sf = SFD_FigureDirType(sf,tok,dirname,enc,remap,had_layer_cnt,lazy);
     else if ( sf->subfontcnt!=0 ) {
 	ff_progress_change_stages(2*sf->subfontcnt);
 	for ( i=0; i<sf->subfontcnt; ++i ) {
 	    if ( i!=0 )
 		ff_progress_next_stage();
-	    sf->subfonts[i] = SFD_GetFont(sfd,sf,tok,fromdir,dirname,sfdversion);
+	    sf->subfonts[i] = SFD_GetFont(sfd,sf,tok,fromdir,dirname,sfdversion,false);
 	}
     } else if ( sf->mm!=NULL ) {
 	MMSet *mm = sf->mm;
@@ -7622,12 +8356,12 @@ exit( 1 );
 	for ( i=0; i<mm->instance_count; ++i ) {
 	    if ( i!=0 )
 		ff_progress_next_stage();
-	    mm->instances[i] = SFD_GetFont(sfd,NULL,tok,fromdir,dirname,sfdversion);
+	    mm->instances[i] = SFD_GetFont(sfd,NULL,tok,fromdir,dirname,sfdversion,false);
 	    EncMapFree(mm->instances[i]->map); mm->instances[i]->map=NULL;
 	    mm->instances[i]->mm = mm;
 	}
 	ff_progress_next_stage();
-	mm->normal = SFD_GetFont(sfd,NULL,tok,fromdir,dirname,sfdversion);
+	mm->normal = SFD_GetFont(sfd,NULL,tok,fromdir,dirname,sfdversion,false);
 	mm->normal->mm = mm;
 	sf->mm = NULL;
 	SplineFontFree(sf);
@@ -7639,6 +8373,14 @@ exit( 1 );
 	    EncMapFree(sf->map);
 	    sf->map = map;
 	}
+    } else if ( lazy && cidmaster==NULL && sf->sfd_version>=2 ) {
+	sf->lazy = chunkalloc(sizeof(struct sfd_lazy));
+	sf->lazy->sfd = sfd;
+	sf->lazy->had_layer_cnt = had_layer_cnt;
+	while ( SFDIndexChar(sfd,sf,sf->lazy,NULL)!=NULL ) {
+	    ff_progress_next();
+	}
+	ff_progress_next_stage();
     } else {
 	while ( SFDGetChar(sfd,sf,had_layer_cnt)!=NULL ) {
 	    ff_progress_next();
@@ -7706,75 +8448,100 @@ return( -1 );
         LogError("Bad SFD Version number %.1f", dval );
 return( -1 );
     }
-    ch = nlgetc(sfd); ungetc(ch,sfd);
+    ch = nlgetc(sfd); sfdungetc(ch,sfd);
     if ( ch!='\r' && ch!='\n' )
 return( -1 );
 
 return( dval );
 }
 
-static SplineFont *SFD_Read(char *filename,FILE *sfd, int fromdir) {
+static void SFDCheckOnlyBitmaps(SplineFont *sf) {
+    int i;
+    SplineChar *sc;
+
+/* Jonathyn Bet'nct points out that once you edit in an outline window, even */
+/*  if by mistake, your onlybitmaps status is gone for good */
+/* Regenerate it if the font has no splines, refs, etc. */
+    if ( sf->onlybitmaps )
+return;
+    for ( i=sf->glyphcnt-1; i>=0; --i )
+	if ( (sc = sf->glyphs[i])!=NULL &&
+		(sc->layer_cnt!=2 ||
+		 sc->layers[ly_fore].splines!=NULL ||
+		 sc->layers[ly_fore].refs!=NULL ))
+    break;
+    if ( i==-1 )
+	sf->onlybitmaps = true;
+}
+
+static SplineFont *SFD_Read(char *filename,FILE *sfd, int fromdir,
+	enum openflags openflags) {
     SplineFont *sf=NULL;
-    char oldloc[24], tok[2000];
+    struct chunkarena *oldarena;
+    CLocaleSave oldloc;
+    char tok[2000];
     double version;
 
     if ( sfd==NULL ) {
 	if ( fromdir ) {
 	    snprintf(tok,sizeof(tok),"%s/" FONT_PROPS, filename );
-	    sfd = fopen(tok,"r");
+	    sfd = sfdopen(tok);
 	} else
-	    sfd = fopen(filename,"r");
+	    sfd = sfdopen(filename);
     }
     if ( sfd==NULL )
 return( NULL );
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SFDBufferOpen(sfd);
+    SwitchToCLocale(&oldloc);
     ff_progress_change_stages(2);
+    oldarena = sfd_arena;
+    sfd_arena = (openflags&of_arena) ? ChunkArenaNew() : NULL;
     if ( (version = SFDStartsCorrectly(sfd,tok))!=-1 )
-	sf = SFD_GetFont(sfd,NULL,tok,fromdir,filename,version);
-    setlocale(LC_NUMERIC,oldloc);
+	sf = SFD_GetFont(sfd,NULL,tok,fromdir,filename,version,
+		(openflags&of_lazy) && no_windowing_ui);
+    /* The fonts hold their own refs now */
+    ChunkArenaUnref(sfd_arena);
+    sfd_arena = oldarena;
+    SwitchFromCLocale(&oldloc);
     if ( sf!=NULL ) {
 	sf->filename = copy(filename);
 	if ( sf->mm!=NULL ) {
 	    int i;
 	    for ( i=0; i<sf->mm->instance_count; ++i )
 		sf->mm->instances[i]->filename = copy(filename);
-	} else if ( !sf->onlybitmaps ) {
-/* Jonathyn Bet'nct points out that once you edit in an outline window, even */
-/*  if by mistake, your onlybitmaps status is gone for good */
-/* Regenerate it if the font has no splines, refs, etc. */
-	    int i;
-	    SplineChar *sc;
-	    for ( i=sf->glyphcnt-1; i>=0; --i )
-		if ( (sc = sf->glyphs[i])!=NULL &&
-			(sc->layer_cnt!=2 ||
-			 sc->layers[ly_fore].splines!=NULL ||
-			 sc->layers[ly_fore].refs!=NULL ))
-	     break;
-	     if ( i==-1 )
-		 sf->onlybitmaps = true;
-	}
+	} else if ( sf->lazy==NULL )
+	    SFDCheckOnlyBitmaps(sf);
     }
-    fclose(sfd);
+    /* A lazily loaded font keeps its file open until all glyphs are read, */
+    /*  but not the copy of it in memory */
+    if ( sf==NULL || sf->lazy==NULL || sf->lazy->sfd!=sfd )
+	sfdclose(sfd);
+    else
+	SFDBufferClose(sfd);
 return( sf );
 }
 
 SplineFont *SFDRead(char *filename) {
-return( SFD_Read(filename,NULL,false));
+return( SFD_Read(filename,NULL,false,0));
 }
 
-SplineFont *_SFDRead(char *filename,FILE *sfd) {
-return( SFD_Read(filename,sfd,false));
+SplineFont *_SFDRead(char *filename,FILE *sfd,enum openflags openflags) {
+return( SFD_Read(filename,sfd,false,openflags));
 }
 
 SplineFont *SFDirRead(char *filename) {
-return( SFD_Read(filename,NULL,true));
+return( SFD_Read(filename,NULL,true,0));
+}
+
+SplineFont *_SFDirRead(char *filename,enum openflags openflags) {
+return( SFD_Read(filename,NULL,true,openflags));
 }
 
 SplineChar *SFDReadOneChar(SplineFont *cur_sf,const char *name) {
     FILE *sfd;
     SplineChar *sc=NULL;
-    char oldloc[24], tok[2000];
+    CLocaleSave oldloc;
+    char tok[2000];
     uint32 pos;
     SplineFont sf;
     LayerInfo layers[2];
@@ -7784,13 +8551,12 @@ SplineChar *SFDReadOneChar(SplineFont *cur_sf,const char *name) {
 
     if ( cur_sf->save_to_dir ) {
 	snprintf(tok,sizeof(tok),"%s/" FONT_PROPS,cur_sf->filename);
-	sfd = fopen(tok,"r");
+	sfd = sfdopen(tok);
     } else
-	sfd = fopen(cur_sf->filename,"r");
+	sfd = sfdopen(cur_sf->filename);
     if ( sfd==NULL )
 return( NULL );
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
 
     memset(&sf,0,sizeof(sf));
     memset(&layers,0,sizeof(layers));
@@ -7803,11 +8569,11 @@ return( NULL );
 	sf.gpos_lookups = cur_sf->gpos_lookups;
 	sf.gsub_lookups = cur_sf->gsub_lookups;
 	sf.anchor = cur_sf->anchor;
-	pos = ftell(sfd);
+	pos = sfdtell(sfd);
 	while ( getname(sfd,tok)!=-1 ) {
 	    if ( strcmp(tok,"StartChar:")==0 ) {
 		if ( getname(sfd,tok)==1 && strcmp(tok,name)==0 ) {
-		    fseek(sfd,pos,SEEK_SET);
+		    sfdseek(sfd,pos);
 		    sc = SFDGetChar(sfd,&sf,had_layer_cnt);
 	break;
 		}
@@ -7848,24 +8614,24 @@ return( NULL );
 	    } else if ( strmatch(tok,"Descent:")==0 ) {
 		getint(sfd,&sf.descent);
 	    }
-	    pos = ftell(sfd);
+	    pos = sfdtell(sfd);
 	}
     }
-    fclose(sfd);
+    sfdclose(sfd);
     if ( cur_sf->save_to_dir ) {
 	if ( sc!=NULL ) IError("Read a glyph from font.props");
 	/* Doesn't work for CID keyed, nor for mm */
 	snprintf(tok,sizeof(tok),"%s/%s" GLYPH_EXT,cur_sf->filename,name);
-	sfd = fopen(tok,"r");
+	sfd = sfdopen(tok);
 	if ( sfd!=NULL ) {
 	    sc = SFDGetChar(sfd,&sf,had_layer_cnt);
-	    fclose(sfd);
+	    sfdclose(sfd);
 	}
     }
 
     if ( sf.layers!=layers )
 	free(sf.layers);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 return( sc );
 }
 
@@ -7983,7 +8749,7 @@ static SplineFont *SlurpRecovery(FILE *asfd,char *tok,int sizetok) {
     SplineFont *sf;
 
     ch=nlgetc(asfd);
-    ungetc(ch,asfd);
+    sfdungetc(ch,asfd);
     if ( ch=='B' ) {
 	if ( getname(asfd,tok)!=1 )
 return(NULL);
@@ -8022,8 +8788,8 @@ return( true );
 return( false );
     }
 
-    fgets(buffer,sizeof(buffer),asfd);
-    rewind(asfd);
+    sfdgets(buffer,sizeof(buffer),asfd);
+    sfdseek(asfd,0);
     if ( strncmp(buffer,"Base: ",6)!=0 )
 	strcpy(buffer+6, "<New File>");
     pt = buffer+6;
@@ -8057,18 +8823,18 @@ return( true );
 }
 
 SplineFont *SFRecoverFile(char *autosavename,int inquire,int *state) {
-    FILE *asfd = fopen( autosavename,"r");
+    FILE *asfd = sfdopen(autosavename);
     SplineFont *ret;
-    char oldloc[24], tok[1025];
+    CLocaleSave oldloc;
+    char tok[1025];
 
     if ( asfd==NULL )
 return(NULL);
     if ( inquire && !ask_about_file(asfd,state,autosavename)) {
-	fclose( asfd );
+	sfdclose(asfd);
 return( NULL );
     }
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     ret = SlurpRecovery(asfd,tok,sizeof(tok));
     if ( ret==NULL ) {
 	char *buts[3];
@@ -8076,8 +8842,8 @@ return( NULL );
 	if ( ff_ask(_("Recovery Failed"),(const char **) buts,0,1,_("Automagic recovery of changes to %.80s failed.\nShould FontForge try again to recover next time you start it?"),tok)==0 )
 	    unlink(autosavename);
     }
-    setlocale(LC_NUMERIC,oldloc);
-    fclose(asfd);
+    SwitchFromCLocale(&oldloc);
+    sfdclose(asfd);
     if ( ret )
 	ret->autosavename = copy(autosavename);
 return( ret );
@@ -8086,7 +8852,7 @@ return( ret );
 void SFAutoSave(SplineFont *sf,EncMap *map) {
     int i, k, max;
     FILE *asfd;
-    char oldloc[24];
+    CLocaleSave oldloc;
     SplineFont *ssf;
     extern struct compressors compressors[];
 
@@ -8102,8 +8868,7 @@ return;
     for ( i=0; i<sf->subfontcnt; ++i )
 	if ( sf->subfonts[i]->glyphcnt>max ) max = sf->subfonts[i]->glyphcnt;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     if ( !sf->new && sf->origname!=NULL )	/* might be a new file */
 	fprintf( asfd, "Base: %s%s\n", sf->origname,
 		sf->compression==0?"":compressors[sf->compression-1].ext );
@@ -8133,7 +8898,7 @@ return;
     fprintf( asfd, "EndChars\n" );
     fprintf( asfd, "EndSplineFont\n" );
     fclose(asfd);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     sf->changed_since_autosave = false;
 }
 
@@ -8160,17 +8925,17 @@ return;
 }
 
 char **NamesReadSFD(char *filename) {
-    FILE *sfd = fopen(filename,"r");
-    char oldloc[24],tok[2000];
+    FILE *sfd = sfdopen(filename);
+    CLocaleSave oldloc;
+    char tok[2000];
     char **ret = NULL;
     int eof;
 
     if ( sfd==NULL )
 return( NULL );
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     if ( SFDStartsCorrectly(sfd,tok)!=-1 ) {
-	while ( !feof(sfd)) {
+	while ( !sfdeof(sfd)) {
 	    if ( (eof = getname(sfd,tok))!=1 ) {
 		if ( eof==-1 )
 	break;
@@ -8186,7 +8951,7 @@ return( NULL );
 	    }
 	}
     }
-    setlocale(LC_NUMERIC,oldloc);
-    fclose(sfd);
+    SwitchFromCLocale(&oldloc);
+    sfdclose(sfd);
 return( ret );
 }
@@ -28,6 +28,8 @@
 #include "fontforgevw.h"
 #include <math.h>
 #include <locale.h>
+#include <unistd.h>
+#include <sys/time.h>
 # include <ustring.h>
 # include <utype.h>
 # include <gresource.h>
@@ -831,7 +833,8 @@ static void SplineSetsChangeCoord(SplineSet *spl,real old, real new,int isy,
     }
 }
 
-void SCRound2Int(SplineChar *sc,int layer, real factor) {
+/* Doesn't tell the ui about the change, so can be used in a worker thread */
+void _SCRound2Int(SplineChar *sc,int layer, real factor) {
     RefChar *r;
     AnchorPoint *ap;
     StemInfo *stems;
@@ -868,16 +871,16 @@ void SCRound2Int(SplineChar *sc,int layer, real factor) {
 	    RefCharFindBounds(r);
 	}
     }
-    if ( sc->parent->multilayer )
-	layer = ly_fore;
-    else
-	--layer;
 
     for ( ap=sc->anchor; ap!=NULL; ap=ap->next ) {
 	ap->me.x = rint(ap->me.x*factor)/factor;
 	ap->me.y = rint(ap->me.y*factor)/factor;
     }
-    SCCharChangedUpdate(sc,layer);
+}
+
+void SCRound2Int(SplineChar *sc,int layer, real factor) {
+    _SCRound2Int(sc,layer,factor);
+    SCCharChangedUpdate(sc,sc->parent->multilayer ? ly_fore : layer);
 }
 
 void AltUniRemove(SplineChar *sc,int uni) {
@@ -924,6 +927,7 @@ void AltUniAdd(SplineChar *sc,int uni) {
 	    altuni->unienc = uni;
 	    altuni->vs = -1;
 	    altuni->fid = 0;
+	    SFHashUnicode(sc->parent,sc,uni);
 	}
     }
 }
@@ -938,6 +942,7 @@ void AltUniAdd_DontCheckDups(SplineChar *sc,int uni) {
 	altuni->unienc = uni;
 	altuni->vs = -1;
 	altuni->fid = 0;
+	SFHashUnicode(sc->parent,sc,uni);
     }
 }
 
@@ -1074,9 +1079,12 @@ return( false );
 	    }
 	}
     }
-    if ( alt!=NULL )
+    if ( alt!=NULL ) {
 	alt->unienc = sc->unicodeenc;
+	SFHashUnicode(sf,sc,alt->unienc);
+    }
     sc->unicodeenc = unienc;
+    SFHashUnicode(sf,sc,unienc);
     if ( sc->name==NULL || strcmp(name,sc->name)!=0 ) {
 	if ( sc->name!=NULL )
 	    SFGlyphRenameFixup(sf,sc->name,name);
@@ -1488,37 +1496,16 @@ return( h1 );
 return( NULL );
 }
 
-int SCValidate(SplineChar *sc, int layer, int force) {
-    SplineSet *ss;
-    Spline *s1, *s2, *s, *first;
-    SplinePoint *sp;
-    RefChar *ref;
-    int lastscan= -1;
-    int cnt, path_cnt, pt_cnt;
-    StemInfo *h;
-    SplineSet *base;
-    bigreal len2, bound2, x, y;
-    extended extrema[4];
+/* Checks that the glyphs named by sc's lookups and variants exist, and that */
+/*  its own name is a good one */
+static int SCValidateNames(SplineChar *sc) {
     PST *pst;
-    struct ttf_table *tab;
     extern int allow_utf8_glyphnames;
-    RefChar *r;
-    BasePoint lastpt;
-    int gid, k;
-    SplineFont *cid, *sf;
-    SplineChar *othersc;
-    struct altuni *alt;
-
-    if ( (sc->layers[layer].validation_state&vs_known) && !force )
-  goto end;
-
-    sc->layers[layer].validation_state = 0;
-
-    base = LayerAllSplines(&sc->layers[layer]);
+    int state = 0;
 
     if ( !allow_utf8_glyphnames ) {
 	if ( strlen(sc->name)>31 )
-	    sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+	    state |= vs_badglyphname|vs_known;
 	else {
 	    char *pt;
 	    for ( pt = sc->name; *pt; ++pt ) {
@@ -1528,7 +1515,7 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 			*pt == '.' || *pt == '_' )
 		    /* That's ok */;
 		else {
-		    sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+		    state |= vs_badglyphname|vs_known;
 	    break;
 		}
 	    }
@@ -1538,74 +1525,97 @@ int SCValidate(SplineChar *sc, int layer, int force) {
     for ( pst=sc->possub; pst!=NULL; pst=pst->next ) {
 	if ( pst->type==pst_substitution &&
 		!SCWorthOutputting(SFGetChar(sc->parent,-1,pst->u.subs.variant))) {
-	    sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+	    state |= vs_badglyphname|vs_known;
     break;
 	} else if ( pst->type==pst_pair &&
 		!SCWorthOutputting(SFGetChar(sc->parent,-1,pst->u.pair.paired))) {
-	    sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+	    state |= vs_badglyphname|vs_known;
     break;
 	} else if ( (pst->type==pst_alternate || pst->type==pst_multiple || pst->type==pst_ligature) &&
 		!SFValidNameList(sc->parent,pst->u.mult.components)) {
-	    sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+	    state |= vs_badglyphname|vs_known;
     break;
 	}
     }
     if ( sc->vert_variants!=NULL && sc->vert_variants->variants != NULL &&
 	    !SFValidNameList(sc->parent,sc->vert_variants->variants) )
-	sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+	state |= vs_badglyphname|vs_known;
     else if ( sc->horiz_variants!=NULL && sc->horiz_variants->variants != NULL &&
 	    !SFValidNameList(sc->parent,sc->horiz_variants->variants) )
-	sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+	state |= vs_badglyphname|vs_known;
     else {
 	int i;
 	if ( sc->vert_variants!=NULL ) {
 	    for ( i=0; i<sc->vert_variants->part_cnt; ++i ) {
 		if ( !SCWorthOutputting(SFGetChar(sc->parent,-1,sc->vert_variants->parts[i].component)))
-		    sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+		    state |= vs_badglyphname|vs_known;
 	    break;
 	    }
 	}
 	if ( sc->horiz_variants!=NULL ) {
 	    for ( i=0; i<sc->horiz_variants->part_cnt; ++i ) {
 		if ( !SCWorthOutputting(SFGetChar(sc->parent,-1,sc->horiz_variants->parts[i].component)))
-		    sc->layers[layer].validation_state |= vs_badglyphname|vs_known;
+		    state |= vs_badglyphname|vs_known;
 	    break;
 	    }
 	}
     }
+return( state );
+}
+
+/* The checks which look at nothing but the glyph itself (and at the font's */
+/*  em size and 'maxp' table). These are the slow ones, and may be done on */
+/*  several glyphs at once in different threads */
+static int SCValidateOutlines(SplineChar *sc, int layer) {
+    SplineSet *ss;
+    Spline *s1, *s2, *s, *first;
+    SplinePoint *sp;
+    RefChar *ref;
+    int lastscan= -1;
+    int cnt, path_cnt, pt_cnt;
+    StemInfo *h;
+    SplineSet *base;
+    bigreal len2, bound2, x, y;
+    extended extrema[4];
+    struct ttf_table *tab;
+    RefChar *r;
+    BasePoint lastpt;
+    int state = 0;
+
+    base = LayerAllSplines(&sc->layers[layer]);
 
     for ( ss=sc->layers[layer].splines; ss!=NULL; ss=ss->next ) {
 	/* TrueType uses single points to move things around so ignore them */
 	if ( ss->first->next==NULL )
 	    /* Do Nothing */;
 	else if ( ss->first->prev==NULL ) {
-	    sc->layers[layer].validation_state |= vs_opencontour|vs_known;
+	    state |= vs_opencontour|vs_known;
     break;
 	}
     }
 
     /* If there's an open contour we can't really tell whether it self-intersects */
-    if ( sc->layers[layer].validation_state & vs_opencontour )
-	/* sc->layers[layer].validation_state |= vs_selfintersects*/;
+    if ( state & vs_opencontour )
+	/* state |= vs_selfintersects*/;
     else {
 	if ( SplineSetIntersect(base,&s1,&s2) )
-	    sc->layers[layer].validation_state |= vs_selfintersects|vs_known;
+	    state |= vs_selfintersects|vs_known;
     }
 
     /* If there's a self-intersection we are guaranteed that both the self- */
     /*  intersecting contours will be in the wrong direction at some point */
-    if ( sc->layers[layer].validation_state & vs_selfintersects )
-	/*sc->layers[layer].validation_state |= vs_wrongdirection*/;
+    if ( state & vs_selfintersects )
+	/*state |= vs_wrongdirection*/;
     else {
 	if ( SplineSetsDetectDir(&base,&lastscan)!=NULL )
-	    sc->layers[layer].validation_state |= vs_wrongdirection|vs_known;
+	    state |= vs_wrongdirection|vs_known;
     }
 
     /* Different kind of "wrong direction" */
     for ( ref=sc->layers[layer].refs; ref!=NULL; ref=ref->next ) {
 	if ( ref->transform[0]*ref->transform[3]<0 ||
 		(ref->transform[0]==0 && ref->transform[1]*ref->transform[2]>0)) {
-	    sc->layers[layer].validation_state |= vs_flippedreferences|vs_known;
+	    state |= vs_flippedreferences|vs_known;
     break;
 	}
     }
@@ -1613,7 +1623,7 @@ int SCValidate(SplineChar *sc, int layer, int force) {
     for ( h=sc->hstem, cnt=0; h!=NULL; h=h->next, ++cnt );
     for ( h=sc->vstem       ; h!=NULL; h=h->next, ++cnt );
     if ( cnt>=96 )
-	sc->layers[layer].validation_state |= vs_toomanyhints|vs_known;
+	state |= vs_toomanyhints|vs_known;
 
     if ( sc->layers[layer].splines!=NULL ) {
 	int anyhm=0;
@@ -1635,7 +1645,7 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 	if ( !anyhm )
 	    h = SCHintOverlapInMask(sc,NULL);
 	if ( h!=NULL )
-	    sc->layers[layer].validation_state |= vs_overlappedhints|vs_known;
+	    state |= vs_overlappedhints|vs_known;
     }
 
     memset(&lastpt,0,sizeof(lastpt));
@@ -1646,11 +1656,11 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 	    if ( (!SPInterpolate(sp) && (sp->me.x != rint(sp->me.x) || sp->me.y != rint(sp->me.y))) ||
 		    sp->nextcp.x != rint(sp->nextcp.x) || sp->nextcp.y != rint(sp->nextcp.y) ||
 		    sp->prevcp.x != rint(sp->prevcp.x) || sp->prevcp.y != rint(sp->prevcp.y))
-		sc->layers[layer].validation_state |= vs_nonintegral|vs_known;
+		state |= vs_nonintegral|vs_known;
 	    if ( BPTooFar(&lastpt,&sp->prevcp) ||
 		    BPTooFar(&sp->prevcp,&sp->me) ||
 		    BPTooFar(&sp->me,&sp->nextcp))
-		sc->layers[layer].validation_state |= vs_pointstoofarapart|vs_known;
+		state |= vs_pointstoofarapart|vs_known;
 	    memcpy(&lastpt,&sp->nextcp,sizeof(lastpt));
 	    ++pt_cnt;
 	    if ( sp->next==NULL )
@@ -1669,7 +1679,7 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 	}
     }
     if ( pt_cnt>1500 )
-	sc->layers[layer].validation_state |= vs_toomanypoints|vs_known;
+	state |= vs_toomanypoints|vs_known;
 
     LayerUnAllSplines(&sc->layers[layer]);
 
@@ -1691,7 +1701,7 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 	    len2 = x*x + y*y;
 	    /* short splines (serifs) are not required to have points at their extrema */
 	    if ( len2>bound2 && Spline2DFindExtrema(s,extrema)>0 ) {
-		sc->layers[layer].validation_state |= vs_missingextrema|vs_known;
+		state |= vs_missingextrema|vs_known;
     goto break_2_loops;
 	    }
 	}
@@ -1714,9 +1724,9 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 	/* Already figured out two of these */
 	if ( sc->layers[layer].splines==NULL ) {
 	    if ( pt_cnt>composit_pt_max )
-		sc->layers[layer].validation_state |= vs_maxp_toomanycomppoints|vs_known;
+		state |= vs_maxp_toomanycomppoints|vs_known;
 	    if ( path_cnt>composit_path_max )
-		sc->layers[layer].validation_state |= vs_maxp_toomanycomppaths|vs_known;
+		state |= vs_maxp_toomanycomppaths|vs_known;
 	}
 
 	for ( ss=sc->layers[layer].splines, pt_cnt=path_cnt=0; ss!=NULL; ss=ss->next, ++path_cnt ) {
@@ -1730,12 +1740,12 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 	    }
 	}
 	if ( pt_cnt>pt_max )
-	    sc->layers[layer].validation_state |= vs_maxp_toomanypoints|vs_known;
+	    state |= vs_maxp_toomanypoints|vs_known;
 	if ( path_cnt>path_max )
-	    sc->layers[layer].validation_state |= vs_maxp_toomanypaths|vs_known;
+	    state |= vs_maxp_toomanypaths|vs_known;
 
 	if ( sc->ttf_instrs_len>instr_len_max )
-	    sc->layers[layer].validation_state |= vs_maxp_instrtoolong|vs_known;
+	    state |= vs_maxp_instrtoolong|vs_known;
 
 	rd = 0;
 	for ( r=sc->layers[layer].refs, cnt=0; r!=NULL; r=r->next, ++cnt ) {
@@ -1744,10 +1754,21 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 		rd = rdtest;
 	}
 	if ( cnt>num_comp_max )
-	    sc->layers[layer].validation_state |= vs_maxp_toomanyrefs|vs_known;
+	    state |= vs_maxp_toomanyrefs|vs_known;
 	if ( rd>comp_depth_max )
-	    sc->layers[layer].validation_state |= vs_maxp_refstoodeep|vs_known;
+	    state |= vs_maxp_refstoodeep|vs_known;
     }
+return( state );
+}
+
+/* Looks through all the glyphs in the font (or cid-keyed family) for others */
+/*  with sc's name or any of its unicode code points */
+static int SCValidateDuplicates(SplineChar *sc) {
+    int gid, k;
+    SplineFont *cid, *sf;
+    SplineChar *othersc;
+    struct altuni *alt;
+    int state = 0;
 
     k=0;
     cid = sc->parent;
@@ -1759,16 +1780,26 @@ int SCValidate(SplineChar *sc, int layer, int force) {
 	    if ( othersc==sc )
 	continue;
 	    if ( strcmp(sc->name,othersc->name)==0 )
-		sc->layers[layer].validation_state |= vs_dupname|vs_known;
+		state |= vs_dupname|vs_known;
 	    if ( sc->unicodeenc!=-1 && UniMatch(-1,sc->unicodeenc,othersc) )
-		sc->layers[layer].validation_state |= vs_dupunicode|vs_known;
+		state |= vs_dupunicode|vs_known;
 	    for ( alt=sc->altuni; alt!=NULL; alt=alt->next )
 		if ( UniMatch(alt->vs,alt->unienc,othersc) )
-		    sc->layers[layer].validation_state |= vs_dupunicode|vs_known;
+		    state |= vs_dupunicode|vs_known;
 	}
 	++k;
     } while ( k<cid->subfontcnt );
-		
+return( state );
+}
+
+int SCValidate(SplineChar *sc, int layer, int force) {
+
+    if ( (sc->layers[layer].validation_state&vs_known) && !force )
+  goto end;
+
+    sc->layers[layer].validation_state = SCValidateNames(sc) |
+	    SCValidateOutlines(sc,layer) | SCValidateDuplicates(sc);
+
   end:;
     /* This test is intentionally here and should be done even if the glyph */
     /*  hasn't changed. If the lookup changed it could make the glyph invalid */
@@ -1782,54 +1813,419 @@ return( sc->layers[layer].validation_state&~(vs_known|vs_selfintersects) );
 return( sc->layers[layer].validation_state&~vs_known );
 }
     
-int SFValidate(SplineFont *sf, int layer, int force) {
-    int k, gid;
+/* Validating a whole font. The checks on a glyph's outlines look at nothing */
+/*  but that glyph, so they are done on several glyphs at once in different */
+/*  threads. The other checks look at the rest of the font (and set ticks on */
+/*  the anchor classes) and are done afterwards on the main thread. Checking */
+/*  each glyph's name and code points against all the others would take */
+/*  time proportional to the square of the number of glyphs, so we sort */
+/*  them instead and look for runs of glyphs with the same name or code */
+/*  point */
+/* The results of the outline checks may also be kept in a cache file, keyed */
+/*  by a hash of everything those checks look at. Then a font which is */
+/*  validated again after a few glyphs have changed need only check those */
+struct vdupkey {
+    char *name;			/* NULL if this is a code point */
+    int vs, uni;
+    SplineChar *sc;
+    int index;			/* Of the glyph in the font */
+};
+
+static int vdupcmp(const void *_k1, const void *_k2) {
+    const struct vdupkey *k1 = _k1, *k2 = _k2;
+
+    if ( k1->name!=NULL )
+return( strcmp(k1->name,k2->name) );
+    if ( k1->vs!=k2->vs )
+return( k1->vs<k2->vs ? -1 : 1 );
+    if ( k1->uni!=k2->uni )
+return( k1->uni<k2->uni ? -1 : 1 );
+return( 0 );
+}
+
+static void VDupsFlag(struct vdupkey *keys, int cnt, int *dups, int flag) {
+    int i, j, k;
+
+    qsort(keys,cnt,sizeof(struct vdupkey),vdupcmp);
+    for ( i=0; i<cnt; i=j ) {
+	for ( j=i+1; j<cnt && vdupcmp(&keys[i],&keys[j])==0; ++j );
+	/* The same glyph may have the same code point twice, that's no dup */
+	for ( k=i+1; k<j && keys[k].sc==keys[i].sc; ++k );
+	if ( k<j ) {
+	    for ( k=i; k<j; ++k )
+		dups[keys[k].index] |= flag|vs_known;
+	}
+    }
+}
+
+/* Sets dups[i] to what SCValidateDuplicates would say about glyphs[i], where */
+/*  glyphs holds all the glyphs of the font (or cid-keyed family) */
+static void SFValidateDuplicates(SplineChar **glyphs, int cnt, int *dups) {
+    struct vdupkey *names, *unis;
+    int i, ucnt;
+    SplineChar *sc;
+    struct altuni *alt;
+
+    ucnt = cnt;
+    for ( i=0; i<cnt; ++i )
+	for ( alt=glyphs[i]->altuni; alt!=NULL; alt=alt->next )
+	    ++ucnt;
+    names = galloc((cnt+1)*sizeof(struct vdupkey));
+    unis = galloc((ucnt+1)*sizeof(struct vdupkey));
+    ucnt = 0;
+    for ( i=0; i<cnt; ++i ) {
+	sc = glyphs[i];
+	names[i].name = sc->name;
+	names[i].sc = sc;
+	names[i].index = i;
+	if ( sc->unicodeenc!=-1 ) {
+	    unis[ucnt].name = NULL;
+	    unis[ucnt].vs = -1;
+	    unis[ucnt].uni = sc->unicodeenc;
+	    unis[ucnt].sc = sc;
+	    unis[ucnt++].index = i;
+	}
+	for ( alt=sc->altuni; alt!=NULL; alt=alt->next ) {
+	    unis[ucnt].name = NULL;
+	    unis[ucnt].vs = alt->vs;
+	    unis[ucnt].uni = alt->unienc;
+	    unis[ucnt].sc = sc;
+	    unis[ucnt++].index = i;
+	}
+    }
+
+    VDupsFlag(names,cnt,dups,vs_dupname);
+    VDupsFlag(unis,ucnt,dups,vs_dupunicode);
+    free(names);
+    free(unis);
+}
+
+/* A 64 bit FNV-1a hash of everything SCValidateOutlines looks at */
+#define VHASH_START	14695981039346656037ULL
+
+static void VHashBytes(unsigned long long *hash, const void *data, int len) {
+    const uint8 *pt = data;
+    unsigned long long h = *hash;
+
+    while ( --len>=0 ) {
+	h ^= *pt++;
+	h *= 1099511628211ULL;
+    }
+    *hash = h;
+}
+
+static void VHashInt(unsigned long long *hash, int val) {
+    VHashBytes(hash,&val,sizeof(val));
+}
+
+static void VHashSplines(unsigned long long *hash, SplineSet *ss) {
+    SplinePoint *sp;
+
+    for ( ; ss!=NULL; ss=ss->next ) {
+	VHashInt(hash,-1);		/* Start of a contour */
+	for ( sp=ss->first; ; ) {
+	    VHashBytes(hash,&sp->me,sizeof(BasePoint));
+	    VHashBytes(hash,&sp->nextcp,sizeof(BasePoint));
+	    VHashBytes(hash,&sp->prevcp,sizeof(BasePoint));
+	    VHashInt(hash,sp->nonextcp | (sp->noprevcp<<1) |
+		    (sp->dontinterpolate<<2) | (sp->roundx<<3) | (sp->roundy<<4) |
+		    ((sp->hintmask!=NULL)<<5) | ((sp->next!=NULL)<<6) );
+	    if ( sp->hintmask!=NULL )
+		VHashBytes(hash,sp->hintmask,sizeof(HintMask));
+	    if ( sp->next==NULL )
+	break;
+	    VHashInt(hash,sp->next->order2 | (sp->next->knownlinear<<1) |
+		    (sp->next->acceptableextrema<<2) );
+	    sp = sp->next->to;
+	    if ( sp==ss->first )
+	break;
+	}
+    }
+}
+
+static unsigned long long SCValidationHash(SplineChar *sc, int layer) {
+    unsigned long long hash = VHASH_START;
+    SplineFont *sf = sc->parent;
+    struct ttf_table *tab;
+    RefChar *ref;
+    StemInfo *h;
+
+    VHashInt(&hash,layer);
+    VHashInt(&hash,sf->ascent);
+    VHashInt(&hash,sf->descent);
+    VHashInt(&hash,sf->extrema_bound);
+    if ( (tab = SFFindTable(sf,CHR('m','a','x','p')))!=NULL && tab->len>=32 )
+	VHashBytes(&hash,tab->data,32);
+    VHashInt(&hash,sc->ttf_instrs_len);
+    VHashSplines(&hash,sc->layers[layer].splines);
+    for ( ref=sc->layers[layer].refs; ref!=NULL; ref=ref->next ) {
+	VHashInt(&hash,-2);		/* Start of a reference */
+	VHashBytes(&hash,ref->transform,sizeof(ref->transform));
+	VHashInt(&hash,RefDepth(ref,layer));
+	VHashSplines(&hash,ref->layers[0].splines);
+    }
+    for ( h=sc->hstem; h!=NULL; h=h->next ) {
+	VHashBytes(&hash,&h->start,sizeof(h->start));
+	VHashBytes(&hash,&h->width,sizeof(h->width));
+    }
+    VHashInt(&hash,-3);
+    for ( h=sc->vstem; h!=NULL; h=h->next ) {
+	VHashBytes(&hash,&h->start,sizeof(h->start));
+	VHashBytes(&hash,&h->width,sizeof(h->width));
+    }
+    if ( hash==0 )		/* 0 marks an empty slot in the cache */
+	hash = 1;
+return( hash );
+}
+
+/* Bump this whenever SCValidateOutlines or SCValidationHash changes */
+#define VCACHE_HEADER	"FontForge validation cache 1"
+
+struct vcache {
+    int size, cnt;
+    struct vcacheentry {
+	unsigned long long key;
+	int state;
+    } *entries;
+};
+
+static struct vcacheentry *VCacheSlot(struct vcache *vc, unsigned long long key) {
+    int i = (int) ((key>>7) & (vc->size-1));
+
+    while ( vc->entries[i].key!=0 && vc->entries[i].key!=key )
+	i = (i+1) & (vc->size-1);
+return( &vc->entries[i] );
+}
+
+static void VCacheAdd(struct vcache *vc, unsigned long long key, int state) {
+    struct vcacheentry *old, *slot;
+    int i, oldsize;
+
+    if ( 2*(vc->cnt+1)>vc->size ) {
+	old = vc->entries; oldsize = vc->size;
+	vc->size = vc->size==0 ? 256 : 2*vc->size;
+	vc->entries = gcalloc(vc->size,sizeof(struct vcacheentry));
+	vc->cnt = 0;
+	for ( i=0; i<oldsize; ++i ) if ( old[i].key!=0 )
+	    VCacheAdd(vc,old[i].key,old[i].state);
+	free(old);
+    }
+    slot = VCacheSlot(vc,key);
+    if ( slot->key==0 ) {
+	slot->key = key;
+	++vc->cnt;
+    }
+    slot->state = state;
+}
+
+static int VCacheFind(struct vcache *vc, unsigned long long key, int *state) {
+    struct vcacheentry *slot;
+
+    if ( vc->size==0 )
+return( false );
+    slot = VCacheSlot(vc,key);
+    if ( slot->key==0 )
+return( false );
+    *state = slot->state;
+return( true );
+}
+
+static void VCacheRead(struct vcache *vc, const char *filename) {
+    FILE *file = fopen(filename,"r");
+    char buffer[100];
+    unsigned long long key;
+    unsigned int state;
+
+    if ( file==NULL )
+return;
+    if ( fgets(buffer,sizeof(buffer),file)!=NULL &&
+	    strncmp(buffer,VCACHE_HEADER,strlen(VCACHE_HEADER))==0 ) {
+	while ( fscanf(file,"%llx %x",&key,&state)==2 )
+	    if ( key!=0 )
+		VCacheAdd(vc,key,state);
+    }
+    fclose(file);
+}
+
+static void VCacheWrite(struct vcache *vc, const char *filename) {
+    char *temp = galloc(strlen(filename)+10);
+    FILE *file;
+    int i, ok;
+
+    /* Write to a temporary file and rename it, so someone reading the */
+    /*  cache never sees half of it */
+    sprintf(temp,"%s.%d",filename,(int) getpid());
+    if ( (file = fopen(temp,"w"))==NULL ) {
+	LogError( _("Could not write the validation cache %s\n"), filename );
+	free(temp);
+return;
+    }
+    fprintf(file,"%s\n",VCACHE_HEADER);
+    for ( i=0; i<vc->size; ++i ) if ( vc->entries[i].key!=0 )
+	fprintf(file,"%016llx %x\n",vc->entries[i].key,vc->entries[i].state);
+    ok = !ferror(file);
+    if ( fclose(file)!=0 || !ok || rename(temp,filename)!=0 ) {
+	LogError( _("Could not write the validation cache %s\n"), filename );
+	unlink(temp);
+    }
+    free(temp);
+}
+
+/* Where the validation cache for sf lives by default: beside the font file */
+char *SFValidationCacheName(SplineFont *sf) {
+    char *name, *ret;
+    int len;
+
+    if ( sf->cidmaster!=NULL )
+	sf = sf->cidmaster;
+    name = sf->filename!=NULL ? sf->filename : sf->origname;
+    if ( name==NULL )
+return( NULL );
+    len = strlen(name);
+    while ( len>1 && name[len-1]=='/' )		/* sfdir */
+	--len;
+    ret = galloc(len+strlen(".validation")+1);
+    memcpy(ret,name,len);
+    strcpy(ret+len,".validation");
+return( ret );
+}
+
+struct vthreads {
+    SplineChar **glyphs;
+    int *todo;			/* Indices into glyphs of those to check */
+    int layer;
+    int *states;
+    char *done;
+    struct vcache *cache;	/* Only read while the threads run */
+    unsigned long long *hashes;
+    char *cached;
+};
+
+static void VThreadedGlyph(void *data, int i) {
+    struct vthreads *vt = data;
+    SplineChar *sc = vt->glyphs[vt->todo[i]];
+
+    if ( vt->cache!=NULL ) {
+	vt->hashes[i] = SCValidationHash(sc,vt->layer);
+	vt->cached[i] = VCacheFind(vt->cache,vt->hashes[i],&vt->states[i]);
+    }
+    if ( !vt->cached[i] )
+	vt->states[i] = SCValidateOutlines(sc,vt->layer);
+    vt->done[i] = true;
+}
+
+/* Validates all the glyphs of sf which need it (all of them if force is set). */
+/*  The outlines are checked on threads glyphs at once (0 for the ThreadCount */
+/*  preference). If cachefile isn't NULL then results are looked for in and */
+/*  added to that file. If stats isn't NULL we say what we did there */
+int _SFValidate(SplineFont *sf, int layer, int force, int threads,
+	const char *cachefile, struct validatestats *stats) {
+    int k, gid, i, j, total, cnt, ok;
     SplineFont *sub;
     int any = 0;
-    SplineChar *sc;
-    int cnt=0;
+    SplineChar *sc, **glyphs;
+    int *dups;
+    struct vthreads vt;
+    struct vcache cache;
+    struct timeval start, end;
 #if 0		/* See comment below, leave code in just in case I'm wrong again */
     struct ttf_table *tab;
 #endif
 
+    gettimeofday(&start,NULL);
     if ( sf->cidmaster )
 	sf = sf->cidmaster;
 
-    if ( !no_windowing_ui ) {
-	cnt = 0;
-	k = 0;
-	do {
-	    sub = sf->subfontcnt==0 ? sf : sf->subfonts[k];
-	    for ( gid=0; gid<sub->glyphcnt; ++gid ) if ( (sc=sub->glyphs[gid])!=NULL ) {
-		if ( force || !(sc->layers[layer].validation_state&vs_known) )
-		    ++cnt;
-	    }
-	    ++k;
-	} while ( k<sf->subfontcnt );
-	if ( cnt!=0 )
-	    ff_progress_start_indicator(10,_("Validating..."),_("Validating..."),0,cnt,1);
-    }
-
+    total = 0;
+    k = 0;
+    do {
+	sub = sf->subfontcnt==0 ? sf : sf->subfonts[k];
+	total += sub->glyphcnt;
+	++k;
+    } while ( k<sf->subfontcnt );
+    glyphs = galloc((total+1)*sizeof(SplineChar *));
+    memset(&vt,0,sizeof(vt));
+    vt.todo = galloc((total+1)*sizeof(int));
+    total = cnt = 0;
     k = 0;
     do {
 	sub = sf->subfontcnt==0 ? sf : sf->subfonts[k];
 	for ( gid=0; gid<sub->glyphcnt; ++gid ) if ( (sc=sub->glyphs[gid])!=NULL ) {
-	    if ( force || !(sc->layers[layer].validation_state&vs_known) ) {
-		SCValidate(sc,layer,true);
-		if ( !ff_progress_next())
-return( -1 );
-	    } else if ( SCValidateAnchors(sc)!=NULL )
-		sc->layers[layer].validation_state |= vs_missinganchor;
-	    
-	    if ( sc->unlink_rm_ovrlp_save_undo )
-		any |= sc->layers[layer].validation_state&~vs_selfintersects;
-	    else
-		any |= sc->layers[layer].validation_state;
+	    if ( force || !(sc->layers[layer].validation_state&vs_known) )
+		vt.todo[cnt++] = total;
+	    glyphs[total++] = sc;
 	}
 	++k;
     } while ( k<sf->subfontcnt );
+
+    if ( !no_windowing_ui && cnt!=0 )
+	ff_progress_start_indicator(10,_("Validating..."),_("Validating..."),0,cnt,1);
+
+    dups = gcalloc(total+1,sizeof(int));
+    if ( cnt!=0 )
+	SFValidateDuplicates(glyphs,total,dups);
+
+    memset(&cache,0,sizeof(cache));
+    if ( cachefile!=NULL )
+	VCacheRead(&cache,cachefile);
+    vt.glyphs = glyphs;
+    vt.layer = layer;
+    vt.states = gcalloc(cnt+1,sizeof(int));
+    vt.done = gcalloc(cnt+1,sizeof(char));
+    vt.cached = gcalloc(cnt+1,sizeof(char));
+    vt.hashes = gcalloc(cnt+1,sizeof(unsigned long long));
+    vt.cache = cachefile!=NULL ? &cache : NULL;
+    ok = ThreadedForEach(cnt,ThreadCount(threads),true,VThreadedGlyph,&vt);
+
+    for ( i=j=0; i<total; ++i ) {
+	sc = glyphs[i];
+	if ( j<cnt && vt.todo[j]==i ) {
+	    if ( vt.done[j] ) {
+		sc->layers[layer].validation_state = SCValidateNames(sc) |
+			vt.states[j] | dups[i];
+		if ( SCValidateAnchors(sc)!=NULL )
+		    sc->layers[layer].validation_state |= vs_missinganchor;
+		sc->layers[layer].validation_state |= vs_known;
+	    }
+	    ++j;
+	} else if ( SCValidateAnchors(sc)!=NULL )
+	    sc->layers[layer].validation_state |= vs_missinganchor;
+
+	if ( sc->unlink_rm_ovrlp_save_undo )
+	    any |= sc->layers[layer].validation_state&~vs_selfintersects;
+	else
+	    any |= sc->layers[layer].validation_state;
+    }
     ff_progress_end_indicator();
 
+    if ( cachefile!=NULL ) {
+	/* If we looked at every glyph then anything else in the cache is */
+	/*  for glyphs which are no more, and may go */
+	if ( ok && cnt==total ) {
+	    free(cache.entries);
+	    memset(&cache,0,sizeof(cache));
+	}
+	for ( i=0; i<cnt; ++i ) if ( vt.done[i] )
+	    VCacheAdd(&cache,vt.hashes[i],vt.states[i]);
+	VCacheWrite(&cache,cachefile);
+	free(cache.entries);
+    }
+
+    if ( stats!=NULL ) {
+	stats->validated = cnt;
+	stats->cached = 0;
+	for ( i=0; i<cnt; ++i )
+	    stats->cached += vt.cached[i];
+	gettimeofday(&end,NULL);
+	stats->seconds = (end.tv_sec-start.tv_sec) + (end.tv_usec-start.tv_usec)/1000000.0;
+    }
+    free(vt.states); free(vt.done); free(vt.cached); free(vt.hashes);
+    free(vt.todo);
+    free(dups);
+    free(glyphs);
+    if ( !ok )
+return( -1 );
+
 #if 0
     /* Ah... I no longer believe that the maxp instr_len entry refers to */
     /* prep/fpgm. The footnote I thought was relevant I see actually */
@@ -1854,6 +2250,10 @@ return( -1 );
 return( any&~vs_known );
 }
 
+int SFValidate(SplineFont *sf, int layer, int force) {
+return( _SFValidate(sf,layer,force,0,NULL,NULL));
+}
+
 void SCTickValidationState(SplineChar *sc,int layer) {
     struct splinecharlist *dlist;
 
@@ -552,6 +552,23 @@ return( true );
 return( false );
 }
 
+static void FillSpan(uint8 *bpt,int k,int end) {
+    /* Set bits k through end of a scanline, whole bytes at a time in the */
+    /*  middle */
+    int first = k>>3, last = end>>3;
+
+    if ( k>end )
+return;
+    if ( first==last ) {
+	bpt[first] |= (0xff>>(k&7)) & (0xff<<(7-(end&7)));
+return;
+    }
+    bpt[first] |= 0xff>>(k&7);
+    if ( last>first+1 )
+	memset(bpt+first+1,0xff,last-first-1);
+    bpt[last] |= 0xff<<(7-(end&7));
+}
+
 static void FillChar(EdgeList *es) {
     Edge *active=NULL, *apt, *pr, *e, *prev;
     int i, k, end, width, oldk;
@@ -603,8 +620,7 @@ static void FillChar(EdgeList *es) {
 			bpt[(lx1>>3)] |= (1<<(7-(lx1&7)));
 		}
 	    }
-	    for ( ; k<=end; ++k )
-		bpt[k>>3] |= (1<<(7-(k&7)));
+	    FillSpan(bpt,k,end);
 	    apt->last_mpos = pr->last_mpos = i;
 	    apt->last_opos = oldk;
 	    pr->last_opos = end;
@@ -1591,6 +1607,57 @@ BDFFont *SplineFontRasterize(SplineFont *_sf, int layer, int pixelsize, int indi
 return( bdf );
 }
 
+/* Number of bits set in each byte */
+#define BC2(n)	n, n+1, n+1, n+2
+#define BC4(n)	BC2(n), BC2(n+1), BC2(n+1), BC2(n+2)
+#define BC6(n)	BC4(n), BC4(n+1), BC4(n+1), BC4(n+2)
+static const uint8 bitsset[256] = { BC6(0), BC6(1), BC6(1), BC6(2) };
+
+static void AntiAliasRow(uint8 *bpt,int bits,uint8 *pt,int linear_scale,int max) {
+    /* Add the bits of one row of a bitmap into a row of a greymap, where */
+    /*  each grey pixel covers linear_scale bits. The groups start on byte */
+    /*  boundaries, so we count them a byte (or two) at a time rather than */
+    /*  a bit at a time */
+    int bytes = (bits+7)>>3, b, g, per, cnt, mask, val;
+    uint8 byte;
+
+    if ( linear_scale==16 ) {
+	for ( b=0; b<bytes; b+=2 ) {
+	    byte = bpt[b];
+	    if ( b==bytes-1 && (bits&7) )
+		byte &= 0xff<<(8-(bits&7));
+	    cnt = bitsset[byte];
+	    if ( b+1<bytes ) {
+		byte = bpt[b+1];
+		if ( b+1==bytes-1 && (bits&7) )
+		    byte &= 0xff<<(8-(bits&7));
+		cnt += bitsset[byte];
+	    }
+	    if ( cnt!=0 ) {
+		val = pt[b>>1]+cnt;
+		pt[b>>1] = val>max ? max : val;
+	    }
+	}
+    } else {
+	per = 8/linear_scale;
+	mask = (1<<linear_scale)-1;
+	for ( b=0; b<bytes; ++b ) {
+	    byte = bpt[b];
+	    if ( b==bytes-1 && (bits&7) )
+		byte &= 0xff<<(8-(bits&7));
+	    if ( byte==0 )
+	continue;
+	    for ( g=0; g<per; ++g ) {
+		cnt = bitsset[(byte>>(8-linear_scale*(g+1)))&mask];
+		if ( cnt!=0 ) {
+		    val = pt[b*per+g]+cnt;
+		    pt[b*per+g] = val>max ? max : val;
+		}
+	    }
+	}
+    }
+}
+
 void BDFCAntiAlias(BDFChar *bc, int linear_scale) {
     BDFChar new;
     int i,j, l2 = linear_scale*linear_scale, max = l2-1;
@@ -1633,7 +1700,9 @@ return;
 	for ( i=0; i<=bc->ymax-bc->ymin; ++i ) {
 	    bpt = bc->bitmap + i*bc->bytes_per_line;
 	    pt = new.bitmap + (i/linear_scale)*new.bytes_per_line;
-	    for ( j=0; j<=bc->xmax-bc->xmin; ++j ) {
+	    if ( linear_scale==2 || linear_scale==4 || linear_scale==8 || linear_scale==16 )
+		AntiAliasRow(bpt,bc->xmax-bc->xmin+1,pt,linear_scale,max);
+	    else for ( j=0; j<=bc->xmax-bc->xmin; ++j ) {
 		if ( bpt[(j>>3)] & (1<<(7-(j&7))) )
 		    /* we can get values between 0..2^n we want values between 0..(2^n-1) */
 		    if ( pt[ j/linear_scale ]!=max )
@@ -1746,6 +1815,142 @@ return( SplineFontRasterize(_sf,layer,pixelsize,true));
 return( bdf );
 }
 
+/* Building several strikes at once. Each job is a block of glyphs in one */
+/*  strike, and every glyph lands in its own slot, so the strikes come out */
+/*  the same however the jobs are shared between threads. FreeType faces */
+/*  can't be shared between threads, so each worker gets one of its own */
+#define STRIKE_BLOCK	32
+
+struct strikes {
+    SplineFont *sf;
+    int layer;
+    int32 *sizes;		/* (depth<<16)|pixelsize, as for BitmapControl */
+    BDFFont **bdfs;		/* One for each size */
+    int blocks;			/* Jobs in each strike */
+    int usefreetype;
+    void *ftc;			/* Context for the whole font, if hinting */
+    void **workers;		/* FreeType contexts, one per worker thread */
+};
+
+static BDFChar *StrikeGlyph(struct strikes *st,SplineChar *sc,int pixelsize,int depth) {
+    void *worker = st->workers[ThreadedWorkerIndex()];
+    BDFChar *bc = NULL;
+
+    if ( !st->usefreetype ) {
+	/* Just as SplineFontAntiAlias does it */
+	if ( depth==1 )
+return( SplineCharRasterize(sc,st->layer,pixelsize) );
+	bc = SplineCharRasterize(sc,st->layer,pixelsize*(1<<(depth/2)));
+	BDFCAntiAlias(bc,1<<(depth/2));
+return( bc );
+    }
+
+    if ( !SCWorthOutputting(sc))
+return( NULL );
+    if ( st->ftc!=NULL )
+return( SplineCharFreeTypeRasterize(worker!=NULL?worker:st->ftc,sc->orig_pos,
+		pixelsize,72,depth) );
+    bc = _SplineCharFreeTypeRasterizeNoHints(worker,sc,st->layer,pixelsize,72,depth);
+    if ( bc!=NULL )
+return( bc );
+    if ( depth==1 )
+return( SplineCharRasterize(sc,st->layer,pixelsize) );
+
+return( SplineCharAntiAlias(sc,st->layer,pixelsize,(1<<(depth/2))) );
+}
+
+static void StrikeBlock(void *data,int index) {
+    struct strikes *st = data;
+    int s = index/st->blocks;
+    BDFFont *bdf = st->bdfs[s];
+    int i = (index%st->blocks)*STRIKE_BLOCK, end = i+STRIKE_BLOCK;
+
+    if ( end>bdf->glyphcnt )
+	end = bdf->glyphcnt;
+    for ( ; i<end; ++i )
+	bdf->glyphs[i] = StrikeGlyph(st,st->sf->glyphs[i],
+		st->sizes[s]&0xffff,st->sizes[s]>>16);
+}
+
+void SplineFontRasterizeStrikes(SplineFont *sf,int layer,int32 *sizes,int cnt,
+	int usefreetype,int threads,BDFFont **bdfs) {
+    struct strikes st;
+    int i;
+    void *ftc = NULL;
+    char msg[200];
+
+    if ( cnt<=0 )
+return;
+    if ( usefreetype )
+	ftc = FreeTypeFontContext(sf,NULL,NULL,layer);
+
+    if ( sf->subfontcnt!=0 || sf->multilayer || sf->strokedfont ) {
+	/* The rasterizers don't do these on several threads */
+	for ( i=0; i<cnt; ++i ) {
+	    if ( ftc!=NULL )
+		bdfs[i] = SplineFontFreeTypeRasterize(ftc,sizes[i]&0xffff,sizes[i]>>16);
+	    else if ( usefreetype )
+		bdfs[i] = SplineFontFreeTypeRasterizeNoHints(sf,layer,sizes[i]&0xffff,sizes[i]>>16);
+	    else
+		bdfs[i] = SplineFontAntiAlias(sf,layer,sizes[i]&0xffff,1<<((sizes[i]>>16)/2));
+	}
+	if ( ftc!=NULL )
+	    FreeTypeFreeContext(ftc);
+return;
+    }
+
+    memset(&st,0,sizeof(st));
+    st.sf = sf;
+    st.layer = layer;
+    st.sizes = sizes;
+    st.bdfs = bdfs;
+    st.usefreetype = usefreetype;
+    st.ftc = ftc;
+    st.blocks = (sf->glyphcnt+STRIKE_BLOCK-1)/STRIKE_BLOCK;
+    for ( i=0; i<cnt; ++i ) {
+	bdfs[i] = SplineFontToBDFHeader(sf,sizes[i]&0xffff,false);
+	memset(bdfs[i]->glyphs,0,bdfs[i]->glyphcnt*sizeof(BDFChar *));
+	if ( (sizes[i]>>16)!=1 )
+	    BDFClut(bdfs[i],1<<((sizes[i]>>16)/2));
+    }
+
+    if ( threads>cnt*st.blocks )
+	threads = cnt*st.blocks;
+    if ( threads<1 )
+	threads = 1;
+    st.workers = gcalloc(threads,sizeof(void *));
+    if ( usefreetype && threads>1 && hasFreeType()) {
+	for ( i=0; i<threads; ++i )
+	    if ( (st.workers[i] = FreeTypeContextForThread(ftc))==NULL )
+	break;
+	if ( i<threads ) {
+	    /* Can't have one each, so share the main one on one thread */
+	    while ( --i>=0 )
+		FreeTypeFreeContext(st.workers[i]);
+	    st.workers[0] = NULL;
+	    threads = 1;
+	}
+    }
+
+    strcpy(msg,_("Generating bitmap font"));
+    if ( sf->fontname!=NULL ) {
+	strcat(msg,": ");
+	strncat(msg,sf->fontname,sizeof(msg)-strlen(msg)-1);
+	msg[sizeof(msg)-1] = '\0';
+    }
+    ff_progress_start_indicator(10,_("Rasterizing..."),msg,"",cnt*st.blocks,1);
+    ff_progress_enable_stop(0);
+    ThreadedForEach(cnt*st.blocks,threads,true,StrikeBlock,&st);
+    ff_progress_end_indicator();
+
+    for ( i=0; i<threads; ++i )
+	if ( st.workers[i]!=NULL )
+	    FreeTypeFreeContext(st.workers[i]);
+    free(st.workers);
+    if ( ftc!=NULL )
+	FreeTypeFreeContext(ftc);
+}
+
 static void ByteMult(BDFChar *bc,int factor) {
     /* Internal rasterizer uses bit depth 4, but font expects 8. Correct by multiplying each byte by 17 */
     uint8 *pt, *end;
@@ -1777,11 +1982,22 @@ return(NULL);
 	bdf->glyphs[index] = SplineCharFreeTypeRasterize(bdf->freetype_context,
 		sc->orig_pos,bdf->ptsize,bdf->dpi,bdf->clut?8:1);
     else if ( bdf->recontext_freetype ) {
-	void *ft_context = FreeTypeFontContext(bdf->sf,sc,NULL,bdf->layer);
-	if ( ft_context!=NULL ) {
-	    bdf->glyphs[index] = SplineCharFreeTypeRasterize(ft_context,
+	/* Building the context may update glyphs and get us called again */
+	/*  before it is ready. Those glyphs get their own fonts */
+	if ( !bdf->recontext_tried ) {
+	    bdf->recontext_tried = true;
+	    bdf->recontext = FreeTypeFontContextIncremental(bdf->sf,bdf->layer);
+	}
+	if ( bdf->recontext!=NULL && FreeTypeContextHasGlyph(bdf->recontext,sc) )
+	    bdf->glyphs[index] = SplineCharFreeTypeRasterize(bdf->recontext,
 		    sc->orig_pos,bdf->ptsize,bdf->dpi,bdf->clut?8:1);
-	    FreeTypeFreeContext(ft_context);
+	else {
+	    void *ft_context = FreeTypeFontContext(bdf->sf,sc,NULL,bdf->layer);
+	    if ( ft_context!=NULL ) {
+		bdf->glyphs[index] = SplineCharFreeTypeRasterize(ft_context,
+			sc->orig_pos,bdf->ptsize,bdf->dpi,bdf->clut?8:1);
+		FreeTypeFreeContext(ft_context);
+	    }
 	}
     } else if ( bdf->unhinted_freetype )
 	bdf->glyphs[index] = SplineCharFreeTypeRasterizeNoHints(sc,
@@ -1811,6 +2027,19 @@ return( bdf->glyphs[index]);
 return(BDFPieceMeal(bdf,index));
 }
 
+void BDFPieceMealRegen(BDFFont *bdf, int index) {
+    /* The glyph has changed. Throw its bitmap away, and make sure it isn't */
+    /*  rasterized again from the font as it used to be */
+    if ( index<0 )
+return;
+    if ( index<bdf->glyphcnt ) {
+	BDFCharFree(bdf->glyphs[index]);
+	bdf->glyphs[index] = NULL;
+    }
+    if ( bdf->recontext!=NULL )
+	FreeTypeContextGlyphChanged(bdf->recontext,index);
+}
+
 /* Piecemeal fonts are used as the display font in the fontview, metricsview and other places*/
 /*  as such they are simple fonts (ie. we only display the current cid subfont) */
 BDFFont *SplineFontPieceMeal(SplineFont *sf,int layer,int ptsize,int dpi,
@@ -1910,6 +2139,8 @@ return;
 	free(bdf->clut);
     if ( bdf->freetype_context!=NULL )
 	FreeTypeFreeContext(bdf->freetype_context);
+    if ( bdf->recontext!=NULL )
+	FreeTypeFreeContext(bdf->recontext);
     BDFPropsFree(bdf);
     free( bdf->foundry );
     free(bdf);
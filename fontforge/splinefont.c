@@ -38,6 +38,9 @@
 #include "psfont.h"
 #include <locale.h>
 #include <stddef.h>
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
 
 
 void SFUntickAll(SplineFont *sf) {
@@ -79,8 +82,8 @@ void SFOrderBitmapList(SplineFont *sf) {
 }
 
 SplineChar *SCBuildDummy(SplineChar *dummy,SplineFont *sf,EncMap *map,int i) {
-    static char namebuf[100];
-    static Layer layers[2];
+    static ff_thread_local char namebuf[100];
+    static ff_thread_local Layer layers[2];
 
     memset(dummy,'\0',sizeof(*dummy));
     dummy->color = COLOR_DEFAULT;
@@ -770,6 +773,25 @@ return( name );
     
 #define TOC_NAME	"ff-archive-table-of-contents"
 
+/* Temporary files and directories are numbered. Fonts may be opened on */
+/*  several threads at once and each must get a name of its own */
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t tmpname_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int NextTmpNumber(int *counter) {
+    int ret;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&tmpname_lock);
+#endif
+    ret = ++*counter;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&tmpname_lock);
+#endif
+return( ret );
+}
+
 char *Unarchive(char *name, char **_archivedir) {
     char *dir = getenv("TMPDIR");
     char *pt, *archivedir, *listfile, *listcommand, *unarchivecmd, *desiredfile;
@@ -802,7 +824,7 @@ return( NULL );
 
     if ( dir==NULL ) dir = P_tmpdir;
     archivedir = galloc(strlen(dir)+100);
-    sprintf( archivedir, "%s/ffarchive-%d-%d", dir, getpid(), ++cnt );
+    sprintf( archivedir, "%s/ffarchive-%d-%d", dir, getpid(), NextTmpNumber(&cnt) );
     if ( GFileMkDir(archivedir)!=0 ) {
 	free(archivedir);
 return( NULL );
@@ -867,9 +889,8 @@ struct compressors compressors[] = {
     NULL
 };
 
-char *Decompress(char *name, int compression) {
+static char *DecompressedName(char *name) {
     char *dir = getenv("TMPDIR");
-    char buf[1500];
     char *tmpfile;
 
     if ( dir==NULL ) dir = P_tmpdir;
@@ -878,6 +899,44 @@ char *Decompress(char *name, int compression) {
     strcat(tmpfile,"/");
     strcat(tmpfile,GFileNameTail(name));
     *strrchr(tmpfile,'.') = '\0';
+return( tmpfile );
+}
+
+/* Copy an already decompressed stream into the file Decompress would make */
+static int StreamToFile(FILE *unz, char *tmpfile) {
+    FILE *out;
+    char buffer[4096];
+    int len, ok = false;
+
+    if ( (out = fopen(tmpfile,"wb"))!=NULL ) {
+	while ( (len = fread(buffer,1,sizeof(buffer),unz))>0 )
+	    fwrite(buffer,1,len,out);
+	ok = !ferror(unz);
+	if ( fclose(out)!=0 )
+	    ok = false;
+	if ( !ok )
+	    unlink(tmpfile);
+    }
+return( ok );
+}
+
+char *Decompress(char *name, int compression) {
+    char buf[1500];
+    char *tmpfile = DecompressedName(name);
+
+    if ( InProcessCompression(compression)) {
+	FILE *in, *unz;
+	int ok = false;
+	if ( (in = fopen(name,"rb"))!=NULL ) {
+	    if ( (unz = DecompressStream(in,compression))!=NULL ) {
+		ok = StreamToFile(unz,tmpfile);
+		fclose(unz);
+	    }
+	    fclose(in);
+	}
+	if ( ok )
+return( tmpfile );
+    }
 #if defined( _NO_SNPRINTF ) || defined( __VMS )
     sprintf( buf, "%s < %s > %s", compressors[compression].decomp, name, tmpfile );
 #else
@@ -895,7 +954,7 @@ static char *ForceFileToHaveName(FILE *file, char *exten) {
     FILE *newfile;
 
     forever {
-	sprintf( tmpfilename, P_tmpdir "/fontforge%d-%d", getpid(), try++ );
+	sprintf( tmpfilename, P_tmpdir "/fontforge%d-%d", getpid(), NextTmpNumber(&try) );
 	if ( exten!=NULL )
 	    strcat(tmpfilename,exten);
 	if ( access( tmpfilename, F_OK )==-1 &&
@@ -910,6 +969,25 @@ return(copy(tmpfilename));			/* The filename does not exist */
     }
 }
 
+/* Which formats can be read from a stream, rather than needing a file name */
+static int ReadableFromStream(FILE *file) {
+    int ch1 = getc(file);
+    int ch2 = getc(file);
+    int ch3 = getc(file);
+    int ch4 = getc(file);
+
+    rewind(file);
+return( ( ch1==0 && ch2==1 && ch3==0 && ch4==0 ) ||
+	    (ch1=='O' && ch2=='T' && ch3=='T' && ch4=='O') ||
+	    (ch1=='t' && ch2=='r' && ch3=='u' && ch4=='e') ||
+	    (ch1=='t' && ch2=='t' && ch3=='c' && ch4=='f') ||
+	    (ch1=='w' && ch2=='O' && ch3=='F' && ch4=='F') ||
+	    (ch1=='%' && ch2=='!') || (ch1==0x80 && ch2=='\01') ||
+	    (ch1=='%' && ch2=='P' && ch3=='D' && ch4=='F') ||
+	    (ch1==1 && ch2==0 && ch3==4) ||
+	    (ch1=='S' && ch2=='p' && ch3=='l' && ch4=='i') );
+}
+
 /* This does not check currently existing fontviews, and should only be used */
 /*  by LoadSplineFont (which does) and by RevertFile (which knows what it's doing) */
 SplineFont *_ReadSplineFont(FILE *file,char *filename,enum openflags openflags) {
@@ -918,7 +996,7 @@ SplineFont *_ReadSplineFont(FILE *file,char *filename,enum openflags openflags)
     int fromsfd = false;
     int i;
     char *pt, *ext2, *strippedname, *oldstrippedname, *tmpfile=NULL, *paren=NULL, *fullname=filename, *rparen;
-    char *archivedir=NULL;
+    char *archivedir=NULL, *unzipped=NULL;
     int len;
     int checked;
     int compression=0;
@@ -984,7 +1062,34 @@ return( NULL );
     if ( i==-1 || compressors[i].ext==NULL )
 	i=-1;
     else {
-	if ( file!=NULL ) {
+	/* Most readers will take the font from a stream, and if we can */
+	/*  decompress it ourselves we can give them one without going near */
+	/*  the file system */
+	FILE *in = file!=NULL ? file : fopen(strippedname,"rb"), *unz = NULL;
+	if ( in!=NULL && (unz = DecompressStream(in,i))!=NULL && !ReadableFromStream(unz) ) {
+	    /* We have already started decompressing it, so finish into a */
+	    /*  temporary file rather than decompressing it all over again */
+	    tmpfile = DecompressedName(strippedname);
+	    if ( !StreamToFile(unz,tmpfile) ) {
+		free(tmpfile); tmpfile = NULL;
+	    }
+	    fclose(unz); unz = NULL;
+	    rewind(in);
+	}
+	if ( in!=NULL && in!=file )
+	    fclose(in);
+	if ( unz!=NULL ) {
+	    if ( file!=NULL )
+		fclose(file);
+	    file = unz;
+	    nowlocal = false;
+	    unzipped = strippedname = copy(strippedname);
+	    *strrchr(strippedname,'.') = '\0';
+	} else if ( tmpfile!=NULL ) {
+	    if ( file!=NULL ) {
+		fclose(file); file = NULL;
+	    }
+	} else if ( file!=NULL ) {
 	    char *spuriousname = ForceFileToHaveName(file,compressors[i].ext);
 	    tmpfile = Decompress(spuriousname,i);
 	    fclose(file); file = NULL;
@@ -993,7 +1098,7 @@ return( NULL );
 	    tmpfile = Decompress(strippedname,i);
 	if ( tmpfile!=NULL ) {
 	    strippedname = tmpfile;
-	} else {
+	} else if ( unzipped==NULL ) {
 	    ff_post_error(_("Decompress Failed!"),_("Decompress Failed!"));
 return( NULL );
 	}
@@ -1039,7 +1144,7 @@ return( NULL );
 /* checked == 'F'   => sfdir */
 /* checked == 'b'   => bdf */
 /* checked == 'i'   => ikarus */
-    if ( !wasurl && GFileIsDir(strippedname) ) {
+    if ( nowlocal && GFileIsDir(strippedname) ) {
 	char *temp = galloc(strlen(strippedname)+strlen("/glyphs/contents.plist")+1);
 	strcpy(temp,strippedname);
 	strcat(temp,"/glyphs/contents.plist");
@@ -1050,7 +1155,9 @@ return( NULL );
 	    strcpy(temp,strippedname);
 	    strcat(temp,"/font.props");
 	    if ( GFileExists(temp)) {
-		sf = SFDirRead(strippedname);
+		/* An archive's directory goes away when we are done, so read */
+		/*  all of it now */
+		sf = _SFDirRead(strippedname,wasarchived?openflags&~of_lazy:openflags);
 		checked = 'F';
 	    }
 	}
@@ -1111,7 +1218,7 @@ return( NULL );
 	    sf = SFFromMF(fullname);
 #endif
 	} else if ( ch1=='S' && ch2=='p' && ch3=='l' && ch4=='i' ) {
-	    sf = _SFDRead(fullname,file); file = NULL;
+	    sf = _SFDRead(fullname,file,openflags); file = NULL;
 	    checked = 'f';
 	    fromsfd = true;
 	} else if ( ch1=='S' && ch2=='T' && ch3=='A' && ch4=='R' ) {
@@ -1132,7 +1239,7 @@ return( NULL );
 	/* good */;
     else if (( strmatch(fullname+strlen(fullname)-4, ".sfd")==0 ||
 	 strmatch(fullname+strlen(fullname)-5, ".sfd~")==0 ) && checked!='f' ) {
-	sf = SFDRead(fullname);
+	sf = _SFDRead(fullname,NULL,openflags);
 	fromsfd = true;
     } else if (( strmatch(fullname+strlen(fullname)-4, ".ttf")==0 ||
 		strmatch(fullname+strlen(strippedname)-4, ".ttc")==0 ||
@@ -1231,6 +1338,7 @@ return( NULL );
 	unlink(tmpfile);
 	free(tmpfile);
     }
+    free(unzipped);
     if ( wasarchived )
 	ArchiveCleanup(archivedir);
     if ( (openflags&of_fstypepermitted) && sf!=NULL && (sf->pfminfo.fstype&0xff)==0x0002 ) {
@@ -1406,7 +1514,7 @@ const unichar_t *_uGetModifiers(const unichar_t *fontname, const unichar_t *fami
 	const unichar_t *weight) {
     const unichar_t *pt, *fpt;
     static unichar_t regular[] = { 'R','e','g','u','l','a','r', 0 };
-    static unichar_t space[20];
+    static ff_thread_local unichar_t space[20];
     int i,j;
 
     /* URW fontnames don't match the familyname */
@@ -1828,11 +1936,10 @@ int SFPrivateGuess(SplineFont *sf,int layer, struct psdict *private,char *name,
     real snapcnt[12];
     real stemsnap[12];
     char buffer[211];
-    char *oldloc;
+    CLocaleSave oldloc;
     int ret;
 
-    oldloc = copy(setlocale(LC_NUMERIC,NULL));
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     ret = true;
 
     if ( strcmp(name,"BlueValues")==0 || strcmp(name,"OtherBlues")==0 ) {
@@ -1888,8 +1995,7 @@ int SFPrivateGuess(SplineFont *sf,int layer, struct psdict *private,char *name,
     } else
 	ret = false;
 
-    setlocale(LC_NUMERIC,oldloc);
-    free( oldloc );
+    SwitchFromCLocale(&oldloc);
 return( ret );
 }
 
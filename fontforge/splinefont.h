@@ -525,6 +525,17 @@ typedef struct kernpair {
     struct kernpair *next;
 } KernPair;
 
+/* A list of glyph classes compiled into the class each glyph belongs to */
+/*  Built when first needed, freed when the classes change, and rebuilt */
+/*  when the font's class_generation says glyphs have come or gone */
+struct glyphclassindex {
+    struct splinefont *sf;		/* Font (cidmaster) whose glyph ids we use */
+    int generation;			/* sf->class_generation when built */
+    int cnt;				/* Number of glyph ids covered */
+    int *classes;			/* -1 if the glyph is in no class */
+    unsigned int overlaps: 1;		/* Some glyph is named by several classes */
+};
+
 typedef struct kernclass {
     int first_cnt, second_cnt;		/* Count of classes for first and second chars */
     char **firsts;			/* list of a space separated list of char names */
@@ -536,6 +547,7 @@ typedef struct kernclass {
 #ifdef FONTFORGE_CONFIG_DEVICETABLES
     DeviceTable *adjusts;		/* array of first_cnt*second_cnt entries */
 #endif
+    struct glyphclassindex *firstidx, *secondidx;
     struct kernclass *next;
 } KernClass;
 
@@ -615,6 +627,7 @@ typedef struct generic_fpst {
     uint8 ticked;
     uint8 effectively_by_glyphs;
     char **nclassnames, **bclassnames, **fclassnames;
+    struct glyphclassindex *nclassidx, *bclassidx, *fclassidx;
 } FPST;
 
 enum asm_type { asm_indic, asm_context, asm_lig, asm_simple=4, asm_insert,
@@ -891,6 +904,10 @@ typedef struct enc {
     int (*fromunicode_func)(int);
     unsigned int is_temporary: 1;	/* freed when the map gets freed */
     int char_max;			/* Used by temporary encodings */
+    struct enc_revmap *unirev;		/* unicode -> encoding point, built on first use */
+    struct enc_revmap *namerev;		/* psnames -> encoding point */
+    int32 *rev_unicode;			/* The unicode array and count the maps */
+    int rev_cnt;			/*  were built from, if these change we rebuild */
 } Encoding;
 
 typedef struct namelist {
@@ -946,11 +963,14 @@ typedef struct bdffont {
     unsigned int ticked: 1;
     unsigned int unhinted_freetype: 1;
     unsigned int recontext_freetype: 1;
+    unsigned int recontext_tried: 1;
     struct bdffont *next;
     struct clut *clut;
     char *foundry;
     int res;
     void *freetype_context;
+    void *recontext;		/* whole font context for recontext_freetype, */
+				/*  glyphs changed since come from their own */
     uint16 truesize;		/* for bbsized fonts */
     int16 prop_cnt;
     int16 prop_max;		/* only used within bdfinfo dlg */
@@ -1366,7 +1386,8 @@ typedef struct splinechar {
     unsigned int unlink_rm_ovrlp_save_undo: 1;
     unsigned int inspiro: 1;
     unsigned int lig_caret_cnt_fixed: 1;
-    /* 6 bits left (one more if we ignore compositionunit below) */
+    unsigned int lazy: 1;	/* Only name, encoding & width read from the sfd so far */
+    /* 5 bits left (one more if we ignore compositionunit below) */
 #if HANYANG
     unsigned int compositionunit: 1;
     int16 jamo, varient;
@@ -1412,6 +1433,8 @@ typedef struct splinechar {
     struct glyphvariants *horiz_variants;
     struct mathkern *mathkern;
 /* End of MATH/TeX fields */
+    uint32 serial;			/* Different for every glyph made, so one made */
+					/*  where a freed glyph was isn't taken for it */
 #ifndef _NO_PYTHON
     void *python_sc_object;
     void *python_temporary;
@@ -1773,6 +1796,8 @@ typedef struct splinefont {
     int top_enc;
     uint16 desired_row_cnt, desired_col_cnt;
     struct glyphnamehash *glyphnames;
+    struct glyphunihash *glyphunis;
+    int class_generation;		/* Changed when glyphs come, go or are renamed */
     struct ttf_table {
 	uint32 tag;
 	int32 len, maxlen;
@@ -1864,6 +1889,9 @@ typedef struct splinefont {
     char *woffMetadata;
     real ufo_ascent, ufo_descent;	/* I don't know what these mean, they don't seem to correspond to any other ascent/descent pair, but retain them so round-trip ufo input/output leaves them unchanged */
 	    /* ufo_descent is negative */
+    struct sfd_lazy *lazy;		/* Where to find glyphs not yet read from an sfd file (of_lazy) */
+    struct chunkarena *arena;		/* Where its glyphs were allocated (of_arena) */
+    struct chunkarena **more_arenas;	/* Where other glyphs were (CIDFlatten), NULL terminated */
 } SplineFont;
 
 /* I am going to simplify my life and not encourage intermediate designs */
@@ -1942,7 +1970,7 @@ enum ttf_flags { ttf_flag_shortps = 1, ttf_flag_nohints = 2,
 		};
 enum ttc_flags { ttc_flag_trymerge=0x1, ttc_flag_cff=0x2 };
 enum openflags { of_fstypepermitted=1, of_askcmap=2, of_all_glyphs_in_ttc=4,
-	of_fontlint=8, of_hidewindow=0x10 };
+	of_fontlint=8, of_hidewindow=0x10, of_lazy=0x20, of_arena=0x40 };
 enum ps_flags { ps_flag_nohintsubs = 0x10000, ps_flag_noflex=0x20000,
 		    ps_flag_nohints = 0x40000, ps_flag_restrict256=0x80000,
 		    ps_flag_afm = 0x100000, ps_flag_pfm = 0x200000,
@@ -1956,6 +1984,8 @@ enum ps_flags { ps_flag_nohintsubs = 0x10000, ps_flag_noflex=0x20000,
 		    ps_flag_afmwithmarks = 0x4000000,
 		    ps_flag_noseac = 0x8000000,
 		    ps_flag_outputfontlog = 0x10000000,
+/* search the whole font for the best subroutines (slower, smaller) */
+		    ps_flag_subroutinize = 0x20000000,
 		    ps_flag_mask = (ps_flag_nohintsubs|ps_flag_noflex|
 			ps_flag_afm|ps_flag_pfm|ps_flag_tfm|ps_flag_round)
 		};
@@ -1974,6 +2004,44 @@ struct enc;
 
 extern void *chunkalloc(int size);
 extern void chunkfree(void *, int size);
+struct chunkusage {
+    int size;			/* Of each chunk */
+    long inuse;			/* Bytes of chunks allocated and not freed */
+    long reserved;		/* Bytes of slabs got from the system */
+};
+extern int ChunkUsage(struct chunkusage *usage,int max);
+struct chunkarena;
+extern struct chunkarena *ChunkArenaNew(void);
+extern struct chunkarena *ChunkArenaRef(struct chunkarena *arena);
+extern void ChunkArenaUnref(struct chunkarena *arena);
+extern void ChunkArenaClosing(struct chunkarena *arena,int refs);
+extern struct chunkarena *ChunkArenaUse(struct chunkarena *arena);
+
+#define MAX_THREADS	128
+extern int ff_threads_active;
+extern int ThreadCount(int requested);
+extern int ThreadedForEach(int cnt,int threads,int progress,
+	void (*func)(void *data,int index),void *data);
+extern int ThreadedWorkerIndex(void);
+extern void ThreadsEnterCore(void);
+extern void ThreadsLeaveCore(void);
+extern FILE *MemTmpFile(void);
+
+/* Scratch state which used to be static, one copy per thread */
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+# define ff_thread_local	__thread
+#else
+# define ff_thread_local
+#endif
+
+/* Numbers in font files are always in the C locale. Where the system has */
+/*  per-thread locales only the calling thread is switched */
+typedef struct clocalesave {
+    void *thread_locale, *c_locale;
+    char oldloc[24];
+} CLocaleSave;
+extern void SwitchToCLocale(CLocaleSave *save);
+extern void SwitchFromCLocale(CLocaleSave *save);
 
 extern char *strconcat(const char *str, const char *str2);
 extern char *strconcat3(const char *str, const char *str2, const char *str3);
@@ -2033,6 +2101,8 @@ extern struct pschars *SplineFont2ChrsSubrs2(SplineFont *sf, int nomwid,
 	struct pschars **_subrs,int layer);
 extern struct pschars *CID2ChrsSubrs2(SplineFont *cidmaster,struct fd2data *fds,
 	int flags, struct pschars **_glbls,int layer);
+extern int Type2Subroutinize(struct pschars *chrs,const int *fdsel,int fdcnt,
+	struct pschars **locals,struct pschars **glbls);
 enum bitmapformat { bf_bdf, bf_ttf, bf_sfnt_dfont, bf_sfnt_ms, bf_otb,
 	bf_nfntmacbin, /*bf_nfntdfont, */bf_fon, bf_fnt, bf_palm,
 	bf_ptype3,
@@ -2208,6 +2278,7 @@ extern void SCAddRef(SplineChar *sc,SplineChar *rsc,int layer, real xoff, real y
 extern void _SCAddRef(SplineChar *sc,SplineChar *rsc,int layer, real transform[6]);
 extern KernClass *KernClassCopy(KernClass *kc);
 extern void KernClassFreeContents(KernClass *kc);
+extern void KernClassClearIndex(KernClass *kc);
 extern void KernClassListFree(KernClass *kc);
 extern int KernClassContains(KernClass *kc, char *name1, char *name2, int ordered );
 extern void OTLookupFree(OTLookup *lookup);
@@ -2215,6 +2286,7 @@ extern void OTLookupListFree(OTLookup *lookup );
 extern FPST *FPSTCopy(FPST *fpst);
 extern void FPSTRuleContentsFree(struct fpst_rule *r, enum fpossub_format format);
 extern void FPSTClassesFree(FPST *fpst);
+extern void FPSTClearIndex(FPST *fpst);
 extern void FPSTRulesFree(struct fpst_rule *r, enum fpossub_format format, int rcnt);
 extern void FPSTFree(FPST *fpst);
 extern void ASMFree(ASM *sm);
@@ -2328,11 +2400,14 @@ extern BDFFont *SplineFontRasterize(SplineFont *sf, int layer, int pixelsize, in
 extern void BDFCAntiAlias(BDFChar *bc, int linear_scale);
 extern BDFChar *SplineCharAntiAlias(SplineChar *sc, int layer, int pixelsize,int linear_scale);
 extern BDFFont *SplineFontAntiAlias(SplineFont *sf, int layer, int pixelsize,int linear_scale);
+extern void SplineFontRasterizeStrikes(SplineFont *sf,int layer,int32 *sizes,int cnt,
+	int usefreetype,int threads,BDFFont **bdfs);
 extern struct clut *_BDFClut(int linear_scale);
 extern void BDFClut(BDFFont *bdf, int linear_scale);
 extern int BDFDepth(BDFFont *bdf);
 extern BDFChar *BDFPieceMeal(BDFFont *bdf, int index);
 extern BDFChar *BDFPieceMealCheck(BDFFont *bdf, int index);
+extern void BDFPieceMealRegen(BDFFont *bdf, int index);
 enum piecemeal_flags { pf_antialias=1, pf_bbsized=2, pf_ft_nohints=4, pf_ft_recontext=8 };
 extern BDFFont *SplineFontPieceMeal(SplineFont *sf,int layer,int ptsize, int dpi,int flags,void *freetype_context);
 extern void BDFCharFindBounds(BDFChar *bc,IBounds *bb);
@@ -2624,12 +2699,19 @@ typedef struct globalinstrct {
     StdStem  stdvw;
     StdStem  *stemsnapv;   /* StdVW excluded */
     int      stemsnapvcnt;
+
+    /* While glyphs are instructed in several threads the cvt may only be */
+    /* read. cvt_missed notes that a glyph wanted a value not yet there. */
+    int cvt_readonly;
+    int cvt_missed;
 } GlobalInstrCt;
 
 extern void InitGlobalInstrCt( GlobalInstrCt *gic,SplineFont *sf,int layer,
 	BlueData *bd );
 extern void FreeGlobalInstrCt( GlobalInstrCt *gic );
 extern void NowakowskiSCAutoInstr( GlobalInstrCt *gic,SplineChar *sc );
+extern int NowakowskiAutoInstrThreaded( GlobalInstrCt *gic,SplineChar **glyphs,
+	int cnt, int threads );
 extern void CVT_ImportPrivate(SplineFont *sf);
 
 extern void SCModifyHintMasksAdd(SplineChar *sc,int layer,StemInfo *new);
@@ -2641,7 +2723,9 @@ extern void SCFigureHintMasks(SplineChar *sc,int layer);
 extern void _SplineCharAutoHint( SplineChar *sc, int layer, BlueData *bd, struct glyphdata *gd2, int gen_undoes );
 extern void SplineCharAutoHint( SplineChar *sc,int layer, BlueData *bd);
 extern void SFSCAutoHint( SplineChar *sc,int layer,BlueData *bd);
+extern int SFAutoHintUntickedThreaded( SplineFont *sf, int layer, BlueData *bd, int threads );
 extern void SplineFontAutoHint( SplineFont *sf, int layer);
+extern void _SplineFontAutoHint( SplineFont *sf, int layer, int threads);
 extern void SplineFontAutoHintRefs( SplineFont *sf, int layer);
 extern StemInfo *HintCleanup(StemInfo *stem,int dosort,int instance_count);
 extern int SplineFontIsFlexible(SplineFont *sf,int layer, int flags);
@@ -2675,8 +2759,12 @@ extern MacFeat *SFDParseMacFeatures(FILE *sfd, char *tok);
 extern int SFDWrite(char *filename,SplineFont *sf,EncMap *map,EncMap *normal, int todir);
 extern int SFDWriteBak(SplineFont *sf,EncMap *map,EncMap *normal);
 extern SplineFont *SFDRead(char *filename);
-extern SplineFont *_SFDRead(char *filename,FILE *sfd);
+extern SplineFont *_SFDRead(char *filename,FILE *sfd,enum openflags openflags);
 extern SplineFont *SFDirRead(char *filename);
+extern SplineFont *_SFDirRead(char *filename,enum openflags openflags);
+extern void SFDLoadLazyGlyph(SplineChar *sc);
+extern void SFDLoadLazyGlyphs(SplineFont *sf);
+extern void SFDLazyFree(struct sfd_lazy *lazy);
 extern SplineChar *SFDReadOneChar(SplineFont *sf,const char *name);
 extern char *TTFGetFontName(FILE *ttf,int32 offset,int32 off2);
 extern void TTFLoadBitmaps(FILE *ttf,struct ttfinfo *info, int onlyone);
@@ -2703,6 +2791,9 @@ extern int HttpGetBuf(char *url, char *databuf, int *datalen, void *mutex);
 extern void ArchiveCleanup(char *archivedir);
 extern char *Unarchive(char *name, char **_archivedir);
 extern char *Decompress(char *name, int compression);
+extern int InProcessCompression(int compression);
+extern FILE *DecompressStream(FILE *from,int compression);
+extern int CompressStream(FILE *to,FILE *from,int compression);
 extern SplineFont *SFFromBDF(char *filename,int ispk,int toback);
 extern SplineFont *SFFromMF(char *filename);
 extern void SFCheckPSBitmap(SplineFont *sf);
@@ -2785,6 +2876,7 @@ extern int MatIsIdentity(real transform[6]);
 extern int NameToEncoding(SplineFont *sf,EncMap *map,const char *uname);
 extern void GlyphHashFree(SplineFont *sf);
 extern void SFHashGlyph(SplineFont *sf,SplineChar *sc);
+extern void SFHashUnicode(SplineFont *sf,SplineChar *sc,int uni);
 extern SplineChar *SFHashName(SplineFont *sf,const char *name);
 extern int SFFindGID(SplineFont *sf, int unienc, const char *name );
 extern int SFFindSlot(SplineFont *sf, EncMap *map, int unienc, const char *name );
@@ -2820,6 +2912,7 @@ extern void SFAddLayer(SplineFont *sf,char *name,int order2, int background);
 extern void SFLayerSetBackground(SplineFont *sf,int layer,int is_back);
 
 extern void SplineSetsRound2Int(SplineSet *spl,real factor,int inspiro,int onlysel);
+extern void _SCRound2Int(SplineChar *sc,int layer, real factor);
 extern void SCRound2Int(SplineChar *sc,int layer, real factor);
 extern int SCRoundToCluster(SplineChar *sc,int layer,int sel,bigreal within,bigreal max);
 extern int SplineSetsRemoveAnnoyingExtrema(SplineSet *ss,bigreal err);
@@ -2870,6 +2963,10 @@ extern BDFFont *SplineFontFreeTypeRasterize(void *freetypecontext,int pixelsize,
 extern BDFChar *SplineCharFreeTypeRasterize(void *freetypecontext,int gid,
 	int ptsize, int dpi,int depth);
 extern void FreeTypeFreeContext(void *freetypecontext);
+extern void *FreeTypeFontContextIncremental(SplineFont *sf,int layer);
+extern int FreeTypeContextHasGlyph(void *freetypecontext,SplineChar *sc);
+extern void FreeTypeContextGlyphChanged(void *freetypecontext,int gid);
+extern void *FreeTypeContextForThread(void *freetypecontext);
 extern SplineSet *FreeType_GridFitChar(void *single_glyph_context,
 	int enc, real ptsizey, real ptsizex, int dpi, uint16 *width,
 	SplineChar *sc, int depth, int scaled);
@@ -2877,6 +2974,8 @@ extern struct freetype_raster *FreeType_GetRaster(void *single_glyph_context,
 	int enc, real ptsizey, real ptsizex, int dpi,int depth);
 extern BDFChar *SplineCharFreeTypeRasterizeNoHints(SplineChar *sc,int layer,
 	int ptsize, int dpi,int depth);
+extern BDFChar *_SplineCharFreeTypeRasterizeNoHints(void *thread_context,
+	SplineChar *sc,int layer,int ptsize,int dpi,int depth);
 extern BDFFont *SplineFontFreeTypeRasterizeNoHints(SplineFont *sf,int layer,
 	int pixelsize,int depth);
 extern void FreeType_FreeRaster(struct freetype_raster *raster);
@@ -2940,6 +3039,8 @@ extern struct macname *FindMacSettingName(SplineFont *sf, int feat, int set);
 extern int32 UniFromEnc(int enc, Encoding *encname);
 extern int32 EncFromUni(int32 uni, Encoding *encname);
 extern int32 EncFromName(const char *name,enum uni_interp interp,Encoding *encname);
+extern int32 EncFromPSName(const char *name,Encoding *encname,int last);
+extern void EncodingRevMapsFree(Encoding *enc);
 
 extern void MatInverse(real into[6], real orig[6]);
 
@@ -3076,6 +3177,12 @@ extern void OTLookupsCopyInto(SplineFont *into_sf,SplineFont *from_sf,
 	OTLookup **from_list, OTLookup *before);
 extern struct opentype_str *ApplyTickedFeatures(SplineFont *sf,uint32 *flist, uint32 script, uint32 lang,
 	int pixelsize, SplineChar **glyphs);
+struct shaping_plan;
+extern struct shaping_plan *ShapingPlanCreate(SplineFont *sf,uint32 *flist, uint32 script,
+	uint32 lang, int precompile);
+extern struct opentype_str *ShapingPlanApply(struct shaping_plan *plan,
+	int pixelsize, SplineChar **glyphs);
+extern void ShapingPlanFree(struct shaping_plan *plan);
 extern int VerticalKernFeature(SplineFont *sf, OTLookup *otl, int ask);
 extern void SFGlyphRenameFixup(SplineFont *sf, char *old, char *new);
 
@@ -3089,6 +3196,9 @@ extern void AddNewAALTFeatures(SplineFont *sf);
 extern void SplinePointRound(SplinePoint *,real);
 
 extern int KCFindName(char *name, char **classnames, int cnt, int allow_class0 );
+extern int KCFindClass(KernClass *kc, SplineChar *sc, int second, int allow_class0 );
+extern void GlyphClassIndexFree(struct glyphclassindex *gc);
+extern int GlyphClassIndexFind(struct glyphclassindex **_gc,char **classnames,int cnt,SplineChar *sc);
 extern KernClass *SFFindKernClass(SplineFont *sf,SplineChar *first,SplineChar *last,
 	int *index,int allow_zero);
 extern KernClass *SFFindVKernClass(SplineFont *sf,SplineChar *first,SplineChar *last,
@@ -3199,6 +3309,14 @@ extern AnchorClass *SCValidateAnchors(SplineChar *sc);
 extern void SCTickValidationState(SplineChar *sc,int layer);
 extern int ValidatePrivate(SplineFont *sf);
 extern int SFValidate(SplineFont *sf, int layer, int force);
+struct validatestats {
+    int validated;		/* Glyphs which needed validating */
+    int cached;			/* Of those, the ones found in the cache */
+    double seconds;
+};
+extern int _SFValidate(SplineFont *sf, int layer, int force, int threads,
+	const char *cachefile, struct validatestats *stats);
+extern char *SFValidationCacheName(SplineFont *sf);
 extern int VSMaskFromFormat(SplineFont *sf, int layer, enum fontformat format);
 
 extern int hasspiro(void);
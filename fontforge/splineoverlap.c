@@ -97,7 +97,7 @@ typedef struct preintersection {
     struct preintersection *next;
 } PreIntersection;    
 
-static char *glyphname=NULL;
+static ff_thread_local char *glyphname=NULL;
 
 static void SOError(char *format,...) {
     va_list ap;
@@ -1776,40 +1776,117 @@ static void Validate(Monotonic *ms, Intersection *ilist) {
     }
 }
 
-static Intersection *FindIntersections(Monotonic *ms, enum overlap_type ot) {
+struct sweepm {
+    Monotonic *m;
+    int index;			/* in the linked list */
+};
+
+static int sweep_cmp(const void *_s1, const void *_s2) {
+    const struct sweepm *s1 = _s1, *s2 = _s2;
+
+    if ( s1->m->b.minx<s2->m->b.minx )
+return( -1 );
+    else if ( s1->m->b.minx>s2->m->b.minx )
+return( 1 );
+return( s1->index-s2->index );
+}
+
+static int pair_cmp(const void *_p1, const void *_p2) {
+    const int *p1 = _p1, *p2 = _p2;
+
+    if ( p1[0]!=p2[0] )
+return( p1[0]-p2[0] );
+return( p1[1]-p2[1] );
+}
+
+/* Comparing every monotonic with every other is quadratic, and a stroked */
+/*  glyph may have thousands of them. Instead sweep across the glyph in x, */
+/*  keeping a list of the monotonics whose x range includes the sweep line. */
+/*  Only those can overlap the one we've just reached. We return the pairs */
+/*  whose bounding boxes overlap in the order the old pairwise loops found */
+/*  them (by position in the linked list) because the intersections we find */
+/*  are merged with any found before and so depend slightly on the order */
+static int *FindCandidatePairs(Monotonic **mlist,int cnt,int *_pcnt) {
+    struct sweepm *order, *active;
+    int *pairs=NULL;
+    int i, j, k, acnt, pcnt=0, pmax=0;
     Monotonic *m1, *m2;
+
+    order = galloc(cnt*sizeof(struct sweepm));
+    active = galloc(cnt*sizeof(struct sweepm));
+    for ( i=0; i<cnt; ++i ) {
+	order[i].m = mlist[i];
+	order[i].index = i;
+    }
+    qsort(order,cnt,sizeof(struct sweepm),sweep_cmp);
+    acnt = 0;
+    for ( i=0; i<cnt; ++i ) {
+	m2 = order[i].m;
+	for ( j=k=0; j<acnt; ++j ) {
+	    m1 = active[j].m;
+	    if ( m1->b.maxx < m2->b.minx )
+	continue;		/* Sweep line has passed it, drop it */
+	    active[k++] = active[j];
+	    if ( m2->b.miny > m1->b.maxy || m2->b.maxy < m1->b.miny )
+	continue;		/* Can't intersect */
+	    if ( pcnt>=pmax )
+		pairs = grealloc(pairs,(pmax = 2*pmax+cnt)*2*sizeof(int));
+	    if ( active[j].index<order[i].index ) {
+		pairs[2*pcnt  ] = active[j].index;
+		pairs[2*pcnt+1] = order[i].index;
+	    } else {
+		pairs[2*pcnt  ] = order[i].index;
+		pairs[2*pcnt+1] = active[j].index;
+	    }
+	    ++pcnt;
+	}
+	acnt = k;
+	active[acnt++] = order[i];
+    }
+    free(order); free(active);
+    if ( pcnt!=0 )
+	qsort(pairs,pcnt,2*sizeof(int),pair_cmp);
+    *_pcnt = pcnt;
+return( pairs );
+}
+
+static Intersection *FindIntersections(Monotonic *ms, enum overlap_type ot) {
+    Monotonic *m1, *m2, **mlist;
     BasePoint pts[9];
     extended t1s[10], t2s[10];
     Intersection *ilist=NULL;
-    int i;
-
-    for ( m1=ms; m1!=NULL; m1=m1->linked ) {
-	for ( m2=m1->linked; m2!=NULL; m2=m2->linked ) {
-	    if ( m2->b.minx > m1->b.maxx ||
-		    m2->b.maxx < m1->b.minx ||
-		    m2->b.miny > m1->b.maxy ||
-		    m2->b.maxy < m1->b.miny )
-	continue;		/* Can't intersect */;
-	    if ( CoincidentIntersect(m1,m2,pts,t1s,t2s) ) {
+    int i, cnt, p, pcnt, *pairs;
+
+    for ( m1=ms, cnt=0; m1!=NULL; m1=m1->linked, ++cnt );
+    mlist = galloc((cnt+1)*sizeof(Monotonic *));
+    for ( m1=ms, cnt=0; m1!=NULL; m1=m1->linked )
+	mlist[cnt++] = m1;
+    pairs = FindCandidatePairs(mlist,cnt,&pcnt);
+
+    for ( p=0; p<pcnt; ++p ) {
+	m1 = mlist[pairs[2*p]];
+	m2 = mlist[pairs[2*p+1]];
+	if ( CoincidentIntersect(m1,m2,pts,t1s,t2s) ) {
+	    for ( i=0; i<4 && t1s[i]!=-1; ++i ) {
+		if ( t1s[i]>=m1->tstart && t1s[i]<=m1->tend &&
+			t2s[i]>=m2->tstart && t2s[i]<=m2->tend ) {
+		    AddPreIntersection(m1,m2,t1s[i],t2s[i],&pts[i],true);
+		}
+	    }
+	} else if ( m1->s->knownlinear || m2->s->knownlinear ) {
+	    if ( SplinesIntersect(m1->s,m2->s,pts,t1s,t2s)>0 )
 		for ( i=0; i<4 && t1s[i]!=-1; ++i ) {
 		    if ( t1s[i]>=m1->tstart && t1s[i]<=m1->tend &&
 			    t2s[i]>=m2->tstart && t2s[i]<=m2->tend ) {
-			AddPreIntersection(m1,m2,t1s[i],t2s[i],&pts[i],true);
+			AddPreIntersection(m1,m2,t1s[i],t2s[i],&pts[i],false);
 		    }
 		}
-	    } else if ( m1->s->knownlinear || m2->s->knownlinear ) {
-		if ( SplinesIntersect(m1->s,m2->s,pts,t1s,t2s)>0 )
-		    for ( i=0; i<4 && t1s[i]!=-1; ++i ) {
-			if ( t1s[i]>=m1->tstart && t1s[i]<=m1->tend &&
-				t2s[i]>=m2->tstart && t2s[i]<=m2->tend ) {
-			    AddPreIntersection(m1,m2,t1s[i],t2s[i],&pts[i],false);
-			}
-		    }
-	    } else {
-		FindMonotonicIntersection(m1,m2);
-	    }
+	} else {
+	    FindMonotonicIntersection(m1,m2);
 	}
     }
+    free(pairs);
+    free(mlist);
 
     ilist = TurnPreInter2Inter(ms);
     FigureProperMonotonicsAtIntersections(ilist);
@@ -3361,8 +3438,8 @@ SplineSet *SplineSetRemoveOverlap(SplineChar *sc, SplineSet *base,enum overlap_t
     Intersection *ilist;
     SplineSet *ret;
 
-    if ( sc!=NULL )
-	glyphname = sc->name;
+    /* glyphname is only used to make error messages more helpful */
+    glyphname = sc!=NULL ? sc->name : NULL;
 
     base = SSRemoveTiny(base);
     SSRemoveStupidControlPoints(base);
@@ -114,7 +114,9 @@ typedef struct glyphinfo {
 	struct bits {
 	    uint8 *data;
 	    int dlen;
-	    int psub_index;
+	    int psub_index;	/* -2 => not hashed yet, the subr is in pdata */
+	    uint8 *pdata;
+	    int plen;
 	} *bits;
 	uint8 wasseac;
     } *gb, *active;
@@ -127,6 +129,8 @@ typedef struct glyphinfo {
     const int *bygid;
     int justbroken;
     int instance_count;
+    int defer_subrs;		/* Don't hash bits into psubrs as we go, */
+				/*  GIHashBits does that later */
 } GlyphInfo;
 
 struct mhlist {
@@ -178,8 +182,10 @@ static void GIContentsFree(GlyphInfo *gi,SplineChar *dummynotdef) {
 	gi->psubrs[i].startstop = NULL;
     }
     for ( i=0; i<gi->glyphcnt; ++i ) {
-	for ( j=0; j<gi->gb[i].bcnt; ++j )
+	for ( j=0; j<gi->gb[i].bcnt; ++j ) {
 	    free(gi->gb[i].bits[j].data);
+	    free(gi->gb[i].bits[j].pdata);
+	}
 	free(gi->gb[i].bits);
 	gi->gb[i].bits = NULL;
 	gi->gb[i].bcnt = 0;
@@ -214,6 +220,8 @@ return;
     gi->bits[gi->bcnt].dlen = gb->pt-gb->base;
     gi->bits[gi->bcnt].data = galloc(gi->bits[gi->bcnt].dlen);
     gi->bits[gi->bcnt].psub_index = -1;
+    gi->bits[gi->bcnt].pdata = NULL;
+    gi->bits[gi->bcnt].plen = 0;
     memcpy(gi->bits[gi->bcnt].data,gb->base,gi->bits[gi->bcnt].dlen);
     gb->pt = gb->base;
     gi->justbroken = false;
@@ -232,31 +240,18 @@ static int hashfunc(uint8 *data, int len) {
 return( hash%HSH_SIZE );
 }
 
-static void BreakSubroutine(GrowBuf *gb,struct hintdb *hdb) {
-    GlyphInfo *gi;
+/* Find (or add) a potential subr with this charstring, and count one more */
+/*  use of it */
+static int PSubrIndex(GlyphInfo *gi,uint8 *data,int len) {
     struct potentialsubrs *ps;
     int hash;
     int pi;
 
-    if ( hdb==NULL )
-return;
-    gi = hdb->gi;
-    if ( gi==NULL )
-return;
-    /* The stuff before the first moveto in a glyph (the header that sets */
-    /*  the width, sets up the hints, counters, etc.) can't go into a subr */
-    if ( gi->bcnt==-1 ) {
-	gi->bcnt=0;
-	gi->justbroken = true;
-return;
-    } else if ( gi->justbroken )
-return;
-    /* Otherwise stuff everything in the growbuffer into a subr */
-    hash = hashfunc(gb->base,gb->pt-gb->base);
+    hash = hashfunc(data,len);
     ps = NULL;
     for ( pi=gi->hashed[hash]; pi!=-1; pi=gi->psubrs[pi].next ) {
 	ps = &gi->psubrs[pi];
-	if ( ps->len==gb->pt-gb->base && memcmp(ps->data,gb->base,gb->pt-gb->base)==0 )
+	if ( ps->len==len && memcmp(ps->data,data,len)==0 )
     break;
     }
     if ( pi==-1 ) {
@@ -265,9 +260,9 @@ return;
 	ps = &gi->psubrs[gi->pcnt];
 	memset(ps,0,sizeof(*ps));	/* set cnt to 0 */
 	ps->idx = gi->pcnt++;
-	ps->len = gb->pt-gb->base;
-	ps->data = galloc(ps->len);
-	memcpy(ps->data,gb->base,ps->len);
+	ps->len = len;
+	ps->data = galloc(len);
+	memcpy(ps->data,data,len);
 	ps->next = gi->hashed[hash];
 	gi->hashed[hash] = ps->idx;
 	ps->fd = gi->active->fd;
@@ -275,8 +270,39 @@ return;
     }
     if ( ps->fd!=gi->active->fd )
 	ps->fd = -1;			/* used in multiple cid sub-fonts */
-    gi->bits[gi->bcnt].psub_index = ps->idx;
     ++ps->cnt;
+return( ps->idx );
+}
+
+static void BreakSubroutine(GrowBuf *gb,struct hintdb *hdb) {
+    GlyphInfo *gi;
+    struct bits *bit;
+
+    if ( hdb==NULL )
+return;
+    gi = hdb->gi;
+    if ( gi==NULL )
+return;
+    /* The stuff before the first moveto in a glyph (the header that sets */
+    /*  the width, sets up the hints, counters, etc.) can't go into a subr */
+    if ( gi->bcnt==-1 ) {
+	gi->bcnt=0;
+	gi->justbroken = true;
+return;
+    } else if ( gi->justbroken )
+return;
+    /* Otherwise stuff everything in the growbuffer into a subr */
+    bit = &gi->bits[gi->bcnt];
+    if ( gi->defer_subrs ) {
+	/* Other glyphs may be converted at the same time as this one, and */
+	/*  the order in which subrs get added to psubrs matters. So hang on */
+	/*  to the charstring until GIHashBits can add them in glyph order */
+	bit->psub_index = -2;
+	bit->plen = gb->pt-gb->base;
+	bit->pdata = galloc(bit->plen+1);
+	memcpy(bit->pdata,gb->base,bit->plen);
+    } else
+	bit->psub_index = PSubrIndex(gi,gb->base,gb->pt-gb->base);
     gb->pt = gb->base;
     ++gi->bcnt;
     gi->justbroken = true;
@@ -3017,12 +3043,7 @@ static unsigned char *SplineChar2PS2(SplineChar *sc,int *len, int nomwid,
     HintMask *hm = NULL;
     BasePoint trans;
 
-    if ( autohint_before_generate && sc->changedsincelasthinted &&
-	    !sc->manualhints && !(flags&ps_flag_nohints))
-	SplineCharAutoHint(sc,gi->layer,NULL);
-    if ( !(flags&ps_flag_nohints) && SCNeedsSubsPts(sc,ff_otf,gi->layer))
-	SCFigureHintMasks(sc,gi->layer);
-
+    /* GIEncodeGlyphs has already done any hinting the glyph needed */
     if ( flags&ps_flag_nohints ) {
 	oldh = sc->hstem; oldv = sc->vstem;
 	hc = sc->hconflicts; vc = sc->vconflicts;
@@ -3213,6 +3234,107 @@ static void SplineFont2FullSubrs2(int flags,GlyphInfo *gi) {
 #endif	/* FONTFORGE_CONFIG_PS_REFS_GET_SUBRS */
 }
 
+struct ps2threads {
+    GlyphInfo *gi;
+    int *glyphs;		/* indices into gi->gb */
+    int nomwid, defwid;
+    struct fd2data *fds;	/* For cid-keyed fonts, nomwid/defwid are here */
+    int flags;
+};
+
+static void GIGlyph2PS2(struct ps2threads *pt,GlyphInfo *gi,int i) {
+    struct glyphbits *gb = &pt->gi->gb[i];
+
+    gi->active = gb;
+    if ( pt->fds!=NULL )
+	SplineChar2PS2(gb->sc,NULL,pt->fds[gb->fd].nomwid,pt->fds[gb->fd].defwid,
+		NULL,pt->flags,gi);
+    else
+	SplineChar2PS2(gb->sc,NULL,pt->nomwid,pt->defwid,NULL,pt->flags,gi);
+}
+
+static void GIGlyph2PS2Job(void *_pt,int index) {
+    struct ps2threads *pt = _pt;
+    GlyphInfo local;
+
+    /* Everything shared is only read now, except for the bits of the */
+    /*  current glyph, each thread needs its own of those */
+    local = *pt->gi;
+    local.bits = NULL;
+    local.bcnt = local.bmax = 0;
+    GIGlyph2PS2(pt,&local,pt->glyphs[index]);
+    free(local.bits);
+}
+
+/* Add the subrs of every glyph to psubrs, in the order they would have been */
+/*  added had we converted the glyphs one after another */
+static void GIHashBits(GlyphInfo *gi) {
+    struct glyphbits *gb;
+    int i, j;
+
+    for ( i=0; i<gi->glyphcnt; ++i ) {
+	gi->active = gb = &gi->gb[i];
+	for ( j=0; j<gb->bcnt; ++j ) if ( gb->bits[j].psub_index==-2 ) {
+	    gb->bits[j].psub_index = PSubrIndex(gi,gb->bits[j].pdata,gb->bits[j].plen);
+	    free(gb->bits[j].pdata);
+	    gb->bits[j].pdata = NULL;
+	}
+    }
+    gi->defer_subrs = false;
+}
+
+/* Convert all the glyphs in gi->gb into bits of type2 charstrings. A glyph */
+/*  which is made only of its own contours can be converted without looking */
+/*  at any other glyph, so we do those in parallel. Everything else happens */
+/*  one glyph at a time in glyph order: hinting, and converting glyphs with */
+/*  references, which read (and briefly change) the glyphs they refer to. */
+/*  The only lasting change converting a glyph makes that another glyph can */
+/*  see is the numbering of its hints, so we number those in order too. The */
+/*  subrs are found at the end, again in glyph order, and so the output does */
+/*  not depend on how many threads we used */
+static void GIEncodeGlyphs(GlyphInfo *gi,int nomwid,int defwid,
+	struct fd2data *fds,int flags) {
+    struct ps2threads pt;
+    SplineChar *sc, *scs[MmMax];
+    int i, cnt, threads;
+
+    memset(&pt,0,sizeof(pt));
+    pt.gi = gi;
+    pt.nomwid = nomwid; pt.defwid = defwid;
+    pt.fds = fds;
+    pt.flags = flags;
+    pt.glyphs = galloc((gi->glyphcnt+1)*sizeof(int));
+    gi->defer_subrs = true;
+
+    threads = ThreadCount(0);
+    cnt = 0;
+    for ( i=0; i<gi->glyphcnt; ++i ) {
+	if ( (sc=gi->gb[i].sc)==NULL )
+    continue;
+	if ( autohint_before_generate && sc->changedsincelasthinted &&
+		!sc->manualhints && !(flags&ps_flag_nohints))
+	    SplineCharAutoHint(sc,gi->layer,NULL);
+	if ( !(flags&ps_flag_nohints) && SCNeedsSubsPts(sc,ff_otf,gi->layer))
+	    SCFigureHintMasks(sc,gi->layer);
+	if ( threads>1 && sc->layers[gi->layer].refs==NULL ) {
+	    scs[0] = sc;
+	    NumberHints(scs,1);
+	    pt.glyphs[cnt++] = i;
+	} else {
+	    GIGlyph2PS2(&pt,gi,i);
+	    ff_progress_next();
+	}
+    }
+    if ( cnt>0 && !ThreadedForEach(cnt,threads,true,GIGlyph2PS2Job,&pt) ) {
+	/* Cancelled. But we've got to produce something for every glyph */
+	for ( i=0; i<cnt; ++i )
+	    if ( gi->gb[pt.glyphs[i]].bits==NULL )
+		GIGlyph2PS2(&pt,gi,pt.glyphs[i]);
+    }
+    GIHashBits(gi);
+    free(pt.glyphs);
+}
+
 struct pschars *SplineFont2ChrsSubrs2(SplineFont *sf, int nomwid, int defwid,
 	const int *bygid, int cnt, int flags, struct pschars **_subrs, int layer) {
     struct pschars *subrs, *chrs;
@@ -3260,14 +3382,7 @@ struct pschars *SplineFont2ChrsSubrs2(SplineFont *sf, int nomwid, int defwid,
     }
     MarkTranslationRefs(sf,layer);
     SplineFont2FullSubrs2(flags,&gi);
-
-    for ( i=0; i<cnt; ++i ) {
-	if ( (sc = gi.gb[i].sc)==NULL )
-    continue;
-	gi.active = &gi.gb[i];
-	SplineChar2PS2(sc,NULL,nomwid,defwid,NULL,flags,&gi);
-	ff_progress_next();
-    }
+    GIEncodeGlyphs(&gi,nomwid,defwid,NULL,flags);
 
     for ( i=scnt=0; i<gi.pcnt; ++i ) {
 	/* A subroutine call takes somewhere between 2 and 4 bytes itself. */
@@ -3302,7 +3417,7 @@ struct pschars *SplineFont2ChrsSubrs2(SplineFont *sf, int nomwid, int defwid,
     chrs->cnt = cnt;
     chrs->next = cnt;
     chrs->lens = galloc(cnt*sizeof(int));
-    chrs->values = galloc(cnt*sizeof(unsigned char *));
+    chrs->values = gcalloc(cnt,sizeof(unsigned char *));
     chrs->keys = galloc(cnt*sizeof(char *));
     for ( i=0; i<cnt; ++i ) {
 	int len=0;
@@ -3406,6 +3521,8 @@ struct pschars *SplineFont2ChrsSubrs2(SplineFont *sf, int nomwid, int defwid,
 	}
     }
     
+    if ( flags&ps_flag_subroutinize )
+	Type2Subroutinize(chrs,NULL,1,&subrs,NULL);
     GIFree(&gi,&dummynotdef);
     *_subrs = subrs;
 return( chrs );
@@ -3489,12 +3606,10 @@ struct pschars *CID2ChrsSubrs2(SplineFont *cidmaster,struct fd2data *fds,
 	}
 	if ( sc!=NULL ) {
 	    sc->lsidebearing = 0x7fff;
-	    gi.active = &gi.gb[cnt];
 	    sc->ttf_glyph = cnt++;
-	    SplineChar2PS2(sc,NULL,fds[i].nomwid,fds[i].defwid,NULL,flags,&gi);
 	}
-	ff_progress_next();
     }
+    GIEncodeGlyphs(&gi,0,0,fds,flags);
 
     scnts = gcalloc( cidmaster->subfontcnt+1,sizeof(int));
     for ( i=0; i<gi.pcnt; ++i ) {
@@ -3613,6 +3728,18 @@ struct pschars *CID2ChrsSubrs2(SplineFont *cidmaster,struct fd2data *fds,
 	chrs->values[i][len++] = 14;	/* endchar */
 	chrs->values[i][len] = '\0';
     }
+    if ( flags&ps_flag_subroutinize ) {
+	int *fdsel = galloc(cnt*sizeof(int));
+	struct pschars **locals = galloc(cidmaster->subfontcnt*sizeof(struct pschars *));
+	for ( i=0; i<cnt; ++i )
+	    fdsel[i] = gi.gb[i].fd;
+	for ( fd=0; fd<cidmaster->subfontcnt; ++fd )
+	    locals[fd] = fds[fd].subrs;
+	Type2Subroutinize(chrs,fdsel,cidmaster->subfontcnt,locals,&glbls);
+	for ( fd=0; fd<cidmaster->subfontcnt; ++fd )
+	    fds[fd].subrs = locals[fd];
+	free(locals); free(fdsel);
+    }
     GIFree(&gi,&dummynotdef);
     *_glbls = glbls;
 return( chrs );
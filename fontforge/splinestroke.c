@@ -98,7 +98,7 @@ typedef struct strokecontext {
     real inverse[6];
 } StrokeContext;
 
-static char *glyphname=NULL;
+static ff_thread_local char *glyphname=NULL;
 
 /* Basically the idea is we find the spline, and then at each point, project */
 /*  out normal to the current slope and find a point that is radius units away*/
@@ -49,7 +49,6 @@ typedef struct quartic {
 /*  into splinefont.h after (or instead of) the definition of chunkalloc()*/
 
 #ifndef chunkalloc
-#define ALLOC_CHUNK	100		/* Number of small chunks to malloc at a time */
 #if !defined(FONTFORGE_CONFIG_USE_LONGDOUBLE) && !defined(FONTFORGE_CONFIG_USE_DOUBLE)
 # define CHUNK_MAX	100		/* Maximum size (in chunk units) that we are prepared to allocate */
 					/* The size of our data structures */
@@ -60,39 +59,453 @@ typedef struct quartic {
 					/*  the machine. if pointers are 64 bits*/
 					/*  we may need twice as much space as for 32 bits */
 
-#ifdef FLAG
-#undef FLAG
-#define FLAG 0xbadcafe
+/* Chunks of each size are carved out of slabs, aligned blocks of SLAB_SIZE */
+/*  bytes each holding chunks of one size. Each thread keeps a short free */
+/*  list of every size, so most allocations and frees don't need a lock. */
+/*  When a thread's list is empty it takes a batch from the slabs, when it */
+/*  gets too long it gives a batch back. A slab with none of its chunks in */
+/*  use is given back to the system (but we keep one spare of each size) */
+/* Some callers chunkfree things they galloced. Those can't go back to a */
+/*  slab so we keep them on a list of their own and reuse them */
+/* A font read from disk may have an arena of its own. While we read its */
+/*  glyphs their chunks come from slabs belonging to the arena, and chunks */
+/*  freed back to them are only reused by it. When the last font using the */
+/*  arena goes all its slabs go at once, and while that font is being torn */
+/*  down (the arena is dying) freeing its chunks one by one does nothing */
+#define SLAB_SHIFT	16
+#define SLAB_SIZE	(1<<SLAB_SHIFT)
+#define SLAB_HEADER	((sizeof(struct chunkslab)+15)&~15)
+#define CHUNK_BATCH(index)	((index)<=8 ? 64 : (index)<=64 ? 512/(index) : 8)
+
+struct chunk { struct chunk *next; };
+
+struct chunkslab {
+    struct chunkslab *prev, *next;	/* Slabs of this size with chunks to spare */
+    struct chunk *free;			/* Chunks given back to this slab */
+    char *fresh, *end;			/* Chunks never handed out yet */
+    void *block;			/* What we got from malloc */
+    int index;				/* Size of chunks (in chunk units) */
+    int used;				/* Chunks handed out to threads */
+    struct chunkarena *arena;		/* Or NULL if it is shared by everyone */
+    struct chunkslab *anext;		/* All slabs of the arena */
+    unsigned int listed: 1;
+    unsigned int mapped: 1;
+};
+
+struct chunkclass {
+    struct chunkslab *spare;		/* Slabs with chunks to spare */
+    struct chunk *foreign;		/* Chunks which didn't come from a slab */
+    int spare_cnt;
+    int slabs;
+    long used;				/* Chunks handed out to threads */
+};
+static struct chunkclass chunkclasses[CHUNK_MAX];
+
+static struct chunkcache {
+    struct chunk *free[CHUNK_MAX];
+    int cnt[CHUNK_MAX];
+    struct chunkcache *next;
+} *chunkcaches;
+static ff_thread_local struct chunkcache *chunkcache;
+
+/* A bitmap of the addresses of our slabs, so chunkfree can tell whether */
+/*  an item came from one. Two levels as the address space is big */
+#define SLABMAP_BITS	16
+static uint32 *slabmap[1<<SLABMAP_BITS];
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+static pthread_mutex_t chunk_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t chunk_key;
+static pthread_once_t chunk_key_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t slabmap_lock = PTHREAD_MUTEX_INITIALIZER;
+# define CHUNK_LOCK()	pthread_mutex_lock(&chunk_lock)
+# define CHUNK_UNLOCK()	pthread_mutex_unlock(&chunk_lock)
+# define ARENA_LOCK(arena)	pthread_mutex_lock(&(arena)->lock)
+# define ARENA_UNLOCK(arena)	pthread_mutex_unlock(&(arena)->lock)
+#else
+# define CHUNK_LOCK()
+# define CHUNK_UNLOCK()
+# define ARENA_LOCK(arena)
+# define ARENA_UNLOCK(arena)
 #endif
 
+struct chunkarena {
+    struct chunkclass classes[CHUNK_MAX];
+    struct chunkslab *slabs;
+    struct chunkarena *next;
+    int refcnt;
+    unsigned int dying: 1;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;
+#endif
+};
+static struct chunkarena *chunkarenas;
+static ff_thread_local struct chunkarena *chunkarena;	/* Where this thread's chunks come from, if not the slabs everyone shares */
+
 #ifdef CHUNKDEBUG
 static int chunkdebug = 0;	/* When this is set we never free anything, insuring that each chunk is unique */
 #endif
 
-#if ALLOC_CHUNK>1
-struct chunk { struct chunk *next; };
-struct chunk2 { struct chunk2 *next; int flag; };
-static struct chunk *chunklists[CHUNK_MAX] = { 0 };
+/* Arenas make slabs without holding the chunk lock, so writers of the map */
+/*  have a lock of their own. Readers (every chunkfree) take no lock: the */
+/*  second level maps are published with a release store and never freed, */
+/*  and the bit for a slab can't change while any chunk of it is live, so */
+/*  an acquire load sees the right answer for anything being freed */
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+# define SLABMAP_LOAD(p)	__atomic_load_n(&(p),__ATOMIC_ACQUIRE)
+# define SLABMAP_STORE(p,v)	__atomic_store_n(&(p),(v),__ATOMIC_RELEASE)
+# define SLABMAP_OR(p,v)	__atomic_fetch_or(&(p),(v),__ATOMIC_RELEASE)
+# define SLABMAP_AND(p,v)	__atomic_fetch_and(&(p),(v),__ATOMIC_RELEASE)
+# define SLABMAP_READ_LOCK()
+# define SLABMAP_READ_UNLOCK()
+#else
+# define SLABMAP_LOAD(p)	(p)
+# define SLABMAP_STORE(p,v)	((p) = (v))
+# define SLABMAP_OR(p,v)	((p) |= (v))
+# define SLABMAP_AND(p,v)	((p) &= (v))
+# ifdef HAVE_PTHREAD_H		/* No atomics, so readers must lock too */
+#  define SLABMAP_READ_LOCK()	pthread_mutex_lock(&slabmap_lock)
+#  define SLABMAP_READ_UNLOCK()	pthread_mutex_unlock(&slabmap_lock)
+# else
+#  define SLABMAP_READ_LOCK()
+#  define SLABMAP_READ_UNLOCK()
+# endif
+#endif
+
+static int SlabMap(struct chunkslab *slab,int set) {
+    uintptr_t slabno = ((uintptr_t) slab)>>SLAB_SHIFT;
+    uint32 **map = &slabmap[slabno>>SLABMAP_BITS], *level;
+    int bit = slabno&((1<<SLABMAP_BITS)-1);
+
+    if ( (slabno>>SLABMAP_BITS)>=(1<<SLABMAP_BITS) )
+return( false );
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&slabmap_lock);
+#endif
+    if ( (level = *map)==NULL && set ) {
+	level = gcalloc((1<<SLABMAP_BITS)/32,sizeof(uint32));
+	SLABMAP_STORE(*map,level);
+    }
+    if ( level==NULL )
+	set = false;
+    else if ( set )
+	SLABMAP_OR(level[bit>>5],(uint32) 1<<(bit&31));
+    else
+	SLABMAP_AND(level[bit>>5],~((uint32) 1<<(bit&31)));
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&slabmap_lock);
+#endif
+return( set );
+}
+
+static struct chunkslab *SlabOf(void *item) {
+    uintptr_t slabno = ((uintptr_t) item)>>SLAB_SHIFT;
+    uint32 *map;
+    int bit = slabno&((1<<SLABMAP_BITS)-1), found;
+
+    if ( (slabno>>SLABMAP_BITS)>=(1<<SLABMAP_BITS) )
+return( NULL );
+    SLABMAP_READ_LOCK();
+    found = (map = SLABMAP_LOAD(slabmap[slabno>>SLABMAP_BITS]))!=NULL &&
+	    (SLABMAP_LOAD(map[bit>>5])&((uint32) 1<<(bit&31)));
+    SLABMAP_READ_UNLOCK();
+    if ( !found )
+return( NULL );
+return( (struct chunkslab *) (slabno<<SLAB_SHIFT) );
+}
+
+static void SlabList(struct chunkclass *cl,struct chunkslab *slab) {
+    slab->prev = NULL;
+    slab->next = cl->spare;
+    if ( cl->spare!=NULL )
+	cl->spare->prev = slab;
+    cl->spare = slab;
+    slab->listed = true;
+    ++cl->spare_cnt;
+}
+
+static void SlabUnlist(struct chunkclass *cl,struct chunkslab *slab) {
+    if ( slab->prev!=NULL )
+	slab->prev->next = slab->next;
+    else
+	cl->spare = slab->next;
+    if ( slab->next!=NULL )
+	slab->next->prev = slab->prev;
+    slab->listed = false;
+    --cl->spare_cnt;
+}
+
+static struct chunkslab *SlabNew(struct chunkclass *cl,int index) {
+    struct chunkslab *slab;
+    void *block;
+
+#if defined(__MINGW32__)
+    if ( (block = malloc(2*SLAB_SIZE))==NULL )
+return( NULL );
+    slab = (struct chunkslab *) ((((uintptr_t) block)+SLAB_SIZE-1)&~(uintptr_t) (SLAB_SIZE-1));
+#else
+    if ( posix_memalign(&block,SLAB_SIZE,SLAB_SIZE)!=0 )
+return( NULL );
+    slab = block;
 #endif
+    memset(slab,0,sizeof(struct chunkslab));
+    slab->block = block;
+    slab->index = index;
+    slab->fresh = ((char *) slab) + SLAB_HEADER;
+    slab->end = ((char *) slab) + SLAB_SIZE;
+    /* If we can't map it its chunks will look foreign when freed, which */
+    /*  is safe. The slab just never goes back */
+    slab->mapped = SlabMap(slab,true);
+    SlabList(cl,slab);
+    ++cl->slabs;
+return( slab );
+}
+
+static void SlabRelease(struct chunkclass *cl,struct chunkslab *slab) {
+    if ( slab->listed )
+	SlabUnlist(cl,slab);
+    SlabMap(slab,false);
+    --cl->slabs;
+    free(slab->block);
+}
+
+static void ChunkCacheFree(void *_cc);
+
+static void ChunkKeyInit(void) {
+#ifdef HAVE_PTHREAD_H
+    pthread_key_create(&chunk_key,ChunkCacheFree);
+#endif
+}
+
+static struct chunkcache *ChunkCache(void) {
+    struct chunkcache *cc = chunkcache;
+
+    if ( cc==NULL ) {
+	cc = gcalloc(1,sizeof(struct chunkcache));
+	CHUNK_LOCK();
+	cc->next = chunkcaches;
+	chunkcaches = cc;
+	CHUNK_UNLOCK();
+#ifdef HAVE_PTHREAD_H
+	/* So that we get the chunks back when the thread goes away */
+	pthread_once(&chunk_key_once,ChunkKeyInit);
+	pthread_setspecific(chunk_key,cc);
+#endif
+	chunkcache = cc;
+    }
+return( cc );
+}
+
+/* Give a thread's spare chunks of one size back to their slabs, until it */
+/*  has no more than keep. Must hold the lock */
+static void ChunkFlush(struct chunkcache *cc,int index,int keep) {
+    struct chunk *item;
+    struct chunkslab *slab;
+    struct chunkclass *cl;
+
+    while ( cc->cnt[index]>keep ) {
+	item = cc->free[index];
+	cc->free[index] = item->next;
+	--cc->cnt[index];
+	if ( (slab = SlabOf(item))==NULL ) {
+	    /* From a slab we couldn't map */
+	    item->next = chunkclasses[index].foreign;
+	    chunkclasses[index].foreign = item;
+	    --chunkclasses[index].used;
+    continue;
+	}
+	cl = &chunkclasses[slab->index];
+	item->next = slab->free;
+	slab->free = item;
+	--cl->used;
+	if ( !slab->listed )
+	    SlabList(cl,slab);
+	if ( --slab->used==0 && cl->spare_cnt>1 )
+	    SlabRelease(cl,slab);
+    }
+}
+
+static void ChunkRefill(struct chunkcache *cc,int index) {
+    struct chunkclass *cl = &chunkclasses[index];
+    struct chunkslab *slab;
+    struct chunk *item;
+    int size = index*CHUNK_UNIT, want = CHUNK_BATCH(index), got = 0;
 
-#if defined(FLAG) && ALLOC_CHUNK>1
-void chunktest(void) {
+    CHUNK_LOCK();
+    while ( got<want ) {
+	if ( (slab = cl->spare)==NULL && (slab = SlabNew(cl,index))==NULL )
+    break;
+	while ( got<want && slab->free!=NULL ) {
+	    item = slab->free;
+	    slab->free = item->next;
+	    item->next = cc->free[index];
+	    cc->free[index] = item;
+	    ++slab->used; ++got;
+	}
+	while ( got<want && slab->fresh+size<=slab->end ) {
+	    item = (struct chunk *) slab->fresh;
+	    slab->fresh += size;
+	    item->next = cc->free[index];
+	    cc->free[index] = item;
+	    ++slab->used; ++got;
+	}
+	if ( slab->free==NULL && slab->fresh+size>slab->end )
+	    SlabUnlist(cl,slab);
+    }
+    cl->used += got;
+    CHUNK_UNLOCK();
+    cc->cnt[index] += got;
+}
+
+static void ChunkCacheFree(void *_cc) {
+    struct chunkcache *cc = _cc, *prev;
     int i;
-    struct chunk2 *c;
 
-    for ( i=2; i<CHUNK_MAX; ++i )
-	for ( c=(struct chunk2 *) chunklists[i]; c!=NULL; c=c->next )
-	    if ( c->flag!=FLAG ) {
-		fprintf( stderr, "Chunk memory list has been corrupted\n" );
-		abort();
-	    }
+    CHUNK_LOCK();
+    for ( i=0; i<CHUNK_MAX; ++i )
+	ChunkFlush(cc,i,0);
+    if ( chunkcaches==cc )
+	chunkcaches = cc->next;
+    else {
+	for ( prev=chunkcaches; prev->next!=cc; prev=prev->next );
+	prev->next = cc->next;
+    }
+    CHUNK_UNLOCK();
+    free(cc);
 }
+
+static void *ChunkForeign(int index) {
+    struct chunk *item;
+
+    CHUNK_LOCK();
+    if ( (item = chunkclasses[index].foreign)!=NULL )
+	chunkclasses[index].foreign = item->next;
+    CHUNK_UNLOCK();
+return( item );
+}
+
+static void *ArenaAlloc(struct chunkarena *arena,int index) {
+    struct chunkclass *cl = &arena->classes[index];
+    struct chunkslab *slab;
+    struct chunk *item = NULL;
+    int size = index*CHUNK_UNIT;
+
+    ARENA_LOCK(arena);
+    if ( (slab = cl->spare)==NULL && (slab = SlabNew(cl,index))!=NULL ) {
+	if ( !slab->mapped ) {
+	    /* Its chunks would look foreign when freed and outlive the arena */
+	    SlabRelease(cl,slab);
+	    slab = NULL;
+	} else {
+	    slab->arena = arena;
+	    slab->anext = arena->slabs;
+	    arena->slabs = slab;
+	}
+    }
+    if ( slab!=NULL ) {
+	if ( slab->free!=NULL ) {
+	    item = slab->free;
+	    slab->free = item->next;
+	} else {
+	    item = (struct chunk *) slab->fresh;
+	    slab->fresh += size;
+	}
+	++slab->used; ++cl->used;
+	if ( slab->free==NULL && slab->fresh+size>slab->end )
+	    SlabUnlist(cl,slab);
+    }
+    ARENA_UNLOCK(arena);
+return( item );
+}
+
+static void ArenaFree(struct chunkslab *slab,struct chunk *item) {
+    struct chunkarena *arena = slab->arena;
+    struct chunkclass *cl = &arena->classes[slab->index];
+
+    if ( arena->dying )
+return;
+    ARENA_LOCK(arena);
+    item->next = slab->free;
+    slab->free = item;
+    --slab->used; --cl->used;
+    if ( !slab->listed )
+	SlabList(cl,slab);
+    ARENA_UNLOCK(arena);
+}
+
+struct chunkarena *ChunkArenaNew(void) {
+    struct chunkarena *arena = gcalloc(1,sizeof(struct chunkarena));
+
+    arena->refcnt = 1;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&arena->lock,NULL);
+#endif
+    CHUNK_LOCK();
+    arena->next = chunkarenas;
+    chunkarenas = arena;
+    CHUNK_UNLOCK();
+return( arena );
+}
+
+struct chunkarena *ChunkArenaRef(struct chunkarena *arena) {
+    if ( arena!=NULL ) {
+	ARENA_LOCK(arena);
+	++arena->refcnt;
+	ARENA_UNLOCK(arena);
+    }
+return( arena );
+}
+
+void ChunkArenaUnref(struct chunkarena *arena) {
+    struct chunkarena *prev;
+    struct chunkslab *slab, *next;
+    int last;
+
+    if ( arena==NULL )
+return;
+    ARENA_LOCK(arena);
+    last = --arena->refcnt==0;
+    ARENA_UNLOCK(arena);
+    if ( !last )
+return;
+    CHUNK_LOCK();
+    if ( chunkarenas==arena )
+	chunkarenas = arena->next;
+    else {
+	for ( prev=chunkarenas; prev->next!=arena; prev=prev->next );
+	prev->next = arena->next;
+    }
+    CHUNK_UNLOCK();
+    for ( slab=arena->slabs; slab!=NULL; slab=next ) {
+	next = slab->anext;
+	SlabMap(slab,false);
+	free(slab->block);
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&arena->lock);
 #endif
+    free(arena);
+}
+
+/* Someone is about to free everything which holds refs of the arena. If */
+/*  no one else holds any then anything they free goes with the arena */
+void ChunkArenaClosing(struct chunkarena *arena,int refs) {
+    if ( arena!=NULL && arena->refcnt<=refs )
+	arena->dying = true;
+}
+
+/* Make chunkalloc on this thread use the arena (or the shared slabs when */
+/*  NULL). Returns what it used before */
+struct chunkarena *ChunkArenaUse(struct chunkarena *arena) {
+    struct chunkarena *old = chunkarena;
+
+    chunkarena = arena;
+return( old );
+}
 
 void *chunkalloc(int size) {
-# if ALLOC_CHUNK<=1
-return( gcalloc(1,size));
-# else
+    struct chunkcache *cc;
     struct chunk *item;
     int index;
 
@@ -103,43 +516,36 @@ return( gcalloc(1,size));
 	fprintf( stderr, "Attempt to allocate something of size %d\n", size );
 return( gcalloc(1,size));
     }
-#ifdef FLAG
-    chunktest();
-#endif
-    index = (size+CHUNK_UNIT-1)/CHUNK_UNIT;
-    if ( chunklists[index]==NULL ) {
-	char *pt, *end;
-	pt = galloc(ALLOC_CHUNK*size);
-	chunklists[index] = (struct chunk *) pt;
-	end = pt+(ALLOC_CHUNK-1)*size;
-	while ( pt<end ) {
-	    ((struct chunk *) pt)->next = (struct chunk *) (pt + size);
-#ifdef FLAG
-	    ((struct chunk2 *) pt)->flag = FLAG;
-#endif
-	    pt += size;
-	}
-	((struct chunk *) pt)->next = NULL;
-#ifdef FLAG
-	((struct chunk2 *) pt)->flag = FLAG;
-#endif
+    index = size/CHUNK_UNIT;
+    if ( chunkarena!=NULL && (item = ArenaAlloc(chunkarena,index))!=NULL ) {
+	memset(item,'\0',size);
+return( item );
     }
-    item = chunklists[index];
-    chunklists[index] = item->next;
+    if ( chunkclasses[index].foreign!=NULL && (item = ChunkForeign(index))!=NULL ) {
+	memset(item,'\0',size);
+return( item );
+    }
+    cc = ChunkCache();
+    if ( cc->free[index]==NULL ) {
+	ChunkRefill(cc,index);
+	if ( cc->free[index]==NULL )
+return( gcalloc(1,size));
+    }
+    item = cc->free[index];
+    cc->free[index] = item->next;
+    --cc->cnt[index];
     memset(item,'\0',size);
 return( item );
-# endif
 }
 
 void chunkfree(void *item,int size) {
     int index = (size+CHUNK_UNIT-1)/CHUNK_UNIT;
+    struct chunkcache *cc;
+    struct chunkslab *slab;
 #ifdef CHUNKDEBUG
     if ( chunkdebug )
 return;
 #endif
-# if ALLOC_CHUNK<=1
-    free(item);
-# else
     if ( item==NULL )
 return;
 
@@ -149,26 +555,56 @@ return;
     if ( (size&(CHUNK_UNIT-1)) || size>=CHUNK_MAX*CHUNK_UNIT || size<=sizeof(struct chunk)) {
 	fprintf( stderr, "Attempt to free something of size %d\n", size );
 	free(item);
+    } else if ( (slab = SlabOf(item))==NULL ) {
+	CHUNK_LOCK();
+	((struct chunk *) item)->next = chunkclasses[index].foreign;
+	chunkclasses[index].foreign = item;
+	CHUNK_UNLOCK();
+    } else if ( slab->arena!=NULL ) {
+	ArenaFree(slab,item);
     } else {
-#ifdef LOCAL_DEBUG
-	if ( (char *) (chunklists[index]) == (char *) item ||
-		( ((char *) (chunklists[index]))<(char *) item &&
-		  ((char *) (chunklists[index]))+size>(char *) item) ||
-		( ((char *) (chunklists[index]))>(char *) item &&
-		  ((char *) (chunklists[index]))<((char *) item)+size))
-	      IError( "Memory mixup. Chunk list is wrong!!!" );
-#endif
-	((struct chunk *) item)->next = chunklists[index];
-#  ifdef FLAG
-	if ( size>=sizeof(struct chunk2))
-	    ((struct chunk2 *) item)->flag = FLAG;
-#  endif
-	chunklists[index] = (struct chunk *) item;
-    }
-#  ifdef FLAG
-    chunktest();
-#  endif
-# endif
+	/* The slab knows how big the chunk really is */
+	index = slab->index;
+	cc = ChunkCache();
+	((struct chunk *) item)->next = cc->free[index];
+	cc->free[index] = item;
+	if ( ++cc->cnt[index]>2*CHUNK_BATCH(index) ) {
+	    CHUNK_LOCK();
+	    ChunkFlush(cc,index,CHUNK_BATCH(index));
+	    CHUNK_UNLOCK();
+	}
+    }
+}
+
+/* Fills in what is in use, and what we have got from the system, for each */
+/*  size of chunk we've allocated. Returns the number of sizes */
+int ChunkUsage(struct chunkusage *usage,int max) {
+    struct chunkcache *cc;
+    struct chunkarena *arena;
+    long used, slabs;
+    int i, cnt=0;
+
+    CHUNK_LOCK();
+    for ( i=0; i<CHUNK_MAX && cnt<max; ++i ) {
+	used = chunkclasses[i].used;
+	slabs = chunkclasses[i].slabs;
+	for ( cc=chunkcaches; cc!=NULL; cc=cc->next )
+	    used -= cc->cnt[i];
+	for ( arena=chunkarenas; arena!=NULL; arena=arena->next ) {
+	    ARENA_LOCK(arena);
+	    used += arena->classes[i].used;
+	    slabs += arena->classes[i].slabs;
+	    ARENA_UNLOCK(arena);
+	}
+	if ( slabs==0 )
+    continue;
+	usage[cnt].size = i*CHUNK_UNIT;
+	usage[cnt].inuse = used*i*CHUNK_UNIT;
+	usage[cnt].reserved = slabs*SLAB_SIZE;
+	++cnt;
+    }
+    CHUNK_UNLOCK();
+return( cnt );
 }
 #endif
 
@@ -5829,6 +6265,7 @@ FPST *FPSTCopy(FPST *fpst) {
     nfpst = chunkalloc(sizeof(FPST));
     *nfpst = *fpst;
     nfpst->next = NULL;
+    nfpst->nclassidx = nfpst->bclassidx = nfpst->fclassidx = NULL;
     if ( nfpst->nccnt!=0 ) {
 	nfpst->nclass = galloc(nfpst->nccnt*sizeof(char *));
 	nfpst->nclassnames = galloc(nfpst->nccnt*sizeof(char *));
@@ -5857,9 +6294,30 @@ FPST *FPSTCopy(FPST *fpst) {
 return( nfpst );
 }
 
+void GlyphClassIndexFree(struct glyphclassindex *gc) {
+    if ( gc==NULL )
+return;
+    free(gc->classes);
+    chunkfree(gc,sizeof(struct glyphclassindex));
+}
+
+void FPSTClearIndex(FPST *fpst) {
+    GlyphClassIndexFree(fpst->nclassidx);
+    GlyphClassIndexFree(fpst->bclassidx);
+    GlyphClassIndexFree(fpst->fclassidx);
+    fpst->nclassidx = fpst->bclassidx = fpst->fclassidx = NULL;
+}
+
+void KernClassClearIndex(KernClass *kc) {
+    GlyphClassIndexFree(kc->firstidx);
+    GlyphClassIndexFree(kc->secondidx);
+    kc->firstidx = kc->secondidx = NULL;
+}
+
 void FPSTClassesFree(FPST *fpst) {
     int i;
 
+    FPSTClearIndex(fpst);
     for ( i=0; i<fpst->nccnt; ++i ) {
 	free(fpst->nclass[i]);
 	free(fpst->nclassnames[i]);
@@ -5945,10 +6403,19 @@ void LayerDefault(Layer *layer) {
 #endif
 }
 
+static uint32 glyph_serial;
+
 SplineChar *SplineCharCreate(int layer_cnt) {
     SplineChar *sc = chunkalloc(sizeof(SplineChar));
     int i;
 
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+    sc->serial = __atomic_add_fetch(&glyph_serial,1,__ATOMIC_RELAXED);
+#else
+    CHUNK_LOCK();
+    sc->serial = ++glyph_serial;
+    CHUNK_UNLOCK();
+#endif
     sc->color = COLOR_DEFAULT;
     sc->orig_pos = 0xffff;
     sc->unicodeenc = -1;
@@ -6285,6 +6752,7 @@ KernClass *KernClassCopy(KernClass *kc) {
 return( NULL );
     new = chunkalloc(sizeof(KernClass));
     *new = *kc;
+    new->firstidx = new->secondidx = NULL;
     new->firsts = galloc(new->first_cnt*sizeof(char *));
     new->seconds = galloc(new->second_cnt*sizeof(char *));
     new->offsets = galloc(new->first_cnt*new->second_cnt*sizeof(int16));
@@ -6312,6 +6780,7 @@ return( new );
 void KernClassFreeContents(KernClass *kc) {
     int i;
 
+    KernClassClearIndex(kc);
     for ( i=1; i<kc->first_cnt; ++i )
 	free(kc->firsts[i]);
     for ( i=1; i<kc->second_cnt; ++i )
@@ -6448,6 +6917,7 @@ static void EncodingFree(Encoding *enc) {
 
     if ( enc==NULL )
 return;
+    EncodingRevMapsFree(enc);
     free(enc->enc_name);
     free(enc->unicode);
     if ( enc->psnames!=NULL ) {
@@ -6634,7 +7104,7 @@ void JustifyFree(Justify *just) {
 }
 
 void SplineFontFree(SplineFont *sf) {
-    int i;
+    int i, refs;
     BDFFont *bdf, *bnext;
 
     if ( sf==NULL )
@@ -6643,6 +7113,13 @@ return;
 	MMSetFree(sf->mm);
 return;
     }
+    if ( sf->arena!=NULL && sf->cidmaster==NULL ) {
+	/* If only we and our subfonts use the arena, there's no point in */
+	/*  giving back the glyphs' chunks one by one */
+	for ( i=refs=0; i<sf->subfontcnt; ++i )
+	    refs += sf->subfonts[i]->arena==sf->arena;
+	ChunkArenaClosing(sf->arena,refs+1);
+    }
     CopyBufferClearCopiedFrom(sf);
     PasteRemoveSFAnchors(sf);
     for ( bdf = sf->bitmaps; bdf!=NULL; bdf = bnext ) {
@@ -6652,6 +7129,7 @@ return;
     for ( i=0; i<sf->glyphcnt; ++i ) if ( sf->glyphs[i]!=NULL )
 	SplineCharFree(sf->glyphs[i]);
     free(sf->glyphs);
+    SFDLazyFree(sf->lazy);
     free(sf->fontname);
     free(sf->fullname);
     free(sf->familyname);
@@ -6698,6 +7176,12 @@ return;
     BaseFree(sf->horiz_base);
     BaseFree(sf->vert_base);
     JustifyFree(sf->justify);
+    ChunkArenaUnref(sf->arena);
+    if ( sf->more_arenas!=NULL ) {
+	for ( i=0; sf->more_arenas[i]!=NULL; ++i )
+	    ChunkArenaUnref(sf->more_arenas[i]);
+	free(sf->more_arenas);
+    }
     free(sf);
 }
 
@@ -6726,8 +7210,13 @@ void MMSetFreeContents(MMSet *mm) {
 }
 
 void MMSetFree(MMSet *mm) {
-    int i;
+    int i, refs;
 
+    if ( mm->normal->arena!=NULL ) {
+	for ( i=refs=0; i<mm->instance_count; ++i )
+	    refs += mm->instances[i]->arena==mm->normal->arena;
+	ChunkArenaClosing(mm->normal->arena,refs+1);
+    }
     for ( i=0; i<mm->instance_count; ++i ) {
 	mm->instances[i]->mm = NULL;
 	mm->instances[i]->map = NULL;
@@ -63,6 +63,7 @@ static int svg_outfontheader(FILE *file, SplineFont *sf,int layer) {
     char *hash, *hasv, ch;
     int minu, maxu, i;
     time_t now;
+    char timebuf[32];
     const char *author = GetAuthor();
 
     memset(&info,0,sizeof(info));
@@ -79,8 +80,14 @@ static int svg_outfontheader(FILE *file, SplineFont *sf,int layer) {
     }
     fprintf( file, "<svg>\n" );
     time(&now);
+#if defined(__MINGW32__)
+    strncpy(timebuf,ctime(&now),sizeof(timebuf));
+    timebuf[sizeof(timebuf)-1] = '\0';
+#else
+    ctime_r(&now,timebuf);
+#endif
     fprintf( file, "<metadata>\nCreated by FontForge %d at %s",
-	    library_version_configuration.library_source_versiondate, ctime(&now) );
+	    library_version_configuration.library_source_versiondate, timebuf );
     if ( author!=NULL )
 	fprintf(file," By %s\n", author);
     else
@@ -927,11 +934,10 @@ return( uni==-1 || uni>=0x10000 ||
 
 static void svg_sfdump(FILE *file,SplineFont *sf,int layer) {
     int defwid, i, formeduni;
-    char oldloc[24];
+    CLocaleSave oldloc;
     struct altuni *altuni;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
 
     for ( i=0; i<sf->glyphcnt; ++i ) if ( sf->glyphs[i]!=NULL )
 	sf->glyphs[i]->ticked = false;
@@ -993,7 +999,7 @@ static void svg_sfdump(FILE *file,SplineFont *sf,int layer) {
     svg_dumpkerns(file,sf,false);
     svg_dumpkerns(file,sf,true);
     svg_outfonttrailer(file,sf);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 }
 
 int _WriteSVGFont(FILE *file,SplineFont *sf,enum fontformat format,int flags,
@@ -1031,7 +1037,8 @@ return( ret );
 }
 
 int _ExportSVG(FILE *svg,SplineChar *sc,int layer) {
-    char oldloc[24], *end;
+    CLocaleSave oldloc;
+    char *end;
     int em_size;
     DBounds b;
 
@@ -1042,8 +1049,7 @@ int _ExportSVG(FILE *svg,SplineChar *sc,int layer) {
     if ( b.miny>-sc->parent->descent ) b.miny = -sc->parent->descent;
     if ( b.maxy<em_size ) b.maxy = em_size;
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     fprintf(svg, "<?xml version=\"1.0\" standalone=\"no\"?>\n" );
     fprintf(svg, "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\" >\n" ); 
     fprintf(svg, "<svg viewBox=\"%d %d %d %d\">\n",
@@ -1070,7 +1076,7 @@ int _ExportSVG(FILE *svg,SplineChar *sc,int layer) {
     fprintf(svg, "  </g>\n\n" );
     fprintf(svg, "</svg>\n" );
 
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 return( !ferror(svg));
 }
 
@@ -3751,7 +3757,7 @@ void SFSetOrder(SplineFont *sf,int order2) {
 static SplineFont *_SFReadSVG(xmlDocPtr doc, char *filename) {
     xmlNodePtr *fonts, font;
     SplineFont *sf;
-    char oldloc[24];
+    CLocaleSave oldloc;
     char *chosenname = NULL;
 
     fonts = FindSVGFontNodes(doc);
@@ -3771,10 +3777,9 @@ return( NULL );
 	}
     }
     free(fonts);
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     sf = SVGParseFont(font);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     _xmlFreeDoc(doc);
 
     if ( sf!=NULL ) {
@@ -3879,7 +3884,7 @@ return( ret );
 Entity *EntityInterpretSVG(char *filename,char *memory, int memlen,int em_size,int ascent) {
     xmlDocPtr doc;
     xmlNodePtr top;
-    char oldloc[24];
+    CLocaleSave oldloc;
     Entity *ret;
     int order2;
 
@@ -3903,10 +3908,9 @@ return( NULL );
 return( NULL );
     }
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     ret = SVGParseSVG(top,em_size,ascent);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     _xmlFreeDoc(doc);
 
     if ( loaded_fonts_same_as_new )
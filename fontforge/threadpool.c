@@ -0,0 +1,327 @@
+/* Copyright (C) 2012 by George Williams */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+
+ * The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "fontforgevw.h"
+#include <ustring.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <locale.h>
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+/* A very simple work pool. The caller hands us a count of independent jobs */
+/*  and a function to do one of them, we start some threads which pull job */
+/*  indices off a shared counter until there are none left. The main thread */
+/*  does none of the work itself, it just sits around waiting for things to */
+/*  finish and updating the progress indicator (which is not thread safe */
+/*  and must only be touched from the main thread). */
+/* Anything a job function calls must be safe to call from several threads */
+/*  at once on different glyphs. chunkalloc is (when ff_threads_active is */
+/*  set), but the ui hooks (SCUpdateAll, SCHintsChanged, ...) are not and */
+/*  must be called after ThreadedForEach returns. IError and LogError may */
+/*  be used, in a worker thread their messages are queued and they get */
+/*  passed on to the ui when everything is done. Only the workers see this, */
+/*  ui_interface itself is never changed, so another python thread calling */
+/*  in while a pool runs still talks to the real ui */
+/* Only one pool runs at a time. A job which asks for threads, or a second */
+/*  python thread which wants some while another pool is busy, just runs */
+/*  its jobs itself */
+
+int ff_threads_active = 0;
+int thread_count_pref = 0;		/* Preference item, 0 means one per processor */
+static ff_thread_local int worker_index;
+static ff_thread_local struct ui_interface *worker_ui;	/* NULL except in workers */
+
+struct ui_interface *ThreadUiInterface(void) {
+    if ( worker_ui!=NULL )
+return( worker_ui );
+return( ui_interface );
+}
+
+/* How many threads to use if we're asked for requested. 0 means as many */
+/*  as the user wants (ThreadCount preference), or one for each processor */
+int ThreadCount(int requested) {
+    long cpus;
+
+    if ( requested<=0 )
+	requested = thread_count_pref;
+    if ( requested>0 )
+return( requested>MAX_THREADS ? MAX_THREADS : requested );
+#ifdef _SC_NPROCESSORS_ONLN
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    cpus = 1;
+#endif
+    if ( cpus<1 )
+return( 1 );
+    if ( cpus>MAX_THREADS )
+return( MAX_THREADS );
+return( (int) cpus );
+}
+
+#ifdef HAVE_PTHREAD_H
+struct threadjobs {
+    void (*func)(void *data,int index);
+    void *data;
+    int cnt;
+    int next;		/* Index of the next job nobody has started */
+    int done;		/* Number of jobs finished */
+    int stop;		/* Set when the user cancels, don't start anything new */
+    int workers;	/* Number of workers which have started */
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+};
+
+struct threadmsg {
+    char *msg;
+    int ierror;
+    struct threadmsg *next;
+};
+
+static struct ui_interface thread_ui;
+static struct threadmsg *msgs, *lastmsg;
+static pthread_mutex_t msg_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t active_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ThreadsActive(int delta) {
+    pthread_mutex_lock(&active_lock);
+    ff_threads_active += delta;
+    pthread_mutex_unlock(&active_lock);
+}
+
+static void QueueMessage(int ierror,const char *fmt,va_list ap) {
+    char buffer[2000];
+    struct threadmsg *m;
+
+    vsnprintf(buffer,sizeof(buffer),fmt,ap);
+    m = gcalloc(1,sizeof(struct threadmsg));
+    m->msg = copy(buffer);
+    m->ierror = ierror;
+    pthread_mutex_lock(&msg_lock);
+    if ( lastmsg==NULL )
+	msgs = m;
+    else
+	lastmsg->next = m;
+    lastmsg = m;
+    pthread_mutex_unlock(&msg_lock);
+}
+
+static void ThreadIError(const char *fmt,...) {
+    va_list ap;
+
+    va_start(ap,fmt);
+    QueueMessage(true,fmt,ap);
+    va_end(ap);
+}
+
+static void ThreadLogError(const char *fmt,...) {
+    va_list ap;
+
+    va_start(ap,fmt);
+    QueueMessage(false,fmt,ap);
+    va_end(ap);
+}
+
+static void FlushMessages(void) {
+    struct threadmsg *m, *next;
+
+    for ( m=msgs; m!=NULL; m=next ) {
+	next = m->next;
+	if ( m->ierror )
+	    IError("%s",m->msg);
+	else
+	    LogError("%s",m->msg);
+	free(m->msg);
+	free(m);
+    }
+    msgs = lastmsg = NULL;
+}
+
+static void *ThreadedWorker(void *_tj) {
+    struct threadjobs *tj = _tj;
+    int index;
+
+    pthread_mutex_lock(&tj->lock);
+    worker_index = tj->workers++;
+    pthread_mutex_unlock(&tj->lock);
+    worker_ui = &thread_ui;
+    forever {
+	pthread_mutex_lock(&tj->lock);
+	if ( tj->stop || tj->next>=tj->cnt ) {
+	    pthread_mutex_unlock(&tj->lock);
+    break;
+	}
+	index = tj->next++;
+	pthread_mutex_unlock(&tj->lock);
+
+	(tj->func)(tj->data,index);
+
+	pthread_mutex_lock(&tj->lock);
+	++tj->done;
+	pthread_cond_signal(&tj->finished);
+	pthread_mutex_unlock(&tj->lock);
+    }
+    worker_ui = NULL;
+return( NULL );
+}
+#endif
+
+/* Calls func(data,i) for 0<=i<cnt using up to threads worker threads. If */
+/*  progress is set then we call ff_progress_next once for each job done, */
+/*  and if that tells us to stop we don't start any more jobs (but jobs */
+/*  already running are allowed to finish). Returns false if cancelled */
+int ThreadedForEach(int cnt,int threads,int progress,
+	void (*func)(void *data,int index),void *data) {
+    int i, ok = true, was_worker = worker_index;
+#ifdef HAVE_PTHREAD_H
+    struct threadjobs tj;
+    pthread_t ids[MAX_THREADS];
+    int reported, done;
+
+    if ( threads>cnt )
+	threads = cnt;
+    if ( threads>MAX_THREADS )
+	threads = MAX_THREADS;
+    if ( threads>1 && pthread_mutex_trylock(&pool_lock)!=0 )
+	threads = 1;		/* Someone else has the pool, run serially */
+    if ( threads>1 ) {
+	memset(&tj,0,sizeof(tj));
+	tj.func = func; tj.data = data;
+	tj.cnt = cnt;
+	pthread_mutex_init(&tj.lock,NULL);
+	pthread_cond_init(&tj.finished,NULL);
+	ThreadsActive(1);
+	thread_ui.ierror = ThreadIError;
+	thread_ui.logwarning = ThreadLogError;
+	for ( i=0; i<threads; ++i )
+	    if ( pthread_create(&ids[i],NULL,ThreadedWorker,&tj)!=0 )
+	break;
+	threads = i;
+	if ( threads==0 ) {
+	    ThreadedWorker(&tj);	/* Couldn't start anything, do it ourselves */
+	    worker_index = was_worker;
+	}
+	reported = 0;
+	pthread_mutex_lock(&tj.lock);
+	while ( reported<cnt && !(tj.stop && tj.done==tj.next) ) {
+	    if ( tj.done==reported ) {
+		pthread_cond_wait(&tj.finished,&tj.lock);
+	    continue;
+	    }
+	    done = tj.done;
+	    pthread_mutex_unlock(&tj.lock);
+	    for ( ; reported<done; ++reported )
+		if ( progress && ok && !ff_progress_next())
+		    ok = false;
+	    pthread_mutex_lock(&tj.lock);
+	    if ( !ok )
+		tj.stop = true;
+	}
+	pthread_mutex_unlock(&tj.lock);
+	for ( i=0; i<threads; ++i )
+	    pthread_join(ids[i],NULL);
+	FlushMessages();
+	ThreadsActive(-1);
+	pthread_mutex_unlock(&pool_lock);
+	pthread_mutex_destroy(&tj.lock);
+	pthread_cond_destroy(&tj.finished);
+return( ok );
+    }
+#endif
+    worker_index = 0;
+    for ( i=0; i<cnt; ++i ) {
+	(func)(data,i);
+	if ( progress && !ff_progress_next()) {
+	    ok = false;
+    break;
+	}
+    }
+    worker_index = was_worker;
+return( ok );
+}
+
+/* Which of the workers ThreadedForEach started is running the current job, */
+/*  counting from 0, and always less than the number of threads asked for. */
+/*  Jobs can use this to keep things which mustn't be shared between */
+/*  threads (a FreeType face, say), one for each worker */
+int ThreadedWorkerIndex(void) {
+return( worker_index );
+}
+
+/* Python releases its interpreter lock around long operations on a font so */
+/*  that other python threads may work on other fonts. While it does so the */
+/*  shared parts of the core (the chunk allocator, ...) must lock */
+void ThreadsEnterCore(void) {
+#ifdef HAVE_PTHREAD_H
+    ThreadsActive(1);
+#endif
+}
+
+void ThreadsLeaveCore(void) {
+#ifdef HAVE_PTHREAD_H
+    ThreadsActive(-1);
+#endif
+}
+
+/* setlocale changes the locale of every thread in the process, so one */
+/*  thread restoring the user's locale could break another halfway through */
+/*  reading a font. uselocale only affects the calling thread */
+void SwitchToCLocale(CLocaleSave *save) {
+#if defined(LC_NUMERIC_MASK) && !defined(__MINGW32__)
+    locale_t cur = uselocale((locale_t) 0), base;
+
+    save->c_locale = NULL;
+    base = duplocale(cur);
+    if ( base!=(locale_t) 0 ) {
+	save->c_locale = newlocale(LC_NUMERIC_MASK,"C",base);
+	if ( save->c_locale==NULL )
+	    freelocale(base);
+    }
+    if ( save->c_locale!=NULL ) {
+	save->thread_locale = uselocale((locale_t) save->c_locale);
+return;
+    }
+#else
+    save->c_locale = NULL;
+#endif
+    strncpy( save->oldloc,setlocale(LC_NUMERIC,NULL),sizeof(save->oldloc)-1 );
+    save->oldloc[sizeof(save->oldloc)-1] = '\0';
+    setlocale(LC_NUMERIC,"C");
+}
+
+void SwitchFromCLocale(CLocaleSave *save) {
+#if defined(LC_NUMERIC_MASK) && !defined(__MINGW32__)
+    if ( save->c_locale!=NULL ) {
+	uselocale((locale_t) save->thread_locale);
+	freelocale((locale_t) save->c_locale);
+	save->c_locale = NULL;
+return;
+    }
+#endif
+    setlocale(LC_NUMERIC,save->oldloc);
+}
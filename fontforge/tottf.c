@@ -650,7 +650,8 @@ void putfixed(FILE *file,real dval) {
 }
 
 int ttfcopyfile(FILE *ttf, FILE *other, int pos, char *tab_name) {
-    int ch;
+    char buffer[8*1024];
+    size_t len;
     int ret = 1;
 
     if ( ferror(ttf) || ferror(other)) {
@@ -659,8 +660,11 @@ int ttfcopyfile(FILE *ttf, FILE *other, int pos, char *tab_name) {
 	IError("File Offset wrong for ttf table (%s), %d expected %d", tab_name, ftell(ttf), pos );
     }
     rewind(other);
-    while (( ch = getc(other))!=EOF )
-	putc(ch,ttf);
+    while (( len = fread(buffer,1,sizeof(buffer),other))>0 )
+	if ( fwrite(buffer,1,len,ttf)!=len ) {
+	    ret = 0;
+    break;
+	}
     if ( ferror(other)) ret = 0;
     if ( fclose(other)) ret = 0;
 return( ret );
@@ -1244,10 +1248,12 @@ static void dumpcomposite(SplineChar *sc, struct glyphinfo *gi) {
 	putc('\0',gi->glyphs);		/* on a word boundary, can only happen if odd number of instrs */
 }
 
-static void dumpglyph(SplineChar *sc, struct glyphinfo *gi) {
+/* ttfss is the glyph already converted to quadratic splines (we take it */
+/*  over), or NULL if we should convert it ourselves */
+static void dumpglyph(SplineChar *sc, struct glyphinfo *gi, SplineSet *ttfss) {
     struct glyphhead gh;
     DBounds bb;
-    SplineSet *ss, *ttfss;
+    SplineSet *ss;
     int contourcnt, ptcnt, origptcnt;
     BasePoint *bp;
     char *fs;
@@ -1261,6 +1267,7 @@ static void dumpglyph(SplineChar *sc, struct glyphinfo *gi) {
 /*  are ok, glyphs with a single point and anything else are ok, glyphs with */
 /*  a line are ok. But a single point is not ok. Dunno why */
     if ( sc->layers[gi->layer].splines==NULL && sc->layers[gi->layer].refs==NULL ) {
+	SplinePointListsFree(ttfss);
 	dumpspace(sc,gi);
 return;
     }
@@ -1271,7 +1278,8 @@ return;
 	IError("max glyph count wrong in ttf output");
     gi->loca[gi->next_glyph] = ftell(gi->glyphs);
 
-    ttfss = SCttfApprox(sc,gi->layer);
+    if ( ttfss==NULL )
+	ttfss = SCttfApprox(sc,gi->layer);
     ptcnt = SSTtfNumberPoints(ttfss);
     for ( ss=ttfss, contourcnt=0; ss!=NULL; ss=ss->next ) {
 	++contourcnt;
@@ -1445,10 +1453,76 @@ static int AssignTTFBitGlyph(struct glyphinfo *gi,SplineFont *sf,EncMap *map,int
 return j;
 }
 
+/* Converting cubic outlines to quadratic is most of the work in building */
+/*  the glyf table, and each glyph can be done on its own. So we convert a */
+/*  block of glyphs in parallel, and then write them out in order */
+#define APPROX_BLOCK	256
+
+struct ttfapprox {
+    SplineFont *sf;
+    struct glyphinfo *gi;
+    int start;
+    SplineSet *ttfss[APPROX_BLOCK];
+};
+
+/* The glyph at position i of the glyph list if dumpglyphs will pass it to */
+/*  dumpglyph, and it has an outline to convert */
+static SplineChar *ApproxGlyph(SplineFont *sf,struct glyphinfo *gi,int i) {
+    SplineChar *sc;
+
+    if ( gi->onlybitmaps || gi->bygid[i]==-1 )
+return( NULL );
+    sc = sf->glyphs[gi->bygid[i]];
+    if ( i==0 ) {
+	if ( gi->fixed_width>0 && sc->width!=gi->fixed_width )
+return( NULL );
+    } else if ( sc->ttf_glyph<=0 || IsTTFRefable(sc,gi->layer) )
+return( NULL );
+    if ( sc->layers[gi->layer].splines==NULL && sc->layers[gi->layer].refs==NULL )
+return( NULL );
+return( sc );
+}
+
+static void ApproxGlyphJob(void *_ta,int index) {
+    struct ttfapprox *ta = _ta;
+    SplineChar *sc = ApproxGlyph(ta->sf,ta->gi,ta->start+index);
+
+    if ( sc!=NULL )
+	ta->ttfss[index] = SCttfApprox(sc,ta->gi->layer);
+}
+
+static SplineSet *ApproxedGlyph(struct ttfapprox *ta,int i) {
+    SplineSet *ttfss;
+
+    if ( ta==NULL )
+return( NULL );
+    if ( i%APPROX_BLOCK==0 ) {
+	ta->start = i;
+	memset(ta->ttfss,0,sizeof(ta->ttfss));
+	ThreadedForEach(ta->gi->gcnt-i<APPROX_BLOCK ? ta->gi->gcnt-i : APPROX_BLOCK,
+		ThreadCount(0),false,ApproxGlyphJob,ta);
+    }
+    ttfss = ta->ttfss[i%APPROX_BLOCK];
+    ta->ttfss[i%APPROX_BLOCK] = NULL;
+return( ttfss );
+}
+
+static void ApproxFree(struct ttfapprox *ta) {
+    int i;
+
+    if ( ta==NULL )
+return;
+    for ( i=0; i<APPROX_BLOCK; ++i )
+	SplinePointListsFree(ta->ttfss[i]);
+    free(ta);
+}
+
 static int dumpglyphs(SplineFont *sf,struct glyphinfo *gi) {
     int i;
     int fixed = gi->fixed_width;
     int answer, answered=-1;
+    struct ttfapprox *ta = NULL;
+    SplineSet *ttfss;
 
     ff_progress_change_stages(2+gi->strikecnt);
     QuickBlues(sf,gi->layer,&gi->bd);
@@ -1489,20 +1563,26 @@ static int dumpglyphs(SplineFont *sf,struct glyphinfo *gi) {
     gi->pointcounts = galloc((gi->maxp->numGlyphs+1)*sizeof(int32));
     memset(gi->pointcounts,-1,(gi->maxp->numGlyphs+1)*sizeof(int32));
     gi->next_glyph = 0;
-    gi->glyphs = tmpfile();
-    gi->hmtx = tmpfile();
+    gi->glyphs = MemTmpFile();
+    gi->hmtx = MemTmpFile();
     if ( sf->hasvmetrics )
-	gi->vmtx = tmpfile();
+	gi->vmtx = MemTmpFile();
     FigureFullMetricsEnd(sf,gi,true);
 
     if ( fixed>0 ) {
 	gi->lasthwidth = 3;
 	gi->hfullcnt = 3;
     }
+    if ( !gi->onlybitmaps && ThreadCount(0)>1 ) {
+	ta = gcalloc(1,sizeof(struct ttfapprox));
+	ta->sf = sf;
+	ta->gi = gi;
+    }
     for ( i=0; i<gi->gcnt; ++i ) {
+	ttfss = ApproxedGlyph(ta,i);
 	if ( i==0 ) {
 	    if ( gi->bygid[0]!=-1 && (fixed<=0 || sf->glyphs[gi->bygid[0]]->width==fixed))
-		dumpglyph(sf->glyphs[gi->bygid[0]],gi);
+		dumpglyph(sf->glyphs[gi->bygid[0]],gi,ttfss);
 	    else
 		dumpmissingglyph(sf,gi,fixed);
 	} else if ( i<=2 && gi->bygid[i]==-1 )
@@ -1515,7 +1595,7 @@ static int dumpglyphs(SplineFont *sf,struct glyphinfo *gi) {
 		if ( IsTTFRefable(sf->glyphs[gi->bygid[i]],gi->layer) )
 		    dumpcomposite(sf->glyphs[gi->bygid[i]],gi);
 		else
-		    dumpglyph(sf->glyphs[gi->bygid[i]],gi);
+		    dumpglyph(sf->glyphs[gi->bygid[i]],gi,ttfss);
 	    }
 	}
 	if ( (ftell(gi->glyphs)&3) != 0 ) {
@@ -1526,9 +1606,12 @@ static int dumpglyphs(SplineFont *sf,struct glyphinfo *gi) {
 	    if ( ftell(gi->glyphs)&2 )
 		putshort(gi->glyphs,0);
 	}
-	if ( !ff_progress_next())
+	if ( !ff_progress_next()) {
+	    ApproxFree(ta);
 return( false );
+	}
     }
+    ApproxFree(ta);
 
     /* extra location entry points to end of last glyph */
     gi->loca[gi->next_glyph] = ftell(gi->glyphs);
@@ -1560,7 +1643,7 @@ return( true );
 /* Generate a null glyf and loca table for X opentype bitmaps */
 static int dumpnoglyphs(SplineFont *sf,struct glyphinfo *gi) {
 
-    gi->glyphs = tmpfile();
+    gi->glyphs = MemTmpFile();
     gi->glyph_len = 0;
     /* loca gets built in dummyloca */
 return( true );
@@ -1592,7 +1675,7 @@ static void ttfdumphdmx(SplineFont *sf,struct alltabs *at,int *bsizes) {
 return;
 
     /* what happens if a strike is missing a glyph????? */
-    at->hdmxf = tmpfile();
+    at->hdmxf = MemTmpFile();
 #endif
 }
 
@@ -1616,7 +1699,7 @@ return( i );
     pos = ftell(at->sidf)+1;
     if ( pos>=65536 && !at->sidlongoffset ) {
 	at->sidlongoffset = true;
-	news = tmpfile();
+	news = MemTmpFile();
 	rewind(at->sidh);
 	for ( i=0; i<at->sidcnt; ++i )
 	    putlong(news,getushort(at->sidh));
@@ -1963,7 +2046,7 @@ static void _dumpcffstrings(FILE *file, struct pschars *strs) {
 }
 
 static FILE *dumpcffstrings(struct pschars *strs) {
-    FILE *file = tmpfile();
+    FILE *file = MemTmpFile();
     _dumpcffstrings(file,strs);
     PSCharsFree(strs);
 return( file );
@@ -2504,9 +2587,9 @@ static int dumpcffhmtx(struct alltabs *at,SplineFont *sf,int bitmaps) {
     int dovmetrics = sf->hasvmetrics;
     int width = at->gi.fixed_width;
 
-    at->gi.hmtx = tmpfile();
+    at->gi.hmtx = MemTmpFile();
     if ( dovmetrics )
-	at->gi.vmtx = tmpfile();
+	at->gi.vmtx = MemTmpFile();
     FigureFullMetricsEnd(sf,&at->gi,bitmaps);	/* Bitmap fonts use ttf convention of 3 magic glyphs */
     if ( at->gi.bygid[0]!=-1 && (sf->glyphs[at->gi.bygid[0]]->width==width || width<=0 )) {
 	putshort(at->gi.hmtx,sf->glyphs[at->gi.bygid[0]]->width);
@@ -2579,9 +2662,9 @@ static void dumpcffcidhmtx(struct alltabs *at,SplineFont *_sf) {
     SplineFont *sf;
     int dovmetrics = _sf->hasvmetrics;
 
-    at->gi.hmtx = tmpfile();
+    at->gi.hmtx = MemTmpFile();
     if ( dovmetrics )
-	at->gi.vmtx = tmpfile();
+	at->gi.vmtx = MemTmpFile();
     FigureFullMetricsEnd(_sf,&at->gi,false);
 
     max = 0;
@@ -2636,12 +2719,12 @@ static int dumptype2glyphs(SplineFont *sf,struct alltabs *at) {
     int i;
     struct pschars *subrs, *chrs;
 
-    at->cfff = tmpfile();
-    at->sidf = tmpfile();
-    at->sidh = tmpfile();
-    at->charset = tmpfile();
-    at->encoding = tmpfile();
-    at->private = tmpfile();
+    at->cfff = MemTmpFile();
+    at->sidf = MemTmpFile();
+    at->sidh = MemTmpFile();
+    at->charset = MemTmpFile();
+    at->encoding = MemTmpFile();
+    at->private = MemTmpFile();
 
     dumpcffheader(sf,at->cfff);
     dumpcffnames(sf,at->cfff);
@@ -2680,17 +2763,17 @@ static int dumpcidglyphs(SplineFont *sf,struct alltabs *at) {
     int i;
     struct pschars *glbls = NULL, *chrs;
 
-    at->cfff = tmpfile();
-    at->sidf = tmpfile();
-    at->sidh = tmpfile();
-    at->charset = tmpfile();
-    at->fdselect = tmpfile();
-    at->fdarray = tmpfile();
-    at->globalsubrs = tmpfile();
+    at->cfff = MemTmpFile();
+    at->sidf = MemTmpFile();
+    at->sidh = MemTmpFile();
+    at->charset = MemTmpFile();
+    at->fdselect = MemTmpFile();
+    at->fdarray = MemTmpFile();
+    at->globalsubrs = MemTmpFile();
 
     at->fds = gcalloc(sf->subfontcnt,sizeof(struct fd2data));
     for ( i=0; i<sf->subfontcnt; ++i ) {
-	at->fds[i].private = tmpfile();
+	at->fds[i].private = MemTmpFile();
 	ATFigureDefWidth(sf->subfonts[i],at,i);
     }
     if ( (chrs = CID2ChrsSubrs2(sf,at->fds,at->gi.flags,&glbls,at->gi.layer))==NULL )
@@ -3603,7 +3686,7 @@ docs are wrong.
 static void redoloca(struct alltabs *at) {
     int i;
 
-    at->loca = tmpfile();
+    at->loca = MemTmpFile();
     if ( at->head.locais32 ) {
 	for ( i=0; i<=at->maxp.numGlyphs; ++i )
 	    putlong(at->loca,at->gi.loca[i]);
@@ -3623,7 +3706,7 @@ static void redoloca(struct alltabs *at) {
 
 static void dummyloca(struct alltabs *at) {
 
-    at->loca = tmpfile();
+    at->loca = MemTmpFile();
     if ( at->head.locais32 ) {
 	putlong(at->loca,0);
 	at->localen = sizeof(int32);
@@ -3635,7 +3718,7 @@ static void dummyloca(struct alltabs *at) {
 }
 
 static void redohead(struct alltabs *at) {
-    at->headf = tmpfile();
+    at->headf = MemTmpFile();
 
     putlong(at->headf,at->head.version);
     putlong(at->headf,at->head.revision);
@@ -3668,10 +3751,10 @@ static void redohhead(struct alltabs *at,int isv) {
     FILE *f;
 
     if ( !isv ) {
-	f = at->hheadf = tmpfile();
+	f = at->hheadf = MemTmpFile();
 	head = &at->hhead;
     } else {
-	f = at->vheadf = tmpfile();
+	f = at->vheadf = MemTmpFile();
 	head = &at->vhead;
     }
 
@@ -3702,7 +3785,7 @@ static void redohhead(struct alltabs *at,int isv) {
 }
 
 static void redomaxp(struct alltabs *at,enum fontformat format) {
-    at->maxpf = tmpfile();
+    at->maxpf = MemTmpFile();
 
     putlong(at->maxpf,at->maxp.version);
     putshort(at->maxpf,at->maxp.numGlyphs);
@@ -3729,7 +3812,7 @@ static void redomaxp(struct alltabs *at,enum fontformat format) {
 
 static void redoos2(struct alltabs *at) {
     int i;
-    at->os2f = tmpfile();
+    at->os2f = MemTmpFile();
 
     putshort(at->os2f,at->os2.version);
     putshort(at->os2f,at->os2.avgCharWid);
@@ -3788,7 +3871,7 @@ static int icomp(const void *a, const void *b) {
 static void dumpgasp(struct alltabs *at, SplineFont *sf) {
     int i;
 
-    at->gaspf = tmpfile();
+    at->gaspf = MemTmpFile();
     if ( sf->gasp_cnt==0 ) {
 	putshort(at->gaspf,0);	/* Old version number */
 	/* For fonts with no instructions always dump a gasp table which */
@@ -3878,7 +3961,7 @@ return( latin1_2_utf8_copy(str));
 /*  but let's do it just in case */
 void DefaultTTFEnglishNames(struct ttflangname *dummy, SplineFont *sf) {
     time_t now;
-    struct tm *tm;
+    struct tm *tm, tmbuf;
     char buffer[200];
 
     if ( dummy->names[ttf_copyright]==NULL || *dummy->names[ttf_copyright]=='\0' )
@@ -3889,7 +3972,12 @@ void DefaultTTFEnglishNames(struct ttflangname *dummy, SplineFont *sf) {
 	dummy->names[ttf_subfamily] = utf8_verify_copy(SFGetModifiers(sf));
     if ( dummy->names[ttf_uniqueid]==NULL || *dummy->names[ttf_uniqueid]=='\0' ) {
 	time(&now);
-	tm = localtime(&now);
+#if defined(__MINGW32__)
+	tmbuf = *localtime(&now);
+	tm = &tmbuf;
+#else
+	tm = localtime_r(&now,&tmbuf);
+#endif
 	sprintf( buffer, "%s : %s : %d-%d-%d",
 		BDFFoundry?BDFFoundry:TTFFoundry?TTFFoundry:"FontForge 2.0",
 		sf->fullname!=NULL?sf->fullname:sf->fontname,
@@ -4098,7 +4186,7 @@ static void dumpnames(struct alltabs *at, SplineFont *sf,enum fontformat format)
     nt.encoding_name = at->map->enc;
     nt.format	     = format;
     nt.applemode     = at->applemode;
-    nt.strings	     = tmpfile();
+    nt.strings	     = MemTmpFile();
     if (( format>=ff_ttf && format<=ff_otfdfont) && (at->gi.flags&ttf_flag_symbol))
 	nt.format    = ff_ttfsym;
 
@@ -4157,7 +4245,7 @@ static void dumpnames(struct alltabs *at, SplineFont *sf,enum fontformat format)
 
     qsort(nt.entries,nt.cur,sizeof(NameEntry),compare_entry);
 
-    at->name = tmpfile();
+    at->name = MemTmpFile();
     putshort(at->name,0);				/* format */
     putshort(at->name,nt.cur);				/* numrec */
     putshort(at->name,(3+nt.cur*6)*sizeof(int16));	/* offset to strings */
@@ -4201,7 +4289,7 @@ static void dumppost(struct alltabs *at, SplineFont *sf, enum fontformat format)
 	    (at->gi.flags&ttf_flag_shortps));
     uint32 here;
 
-    at->post = tmpfile();
+    at->post = MemTmpFile();
 
     putlong(at->post,shorttable?0x00030000:0x00020000);	/* formattype */
     putfixed(at->post,sf->italicangle);
@@ -4467,7 +4555,7 @@ return( NULL );		/* Doesn't have the single byte entries */
 	subheads[i].rangeoff = subheads[i].rangeoff*sizeof(uint16) +
 		(subheadcnt-i)*sizeof(struct subhead) + sizeof(uint16);
 
-    sub = tmpfile();
+    sub = MemTmpFile();
     if ( sub==NULL )
 return( NULL );
 
@@ -4587,7 +4675,7 @@ return(NULL);
     if ( !map->enc->is_unicodefull )
 	map = freeme = EncMapFromEncoding(sf,FindOrMakeEncoding("ucs4"));
 
-    format12 = tmpfile();
+    format12 = MemTmpFile();
     if ( format12==NULL )
 return( NULL );
 
@@ -4632,7 +4720,7 @@ static FILE *NeedsUCS2Table(SplineFont *sf,int *ucs2len,EncMap *map,int issymbol
     struct cmapseg { uint16 start, end; uint16 delta; uint16 rangeoff; } *cmapseg;
     uint16 *ranges;
     SplineChar *sc;
-    FILE *format4 = tmpfile();
+    FILE *format4 = MemTmpFile();
 
     memset(avail,0xff,65536*sizeof(uint32));
     if ( map->enc->is_unicodebmp || map->enc->is_unicodefull ) { int gid;
@@ -4793,7 +4881,7 @@ return( NULL );			/* No variation selectors */
 
     avail = galloc(unicode4_size*sizeof(uint32));
 
-    format14 = tmpfile();
+    format14 = MemTmpFile();
     putshort(format14,14);
     putlong(format14,0);		/* Length, fixup later */
     putlong(format14,vs_cnt);		/* number of selectors */
@@ -4898,7 +4986,7 @@ static void dumpcmap(struct alltabs *at, SplineFont *sf,enum fontformat format)
     if (( format>=ff_ttf && format<=ff_otfdfont) && (at->gi.flags&ttf_flag_symbol))
 	modformat = ff_ttfsym;
 
-    at->cmap = tmpfile();
+    at->cmap = MemTmpFile();
 
     /* MacRoman encoding table */ /* Not going to bother with making this work for cid fonts */
     /* I now see that Apple doesn't restrict us to format 0 sub-tables (as */
@@ -4965,6 +5053,7 @@ static void dumpcmap(struct alltabs *at, SplineFont *sf,enum fontformat format)
 		    sc->unicodeenc = -1;
 		}
 	    }
+	    GlyphHashFree(sf);
 	}
     }
 
@@ -5129,6 +5218,7 @@ static void dumpcmap(struct alltabs *at, SplineFont *sf,enum fontformat format)
 		sf->glyphs[i]->unicodeenc = sf->glyphs[i]->orig_pos;
 		sf->glyphs[i]->orig_pos = i;
 	    }
+	    GlyphHashFree(sf);
 	}
     }
 }
@@ -5306,7 +5396,7 @@ static FILE *dumpstoredtable(SplineFont *sf,uint32 tag,int *len) {
 return( NULL );
     }
 
-    out = tmpfile();
+    out = MemTmpFile();
     fwrite(tab->data,1,tab->len,out);
     if ( (tab->len&1))
 	putc('\0',out);
@@ -5322,7 +5412,7 @@ static FILE *dumpsavedtable(struct ttf_table *tab) {
     if ( tab==NULL )
 return( NULL );
 
-    out = tmpfile();
+    out = MemTmpFile();
     fwrite(tab->data,1,tab->len,out);
     if ( (tab->len&1))
 	putc('\0',out);
@@ -6002,7 +6092,7 @@ return( true );
 }
 
 static char *Tag2String(uint32 tag) {
-    static char buffer[8];
+    static ff_thread_local char buffer[8];
 
     buffer[0] = tag>>24;
     buffer[1] = tag>>16;
@@ -6179,12 +6269,11 @@ static void ATinit(struct alltabs *at,SplineFont *sf,EncMap *map,int flags, int
 int _WriteTTFFont(FILE *ttf,SplineFont *sf,enum fontformat format,
 	int32 *bsizes, enum bitmapformat bf,int flags,EncMap *map, int layer) {
     struct alltabs at;
-    char oldloc[24];
+    CLocaleSave oldloc;
     int i, anyglyphs;
 
     /* TrueType probably doesn't need this, but OpenType does for floats in dictionaries */
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     
     if ( format==ff_otfcid || format== ff_cffcid ) {
 	if ( sf->cidmaster ) sf = sf->cidmaster;
@@ -6229,39 +6318,51 @@ int _WriteTTFFont(FILE *ttf,SplineFont *sf,enum fontformat format,
 	if ( initTables(&at,sf,format,bsizes,bf,flags))
 	    dumpttf(ttf,&at,format);
     }
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     if ( at.error || ferror(ttf))
 return( 0 );
 
-#ifdef __CygWin
-    /* Modern versions of windows want the execute bit set on a ttf file */
-    /* I've no idea what this corresponds to in windows, nor any idea on */
-    /*  how to set it from the windows UI, but this seems to work */
-    {
-	struct stat buf;
-	fstat(fileno(ttf),&buf);
-	fchmod(fileno(ttf),S_IXUSR | buf.st_mode );
-    }
-#endif
-
 return( 1 );
 }
 
 int WriteTTFFont(char *fontname,SplineFont *sf,enum fontformat format,
 	int32 *bsizes, enum bitmapformat bf,int flags,EncMap *map, int layer) {
-    FILE *ttf;
+    FILE *ttf, *out=NULL;
     int ret;
 
     if ( strstr(fontname,"://")!=NULL ) {
 	if (( ttf = tmpfile())==NULL )
 return( 0 );
     } else {
-	if (( ttf=fopen(fontname,"wb+"))==NULL )
+	if (( out=fopen(fontname,"wb"))==NULL )
+return( 0 );
+	/* Build the font in memory and write it out in one go at the end */
+	if (( ttf = MemTmpFile())==NULL ) {
+	    fclose(out);
 return( 0 );
+	}
     }
     ret = _WriteTTFFont(ttf,sf,format,bsizes,bf,flags,map,layer);
     if ( strstr(fontname,"://")!=NULL && ret )
 	ret = URLFromFile(fontname,ttf);
+    if ( out!=NULL ) {
+	if ( ret )
+	    ret = ttfcopyfile(out,ttf,0,"font");	/* Closes ttf */
+	else
+	    fclose(ttf);
+	ttf = out;
+#ifdef __CygWin
+	/* Modern versions of windows want the execute bit set on a ttf file */
+	/* I've no idea what this corresponds to in windows, nor any idea on */
+	/*  how to set it from the windows UI, but this seems to work */
+	{
+	    struct stat buf;
+	    fflush(ttf);
+	    fstat(fileno(ttf),&buf);
+	    fchmod(fileno(ttf),S_IXUSR | buf.st_mode );
+	}
+#endif
+    }
     if ( ret && (flags&ttf_flag_glyphmap) )
 	DumpGlyphToNameMap(fontname,sf);
     if ( fclose(ttf)==-1 )
@@ -6317,7 +6418,7 @@ static void dumphex(struct hexout *hexout,FILE *temp,int length) {
 }
     
 static void dumptype42(FILE *type42,struct alltabs *at, enum fontformat format) {
-    FILE *temp = tmpfile();
+    FILE *temp = MemTmpFile();
     struct hexout hexout;
     int i, length;
 
@@ -6362,12 +6463,11 @@ static void dumptype42(FILE *type42,struct alltabs *at, enum fontformat format)
 int _WriteType42SFNTS(FILE *type42,SplineFont *sf,enum fontformat format,
 	int flags,EncMap *map,int layer) {
     struct alltabs at;
-    char oldloc[24];
+    CLocaleSave oldloc;
     int i;
 
     /* TrueType probably doesn't need this, but OpenType does for floats in dictionaries */
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
 
     if ( sf->subfontcnt!=0 ) sf = sf->subfonts[0];
 
@@ -6383,7 +6483,7 @@ int _WriteType42SFNTS(FILE *type42,SplineFont *sf,enum fontformat format,
 	dumptype42(type42,&at,format);
     free(at.gi.loca);
 
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
     if ( at.error || ferror(type42))
 return( 0 );
 
@@ -7083,7 +7183,7 @@ return( 0 );
 	/* Generate all the fonts (don't generate DSIGs, there's one DSIG for */
 	/*  the ttc as a whole) */
 	for ( sfitem= sfs, cnt=0; sfitem!=NULL; sfitem=sfitem->next, ++cnt ) {
-	    sfitem->tempttf = tmpfile();
+	    sfitem->tempttf = MemTmpFile();
 	    if ( sfitem->tempttf==NULL )
 		ok=0;
 	    else
@@ -1278,6 +1278,40 @@ uint16 *ClassesFromNames(SplineFont *sf,char **classnames,int class_cnt,
 return( class );
 }
 
+/* Same as ClassesFromNames, but uses (and fills in) a compiled class index */
+/*  A glyph named by several classes goes in the last of them here, while */
+/*  the index (like KCFindName) holds the first, so then use the names */
+static uint16 *ClassesFromIndex(SplineFont *sf,struct glyphclassindex **idx,
+	char **classnames,int class_cnt,int numGlyphs, SplineChar ***glyphs) {
+    uint16 *class;
+    int i, k, c;
+    SplineFont *_sf;
+    SplineChar *sc, **gs=NULL;
+
+    if ( sf->cidmaster!=NULL )
+	sf = sf->cidmaster;
+    class = gcalloc(numGlyphs,sizeof(uint16));
+    if ( glyphs ) *glyphs = gs = gcalloc(numGlyphs,sizeof(SplineChar *));
+    k = 0;
+    do {
+	_sf = sf->subfontcnt==0 ? sf : sf->subfonts[k];
+	for ( i=0; i<_sf->glyphcnt; ++i ) if ( (sc=_sf->glyphs[i])!=NULL && sc->ttf_glyph!=-1 ) {
+	    c = GlyphClassIndexFind(idx,classnames,class_cnt,sc);
+	    if ( c==-2 || (*idx)->overlaps ) {
+		free(class);
+		if ( gs!=NULL ) free(gs);
+return( ClassesFromNames(sf,classnames,class_cnt,numGlyphs,glyphs,false));
+	    } else if ( c!=-1 && sc->ttf_glyph<numGlyphs ) {
+		class[sc->ttf_glyph] = c;
+		if ( gs!=NULL )
+		    gs[sc->ttf_glyph] = sc;
+	    }
+	}
+	++k;
+    } while ( k<sf->subfontcnt );
+return( class );
+}
+
 static SplineChar **GlyphsFromClasses(SplineChar **gs, int numGlyphs) {
     int i, cnt;
     SplineChar **glyphs;
@@ -1388,9 +1422,9 @@ static void dumpgposkernclass(FILE *gpos,SplineFont *sf,
 	putshort(gpos,anydevtab?0x0044:0x0004);	/* Alter XAdvance of first character */
 	putshort(gpos,0x0000);			/* leave second char alone */
     }
-    class1 = ClassesFromNames(sf,kc->firsts,kc->first_cnt,at->maxp.numGlyphs,&glyphs,false);
+    class1 = ClassesFromIndex(sf,&kc->firstidx,kc->firsts,kc->first_cnt,at->maxp.numGlyphs,&glyphs);
     glyphs = GlyphsFromClasses(glyphs,at->maxp.numGlyphs);
-    class2 = ClassesFromNames(sf,kc->seconds,kc->second_cnt,at->maxp.numGlyphs,NULL,false);
+    class2 = ClassesFromIndex(sf,&kc->secondidx,kc->seconds,kc->second_cnt,at->maxp.numGlyphs,NULL);
     putshort(gpos,0);		/* offset to first glyph classes */
     putshort(gpos,0);		/* offset to second glyph classes */
     putshort(gpos,kc->first_cnt);
@@ -1764,7 +1798,7 @@ static void dumpgposAnchorData(FILE *gpos,AnchorClass *_ac,
 
     fseek(gpos,subtable_start+2,SEEK_SET);	/* mark coverage table offset */
     putshort(gpos,coverage_offset-subtable_start);
-    fseek(gpos,4,SEEK_CUR);
+    fseek(gpos,subtable_start+8,SEEK_SET);	/* mark array offset */
     putshort(gpos,markarray_offset-subtable_start);
 
     fseek(gpos,0,SEEK_END);
@@ -2122,11 +2156,11 @@ static void dumpg___ContextChainClass(FILE *lfile,SplineFont *sf,
     for ( cnt=0; cnt<fpst->nccnt; ++cnt )
 	putshort(lfile,0);
 
-    iclass = ClassesFromNames(sf,fpst->nclass,fpst->nccnt,at->maxp.numGlyphs,&iglyphs,false);
+    iclass = ClassesFromIndex(sf,&fpst->nclassidx,fpst->nclass,fpst->nccnt,at->maxp.numGlyphs,&iglyphs);
     lglyphs = bglyphs = NULL; bclass = lclass = NULL;
     if ( !iscontext ) {
-	bclass = ClassesFromNames(sf,fpst->bclass,fpst->bccnt,at->maxp.numGlyphs,&bglyphs,false);
-	lclass = ClassesFromNames(sf,fpst->fclass,fpst->fccnt,at->maxp.numGlyphs,&lglyphs,false);
+	bclass = ClassesFromIndex(sf,&fpst->bclassidx,fpst->bclass,fpst->bccnt,at->maxp.numGlyphs,&bglyphs);
+	lclass = ClassesFromIndex(sf,&fpst->fclassidx,fpst->fclass,fpst->fccnt,at->maxp.numGlyphs,&lglyphs);
     }
     pos = ftell(lfile);
     fseek(lfile,base+sizeof(uint16),SEEK_SET);
@@ -2573,7 +2607,7 @@ static FILE *G___figureLookups(SplineFont *sf,int is_gpos,
     struct lookup_subtable *sub;
     int index, i,j;
     FILE *final;
-    FILE *lfile = tmpfile();
+    FILE *lfile = MemTmpFile();
     OTLookup **sizeordered;
     OTLookup *all = is_gpos ? sf->gpos_lookups : sf->gsub_lookups;
     char *buffer;
@@ -2609,7 +2643,7 @@ return( lfile );
 	    sizeordered[ otl->lookup_index ] = otl;
     qsort(sizeordered,index,sizeof(OTLookup *),lookup_size_cmp);
 
-    final = tmpfile();
+    final = MemTmpFile();
     buffer = galloc(32768);
     for ( i=0; i<index; ++i ) {
 	uint32 diff;
@@ -2909,7 +2943,7 @@ return( NULL );
     /* Now we've worked out which lookups need extension tables and marked them*/
     /* Generate the extension tables, and update the offsets to reflect the size */
     /* of the extensions */
-    efile = tmpfile();
+    efile = MemTmpFile();
 
     len2 = 0;
     for ( otf=all; otf!=NULL; otf=otf->next ) if ( otf->lookup_index!=-1 ) {
@@ -2989,7 +3023,7 @@ return( NULL );
 return( NULL );
     }
 
-    g___ = tmpfile();
+    g___ = MemTmpFile();
 
     putlong(g___,0x10000);		/* version number */
     putshort(g___,10);		/* offset to script table */
@@ -3409,7 +3443,7 @@ void otf_dumpgdef(struct alltabs *at, SplineFont *sf) {
     if ( !needsclass && lcnt==0 && sf->mark_class_cnt==0 && sf->mark_set_cnt==0 )
 return;					/* No anchor positioning, no ligature carets */
 
-    at->gdef = tmpfile();
+    at->gdef = MemTmpFile();
     if ( sf->mark_set_cnt==0 )
 	putlong(at->gdef,0x00010000);		/* Version */
     else
@@ -4006,7 +4040,7 @@ void otf_dump_math(struct alltabs *at, SplineFont *sf) {
     if ( sf->MATH==NULL )
 return;
 
-    at->math = mathf = tmpfile();
+    at->math = mathf = MemTmpFile();
 
     putlong(mathf,  0x00010000 );		/* Version 1 */
     putshort(mathf, 10);			/* Offset to constants */
@@ -4232,7 +4266,7 @@ return;
 
     SFBaseSort(sf);
 
-    at->base = basef = tmpfile();
+    at->base = basef = MemTmpFile();
 
     putlong(basef,  0x00010000 );		/* Version 1 */
     putshort(basef,  0 );			/* offset to horizontal baselines, fill in later */
@@ -4538,7 +4572,7 @@ return;
     SFJstfSort(sf);
     for ( jscript=sf->justify, cnt=0; jscript!=NULL; jscript=jscript->next, ++cnt );
 
-    at->jstf = jstf = tmpfile();
+    at->jstf = jstf = MemTmpFile();
 
     putlong(jstf,  0x00010000 );		/* Version 1 */
     putshort(jstf, cnt );			/* script count */
@@ -4677,7 +4711,7 @@ void otf_dump_dummydsig(struct alltabs *at, SplineFont *sf) {
     /*  told an empty DSIG table works for that. So... a truely pointless   */
     /*  instance of a pointless table. I suppose that's a bit ironic. */
 
-    at->dsigf = dsigf = tmpfile();
+    at->dsigf = dsigf = MemTmpFile();
     putlong(dsigf,0x00000001);		/* Standard version (and why isn't it 0x10000 like everything else?) */
     putshort(dsigf,0);			/* No signatures in my signature table*/
     putshort(dsigf,0);			/* No flags */
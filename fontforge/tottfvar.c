@@ -507,7 +507,7 @@ return;
     }
 
     tuple_size = 4+2*mm->axis_count;
-    at->cvar = tmpfile();
+    at->cvar = MemTmpFile();
     putlong( at->cvar, 0x00010000 );	/* Format */
     putshort( at->cvar, cnt );		/* Number of instances with cvt tables (tuple count of interesting tuples) */
     putshort( at->cvar, 8+cnt*tuple_size );	/* Offset to data */
@@ -636,7 +636,7 @@ static void ttf_dumpgvar(struct alltabs *at, MMSet *mm) {
     int16 **deltas;
     int ptcnt;
 
-    at->gvar = tmpfile();
+    at->gvar = MemTmpFile();
     putlong( at->gvar, 0x00010000 );	/* Format */
     putshort( at->gvar, mm->axis_count );
     putshort( at->gvar, mm->instance_count );	/* Number of global tuples */
@@ -709,7 +709,7 @@ static void ttf_dumpavar(struct alltabs *at, MMSet *mm) {
     if ( i==mm->axis_count )		/* We only have simple axes */
 return;					/* No need for a variation table */
 
-    at->avar = tmpfile();
+    at->avar = MemTmpFile();
     putlong( at->avar, 0x00010000 );	/* Format */
     putlong( at->avar, mm->axis_count );
     for ( i=0; i<mm->axis_count; ++i ) {
@@ -766,7 +766,7 @@ return( on->strid );
 static void ttf_dumpfvar(struct alltabs *at, MMSet *mm) {
     int i,j;
 
-    at->fvar = tmpfile();
+    at->fvar = MemTmpFile();
     putlong( at->fvar, 0x00010000 );	/* Format */
     putshort( at->fvar, 16 );		/* Offset to first axis data */
     putshort( at->fvar, 2 );		/* Size count pairs */
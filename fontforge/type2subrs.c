@@ -0,0 +1,725 @@
+/* Copyright (C) 2012 by George Williams */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+
+ * The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "fontforgevw.h"
+#include "psfont.h"
+
+/* The subrs we find while converting glyphs (see BreakSubroutine) are just */
+/*  the pieces of glyph between hint changes which happen to be identical. */
+/*  That misses most of what glyphs really share (a serif, a bowl, the end */
+/*  of a stroke). Here we take the finished charstrings apart into commands */
+/*  (an operator with its operands), and look for the runs of commands which */
+/*  it pays most to share anywhere in the font, using a suffix array of all */
+/*  the glyphs. Then we do it again on the result, so a later round can find */
+/*  runs inside the subrs found by an earlier one. A subr only ever calls */
+/*  subrs found in earlier rounds, so they never nest deeper than T2_ROUNDS */
+/*  (type2 allows 10). In a cid-keyed font a subr used by glyphs of just one */
+/*  sub-font goes into that font's local subrs, anything else is global */
+
+#define T2_ROUNDS	6
+#define T2_MAXSUBRS	65535
+#define T2_CALLCOST	3	/* A guess at what calling a subr costs us */
+#define T2_HASH		65536
+#define T2_STACK	48
+
+struct t2atom {			/* A command, or a call to one of our subrs */
+    int off, len;		/* Where the command's bytes are in the pool */
+    int subr;			/* -1 for a command, else the subr it calls */
+    int next;			/* hash chain */
+    unsigned int endchar: 1;
+};
+
+struct t2string {		/* A glyph or a subr, as a list of atoms */
+    int *atoms;
+    int cnt;
+    int fd;			/* Which sub-font, -1 => global subr */
+};
+
+struct t2subr {
+    int len;			/* Number of atoms it replaces */
+    int atom;			/* The atom which calls it */
+    int uses;
+    int idx;			/* in the final subrs array, -1 => inline it */
+};
+
+struct t2state {
+    uint8 *pool;
+    int plen, pmax;
+    struct t2atom *atoms;
+    int acnt, amax;
+    int *hashed;
+    struct t2string *strs;	/* glyphs first, then subrs */
+    int scnt, smax;
+    int gcnt;			/* number of glyphs */
+    struct t2subr *subrs;	/* subr i is string gcnt+i */
+    int subrcnt;
+    int fdcnt;
+    int *fdsubrs;		/* subrs in each sub-font, [0] is global */
+    /* The command being parsed */
+    uint8 *cmd;
+    int clen, cmax;
+    double vals[T2_STACK];
+    int starts[T2_STACK];
+    int sp, stems, depth;
+};
+
+static void T2CmdAdd(struct t2state *st,const uint8 *bytes,int len) {
+    if ( st->clen+len>st->cmax )
+	st->cmd = grealloc(st->cmd,st->cmax = 2*st->cmax+len+100);
+    memcpy(st->cmd+st->clen,bytes,len);
+    st->clen += len;
+}
+
+static int T2AtomHash(const uint8 *bytes,int len) {
+    unsigned int hash = 0;
+    int i;
+
+    for ( i=0; i<len; ++i )
+	hash = hash*31 + bytes[i];
+return( hash&(T2_HASH-1) );
+}
+
+static int T2NewAtom(struct t2state *st) {
+    if ( st->acnt>=st->amax )
+	st->atoms = grealloc(st->atoms,(st->amax = 2*st->amax+1000)*sizeof(struct t2atom));
+    memset(&st->atoms[st->acnt],0,sizeof(struct t2atom));
+    st->atoms[st->acnt].subr = -1;
+    st->atoms[st->acnt].next = -1;
+return( st->acnt++ );
+}
+
+/* Find (or make) the atom for the command we've just finished parsing */
+static int T2Intern(struct t2state *st,int endchar) {
+    int hash = T2AtomHash(st->cmd,st->clen);
+    int a;
+
+    for ( a=st->hashed[hash]; a!=-1; a=st->atoms[a].next )
+	if ( st->atoms[a].len==st->clen &&
+		memcmp(st->pool+st->atoms[a].off,st->cmd,st->clen)==0 )
+return( a );
+    a = T2NewAtom(st);
+    if ( st->plen+st->clen>st->pmax )
+	st->pool = grealloc(st->pool,st->pmax = 2*st->pmax+st->clen+4000);
+    memcpy(st->pool+st->plen,st->cmd,st->clen);
+    st->atoms[a].off = st->plen;
+    st->atoms[a].len = st->clen;
+    st->atoms[a].endchar = endchar;
+    st->plen += st->clen;
+    st->atoms[a].next = st->hashed[hash];
+    st->hashed[hash] = a;
+return( a );
+}
+
+static void T2StringAdd(struct t2string *str,int *max,int atom) {
+    if ( str->cnt>=*max )
+	str->atoms = grealloc(str->atoms,(*max = 2**max+20)*sizeof(int));
+    str->atoms[str->cnt++] = atom;
+}
+
+/* Break a charstring into commands, expanding any subroutine calls as we */
+/*  go. Returns 1 when we reach an endchar, 0 at a return (or the end of the */
+/*  string), and -1 if it contains something we don't understand, in which */
+/*  case we leave the font alone */
+static int T2Flatten(struct t2state *st,struct t2string *out,int *max,
+	const uint8 *str,int len,struct pschars *local,struct pschars *global) {
+    int i, b0, b1, ret, n, idx;
+    struct pschars *subrs;
+    double val;
+
+    for ( i=0; i<len; ) {
+	b0 = str[i];
+	if ( b0>=32 || b0==28 ) {
+	    if ( b0>=32 && b0<=246 ) {
+		val = b0-139; n = 1;
+	    } else if ( b0>=247 && b0<=254 ) {
+		if ( i+1>=len )
+return( -1 );
+		if ( b0<251 )
+		    val = (b0-247)*256+str[i+1]+108;
+		else
+		    val = -(b0-251)*256-str[i+1]-108;
+		n = 2;
+	    } else if ( b0==28 ) {
+		if ( i+2>=len )
+return( -1 );
+		val = (short) ((str[i+1]<<8)|str[i+2]);
+		n = 3;
+	    } else {
+		if ( i+4>=len )
+return( -1 );
+		val = ((int32) ((str[i+1]<<24)|(str[i+2]<<16)|(str[i+3]<<8)|str[i+4]))/65536.0;
+		n = 5;
+	    }
+	    if ( st->sp>=T2_STACK )
+return( -1 );
+	    st->vals[st->sp] = val;
+	    st->starts[st->sp++] = st->clen;
+	    T2CmdAdd(st,str+i,n);
+	    i += n;
+	} else if ( b0==10 || b0==29 ) {		/* callsubr, callgsubr */
+	    subrs = b0==10 ? local : global;
+	    if ( st->sp==0 || subrs==NULL || st->depth>=10 )
+return( -1 );
+	    val = st->vals[--st->sp];
+	    st->clen = st->starts[st->sp];
+	    idx = (int) val;
+	    if ( idx!=val )
+return( -1 );
+	    idx += subrs->bias;
+	    if ( idx<0 || idx>=subrs->next )
+return( -1 );
+	    ++st->depth;
+	    ret = T2Flatten(st,out,max,subrs->values[idx],subrs->lens[idx],local,global);
+	    --st->depth;
+	    if ( ret!=0 )
+return( ret );
+	    ++i;
+	} else if ( b0==11 ) {			/* return */
+return( 0 );
+	} else if ( b0==12 ) {
+	    if ( i+1>=len )
+return( -1 );
+	    b1 = str[i+1];
+	    if ( b1==24 ) {
+		/* multiply. We use this to call subrs with huge numbers */
+		if ( st->sp<2 )
+return( -1 );
+		--st->sp;
+		st->vals[st->sp-1] *= st->vals[st->sp];
+		T2CmdAdd(st,str+i,2);
+	    } else if ( b1>=34 && b1<=37 ) {	/* flex */
+		T2CmdAdd(st,str+i,2);
+		T2StringAdd(out,max,T2Intern(st,false));
+		st->clen = st->sp = 0;
+	    } else
+return( -1 );	/* Arithmetic and storage, we don't generate them */
+	    i += 2;
+	} else {
+	    n = 1;
+	    if ( b0==1 || b0==3 || b0==18 || b0==23 )	/* the stem hints */
+		st->stems += st->sp/2;
+	    else if ( b0==19 || b0==20 ) {		/* hintmask, cntrmask */
+		st->stems += st->sp/2;			/* implied vstems */
+		n += (st->stems+7)/8;
+		if ( i+n>len )
+return( -1 );
+	    }
+	    T2CmdAdd(st,str+i,n);
+	    T2StringAdd(out,max,T2Intern(st,b0==14));
+	    st->clen = st->sp = 0;
+	    i += n;
+	    if ( b0==14 )			/* endchar */
+return( 1 );
+	}
+    }
+return( 0 );
+}
+
+static struct t2string *T2NewString(struct t2state *st,int fd) {
+    struct t2string *str;
+
+    if ( st->scnt>=st->smax )
+	st->strs = grealloc(st->strs,(st->smax = 2*st->smax+100)*sizeof(struct t2string));
+    str = &st->strs[st->scnt++];
+    memset(str,0,sizeof(*str));
+    str->fd = fd;
+return( str );
+}
+
+/* Suffix array of seq[0..n-1] by prefix doubling, where every value of seq */
+/*  is less than alpha. Leaves the rank of each suffix in rank. tmp is */
+/*  scratch space of n ints */
+static void T2SuffixArray(const int *seq,int n,int alpha,int *sa,int *rank,
+	int *tmp) {
+    int *cnts = gcalloc((alpha>n ? alpha : n)+1,sizeof(int));
+    int *newrank = galloc(n*sizeof(int));
+    int i, k, classes, a, b, ra, rb;
+
+    for ( i=0; i<n; ++i )
+	++cnts[seq[i]];
+    for ( i=1; i<alpha; ++i )
+	cnts[i] += cnts[i-1];
+    for ( i=n-1; i>=0; --i )
+	sa[--cnts[seq[i]]] = i;
+    rank[sa[0]] = 0;
+    for ( i=1; i<n; ++i )
+	rank[sa[i]] = rank[sa[i-1]] + (seq[sa[i]]!=seq[sa[i-1]]);
+    classes = rank[sa[n-1]]+1;
+
+    for ( k=1; classes<n; k<<=1 ) {
+	/* Order by the second half, the suffixes which don't have one first */
+	a = 0;
+	for ( i=n-k; i<n; ++i )
+	    tmp[a++] = i;
+	for ( i=0; i<n; ++i )
+	    if ( sa[i]>=k )
+		tmp[a++] = sa[i]-k;
+	/* then a stable sort by the first half */
+	memset(cnts,0,classes*sizeof(int));
+	for ( i=0; i<n; ++i )
+	    ++cnts[rank[i]];
+	for ( i=1; i<classes; ++i )
+	    cnts[i] += cnts[i-1];
+	for ( i=n-1; i>=0; --i )
+	    sa[--cnts[rank[tmp[i]]]] = tmp[i];
+	newrank[sa[0]] = 0;
+	for ( i=1; i<n; ++i ) {
+	    a = sa[i-1]; b = sa[i];
+	    ra = a+k<n ? rank[a+k] : -1;
+	    rb = b+k<n ? rank[b+k] : -1;
+	    newrank[b] = newrank[a] + (rank[a]!=rank[b] || ra!=rb);
+	}
+	memcpy(rank,newrank,n*sizeof(int));
+	classes = rank[sa[n-1]]+1;
+    }
+    free(newrank);
+    free(cnts);
+}
+
+struct t2cand {
+    int len;			/* in atoms */
+    int lb, rb;			/* its occurrences are sa[lb..rb] */
+    int bytes;
+    int saves;
+};
+
+static int t2cand_cmp(const void *_c1, const void *_c2) {
+    const struct t2cand *c1 = _c1, *c2 = _c2;
+
+    if ( c1->saves!=c2->saves )
+return( c2->saves - c1->saves );
+return( c1->lb - c2->lb );
+}
+
+static int int_cmp(const void *_i1, const void *_i2) {
+return( *(const int *) _i1 - *(const int *) _i2 );
+}
+
+static void T2AddCand(struct t2cand **cands,int *ccnt,int *cmax,int len,
+	int lb,int rb,const int *sa,const int *boff) {
+    int bytes = boff[sa[lb]+len]-boff[sa[lb]];
+    int cnt = rb-lb+1;
+    int saves = cnt*bytes - cnt*T2_CALLCOST - bytes - 1;
+
+    if ( saves<=0 )
+return;
+    if ( *ccnt>=*cmax )
+	*cands = grealloc(*cands,(*cmax = 2**cmax+1000)*sizeof(struct t2cand));
+    (*cands)[*ccnt].len = len;
+    (*cands)[*ccnt].lb = lb;
+    (*cands)[*ccnt].rb = rb;
+    (*cands)[*ccnt].bytes = bytes;
+    (*cands)[*ccnt].saves = saves;
+    ++*ccnt;
+}
+
+/* One round: find the repeated runs of atoms in all the strings we have */
+/*  now, pick the ones which save most (and don't overlap), make subrs of */
+/*  them and replace each use by a call. Returns the number of new subrs */
+static int T2Round(struct t2state *st) {
+    int i, j, k, n, p, s, scnt = st->scnt, alpha, ccnt=0, cmax=0, top, lb;
+    int *seq, *strof, *boff, *sa, *rank, *tmp, *lcp, *fen, *callat, *occ;
+    int *stk_lcp, *stk_lb, newsubrs = 0, fd, acc, lastend, saves, maxatoms;
+    int acnt = st->acnt;
+    struct t2cand *cands = NULL, *c;
+    struct t2string *str;
+
+    n = 0;
+    for ( s=0; s<scnt; ++s )
+	n += st->strs[s].cnt+1;
+    if ( n==0 )
+return( 0 );
+    seq = galloc(n*sizeof(int));
+    strof = galloc(n*sizeof(int));
+    boff = galloc((n+1)*sizeof(int));
+    /* Each string ends with a separator which matches nothing else */
+    for ( s=p=0; s<scnt; ++s ) {
+	for ( i=0; i<st->strs[s].cnt; ++i ) {
+	    seq[p] = st->strs[s].atoms[i];
+	    strof[p++] = s;
+	}
+	seq[p] = acnt+s;
+	strof[p++] = s;
+    }
+    alpha = acnt+scnt;
+    boff[0] = 0;
+    for ( p=0; p<n; ++p ) {
+	if ( seq[p]>=acnt )
+	    boff[p+1] = boff[p];
+	else if ( st->atoms[seq[p]].subr!=-1 )
+	    boff[p+1] = boff[p]+T2_CALLCOST;
+	else
+	    boff[p+1] = boff[p]+st->atoms[seq[p]].len;
+    }
+
+    sa = galloc(n*sizeof(int));
+    rank = galloc(n*sizeof(int));
+    tmp = galloc(n*sizeof(int));
+    T2SuffixArray(seq,n,alpha,sa,rank,tmp);
+
+    /* Longest common prefix of each suffix with the one before it (Kasai) */
+    lcp = tmp;
+    lcp[0] = 0;
+    for ( i=k=0; i<n; ++i ) {
+	if ( rank[i]==0 ) {
+	    k = 0;
+    continue;
+	}
+	j = sa[rank[i]-1];
+	while ( i+k<n && j+k<n && seq[i+k]==seq[j+k] )
+	    ++k;
+	lcp[rank[i]] = k;
+	if ( k>0 ) --k;
+    }
+
+    /* Every lcp interval is a run of atoms which occurs (at least) at each */
+    /*  suffix in the interval. Those are our candidates */
+    stk_lcp = galloc((n+1)*sizeof(int));
+    stk_lb = galloc((n+1)*sizeof(int));
+    top = 0;
+    stk_lcp[0] = 0; stk_lb[0] = 0;
+    for ( i=1; i<=n; ++i ) {
+	k = i<n ? lcp[i] : 0;
+	lb = i-1;
+	while ( k<stk_lcp[top] ) {
+	    lb = stk_lb[top];
+	    T2AddCand(&cands,&ccnt,&cmax,stk_lcp[top],lb,i-1,sa,boff);
+	    --top;
+	}
+	if ( k>stk_lcp[top] ) {
+	    ++top;
+	    stk_lcp[top] = k;
+	    stk_lb[top] = lb;
+	}
+    }
+    free(stk_lcp); free(stk_lb);
+    free(rank); free(tmp);
+
+    qsort(cands,ccnt,sizeof(struct t2cand),t2cand_cmp);
+
+    /* fen is a Fenwick tree counting the atoms already given to a subr */
+    fen = gcalloc(n+1,sizeof(int));
+    callat = galloc(n*sizeof(int));
+    memset(callat,-1,n*sizeof(int));
+    maxatoms = 0;
+    for ( i=0; i<ccnt; ++i )
+	if ( cands[i].rb-cands[i].lb+1>maxatoms )
+	    maxatoms = cands[i].rb-cands[i].lb+1;
+    occ = galloc((maxatoms+1)*sizeof(int));
+    for ( i=0; i<ccnt; ++i ) {
+	c = &cands[i];
+	k = c->rb-c->lb+1;
+	memcpy(occ,sa+c->lb,k*sizeof(int));
+	qsort(occ,k,sizeof(int),int_cmp);
+	acc = 0; lastend = -1; fd = -2;
+	for ( j=0; j<k; ++j ) {
+	    int used = 0;
+	    p = occ[j];
+	    if ( p<lastend )
+	continue;
+	    for ( s=p+c->len; s>0; s-=s&-s )
+		used += fen[s];
+	    for ( s=p; s>0; s-=s&-s )
+		used -= fen[s];
+	    if ( used!=0 )
+	continue;
+	    occ[acc++] = p;
+	    lastend = p+c->len;
+	    if ( fd==-2 )
+		fd = st->strs[strof[p]].fd;
+	    else if ( fd!=st->strs[strof[p]].fd )
+		fd = -1;
+	}
+	if ( acc<2 )
+    continue;
+	saves = acc*c->bytes - acc*T2_CALLCOST - c->bytes -
+		(st->atoms[seq[occ[0]+c->len-1]].endchar ? 0 : 1);
+	if ( saves<=0 || st->fdsubrs[fd+1]>=T2_MAXSUBRS )
+    continue;
+	++st->fdsubrs[fd+1];
+	st->subrs = grealloc(st->subrs,(st->subrcnt+1)*sizeof(struct t2subr));
+	memset(&st->subrs[st->subrcnt],0,sizeof(struct t2subr));
+	st->subrs[st->subrcnt].len = c->len;
+	st->subrs[st->subrcnt].atom = T2NewAtom(st);
+	st->atoms[st->subrs[st->subrcnt].atom].subr = st->subrcnt;
+	st->atoms[st->subrs[st->subrcnt].atom].endchar =
+		st->atoms[seq[occ[0]+c->len-1]].endchar;
+	str = T2NewString(st,fd);
+	str->cnt = c->len;
+	str->atoms = galloc(c->len*sizeof(int));
+	memcpy(str->atoms,seq+occ[0],c->len*sizeof(int));
+	for ( j=0; j<acc; ++j ) {
+	    callat[occ[j]] = st->subrcnt;
+	    for ( p=occ[j]; p<occ[j]+c->len; ++p )
+		for ( s=p+1; s<=n; s+=s&-s )
+		    ++fen[s];
+	}
+	++st->subrcnt;
+	++newsubrs;
+    }
+    free(occ); free(fen); free(cands);
+
+    /* Replace each run we've picked with a call */
+    if ( newsubrs!=0 ) {
+	for ( p=0; p<n; ) {
+	    str = &st->strs[strof[p]];
+	    str->cnt = 0;
+	    while ( seq[p]<acnt ) {
+		if ( callat[p]!=-1 ) {
+		    str->atoms[str->cnt++] = st->subrs[callat[p]].atom;
+		    p += st->subrs[callat[p]].len;
+		} else
+		    str->atoms[str->cnt++] = seq[p++];
+	    }
+	    ++p;			/* Skip the separator */
+	}
+    }
+    free(callat); free(seq); free(strof); free(boff); free(sa);
+return( newsubrs );
+}
+
+static void T2CountUses(struct t2state *st,int s) {
+    struct t2string *str = &st->strs[s];
+    struct t2subr *subr;
+    int i;
+
+    for ( i=0; i<str->cnt; ++i ) if ( st->atoms[str->atoms[i]].subr!=-1 ) {
+	subr = &st->subrs[st->atoms[str->atoms[i]].subr];
+	/* Count each subr's own calls just once */
+	if ( subr->uses++==0 )
+	    T2CountUses(st,st->gcnt+st->atoms[str->atoms[i]].subr);
+    }
+}
+
+static int T2NumLen(int num) {
+return( num>=-107 && num<=107 ? 1 : num>=-1131 && num<=1131 ? 2 : 3 );
+}
+
+static int T2Bias(int cnt) {
+return( cnt<1240 ? 107 : cnt<33900 ? 1131 : 32768 );
+}
+
+static ff_thread_local struct t2subr **_sort_subrs;
+static int uses_cmp(const void *_i1, const void *_i2) {
+    const struct t2subr *s1 = _sort_subrs[*(const int *) _i1];
+    const struct t2subr *s2 = _sort_subrs[*(const int *) _i2];
+
+    if ( s1->uses!=s2->uses )
+return( s2->uses - s1->uses );
+return( *(const int *) _i1 - *(const int *) _i2 );
+}
+
+static ff_thread_local int _slot_bias;
+static int slot_cmp(const void *_i1, const void *_i2) {
+    int l1 = T2NumLen(*(const int *) _i1 - _slot_bias);
+    int l2 = T2NumLen(*(const int *) _i2 - _slot_bias);
+
+    if ( l1!=l2 )
+return( l1-l2 );
+return( *(const int *) _i1 - *(const int *) _i2 );
+}
+
+/* Put the subrs which are called most often where they take fewest bytes */
+/*  to call */
+static void T2Number(struct t2state *st,int fd,int *biases) {
+    int i, cnt=0, *order, *slots;
+    struct t2subr **subrs = galloc(st->subrcnt*sizeof(struct t2subr *));
+
+    order = galloc(st->subrcnt*sizeof(int));
+    for ( i=0; i<st->subrcnt; ++i ) {
+	subrs[i] = &st->subrs[i];
+	if ( st->subrs[i].idx!=-1 && st->strs[st->gcnt+i].fd==fd )
+	    order[cnt++] = i;
+    }
+    _sort_subrs = subrs;
+    qsort(order,cnt,sizeof(int),uses_cmp);
+    slots = galloc((cnt+1)*sizeof(int));
+    for ( i=0; i<cnt; ++i )
+	slots[i] = i;
+    _slot_bias = biases[fd+1] = T2Bias(cnt);
+    qsort(slots,cnt,sizeof(int),slot_cmp);
+    for ( i=0; i<cnt; ++i )
+	st->subrs[order[i]].idx = slots[i];
+    free(slots); free(order); free(subrs);
+}
+
+static void T2Encode(struct t2state *st,GrowBuf *gb,int s,int *biases) {
+    struct t2string *str = &st->strs[s];
+    struct t2atom *atom;
+    struct t2subr *subr;
+    int i, num, fd;
+
+    for ( i=0; i<str->cnt; ++i ) {
+	atom = &st->atoms[str->atoms[i]];
+	if ( atom->subr==-1 ) {
+	    while ( gb->pt+atom->len>=gb->end )
+		GrowBuffer(gb);
+	    memcpy(gb->pt,st->pool+atom->off,atom->len);
+	    gb->pt += atom->len;
+    continue;
+	}
+	subr = &st->subrs[atom->subr];
+	if ( subr->idx==-1 ) {
+	    T2Encode(st,gb,st->gcnt+atom->subr,biases);
+    continue;
+	}
+	fd = st->strs[st->gcnt+atom->subr].fd;
+	num = subr->idx - biases[fd+1];
+	while ( gb->pt+4>=gb->end )
+	    GrowBuffer(gb);
+	if ( num>=-107 && num<=107 )
+	    *gb->pt++ = num+139;
+	else if ( num>0 && num<=1131 ) {
+	    num -= 108;
+	    *gb->pt++ = (num>>8)+247;
+	    *gb->pt++ = num&0xff;
+	} else if ( num<0 && num>=-1131 ) {
+	    num = -num-108;
+	    *gb->pt++ = (num>>8)+251;
+	    *gb->pt++ = num&0xff;
+	} else {
+	    *gb->pt++ = 28;
+	    *gb->pt++ = (num>>8)&0xff;
+	    *gb->pt++ = num&0xff;
+	}
+	*gb->pt++ = fd==-1 ? 29 : 10;
+    }
+}
+
+static uint8 *T2Finish(struct t2state *st,GrowBuf *gb,int s,int *biases,
+	int ret,int *len) {
+    struct t2string *str = &st->strs[s];
+    uint8 *data;
+
+    gb->pt = gb->base;
+    T2Encode(st,gb,s,biases);
+    if ( ret && (str->cnt==0 || !st->atoms[str->atoms[str->cnt-1]].endchar) ) {
+	while ( gb->pt+1>=gb->end )
+	    GrowBuffer(gb);
+	*gb->pt++ = 11;		/* return */
+    }
+    *len = gb->pt-gb->base;
+    data = galloc(*len+1);
+    memcpy(data,gb->base,*len);
+    data[*len] = '\0';
+return( data );
+}
+
+static void T2StateFree(struct t2state *st) {
+    int i;
+
+    for ( i=0; i<st->scnt; ++i )
+	free(st->strs[i].atoms);
+    free(st->strs);
+    free(st->subrs);
+    free(st->atoms);
+    free(st->pool);
+    free(st->hashed);
+    free(st->fdsubrs);
+    free(st->cmd);
+}
+
+/* Replace the subroutines in a set of type2 charstrings with ones found by */
+/*  searching the whole font. fdsel gives the sub-font of each glyph (NULL */
+/*  if there is only one), locals the local subrs of each sub-font, and */
+/*  glbls the global subrs (NULL if we should not use any). The old subrs */
+/*  are freed and replaced by new ones. Returns false (and leaves everything */
+/*  as it was) if we don't understand the charstrings */
+int Type2Subroutinize(struct pschars *chrs,const int *fdsel,int fdcnt,
+	struct pschars **locals,struct pschars **glbls) {
+    struct t2state st;
+    struct t2string *str;
+    struct pschars *subrs, *global = glbls==NULL ? NULL : *glbls;
+    int i, s, fd, max, ret, *biases;
+    GrowBuf gb;
+
+    memset(&st,0,sizeof(st));
+    st.hashed = galloc(T2_HASH*sizeof(int));
+    memset(st.hashed,-1,T2_HASH*sizeof(int));
+    st.fdcnt = fdcnt;
+    st.fdsubrs = gcalloc(fdcnt+1,sizeof(int));
+    for ( i=0; i<chrs->next; ++i ) {
+	fd = fdsel==NULL ? 0 : fdsel[i];
+	str = T2NewString(&st,fd);
+	if ( chrs->values[i]==NULL )
+    continue;
+	max = 0;
+	st.clen = st.sp = st.stems = st.depth = 0;
+	ret = T2Flatten(&st,str,&max,chrs->values[i],chrs->lens[i],locals[fd],global);
+	if ( ret==-1 || (ret==0 && st.clen!=0) ) {
+	    T2StateFree(&st);
+return( false );
+	}
+    }
+    st.gcnt = st.scnt;
+
+    for ( i=0; i<T2_ROUNDS; ++i )
+	if ( T2Round(&st)==0 )
+    break;
+
+    /* A subr called from only one place is better inline */
+    for ( i=0; i<st.gcnt; ++i )
+	T2CountUses(&st,i);
+    for ( i=0; i<st.subrcnt; ++i )
+	st.subrs[i].idx = st.subrs[i].uses<2 ? -1 : 0;
+    biases = galloc((fdcnt+1)*sizeof(int));
+    for ( fd=-1; fd<fdcnt; ++fd )
+	T2Number(&st,fd,biases);
+
+    memset(&gb,0,sizeof(gb));
+    for ( i=0; i<st.gcnt; ++i ) if ( chrs->values[i]!=NULL ) {
+	free(chrs->values[i]);
+	chrs->values[i] = T2Finish(&st,&gb,i,biases,false,&chrs->lens[i]);
+    }
+    for ( fd=-1; fd<fdcnt; ++fd ) {
+	if ( fd==-1 && glbls==NULL )
+    continue;
+	subrs = gcalloc(1,sizeof(struct pschars));
+	for ( i=0; i<st.subrcnt; ++i )
+	    if ( st.subrs[i].idx!=-1 && st.strs[st.gcnt+i].fd==fd )
+		++subrs->cnt;
+	subrs->next = subrs->cnt;
+	subrs->lens = galloc(subrs->cnt*sizeof(int));
+	subrs->values = galloc(subrs->cnt*sizeof(uint8 *));
+	subrs->bias = biases[fd+1];
+	for ( i=0; i<st.subrcnt; ++i ) {
+	    s = st.subrs[i].idx;
+	    if ( s!=-1 && st.strs[st.gcnt+i].fd==fd )
+		subrs->values[s] = T2Finish(&st,&gb,st.gcnt+i,biases,true,&subrs->lens[s]);
+	}
+	if ( fd==-1 ) {
+	    PSCharsFree(*glbls);
+	    *glbls = subrs;
+	} else {
+	    PSCharsFree(locals[fd]);
+	    locals[fd] = subrs;
+	}
+    }
+    free(gb.base);
+    free(biases);
+    T2StateFree(&st);
+return( true );
+}
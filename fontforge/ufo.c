@@ -95,7 +95,11 @@ static void DumpPythonLib(FILE *file,void *python_persistent,SplineChar *sc) {
     PyObject *dict = python_persistent, *items, *key, *value;
     int i, len;
     char *str;
+    /* Fonts may be saved with the interpreter lock let go */
+    PyGILState_STATE gstate = PyGILState_UNLOCKED;
 
+    if ( dict!=NULL )
+	gstate = PyGILState_Ensure();
     if ( has_hints || (dict!=NULL && PyMapping_Check(dict)) ) {
 	if ( sc!=NULL ) {
 	    fprintf( file, "  <lib>\n" );
@@ -161,6 +165,10 @@ static void DumpPythonLib(FILE *file,void *python_persistent,SplineChar *sc) {
 	    fprintf( file, "  </lib>\n" );
 	}
     }
+#ifndef _NO_PYTHON
+    if ( dict!=NULL )
+	PyGILState_Release(gstate);
+#endif
 }
 
 #ifndef _NO_PYTHON
@@ -376,7 +384,14 @@ static void PListOutputBoolean(FILE *plist, char *key, int value) {
 }
 
 static void PListOutputDate(FILE *plist, char *key, time_t timestamp) {
-    struct tm *tm = gmtime(&timestamp);
+    struct tm *tm, tmbuf;
+
+#if defined(__MINGW32__)
+    tmbuf = *gmtime(&timestamp);
+    tm = &tmbuf;
+#else
+    tm = gmtime_r(&timestamp,&tmbuf);
+#endif
 
     fprintf( plist, "\t<key>%s</key>\n", key );
     fprintf( plist, "\t<string>%4d/%02d/%02d %02d:%02d:%02d</string>\n",
@@ -725,13 +740,19 @@ return( PListOutputTrailer(plist));
 
 static int UFOOutputLib(char *basedir,SplineFont *sf) {
 #ifndef _NO_PYTHON
-    if ( sf->python_persistent!=NULL && PyMapping_Check(sf->python_persistent) ) {
-	FILE *plist = PListCreate( basedir, "lib.plist" );
-
-	if ( plist==NULL )
+    if ( sf->python_persistent!=NULL ) {
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	int ismap = PyMapping_Check(sf->python_persistent);
+	FILE *plist;
+
+	PyGILState_Release(gstate);
+	if ( ismap ) {
+	    plist = PListCreate( basedir, "lib.plist" );
+	    if ( plist==NULL )
 return( false );
-	DumpPythonLib(plist,sf->python_persistent,NULL);
+	    DumpPythonLib(plist,sf->python_persistent,NULL);
 return( PListOutputTrailer(plist));
+	}
     }
 #endif
 return( true );
@@ -1416,7 +1437,9 @@ return( NULL );
 		    }
 		}
 #ifndef _NO_PYTHON
+		{ PyGILState_STATE gstate = PyGILState_Ensure();
 		sc->python_persistent = LibToPython(doc,dict);
+		PyGILState_Release(gstate); }
 #endif
 	    }
 	}
@@ -1711,7 +1734,8 @@ SplineFont *SFReadUFO(char *basedir, int flags) {
     xmlChar *keyname, *valname;
     char *stylename=NULL;
     char *temp, *glyphlist, *glyphdir;
-    char oldloc[24], *end;
+    CLocaleSave oldloc;
+    char *end;
     int as = -1, ds= -1, em= -1;
 
     if ( !libxml_init_base()) {
@@ -1744,8 +1768,7 @@ return( NULL );
     }
 
     sf = SplineFontEmpty();
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     for ( keys=dict->children; keys!=NULL; keys=keys->next ) {
 	for ( value = keys->next; value!=NULL && _xmlStrcmp(value->name,(const xmlChar *) "text")==0;
 		value = value->next );
@@ -1961,7 +1984,7 @@ return( NULL );
     if ( em==-1 ) {
 	LogError( _("This font does not specify unitsPerEm\n") );
 	_xmlFreeDoc(doc);
-	setlocale(LC_NUMERIC,oldloc);
+	SwitchFromCLocale(&oldloc);
 	SplineFontFree(sf);
 return( NULL );
     }
@@ -2022,19 +2045,21 @@ return( NULL );
 		dict==NULL ) {
 	    LogError(_("Expected property list file"));
 	} else {
+	    PyGILState_STATE gstate = PyGILState_Ensure();
 	    sf->python_persistent = LibToPython(doc,dict);
+	    PyGILState_Release(gstate);
 	}
 	_xmlFreeDoc(doc);
     }
 #endif
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 return( sf );
 }
 
 SplineSet *SplinePointListInterpretGlif(char *filename,char *memory, int memlen,
 	int em_size,int ascent,int is_stroked) {
     xmlDocPtr doc;
-    char oldloc[24];
+    CLocaleSave oldloc;
     SplineChar *sc;
     SplineSet *ss;
 
@@ -2049,10 +2074,9 @@ return( NULL );
     if ( doc==NULL )
 return( NULL );
 
-    strcpy( oldloc,setlocale(LC_NUMERIC,NULL) );
-    setlocale(LC_NUMERIC,"C");
+    SwitchToCLocale(&oldloc);
     sc = _UFOLoadGlyph(doc,filename);
-    setlocale(LC_NUMERIC,oldloc);
+    SwitchFromCLocale(&oldloc);
 
     if ( sc==NULL )
 return( NULL );
@@ -124,9 +124,12 @@ struct ui_interface {
     int (*stroke_flags)(void);
 };
 extern struct ui_interface *ui_interface;
+/* The same, except in the worker threads of ThreadedForEach, which queue */
+/*  their messages until the main thread can pass them on */
+extern struct ui_interface *ThreadUiInterface(void);
 
-#define IError			(ui_interface->ierror)
-#define LogError		(ui_interface->logwarning)
+#define IError			(ThreadUiInterface()->ierror)
+#define LogError		(ThreadUiInterface()->logwarning)
 #define ff_post_notice		(ui_interface->post_warning)
 #define ff_post_error		(ui_interface->post_error)
 #define ff_ask			(ui_interface->ask)
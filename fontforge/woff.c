@@ -463,7 +463,7 @@ return( 0 );
 
     format = sf->subfonts!=NULL ? ff_otfcid :
 		sf->layers[layer].order2 ? ff_ttf : ff_otf;
-    sfnt = tmpfile();
+    sfnt = MemTmpFile();
     ret = _WriteTTFFont(sfnt,sf,format,bsizes,bf,flags,enc,layer);
     if ( !ret ) {
 	fclose(sfnt);
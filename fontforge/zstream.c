@@ -0,0 +1,412 @@
+/* Copyright (C) 2012 by George Williams */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+
+ * The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "fontforgevw.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Compressed fonts (.gz, .bz2) used to be handed to gunzip or bunzip2, */
+/*  which wrote the font out into a temporary file for us to read. If we */
+/*  can find zlib and libbz2 we do the work ourselves now, decompressing */
+/*  into a stream held in memory (see MemTmpFile) which the readers can */
+/*  seek about in as they please. Compressed sfd files are written the same */
+/*  way. Anything else (.Z, .lzma), or a library we can't find, still goes */
+/*  through the external programs */
+
+#define Z_CHUNK	65536
+
+#ifdef _NO_LIBPNG
+static int haszlib(void) {
+return( false );
+}
+
+static int zinflate(FILE *to,FILE *from) {
+return( false );
+}
+
+static int zdeflate(FILE *to,FILE *from) {
+return( false );
+}
+#else
+# if !defined(_STATIC_LIBPNG) && !defined(NODYNAMIC)
+#  include <dynamic.h>
+# endif
+# include <zlib.h>
+
+# if !defined(_STATIC_LIBPNG) && !defined(NODYNAMIC)
+
+static DL_CONST void *zlib=NULL;
+static int (*_inflateInit2_)(z_stream *,int,const char *,int);
+static int (*_inflate)(z_stream *,int flags);
+static int (*_inflateReset)(z_stream *);
+static int (*_inflateEnd)(z_stream *);
+static int (*_deflateInit2_)(z_stream *,int,int,int,int,int,const char *,int);
+static int (*_deflate)(z_stream *,int flags);
+static int (*_deflateEnd)(z_stream *);
+
+static int _haszlib(void) {
+    if ( (zlib = dlopen("libz" SO_EXT,RTLD_GLOBAL|RTLD_LAZY))==NULL ) {
+	LogError( "%s", dlerror());
+return( false );
+    }
+    _inflateInit2_ = (int (*)(z_stream *,int,const char *,int)) dlsym(zlib,"inflateInit2_");
+    _inflate = (int (*)(z_stream *,int )) dlsym(zlib,"inflate");
+    _inflateReset = (int (*)(z_stream *)) dlsym(zlib,"inflateReset");
+    _inflateEnd = (int (*)(z_stream *)) dlsym(zlib,"inflateEnd");
+    _deflateInit2_ = (int (*)(z_stream *,int,int,int,int,int,const char *,int)) dlsym(zlib,"deflateInit2_");
+    _deflate = (int (*)(z_stream *,int )) dlsym(zlib,"deflate");
+    _deflateEnd = (int (*)(z_stream *)) dlsym(zlib,"deflateEnd");
+    if ( _inflateInit2_==NULL || _inflate==NULL || _inflateReset==NULL ||
+	    _inflateEnd==NULL || _deflateInit2_==NULL || _deflate==NULL ||
+	    _deflateEnd==NULL ) {
+	LogError( "%s", dlerror());
+	dlclose(zlib); zlib=NULL;
+return( false );
+    }
+return( true );
+}
+
+/* Several threads may open compressed fonts at once */
+#  ifdef HAVE_PTHREAD_H
+#   include <pthread.h>
+static pthread_once_t zlib_once = PTHREAD_ONCE_INIT;
+static int zlib_ok;
+
+static void zlibinit(void) {
+    zlib_ok = _haszlib();
+}
+
+static int haszlib(void) {
+    pthread_once(&zlib_once,zlibinit);
+return( zlib_ok );
+}
+#  else
+static int haszlib(void) {
+    static int tried = false, ok;
+
+    if ( !tried ) {
+	ok = _haszlib();
+	tried = true;
+    }
+return( ok );
+}
+#  endif
+
+/* Grump. zlib defines these as macros */
+#define _inflateInit2(strm,bits) \
+        _inflateInit2_((strm),(bits),        ZLIB_VERSION, sizeof(z_stream))
+#define _deflateInit2(strm,level,method,bits,mem,strategy) \
+        _deflateInit2_((strm),(level),(method),(bits),(mem),(strategy), ZLIB_VERSION, sizeof(z_stream))
+
+# else
+/* Either statically linked, or loaded at start up */
+static int haszlib(void) {
+return( true );
+}
+
+#define _inflateInit2	inflateInit2
+#define _inflate	inflate
+#define _inflateReset	inflateReset
+#define _inflateEnd	inflateEnd
+#define _deflateInit2	deflateInit2
+#define _deflate	deflate
+#define _deflateEnd	deflateEnd
+
+# endif /* !defined(_STATIC_LIBPNG) && !defined(NODYNAMIC) */
+
+/* Adding 32 to the window bits makes zlib look for a gzip (or zlib) header */
+/*  itself. A gzip file may be several members one after another */
+static int zinflate(FILE *to,FILE *from) {
+    uint8 *in, *out;
+    z_stream strm;
+    int ret = Z_OK, len, full = false;
+
+    memset(&strm,0,sizeof(strm));
+    if ( _inflateInit2(&strm,MAX_WBITS+32)!=Z_OK )
+return( false );
+    in = galloc(Z_CHUNK); out = galloc(Z_CHUNK);
+    forever {
+	/* If the output filled up, zlib may have more for us without input */
+	if ( strm.avail_in==0 && !full ) {
+	    strm.avail_in = fread(in,1,Z_CHUNK,from);
+	    strm.next_in = in;
+	    if ( strm.avail_in==0 )
+    break;
+	}
+	if ( ret==Z_STREAM_END )
+	    _inflateReset(&strm);
+	strm.avail_out = Z_CHUNK;
+	strm.next_out = out;
+	ret = _inflate(&strm,Z_NO_FLUSH);
+	if ( ret!=Z_OK && ret!=Z_STREAM_END && ret!=Z_BUF_ERROR )
+    break;
+	len = Z_CHUNK-strm.avail_out;
+	if ( len!=0 && fwrite(out,1,len,to)!=len ) {
+	    ret = Z_ERRNO;
+    break;
+	}
+	full = strm.avail_out==0 && ret!=Z_STREAM_END;
+    }
+    _inflateEnd(&strm);
+    free(in); free(out);
+return( ret==Z_STREAM_END );
+}
+
+/* Adding 16 to the window bits gets us a gzip header rather than a zlib one */
+static int zdeflate(FILE *to,FILE *from) {
+    uint8 *in, *out;
+    z_stream strm;
+    int ret, flush, len;
+
+    memset(&strm,0,sizeof(strm));
+    if ( _deflateInit2(&strm,Z_DEFAULT_COMPRESSION,Z_DEFLATED,MAX_WBITS+16,8,
+	    Z_DEFAULT_STRATEGY)!=Z_OK )
+return( false );
+    in = galloc(Z_CHUNK); out = galloc(Z_CHUNK);
+    do {
+	strm.avail_in = fread(in,1,Z_CHUNK,from);
+	strm.next_in = in;
+	flush = feof(from) || ferror(from) ? Z_FINISH : Z_NO_FLUSH;
+	do {
+	    strm.avail_out = Z_CHUNK;
+	    strm.next_out = out;
+	    ret = _deflate(&strm,flush);
+	    len = Z_CHUNK-strm.avail_out;
+	    if ( len!=0 && fwrite(out,1,len,to)!=len )
+		ret = Z_ERRNO;
+	} while ( strm.avail_out==0 && ret!=Z_ERRNO );
+    } while ( flush!=Z_FINISH && ret!=Z_ERRNO );
+    _deflateEnd(&strm);
+    free(in); free(out);
+return( ret==Z_STREAM_END && !ferror(from) );
+}
+#endif /* _NO_LIBPNG */
+
+/* We only look for libbz2 when we can load it as we need it */
+#if defined(_NO_LIBBZ2) || defined(NODYNAMIC)
+static int hasbz2(void) {
+return( false );
+}
+
+static int bz2inflate(FILE *to,FILE *from) {
+return( false );
+}
+
+static int bz2deflate(FILE *to,FILE *from) {
+return( false );
+}
+#else
+# include <dynamic.h>
+# include <bzlib.h>
+
+static DL_CONST void *bz2lib=NULL;
+static int (*_BZ2_bzDecompressInit)(bz_stream *,int,int);
+static int (*_BZ2_bzDecompress)(bz_stream *);
+static int (*_BZ2_bzDecompressEnd)(bz_stream *);
+static int (*_BZ2_bzCompressInit)(bz_stream *,int,int,int);
+static int (*_BZ2_bzCompress)(bz_stream *,int);
+static int (*_BZ2_bzCompressEnd)(bz_stream *);
+
+static int _hasbz2(void) {
+    if ( (bz2lib = dlopen("libbz2" SO_EXT,RTLD_GLOBAL|RTLD_LAZY))==NULL ) {
+	LogError( "%s", dlerror());
+return( false );
+    }
+    _BZ2_bzDecompressInit = (int (*)(bz_stream *,int,int)) dlsym(bz2lib,"BZ2_bzDecompressInit");
+    _BZ2_bzDecompress = (int (*)(bz_stream *)) dlsym(bz2lib,"BZ2_bzDecompress");
+    _BZ2_bzDecompressEnd = (int (*)(bz_stream *)) dlsym(bz2lib,"BZ2_bzDecompressEnd");
+    _BZ2_bzCompressInit = (int (*)(bz_stream *,int,int,int)) dlsym(bz2lib,"BZ2_bzCompressInit");
+    _BZ2_bzCompress = (int (*)(bz_stream *,int)) dlsym(bz2lib,"BZ2_bzCompress");
+    _BZ2_bzCompressEnd = (int (*)(bz_stream *)) dlsym(bz2lib,"BZ2_bzCompressEnd");
+    if ( _BZ2_bzDecompressInit==NULL || _BZ2_bzDecompress==NULL ||
+	    _BZ2_bzDecompressEnd==NULL || _BZ2_bzCompressInit==NULL ||
+	    _BZ2_bzCompress==NULL || _BZ2_bzCompressEnd==NULL ) {
+	LogError( "%s", dlerror());
+	dlclose(bz2lib); bz2lib=NULL;
+return( false );
+    }
+return( true );
+}
+
+# ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+static pthread_once_t bz2_once = PTHREAD_ONCE_INIT;
+static int bz2_ok;
+
+static void bz2init(void) {
+    bz2_ok = _hasbz2();
+}
+
+static int hasbz2(void) {
+    pthread_once(&bz2_once,bz2init);
+return( bz2_ok );
+}
+# else
+static int hasbz2(void) {
+    static int tried = false, ok;
+
+    if ( !tried ) {
+	ok = _hasbz2();
+	tried = true;
+    }
+return( ok );
+}
+# endif
+
+/* Like gzip, bzip2 files may hold several streams one after another */
+static int bz2inflate(FILE *to,FILE *from) {
+    char *in, *out;
+    bz_stream strm;
+    int ret = BZ_OK, len, full = false;
+
+    memset(&strm,0,sizeof(strm));
+    if ( _BZ2_bzDecompressInit(&strm,0,0)!=BZ_OK )
+return( false );
+    in = galloc(Z_CHUNK); out = galloc(Z_CHUNK);
+    forever {
+	if ( strm.avail_in==0 && !full ) {
+	    strm.avail_in = fread(in,1,Z_CHUNK,from);
+	    strm.next_in = in;
+	    if ( strm.avail_in==0 )
+    break;
+	}
+	if ( ret==BZ_STREAM_END ) {
+	    /* Decompressors can't be reset, start another */
+	    int avail = strm.avail_in;
+	    char *next = strm.next_in;
+	    _BZ2_bzDecompressEnd(&strm);
+	    memset(&strm,0,sizeof(strm));
+	    if ( _BZ2_bzDecompressInit(&strm,0,0)!=BZ_OK ) {
+		ret = BZ_MEM_ERROR;
+    break;
+	    }
+	    strm.avail_in = avail;
+	    strm.next_in = next;
+	}
+	strm.avail_out = Z_CHUNK;
+	strm.next_out = out;
+	ret = _BZ2_bzDecompress(&strm);
+	if ( ret!=BZ_OK && ret!=BZ_STREAM_END )
+    break;
+	len = Z_CHUNK-strm.avail_out;
+	if ( len!=0 && fwrite(out,1,len,to)!=len ) {
+	    ret = BZ_IO_ERROR;
+    break;
+	}
+	full = strm.avail_out==0 && ret!=BZ_STREAM_END;
+    }
+    _BZ2_bzDecompressEnd(&strm);
+    free(in); free(out);
+return( ret==BZ_STREAM_END );
+}
+
+static int bz2deflate(FILE *to,FILE *from) {
+    char *in, *out;
+    bz_stream strm;
+    int ret, action, len;
+
+    memset(&strm,0,sizeof(strm));
+    if ( _BZ2_bzCompressInit(&strm,9,0,0)!=BZ_OK )
+return( false );
+    in = galloc(Z_CHUNK); out = galloc(Z_CHUNK);
+    do {
+	strm.avail_in = fread(in,1,Z_CHUNK,from);
+	strm.next_in = in;
+	action = feof(from) || ferror(from) ? BZ_FINISH : BZ_RUN;
+	do {
+	    strm.avail_out = Z_CHUNK;
+	    strm.next_out = out;
+	    ret = _BZ2_bzCompress(&strm,action);
+	    len = Z_CHUNK-strm.avail_out;
+	    if ( len!=0 && fwrite(out,1,len,to)!=len )
+		ret = BZ_IO_ERROR;
+	} while ( ret>=0 && (action==BZ_RUN ? strm.avail_in!=0 : ret!=BZ_STREAM_END) );
+    } while ( action!=BZ_FINISH && ret>=0 );
+    _BZ2_bzCompressEnd(&strm);
+    free(in); free(out);
+return( ret==BZ_STREAM_END && !ferror(from) );
+}
+#endif /* _NO_LIBBZ2 || NODYNAMIC */
+
+static int zkind(int compression) {
+    extern struct compressors compressors[];
+    char *ext = compressors[compression].ext;
+
+    if ( strcmp(ext,".gz")==0 )
+return( 'z' );
+    else if ( strcmp(ext,".bz2")==0 || strcmp(ext,".bz")==0 )
+return( 'b' );
+return( 0 );
+}
+
+/* Can we do this (index into compressors[]) ourselves? */
+int InProcessCompression(int compression) {
+    switch ( zkind(compression) ) {
+      case 'z':
+return( haszlib());
+      case 'b':
+return( hasbz2());
+    }
+return( false );
+}
+
+/* Returns a stream of the decompressed contents of from, positioned at its */
+/*  start. Returns NULL if we can't, in which case from is back at its start */
+FILE *DecompressStream(FILE *from,int compression) {
+    FILE *to;
+    int ok;
+
+    if ( !InProcessCompression(compression))
+return( NULL );
+    if ( (to = MemTmpFile())==NULL )
+return( NULL );
+    rewind(from);
+    if ( zkind(compression)=='z' )
+	ok = zinflate(to,from);
+    else
+	ok = bz2inflate(to,from);
+    if ( !ok || fflush(to)!=0 ) {
+	fclose(to);
+	rewind(from);
+return( NULL );
+    }
+    rewind(to);
+return( to );
+}
+
+/* Compresses everything in from (from its start) into to */
+int CompressStream(FILE *to,FILE *from,int compression) {
+    int ok;
+
+    if ( !InProcessCompression(compression))
+return( false );
+    rewind(from);
+    if ( zkind(compression)=='z' )
+	ok = zdeflate(to,from);
+    else
+	ok = bz2deflate(to,from);
+return( ok && fflush(to)==0 );
+}
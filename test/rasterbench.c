@@ -0,0 +1,131 @@
+/* Copyright (C) 2012 by George Williams */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+
+ * The name of the author may not be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Times the internal rasterizer on every glyph of a font, and checks that
+ *  BDFCAntiAlias produces the same greymaps as the simple bit at a time loop
+ *  it used to use.
+ * Build it against an already built library, something like:
+ *  gcc -O2 -DHAVE_CONFIG_H -I../inc -I../fontforge rasterbench.c \
+ *	-L../fontforge/.libs -lfontforge -lgutils -lgunicode -lm -o rasterbench
+ * and run it as
+ *  rasterbench font pixelsize [linear_scale [repeats]]
+ */
+#include "fontforgevw.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+extern void doinitFontForgeMain(void);
+extern void InitSimpleStuff(void);
+
+static double Now(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv,NULL);
+return( tv.tv_sec + tv.tv_usec/1000000.0 );
+}
+
+static uint8 *SlowAntiAlias(BDFChar *bc, int linear_scale) {
+    /* What BDFCAntiAlias did with bitmaps before it counted bits a byte at */
+    /*  a time */
+    int i,j, max = linear_scale*linear_scale-1;
+    int xmin = floor( ((real) bc->xmin)/linear_scale );
+    int ymin = floor( ((real) bc->ymin)/linear_scale );
+    int xmax = xmin + (bc->xmax-bc->xmin+linear_scale-1)/linear_scale;
+    int ymax = ymin + (bc->ymax-bc->ymin+linear_scale-1)/linear_scale;
+    int bpl = xmax-xmin+1;
+    uint8 *bitmap = calloc((ymax-ymin+1)*bpl,1), *bpt, *pt;
+
+    for ( i=0; i<=bc->ymax-bc->ymin; ++i ) {
+	bpt = bc->bitmap + i*bc->bytes_per_line;
+	pt = bitmap + (i/linear_scale)*bpl;
+	for ( j=0; j<=bc->xmax-bc->xmin; ++j ) {
+	    if ( bpt[(j>>3)] & (1<<(7-(j&7))) )
+		if ( pt[ j/linear_scale ]!=max )
+		    ++pt[ j/linear_scale ];
+	}
+    }
+return( bitmap );
+}
+
+int main(int argc, char **argv) {
+    SplineFont *sf;
+    BDFChar *bc;
+    int i, rep, size, ls, reps, len, cnt=0, bad=0;
+    uint8 *slow;
+    double t, traster=0, tslow=0, tfast=0;
+
+    if ( argc<3 ) {
+	fprintf( stderr, "Usage: %s font pixelsize [linear_scale [repeats]]\n", argv[0] );
+return( 1 );
+    }
+    size = strtol(argv[2],NULL,10);
+    ls = argc>3 ? strtol(argv[3],NULL,10) : 4;
+    reps = argc>4 ? strtol(argv[4],NULL,10) : 3;
+
+    InitSimpleStuff();
+    doinitFontForgeMain();
+    sf = LoadSplineFont(argv[1],0);
+    if ( sf==NULL ) {
+	fprintf( stderr, "Could not open %s\n", argv[1] );
+return( 1 );
+    }
+
+    for ( rep=0; rep<reps; ++rep ) {
+	for ( i=0; i<sf->glyphcnt; ++i ) if ( SCWorthOutputting(sf->glyphs[i]) ) {
+	    t = Now();
+	    bc = SplineCharRasterize(sf->glyphs[i],ly_fore,size*ls);
+	    traster += Now()-t;
+	    if ( bc==NULL )
+	continue;
+	    t = Now();
+	    slow = SlowAntiAlias(bc,ls);
+	    tslow += Now()-t;
+	    t = Now();
+	    BDFCAntiAlias(bc,ls);
+	    tfast += Now()-t;
+	    len = (bc->ymax-bc->ymin+1)*bc->bytes_per_line;
+	    if ( memcmp(slow,bc->bitmap,len)!=0 ) {
+		if ( rep==0 )
+		    fprintf( stderr, "Greymaps differ for %s\n", sf->glyphs[i]->name );
+		++bad;
+	    }
+	    free(slow);
+	    BDFCharFree(bc);
+	    ++cnt;
+	}
+    }
+    printf( "%d glyphs at %d pixels, scale %d\n", cnt, size, ls );
+    printf( "  rasterize           %8.3fs\n", traster );
+    printf( "  anti-alias (old)    %8.3fs\n", tslow );
+    printf( "  anti-alias (new)    %8.3fs\n", tfast );
+    if ( bad!=0 )
+	printf( "  %d greymaps differ\n", bad );
+return( bad!=0 );
+}
@@ -0,0 +1,77 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd fonts/QuadOverlapBugs.sfd
+
+# Packed layers give the points of a layer as flat arrays. Check they agree
+# with the contour objects, and that setting a layer from them gives the same
+# outlines as setting it from the contour objects
+
+import fontforge, struct;
+
+def points(layer):
+  return [[(p.x,p.y,p.on_curve) for p in c] for c in layer];
+
+def unpack(packed):
+  coords, flags, starts, closed, quad = packed;
+  n = len(flags);
+  xy = struct.unpack("%dd" % (2*n), bytes(coords));
+  st = struct.unpack("%di" % (len(starts)//4), bytes(starts));
+  cntrs = [];
+  for j in range(len(st)-1):
+    cntrs.append([(xy[2*i],xy[2*i+1],(bytearray(flags)[i]&1)!=0) for i in range(st[j],st[j+1])]);
+  return cntrs;
+
+def same(a,b):
+  if len(a)!=len(b):
+    return False;
+  for ca, cb in zip(a,b):
+    if len(ca)!=len(cb):
+      return False;
+    for pa, pb in zip(ca,cb):
+      if abs(pa[0]-pb[0])>.001 or abs(pa[1]-pb[1])>.001 or pa[2]!=pb[2]:
+        return False;
+  return True;
+
+for fontname in ("fonts/Ambrosia.sfd", "fonts/QuadOverlapBugs.sfd"):
+  font = fontforge.open(fontname);
+  scratch = font.createChar(-1,"packedscratch");
+  for g in font.glyphs():
+    if g is scratch:
+      continue;
+    fore = g.foreground;
+    packed = g.getPackedLayer();
+    if packed[4]!=fore.is_quadratic:
+      raise ValueError("Packed layer order differs in " + g.glyphname);
+    if not same(unpack(packed),points(fore)):
+      raise ValueError("Packed layer differs from the contours of " + g.glyphname);
+    if list(bytearray(packed[3]))!=[int(c.closed) for c in fore]:
+      raise ValueError("Packed closed flags differ in " + g.glyphname);
+    if not same(unpack(g.getPackedLayer("Fore")),points(fore)):
+      raise ValueError("Packed layer by name differs in " + g.glyphname);
+
+    scratch.foreground = fore;
+    expected = points(scratch.foreground);
+    scratch.clear();
+    scratch.setPackedLayer(*packed);
+    if not same(points(scratch.foreground),expected):
+      raise ValueError("Layer changed going through a packed layer in " + g.glyphname);
+  font.close();
+
+# Bad input is rejected
+font = fontforge.font();
+g = font.createChar(65);
+try:
+  g.setPackedLayer(bytearray(16),bytearray(3),bytearray(struct.pack("2i",0,3)));
+  raise AssertionError("Mismatched coordinates accepted");
+except ValueError:
+  pass;
+g.setPackedLayer(bytearray(struct.pack("4d",0,0,100,100)),bytearray([1,1]),
+	bytearray(struct.pack("2i",0,2)),bytearray([0]));
+if points(g.foreground)!=[[(0,0,True),(100,100,True)]] or g.foreground[0].closed:
+  raise ValueError("Open contour set from a packed layer is wrong");
+
+# The arrays need not be aligned, a slice one byte into a buffer will do
+coords = bytearray(b"\0" + struct.pack("6d",0,0,100,0,50,100));
+starts = bytearray(b"\0" + struct.pack("2i",0,3));
+g.setPackedLayer(memoryview(coords)[1:],bytearray([1,1,1]),memoryview(starts)[1:]);
+if points(g.foreground)!=[[(0,0,True),(100,0,True),(50,100,True)]] or not g.foreground[0].closed:
+  raise ValueError("Unaligned packed layer is wrong");
@@ -0,0 +1,68 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd fonts/AmbrosiaBold.sfd fonts/AmbrosiaItalic.sfd fonts/Caliban.sfd
+
+# Opening, cleaning up and generating fonts let go of the interpreter lock so
+# that other threads may work on other fonts. Check that doing this for
+# several fonts at once gives the same files as doing them one after another
+
+import fontforge, threading;
+
+names = ["Ambrosia", "AmbrosiaBold", "AmbrosiaItalic", "Caliban"];
+formats = ["ttf", "otf"];
+
+def work(name,tag):
+  font = fontforge.open("fonts/%s.sfd" % name);
+  font.selection.all();
+  font.removeOverlap();
+  font.autoHint();
+  font.validate(1);
+  for fmt in formats:
+    font.generate("results/%s-%s.%s" % (name,tag,fmt));
+  font.close();
+
+failed = [];
+def threadwork(name,tag):
+  try:
+    work(name,tag);
+  except:
+    failed.append(name);
+    raise;
+
+def contents(name,tag,fmt):
+  f = open("results/%s-%s.%s" % (name,tag,fmt),"rb");
+  data = f.read();
+  f.close();
+  return data;
+
+# A font file which is already open is not read again, so each thread at any
+# one time gets a different font. The threads go first so that the name and
+# lookup tables which are built on first use are built while they race
+for i in range(3):
+  threads = [];
+  for name in names:
+    t = threading.Thread(target=threadwork,args=(name,"thread%d" % i));
+    threads.append(t);
+    t.start();
+  for t in threads:
+    t.join();
+if failed:
+  raise ValueError("Working on %s failed on a thread" % failed);
+
+for name in names:
+  work(name,"serial");
+
+# The name and head tables hold the time the font was made, so compare the
+# glyph outlines of the otf files and the sizes of the ttf files
+for name in names:
+  for i in range(3):
+    tag = "thread%d" % i;
+    serial = fontforge.open("results/%s-serial.otf" % name);
+    threaded = fontforge.open("results/%s-%s.otf" % (name,tag));
+    for glyph in serial.glyphs():
+      other = threaded[glyph.glyphname];
+      if [list(c) for c in glyph.foreground] != [list(c) for c in other.foreground]:
+        raise ValueError("Outlines of %s differ in %s generated on a thread" % (glyph.glyphname,name));
+    serial.close();
+    threaded.close();
+    if len(contents(name,"serial","ttf"))!=len(contents(name,tag,"ttf")):
+      raise ValueError("%s generated as truetype on a thread differs in size" % name);
@@ -0,0 +1,33 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd fonts/Caliban.sfd
+
+# Small objects are allocated from slabs which are given back when nothing in
+# them is in use. Check that opening fonts uses them, and that closing the
+# fonts gives (most of) them back
+
+import fontforge;
+
+def usage():
+  inuse = reserved = 0;
+  for size, used, slabs in fontforge.memoryUsage():
+    if used<0 or used>slabs:
+      raise ValueError("Chunks of size %d: %d bytes in use but only %d reserved" % (size,used,slabs));
+    inuse += used;
+    reserved += slabs;
+  return inuse, reserved;
+
+before = usage();
+fonts = [fontforge.open("fonts/Ambrosia.sfd"), fontforge.open("fonts/Caliban.sfd")];
+for font in fonts:
+  font.selection.all();
+  font.removeOverlap();
+during = usage();
+if during[0]<=before[0]:
+  raise ValueError("Opening fonts did not allocate anything");
+for font in fonts:
+  font.close();
+after = usage();
+if after[0]>=during[0]:
+  raise ValueError("Closing fonts did not free anything");
+if after[1]>=during[1]:
+  raise ValueError("Closing fonts did not give any slabs back");
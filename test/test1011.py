@@ -0,0 +1,58 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd fonts/Caliban.sfd
+
+# Opening an sfd file with flag 0x40 reads its glyphs into an arena of their
+# own, freed all at once when the font is closed. Check that such a font looks
+# the same as one read normally, that glyphs copied out of it survive its
+# closing, and that closing it gives its memory back
+
+import fontforge;
+
+def usage():
+  inuse = reserved = 0;
+  for size, used, slabs in fontforge.memoryUsage():
+    inuse += used;
+    reserved += slabs;
+  return inuse, reserved;
+
+def outlines(font):
+  return dict([(glyph.glyphname, [list(c) for c in glyph.foreground]) for glyph in font.glyphs()]);
+
+plain = fontforge.open("fonts/Ambrosia.sfd");
+expected = outlines(plain);
+plain.close();
+
+font = fontforge.open("fonts/Ambrosia.sfd",0x40);
+if outlines(font)!=expected:
+  raise ValueError("A font read into an arena has different outlines");
+
+# Change some glyphs, so chunks go back to the arena and are reused
+font.selection.all();
+font.removeOverlap();
+font.round();
+
+# And copy them to another font before closing this one
+other = fontforge.open("fonts/Caliban.sfd");
+font.selection.select("A","B","C");
+font.copy();
+other.selection.select("A","B","C");
+other.paste();
+copied = [[list(c) for c in font[name].foreground] for name in ("A","B","C")];
+font.generate("results/Ambrosia-arena.sfd");
+during = usage();
+font.close();
+after = usage();
+if after[0]>=during[0] or after[1]>=during[1]:
+  raise ValueError("Closing a font read into an arena did not free it");
+
+if [[list(c) for c in other[name].foreground] for name in ("A","B","C")]!=copied:
+  raise ValueError("Glyphs copied out of an arena changed when its font was closed");
+other.close();
+
+plain = fontforge.open("results/Ambrosia-arena.sfd");
+expected = outlines(plain);
+plain.close();
+reread = fontforge.open("results/Ambrosia-arena.sfd",0x40);
+if outlines(reread)!=expected:
+  raise ValueError("A font saved from an arena reads back differently into one");
+reread.close();
@@ -0,0 +1,58 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd fonts/feta20.pfb
+
+# Fonts compressed with gzip or bzip2 are decompressed in memory (when zlib
+# and libbz2 can be found) rather than by running gunzip or bunzip2. Check
+# that they read the same as the uncompressed fonts, and that saving a
+# compressed sfd writes it compressed again
+
+import fontforge, gzip, bz2, shutil;
+
+def outlines(font):
+  return dict([(glyph.glyphname, [list(c) for c in glyph.foreground]) for glyph in font.glyphs()]);
+
+def compressed(name,ext):
+  f = open("fonts/%s" % name,"rb");
+  data = f.read();
+  f.close();
+  out = "results/%s%s" % (name,ext);
+  if ext==".gz":
+    f = gzip.open(out,"wb");
+  else:
+    f = bz2.BZ2File(out,"wb");
+  f.write(data);
+  f.close();
+  return out;
+
+for name in ["Ambrosia.sfd", "feta20.pfb"]:
+  plain = fontforge.open("fonts/%s" % name);
+  expected = outlines(plain);
+  plain.close();
+  for ext in [".gz", ".bz2"]:
+    font = fontforge.open(compressed(name,ext));
+    if outlines(font)!=expected:
+      raise ValueError("%s compressed with %s reads differently" % (name,ext));
+    font.close();
+
+# Saving writes the font back out compressed as it was
+for ext in [".gz", ".bz2"]:
+  font = fontforge.open(compressed("Ambrosia.sfd",ext));
+  font.selection.all();
+  font.round();
+  font.save();
+  font.save("results/Ambrosia-plain.sfd");
+  font.close();
+  plain = fontforge.open("results/Ambrosia-plain.sfd");
+  expected = outlines(plain);
+  plain.close();
+  if ext==".gz":
+    f = gzip.open("results/Ambrosia.sfd.gz","rb");
+  else:
+    f = bz2.BZ2File("results/Ambrosia.sfd.bz2","rb");
+  if f.read(10)!="SplineFont":
+    raise ValueError("A font read from an sfd%s file was not saved as one" % ext);
+  f.close();
+  font = fontforge.open("results/Ambrosia.sfd%s" % ext);
+  if outlines(font)!=expected:
+    raise ValueError("A font saved as sfd%s reads back differently" % ext);
+  font.close();
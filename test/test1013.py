@@ -0,0 +1,80 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd fonts/Caliban.sfd
+
+# Glyphs are converted to charstrings and quadratic outlines on as many
+# threads as the ThreadCount preference says. Check that the fonts generated
+# are the same, byte for byte, on one thread and on several
+
+import fontforge, struct, binascii, re;
+
+# The head, name and FFTM tables hold the time the font was made, compare
+# everything else
+def tables(filename):
+  f = open(filename,"rb");
+  data = f.read();
+  f.close();
+  numTables = struct.unpack(">H",data[4:6])[0];
+  ret = {};
+  for i in range(numTables):
+    tag, checksum, offset, length = struct.unpack(">4sLLL",data[12+16*i:28+16*i]);
+    if tag not in [b"head", b"name", b"FFTM"]:
+      ret[tag] = data[offset:offset+length];
+  return ret;
+
+def decrypt(data,r):
+  plain = [];
+  for cypher in bytearray(data):
+    plain.append(cypher ^ (r>>8));
+    r = ((cypher + r)*52845 + 22719) & 0xffff;
+  return bytearray(plain[4:]);
+
+# A type1 font has a %%CreationDate comment, and its private dictionary and
+# each charstring are encrypted starting with four bytes which change every
+# time
+def type1(filename):
+  f = open(filename,"rb");
+  lines = [l for l in f.readlines() if not l.startswith(b"%%CreationDate")];
+  f.close();
+  for i in range(len(lines)):
+    if lines[i].startswith(b"currentfile eexec"):
+      break;
+  clear = lines[:i+1];
+  encrypted = [];
+  for l in lines[i+1:]:
+    if l.startswith(b"0000"):		# The zeros and cleartomark at the end
+      break;
+    encrypted.append(l.strip());
+  private = decrypt(binascii.unhexlify(b"".join(encrypted)),55665);
+  charstrings = [];
+  pos = 0;
+  while True:
+    match = re.compile(b"([0-9]+) (RD|-[|]) ").search(private,pos);
+    if match is None:
+      break;
+    pos = match.end();
+    end = pos+int(match.group(1));
+    charstrings.append(private[pos:end]);
+    del private[pos:end];
+  return clear, private, [decrypt(c,4330) for c in charstrings];
+
+def generate(name,threads):
+  fontforge.setPrefs("ThreadCount",threads);
+  font = fontforge.open("fonts/%s.sfd" % name);
+  font.uniqueid = 4012345;		# Or we make up a random one for the type1 font
+  # Give the flags every time, or we get those used last
+  for fmt in ["otf", "ttf", "pfa"]:
+    font.generate("results/%s-%d.%s" % (name,threads,fmt),flags=());
+  font.generate("results/%s-%d-nohints.otf" % (name,threads),flags=("no-hints",));
+  font.close();
+
+for name in ["Ambrosia", "Caliban"]:
+  generate(name,1);
+  generate(name,4);
+  for fmt in ["otf", "ttf", "-nohints.otf"]:
+    if fmt[0]!='-':
+      fmt = "." + fmt;
+    if tables("results/%s-1%s" % (name,fmt))!=tables("results/%s-4%s" % (name,fmt)):
+      raise ValueError("%s%s generated on several threads differs" % (name,fmt));
+  if type1("results/%s-1.pfa" % name)!=type1("results/%s-4.pfa" % name):
+    raise ValueError("%s.pfa generated on several threads differs" % name);
+fontforge.setPrefs("ThreadCount",0);
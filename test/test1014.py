@@ -0,0 +1,39 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd fonts/Shaping.fea
+
+# Many strings can be shaped with one set of lookups. Check what python's
+# font.shapeStrings gives for plain and unicode strings and feature tags
+
+import fontforge;
+
+font = fontforge.open("fonts/Ambrosia.sfd");
+font.mergeFeature("fonts/Shaping.fea");
+
+res = font.shapeStrings(["fie", "To", "AVA", u"L\u2019a", ""],
+	("liga", u"ss01", "kern"), "DFLT");
+if len(res)!=5:
+  raise ValueError("Wrong number of shaped strings");
+if [g[0] for g in res[0]]!=["fi", "eacute"] or res[0][0][3]!=0:
+  raise ValueError("Bad substitutions in fie");
+if res[1][0][0]!="T" or res[1][0][3]!=-80 or res[1][1][3]!=0:
+  raise ValueError("Bad class kerning in To");
+if [g[3] for g in res[2]]!=[0, -40, 0]:
+  raise ValueError("Bad class kerning in AVA");
+if res[3][0][3]!=-100 or res[3][2][0]!="aacute":
+  raise ValueError("Bad pair kerning");
+if res[4]!=():
+  raise ValueError("An empty string produced glyphs");
+
+# Only the features asked for are applied
+res = font.shapeStrings(("fie",), ["kern"]);
+if [g[0] for g in res[0]]!=["f", "i", "e"]:
+  raise ValueError("Unrequested substitutions applied");
+
+for strs, feats in [ ([1], ["kern"]), (["fie"], [1]) ]:
+  try:
+    font.shapeStrings(strs,feats);
+  except TypeError:
+    pass;
+  else:
+    raise ValueError("No error for something which isn't a string");
+font.close();
@@ -0,0 +1,83 @@
+#!/usr/local/bin/fontforge
+#Needs: fonts/Ambrosia.sfd ../cidmap/Adobe-Japan1-6.cidmap
+
+# A cidmap file is parsed once and then kept in ~/.FontForge/cidcache. Each
+# run below is a separate fontforge (the maps are only read once a process)
+# with HOME in a scratch directory: one with no cache, one which finds it,
+# and one whose cache has been damaged. All must make the same font, and a
+# damaged cache must be ignored (and replaced)
+
+import fontforge, os, shutil, subprocess;
+
+if os.path.exists("/proc/self/exe"):
+  fontforge_exe = os.readlink("/proc/self/exe");
+else:
+  fontforge_exe = "fontforge";
+
+scratch = os.path.abspath("results/cidcache");
+home = os.path.join(scratch,"home");
+os.makedirs(home);
+# The cidmap is looked for in the current directory first
+shutil.copy("../cidmap/Adobe-Japan1-6.cidmap",scratch);
+cachedir = os.path.join(home,".FontForge","cidcache");
+ambrosia = os.path.abspath("fonts/Ambrosia.sfd");
+
+def flatten(name):
+  out = os.path.join(scratch,name + ".sfd");
+  env = dict(os.environ);
+  env["HOME"] = home;
+  script = 'Open("%s"); ConvertToCID("Adobe","Japan1",6); CIDFlatten(); Save("%s")' % (ambrosia,out);
+  if subprocess.call([fontforge_exe,"-lang=ff","-c",script],cwd=scratch,env=env)!=0:
+    raise ValueError("Flattening a CID font failed (%s cache)" % name);
+  # The times the font was made and changed won't match
+  f = open(out,"rb");
+  lines = [l for l in f.readlines() if not l.startswith(b"CreationTime:") and not l.startswith(b"ModificationTime:")];
+  f.close();
+  return lines;
+
+def cachefile():
+  files = os.listdir(cachedir);
+  if len(files)!=1 or not files[0].startswith("Adobe-Japan1-6.cidmap-"):
+    raise ValueError("Expected one cidmap cache, found %s" % files);
+  return os.path.join(cachedir,files[0]);
+
+cold = flatten("cold");
+cache = cachefile();
+written = os.stat(cache);
+f = open(cache,"rb");
+original = f.read();
+f.close();
+
+def restored(how):
+  f = open(cache,"rb");
+  data = f.read();
+  f.close();
+  if data!=original:
+    raise ValueError("The %s cidmap cache was not replaced" % how);
+
+warm = flatten("warm");
+if warm!=cold:
+  raise ValueError("Flattening with the cidmap cache gave a different font");
+if os.stat(cache).st_ino!=written.st_ino:
+  raise ValueError("The cidmap cache was not used");
+
+# Cut the cache short
+f = open(cache,"r+b");
+f.truncate(written.st_size//2);
+f.close();
+truncated = flatten("truncated");
+if truncated!=cold:
+  raise ValueError("Flattening with a truncated cidmap cache gave a different font");
+restored("truncated");
+
+# Keep the header, fill the rest with rubbish
+f = open(cache,"r+b");
+f.seek(56);
+f.write(b"\xff\x7f\x00\x80" * ((written.st_size-56)//4));
+f.close();
+garbage = flatten("garbage");
+if garbage!=cold:
+  raise ValueError("Flattening with a damaged cidmap cache gave a different font");
+restored("damaged");
+
+shutil.rmtree(scratch);